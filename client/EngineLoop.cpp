@@ -83,7 +83,7 @@ void EngineLoop::Run()
     Timer timer;
     f32 targetDelta = 1.0f / 30.0f;
 
-    _clientRenderer = new ClientRenderer();
+    _clientRenderer = new ClientRenderer(&_updateFramework.taskflow);
 
     _network.client->Connect("127.0.0.1", 3724);
 
@@ -114,6 +114,9 @@ void EngineLoop::Run()
     }
 
     // Clean up stuff here
+    // The renderer was created on this thread, so it gets torn down here too instead of waiting for our destructor
+    delete _clientRenderer;
+    _clientRenderer = nullptr;
 
     Message exitMessage;
     exitMessage.code = MSG_OUT_EXIT_CONFIRM;
@@ -90,6 +90,6 @@ private:
     moodycamel::ConcurrentQueue<Message> _outputQueue;
     FrameworkRegistryPair _updateFramework;
 
-    ClientRenderer* _clientRenderer;
+    ClientRenderer* _clientRenderer = nullptr;
     NetworkPair _network;
 };
\ No newline at end of file
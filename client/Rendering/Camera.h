@@ -12,6 +12,7 @@ public:
     void Update(f32 deltaTime);
 
     mat4x4& GetViewMatrix() { return _viewMatrix; }
+    const vec3& GetPosition() { return _position; }
 
 private:
     void Rotate(f32 amount, const vec3& axis);
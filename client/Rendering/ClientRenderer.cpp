@@ -6,16 +6,36 @@
 #include <Renderer/Renderer.h>
 #include <Renderer/Renderers/Vulkan/RendererVK.h>
 #include <Window/Window.h>
+#include <Utils/DebugHandler.h>
 #include <InputManager.h>
 #include <GLFW/glfw3.h>
+#include <taskflow/taskflow.hpp>
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 const int WIDTH = 1920;
 const int HEIGHT = 1080;
 const size_t FRAME_ALLOCATOR_SIZE = 8 * 1024 * 1024; // 8 MB
+const size_t RENDER_GRAPH_ALLOCATOR_SIZE = 64 * 1024; // 64 KB
+const size_t MAX_INSTANCES = 16384; // Has to match MAX_INSTANCES in test.vert
+const size_t INSTANCE_COLORS_OFFSET = MAX_INSTANCES * sizeof(InstanceTransform);
+const size_t GPU_CULLING_THRESHOLD = 4096; // Scenes with at least this many instances get culled on the GPU
+const u32 CULLING_GROUP_SIZE = 64; // Has to match local_size_x in cull.comp
+const i32 HIZ_SIZE = 1024; // The Hi-Z pyramid is a power of two so every mip halves exactly, its first mip covers 2x2 texels of _mainDepth
+const u32 HIZ_MIP_LEVELS = 11; // Down to 1x1
+const u32 HIZ_GROUP_SIZE = 8; // Has to match local_size_x and local_size_y in hiz_depth.comp and hiz_downsample.comp
+const f32 OCCLUDER_MIN_SIZE = 2.0f; // Instances at least this big along a world axis get drawn into the depth prepass, smaller ones hide too little to be worth it
+const f32 FAR_CLIP = 100.0f;
+const u32 STRESS_SCENE_SIZE = 24; // The stress scene is a grid of this many cubes along each axis
+const f32 STRESS_SCENE_SPACING = 3.0f;
 u32 MAIN_RENDER_LAYER = "MainLayer"_h; // _h will compiletime hash the string into a u32
 
+static_assert(HIZ_SIZE * 2 >= WIDTH && HIZ_SIZE * 2 >= HEIGHT, "The Hi-Z pyramid has to cover all of _mainDepth");
+static_assert(STRESS_SCENE_SIZE * STRESS_SCENE_SIZE * STRESS_SCENE_SIZE >= GPU_CULLING_THRESHOLD, "The stress scene is there to take the GPU culling path");
+static_assert(STRESS_SCENE_SIZE * STRESS_SCENE_SIZE * STRESS_SCENE_SIZE < MAX_INSTANCES, "The stress scene has to fit in the instance buffer next to the rest of the scene");
+static_assert(Renderer::MODEL_MAX_LODS == 4, "CullingConstantBuffer::lodScreenSizes only has room for the thresholds of four LODs");
+
 void key_callback(GLFWwindow* window, i32 key, i32 scancode, i32 action, i32 modifiers)
 {
     Window* userWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
@@ -32,7 +52,26 @@ void cursor_position_callback(GLFWwindow* window, f64 x, f64 y)
     ServiceLocator::GetInputManager()->MousePositionHandler(userWindow, static_cast<f32>(x), static_cast<f32>(y));
 }
 
-ClientRenderer::ClientRenderer()
+// Same test as cull.comp, occluders get drawn into the depth prepass at LOD 0 so they have to stay on LOD 0 in the main pass too
+bool IsOccluder(const Renderer::AABB& localBounds, const mat4x4& modelMatrix)
+{
+    vec3 localExtents = (localBounds.max - localBounds.min) * 0.5f;
+    vec3 extents = glm::abs(vec3(modelMatrix[0])) * localExtents.x + glm::abs(vec3(modelMatrix[1])) * localExtents.y + glm::abs(vec3(modelMatrix[2])) * localExtents.z;
+
+    return glm::max(extents.x, glm::max(extents.y, extents.z)) * 2.0f >= OCCLUDER_MIN_SIZE;
+}
+
+void PackInstance(const Renderer::InstanceData& instance, InstanceTransform& transform, u32& color)
+{
+    mat4x4 transposed = glm::transpose(instance.modelMatrix);
+    transform.rows[0] = transposed[0];
+    transform.rows[1] = transposed[1];
+    transform.rows[2] = transposed[2];
+
+    color = glm::packUnorm4x8(instance.colorMultiplier);
+}
+
+ClientRenderer::ClientRenderer(tf::Taskflow* taskflow)
 {
     _camera = new Camera(vec3(0, 0, -10));
     _window = new Window();
@@ -50,11 +89,33 @@ ClientRenderer::ClientRenderer()
     glfwSetCursorPosCallback(_window->GetWindow(), cursor_position_callback);
 
 
-    _renderer = new Renderer::RendererVK();
+    _renderer = new Renderer::RendererVK(taskflow);
     _renderer->InitWindow(_window);
 
+    // Used by the rendergraph to record its passes in parallel and by the frustum culling
+    // It shares the workers of taskflow, so every taskflow in the engine runs on the same threads
+    _renderTaskflow = new tf::Taskflow(taskflow->share_executor());
+
+    _inputManager->RegisterKeybind("Log Memory Stats", GLFW_KEY_F3, KEYBIND_ACTION_PRESS, KEYBIND_MOD_ANY, std::bind(&ClientRenderer::OnLogMemoryStats, this, std::placeholders::_1, std::placeholders::_2));
+    _inputManager->RegisterKeybind("Toggle GPU Culling", GLFW_KEY_F4, KEYBIND_ACTION_PRESS, KEYBIND_MOD_ANY, std::bind(&ClientRenderer::OnToggleGPUCulling, this, std::placeholders::_1, std::placeholders::_2));
+    _inputManager->RegisterKeybind("Toggle Stress Scene", GLFW_KEY_F5, KEYBIND_ACTION_PRESS, KEYBIND_MOD_ANY, std::bind(&ClientRenderer::OnToggleStressScene, this, std::placeholders::_1, std::placeholders::_2));
+
     CreatePermanentResources();
-    _uiRenderer = new UIRenderer(_renderer);
+    CreatePipelines();
+    CreateScene();
+    _uiRenderer = new UIRenderer(_renderer, _mainColor);
+    CreateRenderGraph();
+
+    // Wait for the pipelines registered by us and our sub renderers to finish compiling
+    _renderer->WaitForPipelines();
+}
+
+ClientRenderer::~ClientRenderer()
+{
+    // Waits for the GPU and tears down the device, which is also what writes the pipeline cache for the next launch
+    _renderer->Deinit();
+
+    delete _renderTaskflow;
 }
 
 bool ClientRenderer::UpdateWindow(f32 deltaTime)
@@ -70,151 +131,574 @@ void ClientRenderer::Update(f32 deltaTime)
     // Update the camera movement
     _camera->Update(deltaTime);
     
-    // Update the view matrix to match the new camera position
-    
+    // Update the view matrix to match the new camera position, it gets applied when the main pass uses it
     _viewConstantBuffer->resource.viewMatrix = _camera->GetViewMatrix();
-    _viewConstantBuffer->Apply(_frameIndex);
 
-    // Register models to be rendered TODO: Push this to the ECS later
-    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
-    mainLayer.Reset(); // Reset the layer first so we don't just infinitely grow our layer
-    mainLayer.RegisterModel(_cubeModel, &_cubeModelInstance);
+    // The main layer keeps its renderables across frames, only what changed gets copied into the instance data
+    UpdateInstanceData();
+
+    // Only the instances inside the view frustum get drawn
+    CullInstances();
 
     _uiRenderer->Update(deltaTime);
 }
 
+void ClientRenderer::OnLogMemoryStats(Window* window, std::shared_ptr<Keybind> keybind)
+{
+    _renderer->LogMemoryStats();
+}
+
+void ClientRenderer::OnToggleGPUCulling(Window* window, std::shared_ptr<Keybind> keybind)
+{
+    // CullInstances picks this up next frame, so small scenes can take the GPU culling path too
+    _forceGPUCulling = !_forceGPUCulling;
+    NC_LOG_MESSAGE("GPU culling %s", _forceGPUCulling ? "forced on" : "back to automatic");
+}
+
+void ClientRenderer::OnToggleStressScene(Window* window, std::shared_ptr<Keybind> keybind)
+{
+    if (_stressRenderables.empty())
+    {
+        AddStressScene();
+    }
+    else
+    {
+        RemoveStressScene();
+    }
+}
+
 void ClientRenderer::Render()
 {
-    // Create rendergraph
+    // The rendergraph only gets compiled again if it has been invalidated and its passes declare something different, otherwise this just runs the execute functions
+    _renderGraph->Setup();
+    _renderGraph->Execute();
+    
+    _renderer->Present(_window, _mainColor);
+}
+
+void ClientRenderer::CreateRenderGraph()
+{
+    // Create rendergraph, we keep it across frames so it only gets compiled once
     Renderer::RenderGraphDesc renderGraphDesc;
-    renderGraphDesc.allocator = _frameAllocator; // We need to give our rendergraph an allocator to use
-    Renderer::RenderGraph renderGraph = _renderer->CreateRenderGraph(renderGraphDesc);
+    renderGraphDesc.allocator = _renderGraphAllocator; // The passes live in here
+    renderGraphDesc.frameAllocator = _frameAllocator; // Everything each Execute needs gets allocated from here
+    renderGraphDesc.taskflow = _renderTaskflow; // The passes get recorded in parallel on this taskflow
+    _renderGraph = _renderer->CreatePersistentRenderGraph(renderGraphDesc);
     
+    // Depth Prepass
+    {
+        struct DepthPrepassData
+        {
+            Renderer::RenderPassMutableResource mainDepth;
+        };
+
+        _renderGraph->AddPass<DepthPrepassData>("Depth Prepass",
+            [&](DepthPrepassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+            {
+                // The occluders are only needed for the occlusion test of the GPU culling
+                if (!_useGPUCulling)
+                    return false;
+
+                data.mainDepth = builder.Write(_mainDepth, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_CLEAR);
+
+                return true;
+            },
+            [&](DepthPrepassData& data, Renderer::CommandList& commandList) // Execute
+            {
+                commandList.BeginPipeline(_occluderPipeline);
+
+                u32 viewOffset = _viewConstantBuffer->Apply();
+                commandList.SetConstantBuffer(0, _viewConstantBuffer->GetGPUResource(), viewOffset);
+                commandList.SetStorageBuffer(1, _instanceBuffer);
+
+                // The occluder buffer takes the place of the visible instance buffer, the occluders are drawn without any culling
+                // They are drawn at LOD 0 and the culling pass keeps them there, so the main pass draws the same surface on top of this depth
+                commandList.SetStorageBuffer(3, _occluderBuffer);
+
+                Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+                const std::vector<Renderer::ModelBatch>& batches = mainLayer.GetBatches();
+
+                for (size_t i = 0; i < batches.size(); i++)
+                {
+                    if (_numOccluders[i] == 0)
+                        continue;
+
+                    commandList.DrawInstanced(batches[i].model, _numOccluders[i], _batchOffsets[i]);
+                }
+                commandList.EndPipeline(_occluderPipeline);
+            });
+    }
+
+    // Hi-Z Pass
+    {
+        struct HiZPassData
+        {
+            Renderer::RenderPassResource mainDepth;
+            Renderer::RenderPassMutableResource hiZ;
+        };
+
+        _renderGraph->AddPass<HiZPassData>("Hi-Z Pass",
+            [&](HiZPassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+            {
+                if (!_useGPUCulling)
+                    return false;
+
+                data.mainDepth = builder.Read(_mainDepth, Renderer::RenderGraphBuilder::ShaderStage::SHADER_STAGE_COMPUTE);
+                data.hiZ = builder.Write(_hiZ, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_UAV, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_DISCARD);
+
+                return true;
+            },
+            [&](HiZPassData& data, Renderer::CommandList& commandList) // Execute
+            {
+                // The first mip gets reduced from the depth of the occluders, every mip after it from the one before
+                HiZPushConstants pushConstants;
+                pushConstants.srcSize = ivec2(WIDTH, HEIGHT);
+                pushConstants.dstSize = ivec2(HIZ_SIZE, HIZ_SIZE);
+
+                commandList.SetPipeline(_hiZDepthPipeline);
+                commandList.SetSampledImage(0, _mainDepth);
+                commandList.SetStorageImage(1, _hiZ, 0);
+                commandList.PushConstant(&pushConstants, 0, sizeof(pushConstants));
+                commandList.Dispatch((HIZ_SIZE + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (HIZ_SIZE + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE);
+
+                commandList.SetPipeline(_hiZDownsamplePipeline);
+                for (u32 mip = 1; mip < HIZ_MIP_LEVELS; mip++)
+                {
+                    commandList.UAVBarrier(_hiZ);
+
+                    pushConstants.srcSize = pushConstants.dstSize;
+                    pushConstants.dstSize = pushConstants.srcSize / 2;
+
+                    commandList.SetStorageImage(0, _hiZ, mip - 1);
+                    commandList.SetStorageImage(1, _hiZ, mip);
+                    commandList.PushConstant(&pushConstants, 0, sizeof(pushConstants));
+                    commandList.Dispatch((pushConstants.dstSize.x + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (pushConstants.dstSize.y + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE);
+                }
+            });
+    }
+
+    // Culling Pass
+    {
+        struct CullingPassData
+        {
+            Renderer::RenderPassResource hiZ;
+            Renderer::RenderPassMutableResource drawArguments;
+            Renderer::RenderPassMutableResource visibleInstances;
+            Renderer::RenderPassMutableResource instanceLODs;
+        };
+
+        _renderGraph->AddPass<CullingPassData>("Culling Pass",
+            [&](CullingPassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+            {
+                // Small scenes are culled on the CPU
+                if (!_useGPUCulling)
+                    return false;
+
+                data.hiZ = builder.Read(_hiZ, Renderer::RenderGraphBuilder::ShaderStage::SHADER_STAGE_COMPUTE);
+                data.drawArguments = builder.Write(_drawArgumentBuffer, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_UAV, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+                data.visibleInstances = builder.Write(_gpuVisibleInstanceBuffer, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_UAV, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_DISCARD);
+                data.instanceLODs = builder.Write(_instanceLODBuffer, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_UAV, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+
+                return true;
+            },
+            [&](CullingPassData& data, Renderer::CommandList& commandList) // Execute
+            {
+                commandList.SetPipeline(_cullingPipeline);
+
+                u32 cullingOffset = _cullingConstantBuffer->Apply();
+                commandList.SetConstantBuffer(0, _cullingConstantBuffer->GetGPUResource(), cullingOffset);
+                commandList.SetStorageBuffer(1, _instanceBuffer);
+                commandList.SetStorageBuffer(2, _drawArgumentBuffer);
+                commandList.SetStorageBuffer(3, _gpuVisibleInstanceBuffer);
+                commandList.SetSampledImage(4, _hiZ);
+                commandList.SetStorageBuffer(5, _instanceLODBuffer);
+
+                // One dispatch per batch, every thread appends its instance to the draw of its LOD if it is visible
+                Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+                const std::vector<Renderer::ModelBatch>& batches = mainLayer.GetBatches();
+
+                for (u32 i = 0; i < batches.size(); i++)
+                {
+                    const Renderer::ModelBatch& batch = batches[i];
+                    u32 numInstances = static_cast<u32>(batch.instances.size());
+                    if (numInstances == 0)
+                        continue;
+
+                    const Renderer::AABB& bounds = _renderer->GetModelBounds(batch.model);
+
+                    CullingPushConstants pushConstants;
+                    pushConstants.boundsCenter = vec4((bounds.min + bounds.max) * 0.5f, 0.0f);
+                    pushConstants.boundsExtents = vec4((bounds.max - bounds.min) * 0.5f, 0.0f);
+                    pushConstants.firstInstance = _batchOffsets[i];
+                    pushConstants.numInstances = numInstances;
+                    pushConstants.drawIndex = _batchDrawSlots[i] * Renderer::MODEL_MAX_LODS;
+                    pushConstants.numLODs = _batchNumLODs[i];
+                    commandList.PushConstant(&pushConstants, 0, sizeof(pushConstants));
+
+                    commandList.Dispatch((numInstances + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE);
+                }
+            });
+    }
+
     // Main Pass
     {
         struct MainPassData
         {
             Renderer::RenderPassMutableResource mainColor;
+            Renderer::RenderPassMutableResource mainDepth;
             Renderer::RenderPassResource cubeTexture;
         };
 
-        renderGraph.AddPass<MainPassData>("Main Pass",
+        _renderGraph->AddPass<MainPassData>("Main Pass",
             [&](MainPassData& data, Renderer::RenderGraphBuilder& builder) // Setup
             {
                 data.mainColor = builder.Write(_mainColor, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_CLEAR);
+
+                // The occluders are already in there if the depth prepass ran
+                Renderer::RenderGraphBuilder::LoadMode depthLoadMode = _useGPUCulling ? Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD : Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_CLEAR;
+                data.mainDepth = builder.Write(_mainDepth, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, depthLoadMode);
                 data.cubeTexture = builder.Read(_cubeTexture, Renderer::RenderGraphBuilder::ShaderStage::SHADER_STAGE_PIXEL);
 
+                if (_useGPUCulling)
+                {
+                    builder.ReadIndirectArguments(_drawArgumentBuffer);
+                    builder.Read(_gpuVisibleInstanceBuffer, Renderer::RenderGraphBuilder::ShaderStage::SHADER_STAGE_VERTEX);
+                }
+
                 return true; // Return true from setup to enable this pass, return false to disable it
             },
             [&](MainPassData& data, Renderer::CommandList& commandList) // Execute
             {
-                Renderer::GraphicsPipelineDesc pipelineDesc;
-                renderGraph.InitializePipelineDesc(pipelineDesc);
-
-                // Shaders
-                Renderer::VertexShaderDesc vertexShaderDesc;
-                vertexShaderDesc.path = "Data/shaders/test.vert.spv";
-                pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
-
-                Renderer::PixelShaderDesc pixelShaderDesc;
-                pixelShaderDesc.path = "Data/shaders/test.frag.spv";
-                pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
-
-                // Constant buffers  TODO: Improve on this, if I set state 0 and 3 it won't work etc...
-                pipelineDesc.states.constantBufferStates[0].enabled = true; // ViewCB
-                pipelineDesc.states.constantBufferStates[0].shaderVisibility = Renderer::ShaderVisibility::SHADER_VISIBILITY_VERTEX;
-                pipelineDesc.states.constantBufferStates[1].enabled = true; // ModelCB
-                pipelineDesc.states.constantBufferStates[1].shaderVisibility = Renderer::ShaderVisibility::SHADER_VISIBILITY_VERTEX;
-
-                // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
-                pipelineDesc.states.inputLayouts[0].enabled = true;
-                pipelineDesc.states.inputLayouts[0].SetName("POSITION");
-                pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
-                pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-                pipelineDesc.states.inputLayouts[1].enabled = true;
-                pipelineDesc.states.inputLayouts[1].SetName("NORMAL");
-                pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
-                pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-                pipelineDesc.states.inputLayouts[2].enabled = true;
-                pipelineDesc.states.inputLayouts[2].SetName("TEXCOORD");
-                pipelineDesc.states.inputLayouts[2].format = Renderer::InputFormat::INPUT_FORMAT_R32G32_FLOAT;
-                pipelineDesc.states.inputLayouts[2].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-
-                // Viewport
-                pipelineDesc.states.viewport.topLeftX = 0;
-                pipelineDesc.states.viewport.topLeftY = 0;
-                pipelineDesc.states.viewport.width = static_cast<f32>(WIDTH);
-                pipelineDesc.states.viewport.height = static_cast<f32>(HEIGHT);
-                pipelineDesc.states.viewport.minDepth = 0.0f;
-                pipelineDesc.states.viewport.maxDepth = 1.0f;
-
-                // ScissorRect
-                pipelineDesc.states.scissorRect.left = 0;
-                pipelineDesc.states.scissorRect.right = WIDTH;
-                pipelineDesc.states.scissorRect.top = 0;
-                pipelineDesc.states.scissorRect.bottom = HEIGHT;
-
-                // Rasterizer state
-                pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
-                pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
-
-                // Samplers TODO: We don't care which samplers we have here, we just need the number of samplers
-                pipelineDesc.states.samplers[0].enabled = true;
-
-                // Textures TODO: We don't care which textures we have here, we just need the number of textures
-                pipelineDesc.textures[0] = data.cubeTexture;
-
-                // Render targets
-                pipelineDesc.renderTargets[0] = data.mainColor;
-
-                // Clear mainColor TODO: This should be handled by the parameter in Setup, and it should definitely not act on ImageID and DepthImageID
-                commandList.Clear(_mainColor, Color(0, 0, 0, 1));
-                
                 // Set pipeline
-                Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
-                commandList.BeginPipeline(pipeline);
+                commandList.BeginPipeline(_mainPipeline);
 
                 // Set view constant buffer
-                commandList.SetConstantBuffer(0, _viewConstantBuffer->GetGPUResource(_frameIndex));
+                u32 viewOffset = _viewConstantBuffer->Apply();
+                commandList.SetConstantBuffer(0, _viewConstantBuffer->GetGPUResource(), viewOffset);
+
+                // Set instance buffer
+                commandList.SetStorageBuffer(1, _instanceBuffer);
+
+                // Set visible instance buffer
+                commandList.SetStorageBuffer(3, _useGPUCulling ? _gpuVisibleInstanceBuffer : _visibleInstanceBuffer);
 
                 // Set texture-sampler pair
-                commandList.SetTextureSampler(2, _cubeTexture, _linearSampler);
+                commandList.PushTextureSampler(0, _cubeTexture, _linearSampler);
 
-                // Render main layer
+                // Render main layer in sorted order, the visible instances of a model are packed after each other in the visible instance buffer so they can be drawn in one call
                 Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+                const std::vector<Renderer::ModelBatch>& batches = mainLayer.GetBatches();
+
+                const std::vector<Renderer::DrawPacket>& drawPackets = mainLayer.GetDrawPackets();
 
-                for (auto const& model : mainLayer.GetModels())
+                // The culling pass wrote how many instances of each LOD are visible, so we can't skip anything here
+                // Packets next to each other whose models share geometry buffers are one multi draw, the LODs a model doesn't have draw nothing
+                if (_useGPUCulling)
                 {
-                    auto const& modelID = Renderer::ModelID(model.first);
-                    auto const& instances = model.second;
+                    for (size_t begin = 0; begin < drawPackets.size();)
+                    {
+                        Renderer::ModelID model = batches[drawPackets[begin].batch].model;
+                        u32 geometryBlock = _renderer->GetModelGeometryBlock(model);
+
+                        size_t end = begin + 1;
+                        while (end < drawPackets.size() && _renderer->GetModelGeometryBlock(batches[drawPackets[end].batch].model) == geometryBlock)
+                        {
+                            end++;
+                        }
 
-                    for (auto const& instance : instances)
+                        u32 argumentOffset = static_cast<u32>(begin * Renderer::MODEL_MAX_LODS * sizeof(Renderer::DrawInstancedIndirectArguments));
+                        u32 drawCount = static_cast<u32>((end - begin) * Renderer::MODEL_MAX_LODS);
+                        commandList.DrawInstancedIndirect(model, _drawArgumentBuffer, argumentOffset, drawCount);
+
+                        begin = end;
+                    }
+                }
+                else
+                {
+                    for (const Renderer::DrawPacket& drawPacket : drawPackets)
                     {
-                        // Update model constant buffer
-                        _modelConstantBuffer->resource.modelMatrix = instance->modelMatrix;
-                        _modelConstantBuffer->resource.colorMultiplier = instance->colorMultiplier;
-                        _modelConstantBuffer->Apply(_frameIndex);
+                        const Renderer::ModelBatch& batch = batches[drawPacket.batch];
 
-                        // Set model constant buffer
-                        commandList.SetConstantBuffer(1, _modelConstantBuffer->GetGPUResource(_frameIndex));
+                        for (u32 lod = 0; lod < _batchNumLODs[drawPacket.batch]; lod++)
+                        {
+                            u32 numVisible = _lodSelector.GetNumInstances(drawPacket.batch, lod);
+                            if (numVisible == 0)
+                                continue;
 
-                        // Draw
-                        commandList.Draw(modelID);
+                            // Draw
+                            commandList.DrawInstanced(batch.model, numVisible, _lodSelector.GetFirstInstance(drawPacket.batch, lod), lod);
+                        }
                     }
                 }
-                commandList.EndPipeline(pipeline);
+                commandList.EndPipeline(_mainPipeline);
             });
     }
 
-    _uiRenderer->AddUIPass(&renderGraph, _mainColor, _frameIndex);
+    _uiRenderer->AddUIPass(_renderGraph);
+}
 
-    renderGraph.Setup();
-    renderGraph.Execute();
-    
-    _renderer->Present(_window, _mainColor);
+void ClientRenderer::UpdateInstanceData()
+{
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+    mainLayer.Sort();
+
+    const std::vector<Renderer::ModelBatch>& batches = mainLayer.GetBatches();
+
+    if (mainLayer.HasLayoutChanged())
+    {
+        // Instances were added or removed so the batches after them moved, lay everything out and upload it again
+        u32 numInstances = 0;
+        _batchOffsets.resize(batches.size());
+
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            _batchOffsets[i] = numInstances;
+            numInstances += static_cast<u32>(batches[i].instances.size());
+        }
+        assert(numInstances <= MAX_INSTANCES); // If this hits you need to increase MAX_INSTANCES
+
+        _instanceTransforms.resize(numInstances);
+        _instanceColors.resize(numInstances);
+        _frustumCuller.Resize(numInstances);
+        _lodSelector.Resize(numInstances);
+        _batchNumLODs.resize(batches.size());
+        _occluderInstances.resize(numInstances);
+        _numOccluders.resize(batches.size());
+
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            const Renderer::ModelBatch& batch = batches[i];
+            const Renderer::AABB& bounds = _renderer->GetModelBounds(batch.model);
+            _batchNumLODs[i] = _renderer->GetModelNumLODs(batch.model);
+
+            for (u32 j = 0; j < batch.instances.size(); j++)
+            {
+                const mat4x4& modelMatrix = batch.instances[j].modelMatrix;
+                PackInstance(batch.instances[j], _instanceTransforms[_batchOffsets[i] + j], _instanceColors[_batchOffsets[i] + j]);
+                _frustumCuller.SetBounds(_batchOffsets[i] + j, bounds, modelMatrix);
+                _lodSelector.SetBounds(_batchOffsets[i] + j, bounds, modelMatrix, IsOccluder(bounds, modelMatrix));
+            }
 
-    // Flip the frameIndex between 0 and 1
-    _frameIndex = !_frameIndex;
+            UpdateOccluders(i);
+        }
+
+        UploadInstances(0, numInstances);
+
+        // The instances moved around, so the LODs the GPU remembered belong to other instances now
+        if (numInstances > 0)
+        {
+            _renderer->UpdateBuffer(_instanceLODBuffer, _lodSelector.GetLODs().data(), 0, numInstances * sizeof(u32));
+        }
+    }
+    else
+    {
+        // Only pack and upload the instances that changed
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            const Renderer::ModelBatch& batch = batches[i];
+            if (batch.dirtyBegin == batch.dirtyEnd)
+                continue;
+
+            const Renderer::AABB& bounds = _renderer->GetModelBounds(batch.model);
+            for (u32 j = batch.dirtyBegin; j < batch.dirtyEnd; j++)
+            {
+                const mat4x4& modelMatrix = batch.instances[j].modelMatrix;
+                PackInstance(batch.instances[j], _instanceTransforms[_batchOffsets[i] + j], _instanceColors[_batchOffsets[i] + j]);
+                _frustumCuller.SetBounds(_batchOffsets[i] + j, bounds, modelMatrix);
+                _lodSelector.SetBounds(_batchOffsets[i] + j, bounds, modelMatrix, IsOccluder(bounds, modelMatrix));
+            }
+
+            UploadInstances(_batchOffsets[i] + batch.dirtyBegin, batch.dirtyEnd - batch.dirtyBegin);
+            UpdateOccluders(i);
+        }
+    }
+
+    mainLayer.ClearDirty();
+}
+
+void ClientRenderer::CullInstances()
+{
+    const mat4x4& viewMatrix = _viewConstantBuffer->resource.viewMatrix;
+    const mat4x4& projMatrix = _viewConstantBuffer->resource.projMatrix;
+    Renderer::Frustum frustum = Renderer::Frustum::FromViewProjection(projMatrix * viewMatrix);
+    vec3 cameraPosition = _camera->GetPosition();
+    f32 projectionScale = glm::abs(projMatrix[1][1]); // Flipped for Vulkan
+
+    // Switching changes what the passes declare, so the RenderGraph only gets compiled again when we cross the threshold
+    u32 numInstances = static_cast<u32>(_instanceTransforms.size());
+    bool useGPUCulling = _forceGPUCulling || numInstances >= GPU_CULLING_THRESHOLD;
+    if (useGPUCulling != _useGPUCulling)
+    {
+        _useGPUCulling = useGPUCulling;
+        _renderGraph->Invalidate();
+    }
+
+    if (_useGPUCulling)
+    {
+        for (u32 i = 0; i < 6; i++)
+        {
+            _cullingConstantBuffer->resource.frustumPlanes[i] = frustum.planes[i];
+        }
+        _cullingConstantBuffer->resource.viewProjectionMatrix = projMatrix * viewMatrix;
+        _cullingConstantBuffer->resource.hiZInfo = vec4(static_cast<f32>(WIDTH), static_cast<f32>(HEIGHT), static_cast<f32>(HIZ_MIP_LEVELS), OCCLUDER_MIN_SIZE);
+        _cullingConstantBuffer->resource.cameraPosition = vec4(cameraPosition, projectionScale);
+        _cullingConstantBuffer->resource.lodScreenSizes = vec4(Renderer::LODSelector::SCREEN_SIZES[0], Renderer::LODSelector::SCREEN_SIZES[1], Renderer::LODSelector::SCREEN_SIZES[2], Renderer::LODSelector::HYSTERESIS);
+
+        ResetDrawArguments();
+        return;
+    }
+
+    _frustumCuller.Cull(frustum, _batchOffsets, _renderTaskflow);
+    _lodSelector.Select(cameraPosition, projectionScale, _batchOffsets, _batchNumLODs, _frustumCuller);
+
+    // The depth of the sort keys follows the nearest visible instance of each batch, batches that went out of view keep their last key
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+    const std::vector<Renderer::ModelBatch>& batches = mainLayer.GetBatches();
+    for (u32 i = 0; i < batches.size(); i++)
+    {
+        if (_frustumCuller.GetNumVisible(i) == 0)
+            continue;
+
+        f32 depth = _lodSelector.GetNearestDistance(i) / FAR_CLIP;
+        mainLayer.SetSortKey(batches[i].model, Renderer::SortKey::WithDepth(batches[i].sortKey, depth));
+    }
+    mainLayer.Sort();
+
+    // The visible instance buffer has one copy per frame in flight, so it gets written as a whole every frame
+    if (numInstances > 0)
+    {
+        _renderer->UpdateBuffer(_visibleInstanceBuffer, _lodSelector.GetSortedInstances().data(), 0, numInstances * sizeof(u32));
+    }
+}
+
+void ClientRenderer::ResetDrawArguments()
+{
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+    const std::vector<Renderer::ModelBatch>& batches = mainLayer.GetBatches();
+    if (batches.size() == 0)
+        return;
+
+    assert(batches.size() <= MAX_INSTANCES); // Every batch has at least one instance, so this can only hit if MAX_INSTANCES does
+
+    // The culling pass counts the visible instances up from 0, each LOD gets its own range of MAX_INSTANCES in the visible instance buffer
+    const std::vector<Renderer::DrawPacket>& drawPackets = mainLayer.GetDrawPackets();
+    _drawArguments.resize(batches.size() * Renderer::MODEL_MAX_LODS);
+    _batchDrawSlots.resize(batches.size());
+
+    for (size_t slot = 0; slot < drawPackets.size(); slot++)
+    {
+        u32 i = drawPackets[slot].batch;
+        _batchDrawSlots[i] = static_cast<u32>(slot);
+
+        for (u32 lod = 0; lod < Renderer::MODEL_MAX_LODS; lod++)
+        {
+            Renderer::DrawInstancedIndirectArguments& arguments = _drawArguments[slot * Renderer::MODEL_MAX_LODS + lod];
+            arguments = Renderer::DrawInstancedIndirectArguments();
+
+            // LODs the model doesn't have stay zero, the multi draw covering them draws nothing for them
+            if (lod >= _batchNumLODs[i])
+                continue;
+
+            const Renderer::ModelLOD& modelLOD = _renderer->GetModelLOD(batches[i].model, lod);
+            arguments.numIndices = modelLOD.numIndices;
+            arguments.firstIndex = modelLOD.firstIndex;
+            arguments.vertexOffset = modelLOD.vertexOffset;
+            arguments.firstInstance = static_cast<u32>(lod * MAX_INSTANCES) + _batchOffsets[i];
+        }
+    }
+
+    _renderer->UpdateBuffer(_drawArgumentBuffer, _drawArguments.data(), 0, _drawArguments.size() * sizeof(Renderer::DrawInstancedIndirectArguments));
+}
+
+void ClientRenderer::UpdateOccluders(size_t batchIndex)
+{
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+    const Renderer::ModelBatch& batch = mainLayer.GetBatches()[batchIndex];
+
+    const Renderer::AABB& bounds = _renderer->GetModelBounds(batch.model);
+
+    // The occluders of a batch are packed after each other, so the whole batch gets picked again when any of its instances changed
+    u32 firstInstance = _batchOffsets[batchIndex];
+    u32 numOccluders = 0;
+
+    for (u32 i = 0; i < batch.instances.size(); i++)
+    {
+        if (IsOccluder(bounds, batch.instances[i].modelMatrix))
+        {
+            _occluderInstances[firstInstance + numOccluders++] = firstInstance + i;
+        }
+    }
+
+    _numOccluders[batchIndex] = numOccluders;
+
+    if (numOccluders > 0)
+    {
+        _renderer->UpdateBuffer(_occluderBuffer, &_occluderInstances[firstInstance], firstInstance * sizeof(u32), numOccluders * sizeof(u32));
+    }
+}
+
+void ClientRenderer::UploadInstances(u32 firstInstance, u32 numInstances)
+{
+    if (numInstances == 0)
+        return;
+
+    // The instance buffer lives in device local memory, these go through the staging ring and get ordered after the frames that are still reading it
+    _renderer->UpdateBuffer(_instanceBuffer, &_instanceTransforms[firstInstance], firstInstance * sizeof(InstanceTransform), numInstances * sizeof(InstanceTransform));
+    _renderer->UpdateBuffer(_instanceBuffer, &_instanceColors[firstInstance], INSTANCE_COLORS_OFFSET + firstInstance * sizeof(u32), numInstances * sizeof(u32));
+}
+
+void ClientRenderer::CreateScene()
+{
+    // Add renderables to the main layer, they stay there until they are removed TODO: Push this to the ECS later
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+
+    Renderer::InstanceData cubeInstance;
+    _cubeRenderable = mainLayer.AddRenderable(_cubeModel, cubeInstance);
+
+    // All instances of a model are drawn in one call, so the sort key groups the models by pipeline and texture
+    // The depth gets updated every frame from the nearest visible instance in CullInstances, and the instances of each call get drawn front to back
+    u16 material = static_cast<Renderer::TextureID::type>(_cubeTexture);
+    mainLayer.SetSortKey(_cubeModel, Renderer::SortKey::Opaque(0, _mainPipeline, material, _cubeModel, 0.0f));
+}
+
+void ClientRenderer::AddStressScene()
+{
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+
+    // A grid of cubes in front of the camera, big enough to cross GPU_CULLING_THRESHOLD
+    f32 halfSize = (STRESS_SCENE_SIZE - 1) * STRESS_SCENE_SPACING * 0.5f;
+    for (u32 z = 0; z < STRESS_SCENE_SIZE; z++)
+    {
+        for (u32 y = 0; y < STRESS_SCENE_SIZE; y++)
+        {
+            for (u32 x = 0; x < STRESS_SCENE_SIZE; x++)
+            {
+                vec3 position = vec3(x * STRESS_SCENE_SPACING - halfSize, y * STRESS_SCENE_SPACING - halfSize, z * STRESS_SCENE_SPACING + STRESS_SCENE_SPACING);
+
+                // The front layer is scaled up so it goes into the depth prepass and hides most of the grid behind it
+                f32 scale = (z == 0) ? OCCLUDER_MIN_SIZE : 1.0f;
+
+                Renderer::InstanceData instance;
+                instance.modelMatrix = glm::scale(glm::translate(mat4x4(1.0f), position), vec3(scale));
+                instance.colorMultiplier = vec4(static_cast<f32>(x) / STRESS_SCENE_SIZE, static_cast<f32>(y) / STRESS_SCENE_SIZE, static_cast<f32>(z) / STRESS_SCENE_SIZE, 1.0f);
+
+                _stressRenderables.push_back(mainLayer.AddRenderable(_cubeModel, instance));
+            }
+        }
+    }
+
+    NC_LOG_MESSAGE("Added a stress scene of %u cubes", static_cast<u32>(_stressRenderables.size()));
+}
+
+void ClientRenderer::RemoveStressScene()
+{
+    Renderer::RenderLayer& mainLayer = _renderer->GetRenderLayer(MAIN_RENDER_LAYER);
+
+    for (Renderer::RenderableID renderable : _stressRenderables)
+    {
+        mainLayer.RemoveRenderable(renderable);
+    }
+    _stressRenderables.clear();
 }
 
 void ClientRenderer::CreatePermanentResources()
@@ -225,6 +709,7 @@ void ClientRenderer::CreatePermanentResources()
     mainColorDesc.dimensions = ivec2(WIDTH, HEIGHT);
     mainColorDesc.format = Renderer::IMAGE_FORMAT_R16G16B16A16_FLOAT;
     mainColorDesc.sampleCount = Renderer::SAMPLE_COUNT_1;
+    mainColorDesc.clearColor = Color(0, 0, 0, 1); // Passes writing it with LOAD_MODE_CLEAR clear it to this
 
 
     _mainColor = _renderer->CreateImage(mainColorDesc);
@@ -238,6 +723,16 @@ void ClientRenderer::CreatePermanentResources()
 
     _mainDepth = _renderer->CreateDepthImage(mainDepthDesc);
 
+    // Hi-Z pyramid, the farthest depth of the occluders for every mip
+    Renderer::ImageDesc hiZDesc;
+    hiZDesc.debugName = "HiZ";
+    hiZDesc.dimensions = ivec2(HIZ_SIZE, HIZ_SIZE);
+    hiZDesc.format = Renderer::IMAGE_FORMAT_R32_FLOAT;
+    hiZDesc.sampleCount = Renderer::SAMPLE_COUNT_1;
+    hiZDesc.mipLevels = HIZ_MIP_LEVELS;
+
+    _hiZ = _renderer->CreateImage(hiZDesc);
+
     // Cube model TODO: This is unnecessary once we have some kind of Scene abstraction
     Renderer::ModelDesc modelDesc;
     modelDesc.path = "Data/models/Cube.novusmodel";
@@ -267,19 +762,175 @@ void ClientRenderer::CreatePermanentResources()
 
         const f32 fov = 68.0f;
         const f32 nearClip = 0.1f;
-        const f32 farClip = 100.0f;
         f32 aspectRatio = static_cast<f32>(WIDTH) / static_cast<f32>(HEIGHT);
 
-        projMatrix = glm::perspective(fov, aspectRatio, nearClip, farClip);
-
-        _viewConstantBuffer->Apply(0);
-        _viewConstantBuffer->Apply(1);
+        projMatrix = glm::perspective(fov, aspectRatio, nearClip, FAR_CLIP);
     }
 
-    // Model Constant Buffer (for per-model data)
-    _modelConstantBuffer = _renderer->CreateConstantBuffer<ModelConstantBuffer>();
+    // Instance buffer (for per-instance data)
+    Renderer::BufferDesc instanceBufferDesc;
+    instanceBufferDesc.debugName = "InstanceBuffer";
+    instanceBufferDesc.size = MAX_INSTANCES * (sizeof(InstanceTransform) + sizeof(u32));
+    instanceBufferDesc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+    instanceBufferDesc.cpuAccess = Renderer::BUFFER_CPU_ACCESS_NONE;
+
+    _instanceBuffer = _renderer->CreateBuffer(instanceBufferDesc);
+
+    // Visible instance buffer (for the indices of the instances that survived culling)
+    Renderer::BufferDesc visibleInstanceBufferDesc;
+    visibleInstanceBufferDesc.debugName = "VisibleInstanceBuffer";
+    visibleInstanceBufferDesc.size = MAX_INSTANCES * sizeof(u32);
+    visibleInstanceBufferDesc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER;
+    visibleInstanceBufferDesc.cpuAccess = Renderer::BUFFER_CPU_ACCESS_WRITE;
+
+    _visibleInstanceBuffer = _renderer->CreateBuffer(visibleInstanceBufferDesc);
+
+    // Culling Constant Buffer (for the frustum the culling pass tests against)
+    _cullingConstantBuffer = _renderer->CreateConstantBuffer<CullingConstantBuffer>();
+
+    // Draw argument buffer (for the indirect draws of the main layer, one per batch), the culling pass counts up the instances in it on the GPU
+    Renderer::BufferDesc drawArgumentBufferDesc;
+    drawArgumentBufferDesc.debugName = "DrawArgumentBuffer";
+    drawArgumentBufferDesc.size = MAX_INSTANCES * Renderer::MODEL_MAX_LODS * sizeof(Renderer::DrawInstancedIndirectArguments);
+    drawArgumentBufferDesc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+    drawArgumentBufferDesc.cpuAccess = Renderer::BUFFER_CPU_ACCESS_NONE;
+
+    _drawArgumentBuffer = _renderer->CreateBuffer(drawArgumentBufferDesc);
+
+    // GPU visible instance buffer (the same as the visible instance buffer, but written by the culling pass)
+    Renderer::BufferDesc gpuVisibleInstanceBufferDesc;
+    gpuVisibleInstanceBufferDesc.debugName = "GPUVisibleInstanceBuffer";
+    gpuVisibleInstanceBufferDesc.size = MAX_INSTANCES * Renderer::MODEL_MAX_LODS * sizeof(u32);
+    gpuVisibleInstanceBufferDesc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER;
+    gpuVisibleInstanceBufferDesc.cpuAccess = Renderer::BUFFER_CPU_ACCESS_NONE;
+
+    _gpuVisibleInstanceBuffer = _renderer->CreateBuffer(gpuVisibleInstanceBufferDesc);
+
+    // Instance LOD buffer (for the LOD the culling pass picked for each instance last frame)
+    Renderer::BufferDesc instanceLODBufferDesc;
+    instanceLODBufferDesc.debugName = "InstanceLODBuffer";
+    instanceLODBufferDesc.size = MAX_INSTANCES * sizeof(u32);
+    instanceLODBufferDesc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+    instanceLODBufferDesc.cpuAccess = Renderer::BUFFER_CPU_ACCESS_NONE;
+
+    _instanceLODBuffer = _renderer->CreateBuffer(instanceLODBufferDesc);
+
+    // Occluder buffer (for the indices of the instances the depth prepass draws)
+    Renderer::BufferDesc occluderBufferDesc;
+    occluderBufferDesc.debugName = "OccluderBuffer";
+    occluderBufferDesc.size = MAX_INSTANCES * sizeof(u32);
+    occluderBufferDesc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+    occluderBufferDesc.cpuAccess = Renderer::BUFFER_CPU_ACCESS_NONE;
+
+    _occluderBuffer = _renderer->CreateBuffer(occluderBufferDesc);
 
     // Frame allocator, this is a fast allocator for data that is only needed this frame
     _frameAllocator = new Memory::StackAllocator(FRAME_ALLOCATOR_SIZE);
     _frameAllocator->Init();
+
+    // Rendergraph allocator, the passes of our rendergraph live in here for as long as the renderer
+    _renderGraphAllocator = new Memory::StackAllocator(RENDER_GRAPH_ALLOCATOR_SIZE);
+    _renderGraphAllocator->Init();
+}
+
+void ClientRenderer::CreatePipelines()
+{
+    // Main pipeline
+    {
+        Renderer::GraphicsPipelineDesc pipelineDesc;
+
+        // Shaders
+        Renderer::VertexShaderDesc vertexShaderDesc;
+        vertexShaderDesc.path = "Data/shaders/test.vert.spv";
+        pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+
+        Renderer::PixelShaderDesc pixelShaderDesc;
+        pixelShaderDesc.path = "Data/shaders/test.frag.spv";
+        pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+
+        // Constant buffers  TODO: Improve on this, if I set state 0 and 3 it won't work etc...
+        pipelineDesc.states.constantBufferStates[0].enabled = true; // ViewCB
+        pipelineDesc.states.constantBufferStates[0].shaderVisibility = Renderer::ShaderVisibility::SHADER_VISIBILITY_VERTEX;
+        pipelineDesc.states.constantBufferStates[1].enabled = true; // Instance buffer
+        pipelineDesc.states.constantBufferStates[1].shaderVisibility = Renderer::ShaderVisibility::SHADER_VISIBILITY_VERTEX;
+
+        // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
+        pipelineDesc.states.inputLayouts[0].enabled = true;
+        pipelineDesc.states.inputLayouts[0].SetName("POSITION");
+        pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
+        pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
+        pipelineDesc.states.inputLayouts[1].enabled = true;
+        pipelineDesc.states.inputLayouts[1].SetName("NORMAL");
+        pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
+        pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
+        pipelineDesc.states.inputLayouts[2].enabled = true;
+        pipelineDesc.states.inputLayouts[2].SetName("TEXCOORD");
+        pipelineDesc.states.inputLayouts[2].format = Renderer::InputFormat::INPUT_FORMAT_R32G32_FLOAT;
+        pipelineDesc.states.inputLayouts[2].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
+
+        // Viewport
+        pipelineDesc.states.viewport.topLeftX = 0;
+        pipelineDesc.states.viewport.topLeftY = 0;
+        pipelineDesc.states.viewport.width = static_cast<f32>(WIDTH);
+        pipelineDesc.states.viewport.height = static_cast<f32>(HEIGHT);
+        pipelineDesc.states.viewport.minDepth = 0.0f;
+        pipelineDesc.states.viewport.maxDepth = 1.0f;
+
+        // ScissorRect
+        pipelineDesc.states.scissorRect.left = 0;
+        pipelineDesc.states.scissorRect.right = WIDTH;
+        pipelineDesc.states.scissorRect.top = 0;
+        pipelineDesc.states.scissorRect.bottom = HEIGHT;
+
+        // Rasterizer state
+        pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
+        pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
+
+        // Depth stencil state, LESS_EQUAL since the occluders are already in the depth buffer when the depth prepass ran
+        pipelineDesc.states.depthStencilState.depthEnable = true;
+        pipelineDesc.states.depthStencilState.depthWriteEnable = true;
+        pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS_EQUAL;
+
+        // Samplers TODO: We don't care which samplers we have here, we just need the number of samplers
+        pipelineDesc.states.samplers[0].enabled = true;
+
+        // The occluder pipeline is the same without the pixel shader and color output
+        Renderer::GraphicsPipelineDesc occluderPipelineDesc = pipelineDesc;
+
+        // Render targets
+        _mainPipeline = _renderer->PrecompilePipeline(pipelineDesc, { _mainColor }, _mainDepth); // This gets compiled on a worker thread, ClientRenderer waits for it before the first frame
+
+        occluderPipelineDesc.states.pixelShader = Renderer::PixelShaderID::Invalid();
+        occluderPipelineDesc.states.samplers[0].enabled = false;
+        occluderPipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+
+        _occluderPipeline = _renderer->PrecompilePipeline(occluderPipelineDesc, {}, _mainDepth);
+    }
+
+    // Culling pipeline
+    {
+        Renderer::ComputePipelineDesc pipelineDesc;
+
+        Renderer::ComputeShaderDesc computeShaderDesc;
+        computeShaderDesc.path = "Data/shaders/cull.comp.spv";
+        pipelineDesc.computeShader = _renderer->LoadShader(computeShaderDesc);
+
+        _cullingPipeline = _renderer->CreatePipeline(pipelineDesc);
+    }
+
+    // Hi-Z pipelines
+    {
+        Renderer::ComputePipelineDesc pipelineDesc;
+
+        Renderer::ComputeShaderDesc computeShaderDesc;
+        computeShaderDesc.path = "Data/shaders/hiz_depth.comp.spv";
+        pipelineDesc.computeShader = _renderer->LoadShader(computeShaderDesc);
+
+        _hiZDepthPipeline = _renderer->CreatePipeline(pipelineDesc);
+
+        computeShaderDesc.path = "Data/shaders/hiz_downsample.comp.spv";
+        pipelineDesc.computeShader = _renderer->LoadShader(computeShaderDesc);
+
+        _hiZDownsamplePipeline = _renderer->CreatePipeline(pipelineDesc);
+    }
 }
@@ -1,17 +1,28 @@
 #pragma once
 #include <NovusTypes.h>
+#include <vector>
+#include <memory>
+#include <taskflow/taskflow.hpp>
 
 #include <Renderer/Descriptors/ImageDesc.h>
 #include <Renderer/Descriptors/DepthImageDesc.h>
 #include <Renderer/Descriptors/TextureDesc.h>
 #include <Renderer/Descriptors/ModelDesc.h>
 #include <Renderer/Descriptors/SamplerDesc.h>
+#include <Renderer/Descriptors/BufferDesc.h>
+#include <Renderer/Descriptors/GraphicsPipelineDesc.h>
+#include <Renderer/Descriptors/ComputePipelineDesc.h>
+#include <Renderer/Commands/DrawInstancedIndirect.h>
 #include <Renderer/ConstantBuffer.h>
 #include <Renderer/InstanceData.h>
+#include <Renderer/RenderLayer.h>
+#include <Renderer/FrustumCuller.h>
+#include <Renderer/LODSelector.h>
 
 namespace Renderer
 {
     class Renderer;
+    class RenderGraph;
 }
 
 namespace Memory
@@ -27,23 +38,49 @@ struct ViewConstantBuffer
     u8 padding[128] = {};
 };
 
-struct ModelConstantBuffer
+struct CullingConstantBuffer
 {
-    vec4 colorMultiplier; // 16 bytes
-    mat4x4 modelMatrix; // 64 bytes
+    vec4 frustumPlanes[6]; // 96 bytes
+    mat4x4 viewProjectionMatrix; // 64 bytes
+    vec4 hiZInfo; // 16 bytes, xy is the size of the depth buffer the Hi-Z pyramid was built from, z is its number of mips, w is OCCLUDER_MIN_SIZE
+    vec4 cameraPosition; // 16 bytes, w is [1][1] of the projection matrix
+    vec4 lodScreenSizes; // 16 bytes, xyz are LODSelector::SCREEN_SIZES, w is LODSelector::HYSTERESIS
 
-    u8 padding[176] = {};
+    u8 padding[48] = {};
+};
+
+struct CullingPushConstants
+{
+    vec4 boundsCenter; // Local space bounds of the model of the batch
+    vec4 boundsExtents;
+    u32 firstInstance;
+    u32 numInstances;
+    u32 drawIndex; // Where the DrawInstancedIndirectArguments of the batch start, one per LOD, see ClientRenderer::_batchDrawSlots
+    u32 numLODs;
+};
+
+struct HiZPushConstants
+{
+    ivec2 srcSize;
+    ivec2 dstSize;
+};
+
+struct InstanceTransform
+{
+    vec4 rows[3]; // 48 bytes, the first three rows of the model matrix, the last one is always (0, 0, 0, 1)
 };
 
 class Window;
 class Camera;
 class UIRenderer;
 class InputManager;
+class Keybind;
 
 class ClientRenderer
 {
 public:
-    ClientRenderer();
+    ClientRenderer(tf::Taskflow* taskflow);
+    ~ClientRenderer();
 
     bool UpdateWindow(f32 deltaTime);
     void Update(f32 deltaTime);
@@ -51,6 +88,20 @@ public:
 
 private:
     void CreatePermanentResources();
+    void CreatePipelines();
+    void CreateRenderGraph();
+    void CreateScene();
+    void AddStressScene();
+    void RemoveStressScene();
+    void UpdateInstanceData();
+    void CullInstances();
+    void ResetDrawArguments();
+    void UpdateOccluders(size_t batchIndex);
+    void UploadInstances(u32 firstInstance, u32 numInstances);
+
+    void OnLogMemoryStats(Window* window, std::shared_ptr<Keybind> keybind);
+    void OnToggleGPUCulling(Window* window, std::shared_ptr<Keybind> keybind);
+    void OnToggleStressScene(Window* window, std::shared_ptr<Keybind> keybind);
 
 private:
     Window* _window;
@@ -58,8 +109,9 @@ private:
     InputManager* _inputManager;
     Renderer::Renderer* _renderer;
     Memory::StackAllocator* _frameAllocator;
-
-    u8 _frameIndex = 0;
+    Memory::StackAllocator* _renderGraphAllocator;
+    tf::Taskflow* _renderTaskflow;
+    Renderer::RenderGraph* _renderGraph;
 
     // Permanent resources
     Renderer::ImageID _mainColor;
@@ -67,11 +119,47 @@ private:
 
     Renderer::ModelID _cubeModel;
     Renderer::TextureID _cubeTexture;
-    Renderer::InstanceData _cubeModelInstance;
+    Renderer::RenderableID _cubeRenderable;
+    std::vector<Renderer::RenderableID> _stressRenderables; // Toggled with F5
     Renderer::SamplerID _linearSampler;
 
     Renderer::ConstantBuffer<ViewConstantBuffer>* _viewConstantBuffer;
-    Renderer::ConstantBuffer<ModelConstantBuffer>* _modelConstantBuffer;
+
+    Renderer::GraphicsPipelineID _mainPipeline;
+    Renderer::GraphicsPipelineID _occluderPipeline;
+    Renderer::ComputePipelineID _cullingPipeline;
+    Renderer::ComputePipelineID _hiZDepthPipeline;
+    Renderer::ComputePipelineID _hiZDownsamplePipeline;
+
+    // Per instance data for all models in the main layer, indexed by gl_InstanceIndex
+    // It is split into MAX_INSTANCES transforms followed by MAX_INSTANCES packed colors, and only the instances that changed get uploaded
+    Renderer::BufferID _instanceBuffer;
+    std::vector<InstanceTransform> _instanceTransforms; // The main layer laid out batch after batch
+    std::vector<u32> _instanceColors; // RGBA8 color multipliers, laid out the same way
+    std::vector<u32> _batchOffsets; // Where each batch of the main layer starts
+
+    // The main layer gets frustum culled on the CPU, the vertex shader looks up which instance to draw in here
+    // The visible instances of each batch are sorted by LOD, so each LOD is drawn with one call
+    Renderer::FrustumCuller _frustumCuller;
+    Renderer::LODSelector _lodSelector;
+    Renderer::BufferID _visibleInstanceBuffer;
+    std::vector<u32> _batchNumLODs;
+
+    // Large scenes get culled on the GPU instead, the culling pass fills these and the main pass draws indirectly from them
+    bool _useGPUCulling = false;
+    bool _forceGPUCulling = false; // Toggled with F4, so the GPU culling path can be checked without a big scene
+    Renderer::ConstantBuffer<CullingConstantBuffer>* _cullingConstantBuffer;
+    Renderer::BufferID _drawArgumentBuffer;
+    Renderer::BufferID _gpuVisibleInstanceBuffer; // Split into one range of MAX_INSTANCES per LOD
+    Renderer::BufferID _instanceLODBuffer; // The GPU keeps its own LOD per instance for the hysteresis
+    std::vector<Renderer::DrawInstancedIndirectArguments> _drawArguments; // MODEL_MAX_LODS per batch, the instance counts start at 0 every frame
+    std::vector<u32> _batchDrawSlots; // The arguments are laid out in draw packet order, so packets next to each other in the same geometry block get drawn with one call
+
+    // With GPU culling the big instances get drawn into _mainDepth first, the culling pass then tests against a Hi-Z pyramid built from it
+    Renderer::ImageID _hiZ;
+    Renderer::BufferID _occluderBuffer; // Indexed like the visible instance buffer, each batch packs its occluders starting at its offset
+    std::vector<u32> _occluderInstances; // Laid out the same way
+    std::vector<u32> _numOccluders; // Per batch
 
     // Sub renderers
     UIRenderer* _uiRenderer;
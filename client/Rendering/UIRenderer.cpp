@@ -17,10 +17,12 @@
 const int WIDTH = 1920;
 const int HEIGHT = 1080;
 
-UIRenderer::UIRenderer(Renderer::Renderer* renderer)
+UIRenderer::UIRenderer(Renderer::Renderer* renderer, Renderer::ImageID renderTarget)
 {
     _renderer = renderer;
+    _renderTarget = renderTarget;
     CreatePermanentResources();
+    CreatePipelines();
 
     InputManager* inputManager = ServiceLocator::GetInputManager();
     inputManager->RegisterKeybind("UI Click Checker", GLFW_MOUSE_BUTTON_LEFT, KEYBIND_ACTION_CLICK, KEYBIND_MOD_ANY, std::bind(&UIRenderer::OnMouseClick, this, std::placeholders::_1, std::placeholders::_2));
@@ -85,8 +87,6 @@ void UIRenderer::Update(f32 deltaTime)
                 panel->SetConstantBuffer(constantBuffer);
             }
             constantBuffer->resource.color = panel->GetColor();
-            constantBuffer->Apply(0);
-            constantBuffer->Apply(1);
 
             panel->ResetDirty();
         }
@@ -186,8 +186,6 @@ void UIRenderer::Update(f32 deltaTime)
             constantBuffer->resource.textColor = label->GetColor();
             constantBuffer->resource.outlineColor = label->GetOutlineColor();
             constantBuffer->resource.outlineWidth = label->GetOutlineWidth();
-            constantBuffer->Apply(0);
-            constantBuffer->Apply(1);
 
             label->ResetDirty();
         }
@@ -246,15 +244,13 @@ void UIRenderer::Update(f32 deltaTime)
                 button->SetConstantBuffer(constantBuffer);
             }
             constantBuffer->resource.color = button->GetColor();
-            constantBuffer->Apply(0);
-            constantBuffer->Apply(1);
 
             button->ResetDirty();
         }
     }
 }
 
-void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID renderTarget, u8 frameIndex)
+void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph)
 {
     // UI Pass
     {
@@ -268,74 +264,14 @@ void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID
         renderGraph->AddPass<UIPassData>("UI Pass",
             [&](UIPassData& data, Renderer::RenderGraphBuilder& builder) // Setup
         {
-            data.renderTarget = builder.Write(renderTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+            data.renderTarget = builder.Write(_renderTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
 
             return true; // Return true from setup to enable this pass, return false to disable it
         },
         [&, uiElementRegistry](UIPassData& data, Renderer::CommandList& commandList) // Execute
         {
-            Renderer::GraphicsPipelineDesc pipelineDesc;
-            renderGraph->InitializePipelineDesc(pipelineDesc);
-
-            // Shaders
-            Renderer::VertexShaderDesc vertexShaderDesc;
-            vertexShaderDesc.path = "Data/shaders/panel.vert.spv";
-            pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
-
-            Renderer::PixelShaderDesc pixelShaderDesc;
-            pixelShaderDesc.path = "Data/shaders/panel.frag.spv";
-            pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
-
-            // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
-            pipelineDesc.states.inputLayouts[0].enabled = true;
-            pipelineDesc.states.inputLayouts[0].SetName("POSITION");
-            pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
-            pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-            pipelineDesc.states.inputLayouts[1].enabled = true;
-            pipelineDesc.states.inputLayouts[1].SetName("NORMAL");
-            pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
-            pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-            pipelineDesc.states.inputLayouts[2].enabled = true;
-            pipelineDesc.states.inputLayouts[2].SetName("TEXCOORD");
-            pipelineDesc.states.inputLayouts[2].format = Renderer::InputFormat::INPUT_FORMAT_R32G32_FLOAT;
-            pipelineDesc.states.inputLayouts[2].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-
-            // Viewport
-            pipelineDesc.states.viewport.topLeftX = 0;
-            pipelineDesc.states.viewport.topLeftY = 0;
-            pipelineDesc.states.viewport.width = static_cast<f32>(WIDTH);
-            pipelineDesc.states.viewport.height = static_cast<f32>(HEIGHT);
-            pipelineDesc.states.viewport.minDepth = 0.0f;
-            pipelineDesc.states.viewport.maxDepth = 1.0f;
-
-            // ScissorRect
-            pipelineDesc.states.scissorRect.left = 0;
-            pipelineDesc.states.scissorRect.right = WIDTH;
-            pipelineDesc.states.scissorRect.top = 0;
-            pipelineDesc.states.scissorRect.bottom = HEIGHT;
-
-            // Rasterizer state
-            pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
-
-            // Samplers TODO: We don't care which samplers we have here, we just need the number of samplers
-            pipelineDesc.states.samplers[0].enabled = true;
-
-            // Textures TODO: We don't care which textures we have here, we just need the number of textures
-            pipelineDesc.textures[0] = Renderer::RenderPassResource(1);
-
-            // Render targets
-            pipelineDesc.renderTargets[0] = data.renderTarget;
-
-            // Blending
-            pipelineDesc.states.blendState.renderTargets[0].blendEnable = true;
-            pipelineDesc.states.blendState.renderTargets[0].srcBlend = Renderer::BlendMode::BLEND_MODE_SRC_ALPHA;
-            pipelineDesc.states.blendState.renderTargets[0].destBlend = Renderer::BlendMode::BLEND_MODE_INV_SRC_ALPHA;
-            pipelineDesc.states.blendState.renderTargets[0].srcBlendAlpha = Renderer::BlendMode::BLEND_MODE_ZERO;
-            pipelineDesc.states.blendState.renderTargets[0].destBlendAlpha = Renderer::BlendMode::BLEND_MODE_ONE;
-
             // Set pipeline
-            Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
-            commandList.BeginPipeline(pipeline);
+            commandList.BeginPipeline(_panelPipeline);
 
             // Draw all the panels
             for (auto panel : uiElementRegistry->GetPanels())
@@ -343,21 +279,18 @@ void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID
                 commandList.PushMarker("Panel", Color(0.0f, 0.1f, 0.0f));
 
                 // Set constant buffer
-                commandList.SetConstantBuffer(0, panel->GetConstantBuffer()->GetGPUResource(frameIndex));
+                auto constantBuffer = panel->GetConstantBuffer();
+                u32 offset = constantBuffer->Apply();
+                commandList.SetConstantBuffer(0, constantBuffer->GetGPUResource(), offset);
 
                 // Set texture-sampler pair
-                commandList.SetTextureSampler(1, panel->GetTextureID(), _linearSampler);
+                commandList.PushTextureSampler(0, panel->GetTextureID(), _linearSampler);
 
                 // Draw
                 commandList.Draw(panel->GetModelID());
 
                 commandList.PopMarker();
             }
-            commandList.EndPipeline(pipeline);
-
-            // Set pipeline
-            pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
-            commandList.BeginPipeline(pipeline);
 
             // Draw all the buttons
             for (auto button : uiElementRegistry->GetButtons())
@@ -368,28 +301,22 @@ void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID
                 commandList.PushMarker("Button", Color(0.0f, 0.1f, 0.0f));
 
                 // Set constant buffer
-                commandList.SetConstantBuffer(0, button->GetConstantBuffer()->GetGPUResource(frameIndex));
+                auto constantBuffer = button->GetConstantBuffer();
+                u32 offset = constantBuffer->Apply();
+                commandList.SetConstantBuffer(0, constantBuffer->GetGPUResource(), offset);
 
                 // Set texture-sampler pair
-                commandList.SetTextureSampler(1, button->GetTextureID(), _linearSampler);
+                commandList.PushTextureSampler(0, button->GetTextureID(), _linearSampler);
 
                 // Draw
                 commandList.Draw(button->GetModelID());
 
                 commandList.PopMarker();
             }
-            commandList.EndPipeline(pipeline);
-
-            // Draw text
-            vertexShaderDesc.path = "Data/shaders/text.vert.spv";
-            pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
-
-            pixelShaderDesc.path = "Data/shaders/text.frag.spv";
-            pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+            commandList.EndPipeline(_panelPipeline);
 
             // Set pipeline
-            pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
-            commandList.BeginPipeline(pipeline);
+            commandList.BeginPipeline(_textPipeline);
 
             // Draw all the labels
             for (auto label : uiElementRegistry->GetLabels())
@@ -397,14 +324,16 @@ void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID
                 commandList.PushMarker("Label", Color(0.0f, 0.1f, 0.0f));
 
                 // Set constant buffer
-                commandList.SetConstantBuffer(0, label->GetConstantBuffer()->GetGPUResource(frameIndex));
+                auto constantBuffer = label->GetConstantBuffer();
+                u32 offset = constantBuffer->Apply();
+                commandList.SetConstantBuffer(0, constantBuffer->GetGPUResource(), offset);
 
                 // Each glyph in the label has it's own plane and texture, this could be optimized in the future.
                 u32 glyphs = label->GetGlyphCount();
                 for (u32 i = 0; i < glyphs; i++)
                 {
                     // Set texture-sampler pair
-                    commandList.SetTextureSampler(1, label->_textures[i], _linearSampler);
+                    commandList.PushTextureSampler(0, label->_textures[i], _linearSampler);
 
                     // Draw
                     commandList.Draw(label->_models[i]);
@@ -412,7 +341,7 @@ void UIRenderer::AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID
 
                 commandList.PopMarker();
             }
-            commandList.EndPipeline(pipeline);
+            commandList.EndPipeline(_textPipeline);
         });
     }
 }
@@ -520,6 +449,73 @@ void UIRenderer::CreatePermanentResources()
     _linearSampler = _renderer->CreateSampler(samplerDesc);
 }
 
+void UIRenderer::CreatePipelines()
+{
+    Renderer::GraphicsPipelineDesc pipelineDesc;
+
+    // Shaders
+    Renderer::VertexShaderDesc vertexShaderDesc;
+    vertexShaderDesc.path = "Data/shaders/panel.vert.spv";
+    pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+
+    Renderer::PixelShaderDesc pixelShaderDesc;
+    pixelShaderDesc.path = "Data/shaders/panel.frag.spv";
+    pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+
+    // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
+    pipelineDesc.states.inputLayouts[0].enabled = true;
+    pipelineDesc.states.inputLayouts[0].SetName("POSITION");
+    pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
+    pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
+    pipelineDesc.states.inputLayouts[1].enabled = true;
+    pipelineDesc.states.inputLayouts[1].SetName("NORMAL");
+    pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
+    pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
+    pipelineDesc.states.inputLayouts[2].enabled = true;
+    pipelineDesc.states.inputLayouts[2].SetName("TEXCOORD");
+    pipelineDesc.states.inputLayouts[2].format = Renderer::InputFormat::INPUT_FORMAT_R32G32_FLOAT;
+    pipelineDesc.states.inputLayouts[2].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
+
+    // Viewport
+    pipelineDesc.states.viewport.topLeftX = 0;
+    pipelineDesc.states.viewport.topLeftY = 0;
+    pipelineDesc.states.viewport.width = static_cast<f32>(WIDTH);
+    pipelineDesc.states.viewport.height = static_cast<f32>(HEIGHT);
+    pipelineDesc.states.viewport.minDepth = 0.0f;
+    pipelineDesc.states.viewport.maxDepth = 1.0f;
+
+    // ScissorRect
+    pipelineDesc.states.scissorRect.left = 0;
+    pipelineDesc.states.scissorRect.right = WIDTH;
+    pipelineDesc.states.scissorRect.top = 0;
+    pipelineDesc.states.scissorRect.bottom = HEIGHT;
+
+    // Rasterizer state
+    pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
+
+    // Samplers TODO: We don't care which samplers we have here, we just need the number of samplers
+    pipelineDesc.states.samplers[0].enabled = true;
+
+    // Blending
+    pipelineDesc.states.blendState.renderTargets[0].blendEnable = true;
+    pipelineDesc.states.blendState.renderTargets[0].srcBlend = Renderer::BlendMode::BLEND_MODE_SRC_ALPHA;
+    pipelineDesc.states.blendState.renderTargets[0].destBlend = Renderer::BlendMode::BLEND_MODE_INV_SRC_ALPHA;
+    pipelineDesc.states.blendState.renderTargets[0].srcBlendAlpha = Renderer::BlendMode::BLEND_MODE_ZERO;
+    pipelineDesc.states.blendState.renderTargets[0].destBlendAlpha = Renderer::BlendMode::BLEND_MODE_ONE;
+
+    // Panels and buttons
+    _panelPipeline = _renderer->PrecompilePipeline(pipelineDesc, { _renderTarget });
+
+    // Text, same states with other shaders
+    vertexShaderDesc.path = "Data/shaders/text.vert.spv";
+    pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+
+    pixelShaderDesc.path = "Data/shaders/text.frag.spv";
+    pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+
+    _textPipeline = _renderer->PrecompilePipeline(pipelineDesc, { _renderTarget });
+}
+
 Renderer::TextureID UIRenderer::ReloadTexture(std::string& texturePath)
 {
     Renderer::TextureDesc textureDesc;
@@ -5,6 +5,7 @@
 #include <Renderer/Descriptors/TextureDesc.h>
 #include <Renderer/Descriptors/ModelDesc.h>
 #include <Renderer/Descriptors/SamplerDesc.h>
+#include <Renderer/Descriptors/GraphicsPipelineDesc.h>
 #include <Renderer/ConstantBuffer.h>
 
 namespace Renderer
@@ -18,16 +19,17 @@ class Keybind;
 class UIRenderer
 {
 public:
-    UIRenderer(Renderer::Renderer* renderer);
+    UIRenderer(Renderer::Renderer* renderer, Renderer::ImageID renderTarget);
 
     void Update(f32 deltaTime);
-    void AddUIPass(Renderer::RenderGraph* renderGraph, Renderer::ImageID renderTarget, u8 frameIndex);
+    void AddUIPass(Renderer::RenderGraph* renderGraph);
     void OnMouseClick(Window* window, std::shared_ptr<Keybind> keybind);
     void OnMousePositionUpdate(Window* window, f32 x, f32 y);
     void OnKeyboardInput(Window* window, i32 key, i32 actionMask, i32 modifierMask);
 
 private:
     void CreatePermanentResources();
+    void CreatePipelines();
 
     // Helper functions
     Renderer::TextureID ReloadTexture(std::string& texturePath);
@@ -36,5 +38,9 @@ private:
 private:
     Renderer::Renderer* _renderer;
 
+    Renderer::ImageID _renderTarget;
+
     Renderer::SamplerID _linearSampler;
+    Renderer::GraphicsPipelineID _panelPipeline;
+    Renderer::GraphicsPipelineID _textPipeline;
 };
\ No newline at end of file
@@ -1,30 +1,190 @@
 #pragma once
 #include <NovusTypes.h>
 #include "Descriptors/CommandListDesc.h"
+#include "CommandStream.h"
+
+#include "Commands/Clear.h"
+#include "Commands/Draw.h"
+#include "Commands/DrawInstanced.h"
+#include "Commands/DrawInstancedIndirect.h"
+#include "Commands/Dispatch.h"
+#include "Commands/PopMarker.h"
+#include "Commands/PushMarker.h"
+#include "Commands/SetConstantBuffer.h"
+#include "Commands/SetStorageBuffer.h"
+#include "Commands/SetStorageImage.h"
+#include "Commands/SetSampledImage.h"
+#include "Commands/SetPipeline.h"
+#include "Commands/SetScissorRect.h"
+#include "Commands/SetViewport.h"
+#include "Commands/PushConstant.h"
+#include "Commands/ImageBarriers.h"
+#include "Commands/BufferBarriers.h"
+#include "Commands/AttachmentOps.h"
 
 namespace Renderer
 {
-    class Renderer;
-    typedef void (*BackendDispatchFunction)(Renderer*, CommandListID, const void*);
-
     class BackendDispatch
     {
     public:
-        static void ClearImage(Renderer* renderer, CommandListID commandList, const void* data);
-        static void ClearDepthImage(Renderer* renderer, CommandListID commandList, const void* data);
-
-        static void Draw(Renderer* renderer, CommandListID commandList, const void* data);
+        // Replays a recorded command stream, backends call this with their own type so the calls below don't have to go through the Renderer vtable
+        template<typename RendererType>
+        static void Dispatch(RendererType* renderer, CommandListID commandList, const CommandChunk* firstChunk)
+        {
+            for (const CommandChunk* chunk = firstChunk; chunk != nullptr; chunk = chunk->next)
+            {
+                const u8* command = chunk->data;
+                const u8* end = chunk->data + chunk->used;
 
-        static void PopMarker(Renderer* renderer, CommandListID commandList, const void* data);
-        static void PushMarker(Renderer* renderer, CommandListID commandList, const void* data);
+                while (command < end)
+                {
+                    const CommandHeader* header = reinterpret_cast<const CommandHeader*>(command);
+                    const void* data = command + sizeof(CommandHeader);
 
-        static void SetConstantBuffer(Renderer* renderer, CommandListID commandList, const void* data);
-        static void BeginGraphicsPipeline(Renderer* renderer, CommandListID commandList, const void* data);
-        static void EndGraphicsPipeline(Renderer* renderer, CommandListID commandList, const void* data);
-        static void SetComputePipeline(Renderer* renderer, CommandListID commandList, const void* data);
+                    switch (header->type)
+                    {
+                        case COMMAND_TYPE_CLEAR_IMAGE:
+                        {
+                            const Commands::ClearImage* actualData = static_cast<const Commands::ClearImage*>(data);
+                            renderer->Clear(commandList, actualData->image, actualData->color);
+                            break;
+                        }
+                        case COMMAND_TYPE_CLEAR_DEPTH_IMAGE:
+                        {
+                            const Commands::ClearDepthImage* actualData = static_cast<const Commands::ClearDepthImage*>(data);
+                            renderer->Clear(commandList, actualData->image, actualData->flags, actualData->depth, actualData->stencil);
+                            break;
+                        }
+                        case COMMAND_TYPE_DRAW:
+                        {
+                            const Commands::Draw* actualData = static_cast<const Commands::Draw*>(data);
+                            renderer->Draw(commandList, actualData->model);
+                            break;
+                        }
+                        case COMMAND_TYPE_DRAW_INSTANCED:
+                        {
+                            const Commands::DrawInstanced* actualData = static_cast<const Commands::DrawInstanced*>(data);
+                            renderer->DrawInstanced(commandList, actualData->model, actualData->lod, actualData->numInstances, actualData->firstInstance);
+                            break;
+                        }
+                        case COMMAND_TYPE_DRAW_INSTANCED_INDIRECT:
+                        {
+                            const Commands::DrawInstancedIndirect* actualData = static_cast<const Commands::DrawInstancedIndirect*>(data);
+                            renderer->DrawInstancedIndirect(commandList, actualData->model, actualData->argumentBuffer, actualData->argumentOffset, actualData->drawCount);
+                            break;
+                        }
+                        case COMMAND_TYPE_DISPATCH:
+                        {
+                            const Commands::Dispatch* actualData = static_cast<const Commands::Dispatch*>(data);
+                            renderer->Dispatch(commandList, actualData->threadGroupCountX, actualData->threadGroupCountY, actualData->threadGroupCountZ);
+                            break;
+                        }
+                        case COMMAND_TYPE_POP_MARKER:
+                        {
+                            renderer->PopMarker(commandList);
+                            break;
+                        }
+                        case COMMAND_TYPE_PUSH_MARKER:
+                        {
+                            const Commands::PushMarker* actualData = static_cast<const Commands::PushMarker*>(data);
+                            renderer->PushMarker(commandList, actualData->color, actualData->marker);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_CONSTANT_BUFFER:
+                        {
+                            const Commands::SetConstantBuffer* actualData = static_cast<const Commands::SetConstantBuffer*>(data);
+                            renderer->SetConstantBuffer(commandList, actualData->slot, actualData->gpuResource, actualData->offset);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_STORAGE_BUFFER:
+                        {
+                            const Commands::SetStorageBuffer* actualData = static_cast<const Commands::SetStorageBuffer*>(data);
+                            renderer->SetStorageBuffer(commandList, actualData->slot, actualData->buffer);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_STORAGE_IMAGE:
+                        {
+                            const Commands::SetStorageImage* actualData = static_cast<const Commands::SetStorageImage*>(data);
+                            renderer->SetStorageImage(commandList, actualData->slot, actualData->image, actualData->mipLevel);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_SAMPLED_IMAGE:
+                        {
+                            const Commands::SetSampledImage* actualData = static_cast<const Commands::SetSampledImage*>(data);
+                            if (actualData->image != ImageID::Invalid())
+                            {
+                                renderer->SetSampledImage(commandList, actualData->slot, actualData->image);
+                            }
+                            else
+                            {
+                                renderer->SetSampledImage(commandList, actualData->slot, actualData->depthImage);
+                            }
+                            break;
+                        }
+                        case COMMAND_TYPE_BEGIN_GRAPHICS_PIPELINE:
+                        {
+                            const Commands::BeginGraphicsPipeline* actualData = static_cast<const Commands::BeginGraphicsPipeline*>(data);
+                            renderer->BeginPipeline(commandList, actualData->pipeline);
+                            break;
+                        }
+                        case COMMAND_TYPE_END_GRAPHICS_PIPELINE:
+                        {
+                            const Commands::EndGraphicsPipeline* actualData = static_cast<const Commands::EndGraphicsPipeline*>(data);
+                            renderer->EndPipeline(commandList, actualData->pipeline);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_COMPUTE_PIPELINE:
+                        {
+                            const Commands::SetComputePipeline* actualData = static_cast<const Commands::SetComputePipeline*>(data);
+                            renderer->SetPipeline(commandList, actualData->pipeline);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_SCISSOR_RECT:
+                        {
+                            const Commands::SetScissorRect* actualData = static_cast<const Commands::SetScissorRect*>(data);
+                            renderer->SetScissorRect(commandList, actualData->scissorRect);
+                            break;
+                        }
+                        case COMMAND_TYPE_SET_VIEWPORT:
+                        {
+                            const Commands::SetViewport* actualData = static_cast<const Commands::SetViewport*>(data);
+                            renderer->SetViewport(commandList, actualData->viewport);
+                            break;
+                        }
+                        case COMMAND_TYPE_PUSH_CONSTANT:
+                        {
+                            const Commands::PushConstant* actualData = static_cast<const Commands::PushConstant*>(data);
+                            renderer->PushConstant(commandList, const_cast<u8*>(actualData->data), actualData->offset, actualData->size);
+                            break;
+                        }
+                        case COMMAND_TYPE_IMAGE_BARRIERS:
+                        {
+                            const Commands::ImageBarriers* actualData = static_cast<const Commands::ImageBarriers*>(data);
+                            renderer->ImageBarriers(commandList, actualData->barriers, actualData->numBarriers);
+                            break;
+                        }
+                        case COMMAND_TYPE_BUFFER_BARRIERS:
+                        {
+                            const Commands::BufferBarriers* actualData = static_cast<const Commands::BufferBarriers*>(data);
+                            renderer->BufferBarriers(commandList, actualData->barriers, actualData->numBarriers);
+                            break;
+                        }
+                        case COMMAND_TYPE_ATTACHMENT_OPS:
+                        {
+                            const Commands::AttachmentOps* actualData = static_cast<const Commands::AttachmentOps*>(data);
+                            renderer->SetAttachmentOps(commandList, actualData->ops, actualData->numOps);
+                            break;
+                        }
+                        default:
+                        {
+                            assert(false); // Unknown command type, did we forget to add a case for a new command?
+                            break;
+                        }
+                    }
 
-        static void SetScissorRect(Renderer* renderer, CommandListID commandList, const void* data);
-        static void SetViewport(Renderer* renderer, CommandListID commandList, const void* data);
-        static void SetTextureSampler(Renderer* renderer, CommandListID commandList, const void* data);
+                    command += header->size;
+                }
+            }
+        }
     };
 }
\ No newline at end of file
@@ -5,18 +5,50 @@
 namespace Renderer
 {
     void CommandList::Execute()
+    {
+        CommandListID commandList = _renderer->BeginCommandList();
+        Record(commandList);
+        _renderer->EndCommandList(commandList);
+    }
+
+    void CommandList::Record(CommandListID commandListID)
     {
         assert(_markerScope == 0); // We need to pop all markers that we push
 
-        CommandListID commandList = _renderer->BeginCommandList();
+        // The backend replays the whole stream in one call
+        if (_firstChunk != nullptr)
+        {
+            _renderer->ExecuteCommands(commandListID, _firstChunk);
+        }
+    }
+
+    void* CommandList::AllocateCommand(CommandType type, u32 size)
+    {
+        assert(_allocator != nullptr);
 
-        // Execute each command
-        for (int i = 0; i < _functions.Count(); i++)
+        if (_currentChunk == nullptr || _currentChunk->used + size > CommandChunk::SIZE)
         {
-            _functions[i](_renderer, commandList, _data[i]);
+            CommandChunk* chunk = Memory::Allocator::New<CommandChunk>(_allocator);
+
+            if (_currentChunk == nullptr)
+            {
+                _firstChunk = chunk;
+            }
+            else
+            {
+                _currentChunk->next = chunk;
+            }
+            _currentChunk = chunk;
         }
 
-        _renderer->EndCommandList(commandList);
+        u8* command = _currentChunk->data + _currentChunk->used;
+        _currentChunk->used += size;
+
+        CommandHeader* header = reinterpret_cast<CommandHeader*>(command);
+        header->type = type;
+        header->size = static_cast<u16>(size);
+
+        return command + sizeof(CommandHeader);
     }
 
     void CommandList::PushMarker(std::string marker, Color color)
@@ -49,6 +81,12 @@ namespace Renderer
         command->pipeline = pipelineID;
     }
 
+    void CommandList::SetPipeline(ComputePipelineID pipelineID)
+    {
+        Commands::SetComputePipeline* command = AddCommand<Commands::SetComputePipeline>();
+        command->pipeline = pipelineID;
+    }
+
     void CommandList::SetScissorRect(u32 left, u32 right, u32 top, u32 bottom)
     {
         Commands::SetScissorRect* command = AddCommand<Commands::SetScissorRect>();
@@ -69,19 +107,58 @@ namespace Renderer
         command->viewport.maxDepth = maxDepth;
     }
 
-    void CommandList::SetConstantBuffer(u32 slot, void* gpuResource)
+    void CommandList::SetConstantBuffer(u32 slot, void* gpuResource, u32 offset)
     {
         Commands::SetConstantBuffer* command = AddCommand<Commands::SetConstantBuffer>();
         command->slot = slot;
         command->gpuResource = gpuResource;
+        command->offset = offset;
+    }
+
+    void CommandList::SetStorageBuffer(u32 slot, BufferID buffer)
+    {
+        Commands::SetStorageBuffer* command = AddCommand<Commands::SetStorageBuffer>();
+        command->slot = slot;
+        command->buffer = buffer;
+    }
+
+    void CommandList::SetStorageImage(u32 slot, ImageID image, u32 mipLevel)
+    {
+        Commands::SetStorageImage* command = AddCommand<Commands::SetStorageImage>();
+        command->slot = slot;
+        command->image = image;
+        command->mipLevel = mipLevel;
+    }
+
+    void CommandList::SetSampledImage(u32 slot, ImageID image)
+    {
+        Commands::SetSampledImage* command = AddCommand<Commands::SetSampledImage>();
+        command->slot = slot;
+        command->image = image;
     }
 
-    void CommandList::SetTextureSampler(u32 slot, TextureID texture, SamplerID sampler)
+    void CommandList::SetSampledImage(u32 slot, DepthImageID image)
     {
-        Commands::SetTextureSampler* command = AddCommand<Commands::SetTextureSampler>();
+        Commands::SetSampledImage* command = AddCommand<Commands::SetSampledImage>();
         command->slot = slot;
-        command->texture = texture;
-        command->sampler = sampler;
+        command->depthImage = image;
+    }
+
+    void CommandList::PushConstant(void* data, u32 offset, u32 size)
+    {
+        assert(size <= Commands::PushConstant::MAX_SIZE);
+
+        Commands::PushConstant* command = AddCommand<Commands::PushConstant>();
+        memcpy(command->data, data, size);
+        command->offset = offset;
+        command->size = size;
+    }
+
+    void CommandList::PushTextureSampler(u32 offset, TextureID texture, SamplerID sampler)
+    {
+        // TextureIDs and SamplerIDs are the indices into the texture table
+        u32 indices[2] = { static_cast<u32>(static_cast<TextureID::type>(texture)), static_cast<u32>(static_cast<SamplerID::type>(sampler)) };
+        PushConstant(indices, offset, sizeof(indices));
     }
 
     void CommandList::Clear(ImageID imageID, Color color)
@@ -100,9 +177,69 @@ namespace Renderer
         command->stencil = stencil;
     }
 
+    void CommandList::ImageBarriers(const ImageBarrier* barriers, u32 numBarriers)
+    {
+        Commands::ImageBarriers* command = AddCommand<Commands::ImageBarriers>();
+        command->barriers = barriers;
+        command->numBarriers = numBarriers;
+    }
+
+    void CommandList::UAVBarrier(ImageID image)
+    {
+        // The barriers of the RenderGraph are owned by its builder, this one lives as long as the commands do
+        ImageBarrier* barrier = Memory::Allocator::New<ImageBarrier>(_allocator);
+        barrier->image = image;
+        barrier->before = RESOURCE_STATE_UAV;
+        barrier->beforeStages = RenderGraphBuilder::SHADER_STAGE_COMPUTE;
+        barrier->after = RESOURCE_STATE_UAV;
+        barrier->afterStages = RenderGraphBuilder::SHADER_STAGE_COMPUTE;
+
+        ImageBarriers(barrier, 1);
+    }
+
+    void CommandList::BufferBarriers(const BufferBarrier* barriers, u32 numBarriers)
+    {
+        Commands::BufferBarriers* command = AddCommand<Commands::BufferBarriers>();
+        command->barriers = barriers;
+        command->numBarriers = numBarriers;
+    }
+
+    void CommandList::SetAttachmentOps(const AttachmentOps* ops, u32 numOps)
+    {
+        Commands::AttachmentOps* command = AddCommand<Commands::AttachmentOps>();
+        command->ops = ops;
+        command->numOps = numOps;
+    }
+
     void CommandList::Draw(ModelID modelID)
     {
         Commands::Draw* command = AddCommand<Commands::Draw>();
         command->model = modelID;
     }
+
+    void CommandList::DrawInstanced(ModelID modelID, u32 numInstances, u32 firstInstance, u32 lod)
+    {
+        Commands::DrawInstanced* command = AddCommand<Commands::DrawInstanced>();
+        command->model = modelID;
+        command->lod = lod;
+        command->numInstances = numInstances;
+        command->firstInstance = firstInstance;
+    }
+
+    void CommandList::DrawInstancedIndirect(ModelID modelID, BufferID argumentBuffer, u32 argumentOffset, u32 drawCount)
+    {
+        Commands::DrawInstancedIndirect* command = AddCommand<Commands::DrawInstancedIndirect>();
+        command->model = modelID;
+        command->argumentBuffer = argumentBuffer;
+        command->argumentOffset = argumentOffset;
+        command->drawCount = drawCount;
+    }
+
+    void CommandList::Dispatch(u32 threadGroupCountX, u32 threadGroupCountY, u32 threadGroupCountZ)
+    {
+        Commands::Dispatch* command = AddCommand<Commands::Dispatch>();
+        command->threadGroupCountX = threadGroupCountX;
+        command->threadGroupCountY = threadGroupCountY;
+        command->threadGroupCountZ = threadGroupCountZ;
+    }
 }
\ No newline at end of file
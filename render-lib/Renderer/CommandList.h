@@ -1,7 +1,9 @@
 #pragma once
 #include <NovusTypes.h>
-#include "BackendDispatch.h"
+#include "CommandStream.h"
 #include "Descriptors/CommandListDesc.h"
+#include "Descriptors/TextureDesc.h"
+#include "Descriptors/SamplerDesc.h"
 #include <vector>
 #include <Memory/StackAllocator.h>
 #include <Containers/DynamicArray.h>
@@ -9,13 +11,22 @@
 // Commands
 #include "Commands/Clear.h"
 #include "Commands/Draw.h"
+#include "Commands/DrawInstanced.h"
+#include "Commands/DrawInstancedIndirect.h"
+#include "Commands/Dispatch.h"
 #include "Commands/PopMarker.h"
 #include "Commands/PushMarker.h"
 #include "Commands/SetConstantBuffer.h"
+#include "Commands/SetStorageBuffer.h"
+#include "Commands/SetStorageImage.h"
+#include "Commands/SetSampledImage.h"
 #include "Commands/SetPipeline.h"
 #include "Commands/SetScissorRect.h"
 #include "Commands/SetViewport.h"
-#include "Commands/SetTextureSampler.h"
+#include "Commands/PushConstant.h"
+#include "Commands/ImageBarriers.h"
+#include "Commands/BufferBarriers.h"
+#include "Commands/AttachmentOps.h"
 
 namespace Renderer
 {
@@ -26,8 +37,6 @@ namespace Renderer
             : _renderer(renderer)
             , _allocator(allocator)
             , _markerScope(0)
-            , _functions(allocator, 32)
-            , _data(allocator, 32)
         {
 
         }
@@ -37,59 +46,67 @@ namespace Renderer
 
         void BeginPipeline(GraphicsPipelineID pipelineID);
         void EndPipeline(GraphicsPipelineID pipelineID);
+        void SetPipeline(ComputePipelineID pipelineID); // Compute pipelines can't be used between BeginPipeline and EndPipeline
 
         void SetScissorRect(u32 left, u32 right, u32 top, u32 bottom);
         void SetViewport(f32 topLeftX, f32 topLeftY, f32 width, f32 height, f32 minDepth, f32 maxDepth);
-        void SetConstantBuffer(u32 slot, void* gpuResource);
-        void SetTextureSampler(u32 slot, TextureID texture, SamplerID sampler);
+        void SetConstantBuffer(u32 slot, void* gpuResource, u32 offset);
+        void SetStorageBuffer(u32 slot, BufferID buffer);
+        void SetStorageImage(u32 slot, ImageID image, u32 mipLevel = 0); // For UAV accesses of one mip, the shader declares it as an image2D at binding 0 of the set
+        void SetSampledImage(u32 slot, ImageID image); // For reads of every mip in the shader read state, the shader declares it as a sampler2D at binding 0 of the set
+        void SetSampledImage(u32 slot, DepthImageID image);
+        void PushConstant(void* data, u32 offset, u32 size);
+        void PushTextureSampler(u32 offset, TextureID texture, SamplerID sampler); // Pushes the texture table indices of texture and sampler as two u32s
 
         void Clear(ImageID imageID, Color color);
         void Clear(DepthImageID imageID, f32 depth, DepthClearFlags flags = DepthClearFlags::DEPTH_CLEAR_DEPTH, u8 stencil = 0);
 
         void Draw(ModelID modelID);
+        void DrawInstanced(ModelID modelID, u32 numInstances, u32 firstInstance = 0, u32 lod = 0); // The instance data is read from a storage buffer indexed by gl_InstanceIndex, which includes firstInstance
+        void DrawInstancedIndirect(ModelID modelID, BufferID argumentBuffer, u32 argumentOffset, u32 drawCount = 1); // argumentBuffer holds drawCount DrawInstancedIndirectArguments starting at argumentOffset
+
+        void Dispatch(u32 threadGroupCountX, u32 threadGroupCountY = 1, u32 threadGroupCountZ = 1);
+
+        // The RenderGraph only places barriers between passes, this makes the UAV writes of the dispatches before it visible to the ones after it in the same pass
+        void UAVBarrier(ImageID image);
 
     private:
         // Execute gets friend-called from RenderGraph
         void Execute();
 
-        template<typename Command>
-        Command* AddCommand()
-        {
-            Command* command = AllocateCommand<Command>();
-
-            AddFunction(Command::DISPATCH_FUNCTION);
-            AddData(command);
+        // Record translates the commands into an already begun backend commandlist, this gets friend-called from RenderGraph and is safe to run in parallel with other CommandLists
+        void Record(CommandListID commandListID);
 
-            return command;
-        }
+        // Transitions images between the states the passes declared, this gets friend-called from RenderGraph
+        void ImageBarriers(const ImageBarrier* barriers, u32 numBarriers);
+        void BufferBarriers(const BufferBarrier* barriers, u32 numBarriers);
+        // Sets how the render passes of the next pass load and store their attachments, this gets friend-called from RenderGraph
+        void SetAttachmentOps(const AttachmentOps* ops, u32 numOps);
 
         template<typename Command>
-        Command* AllocateCommand()
+        Command* AddCommand()
         {
-            assert(_allocator != nullptr);
-
-            return Memory::Allocator::New<Command>(_allocator);
-        }
+            static_assert(alignof(Command) <= CommandChunk::ALIGNMENT, "Commands can't need a bigger alignment than the command stream has");
+            static_assert(CommandChunk::GetCommandSize<Command>() <= CommandChunk::SIZE, "Commands have to fit in a CommandChunk");
 
-        void AddFunction(const BackendDispatchFunction& function)
-        {
-            _functions.Insert(function);
+            void* command = AllocateCommand(Command::TYPE, CommandChunk::GetCommandSize<Command>());
+            return new (command) Command();
         }
 
-        void AddData(void* data)
-        {
-            _data.Insert(data);
-        }
+        // Writes the header into the stream and returns where the command itself goes
+        void* AllocateCommand(CommandType type, u32 size);
 
     private:
         Memory::Allocator* _allocator;
         Renderer* _renderer;
         u32 _markerScope;
 
-        DynamicArray<BackendDispatchFunction> _functions;
-        DynamicArray<void*> _data;
+        // The commands are packed one after another into these, each chunk is one allocation
+        CommandChunk* _firstChunk = nullptr;
+        CommandChunk* _currentChunk = nullptr;
 
         friend class RenderGraph;
+        friend class RenderGraphBuilder;
     };
 
     class ScopedMarker
@@ -0,0 +1,54 @@
+#pragma once
+#include <NovusTypes.h>
+
+namespace Renderer
+{
+    enum CommandType : u8
+    {
+        COMMAND_TYPE_CLEAR_IMAGE,
+        COMMAND_TYPE_CLEAR_DEPTH_IMAGE,
+        COMMAND_TYPE_DRAW,
+        COMMAND_TYPE_DRAW_INSTANCED,
+        COMMAND_TYPE_DRAW_INSTANCED_INDIRECT,
+        COMMAND_TYPE_DISPATCH,
+        COMMAND_TYPE_POP_MARKER,
+        COMMAND_TYPE_PUSH_MARKER,
+        COMMAND_TYPE_SET_CONSTANT_BUFFER,
+        COMMAND_TYPE_SET_STORAGE_BUFFER,
+        COMMAND_TYPE_SET_STORAGE_IMAGE,
+        COMMAND_TYPE_SET_SAMPLED_IMAGE,
+        COMMAND_TYPE_BEGIN_GRAPHICS_PIPELINE,
+        COMMAND_TYPE_END_GRAPHICS_PIPELINE,
+        COMMAND_TYPE_SET_COMPUTE_PIPELINE,
+        COMMAND_TYPE_SET_SCISSOR_RECT,
+        COMMAND_TYPE_SET_VIEWPORT,
+        COMMAND_TYPE_PUSH_CONSTANT,
+        COMMAND_TYPE_IMAGE_BARRIERS,
+        COMMAND_TYPE_BUFFER_BARRIERS,
+        COMMAND_TYPE_ATTACHMENT_OPS
+    };
+
+    // Every command in the stream is a header directly followed by the command struct
+    struct alignas(8) CommandHeader
+    {
+        CommandType type;
+        u16 size; // Header included, the next command starts this many bytes later
+    };
+
+    // A CommandList records into a linked list of these, commands never cross from one chunk to the next
+    struct CommandChunk
+    {
+        static const u32 SIZE = 4096 - 16;
+        static const u32 ALIGNMENT = alignof(CommandHeader); // Every command gets aligned to this
+
+        CommandChunk* next = nullptr;
+        u32 used = 0;
+        alignas(ALIGNMENT) u8 data[SIZE];
+
+        template<typename Command>
+        static constexpr u32 GetCommandSize()
+        {
+            return (sizeof(CommandHeader) + sizeof(Command) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../ResourceStates.h"
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        // Added by the RenderGraph in front of the passes that render to attachments, the ops are owned by the RenderGraphBuilder
+        struct AttachmentOps
+        {
+            static const CommandType TYPE = COMMAND_TYPE_ATTACHMENT_OPS;
+
+            const ::Renderer::AttachmentOps* ops = nullptr;
+            u32 numOps = 0;
+        };
+    }
+}
\ No newline at end of file
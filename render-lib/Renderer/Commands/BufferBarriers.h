@@ -0,0 +1,18 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../ResourceStates.h"
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        // Added by the RenderGraph in front of the passes that need them, the barriers are owned by the RenderGraphBuilder
+        struct BufferBarriers
+        {
+            static const CommandType TYPE = COMMAND_TYPE_BUFFER_BARRIERS;
+
+            const BufferBarrier* barriers = nullptr;
+            u32 numBarriers = 0;
+        };
+    }
+}
\ No newline at end of file
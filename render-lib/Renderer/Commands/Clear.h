@@ -9,7 +9,7 @@ namespace Renderer
     {
         struct ClearImage
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_CLEAR_IMAGE;
 
             ImageID image = ImageID::Invalid();
             Color color = Color::Clear;
@@ -17,7 +17,7 @@ namespace Renderer
         
         struct ClearDepthImage
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_CLEAR_DEPTH_IMAGE;
 
             DepthImageID image = DepthImageID::Invalid();
             DepthClearFlags flags = DepthClearFlags::DEPTH_CLEAR_BOTH;
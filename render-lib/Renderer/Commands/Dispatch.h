@@ -0,0 +1,17 @@
+#pragma once
+#include <NovusTypes.h>
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        struct Dispatch
+        {
+            static const CommandType TYPE = COMMAND_TYPE_DISPATCH;
+
+            u32 threadGroupCountX = 1;
+            u32 threadGroupCountY = 1;
+            u32 threadGroupCountZ = 1;
+        };
+    }
+}
\ No newline at end of file
@@ -9,7 +9,7 @@ namespace Renderer
     {
         struct Draw
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_DRAW;
 
             ModelID model = ModelID::Invalid();
         };
@@ -0,0 +1,19 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../Descriptors/ModelDesc.h"
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        struct DrawInstanced
+        {
+            static const CommandType TYPE = COMMAND_TYPE_DRAW_INSTANCED;
+
+            ModelID model = ModelID::Invalid();
+            u32 lod = 0;
+            u32 numInstances = 0;
+            u32 firstInstance = 0;
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../Descriptors/ModelDesc.h"
+#include "../Descriptors/BufferDesc.h"
+
+namespace Renderer
+{
+    // The layout the GPU reads the arguments of an indirect draw in, matches VkDrawIndexedIndirectCommand
+    struct DrawInstancedIndirectArguments
+    {
+        u32 numIndices = 0;
+        u32 numInstances = 0;
+        u32 firstIndex = 0;
+        i32 vertexOffset = 0;
+        u32 firstInstance = 0;
+    };
+
+    namespace Commands
+    {
+        // Same as DrawInstanced, except the index count, instance count and first instance are read from argumentBuffer on the GPU
+        // With drawCount above 1 the arguments follow each other and may draw any model in the same geometry block as model, it only decides which buffers get bound
+        struct DrawInstancedIndirect
+        {
+            static const CommandType TYPE = COMMAND_TYPE_DRAW_INSTANCED_INDIRECT;
+
+            ModelID model = ModelID::Invalid();
+            BufferID argumentBuffer = BufferID::Invalid();
+            u32 argumentOffset = 0;
+            u32 drawCount = 1;
+        };
+    }
+}
\ No newline at end of file
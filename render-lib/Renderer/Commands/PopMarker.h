@@ -7,7 +7,7 @@ namespace Renderer
     {
         struct PopMarker
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_POP_MARKER;
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+#include <NovusTypes.h>
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        struct PushConstant
+        {
+            static const CommandType TYPE = COMMAND_TYPE_PUSH_CONSTANT;
+            static const u32 MAX_SIZE = 128; // The minimum maxPushConstantsSize Vulkan guarantees
+
+            u8 data[MAX_SIZE];
+            u32 offset = 0;
+            u32 size = 0;
+        };
+    }
+}
\ No newline at end of file
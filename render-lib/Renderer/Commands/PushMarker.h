@@ -7,7 +7,7 @@ namespace Renderer
     {
         struct PushMarker
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_PUSH_MARKER;
 
             Color color = Color::White;
             char marker[16];
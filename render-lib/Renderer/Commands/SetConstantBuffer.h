@@ -8,10 +8,11 @@ namespace Renderer
     {
         struct SetConstantBuffer
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_SET_CONSTANT_BUFFER;
 
             u32 slot = 0;
             void* gpuResource = nullptr;
+            u32 offset = 0;
         };
     }
 }
\ No newline at end of file
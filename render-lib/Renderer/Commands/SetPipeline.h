@@ -9,21 +9,21 @@ namespace Renderer
     {
         struct BeginGraphicsPipeline
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_BEGIN_GRAPHICS_PIPELINE;
 
             GraphicsPipelineID pipeline = GraphicsPipelineID::Invalid();
         };
 
         struct EndGraphicsPipeline
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_END_GRAPHICS_PIPELINE;
 
             GraphicsPipelineID pipeline = GraphicsPipelineID::Invalid();
         };
         
         struct SetComputePipeline
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_SET_COMPUTE_PIPELINE;
 
             ComputePipelineID pipeline = ComputePipelineID::Invalid();
         };
@@ -0,0 +1,19 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../Descriptors/ImageDesc.h"
+#include "../Descriptors/DepthImageDesc.h"
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        struct SetSampledImage
+        {
+            static const CommandType TYPE = COMMAND_TYPE_SET_SAMPLED_IMAGE;
+
+            u32 slot = 0;
+            ImageID image = ImageID::Invalid(); // Only one of image and depthImage is set
+            DepthImageID depthImage = DepthImageID::Invalid();
+        };
+    }
+}
\ No newline at end of file
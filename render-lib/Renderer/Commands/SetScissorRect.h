@@ -8,7 +8,7 @@ namespace Renderer
     {
         struct SetScissorRect
         {
-            static const BackendDispatchFunction DISPATCH_FUNCTION;
+            static const CommandType TYPE = COMMAND_TYPE_SET_SCISSOR_RECT;
 
             ScissorRect scissorRect;
         };
@@ -0,0 +1,17 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../Descriptors/BufferDesc.h"
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        struct SetStorageBuffer
+        {
+            static const CommandType TYPE = COMMAND_TYPE_SET_STORAGE_BUFFER;
+
+            u32 slot = 0;
+            BufferID buffer = BufferID::Invalid();
+        };
+    }
+}
\ No newline at end of file
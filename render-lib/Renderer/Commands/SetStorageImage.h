@@ -0,0 +1,18 @@
+#pragma once
+#include <NovusTypes.h>
+#include "../Descriptors/ImageDesc.h"
+
+namespace Renderer
+{
+    namespace Commands
+    {
+        struct SetStorageImage
+        {
+            static const CommandType TYPE = COMMAND_TYPE_SET_STORAGE_IMAGE;
+
+            u32 slot = 0;
+            ImageID image = ImageID::Invalid();
+            u32 mipLevel = 0;
+        };
+    }
+}
\ No newline at end of file
@@ -7,8 +7,8 @@ namespace Renderer
         struct ConstantBufferBackend
         {
             virtual ~ConstantBufferBackend() {}
-            virtual void Apply(u32 frameIndex, void* data, size_t size) = 0;
-            virtual void* GetGPUResource(u32 frameIndex) = 0;
+            virtual u32 Apply(void* data, size_t size) = 0;
+            virtual void* GetGPUResource() = 0;
         };
     }
 
@@ -22,14 +22,16 @@ namespace Renderer
             return sizeof(T);
         }
 
-        void Apply(u32 frameIndex)
+        // Copies resource into this frame's constant buffer memory, bind the returned offset with CommandList::SetConstantBuffer
+        // The memory is recycled every frame, so this needs to be called every frame the constant buffer is used
+        u32 Apply()
         {
-            backend->Apply(frameIndex, &resource, GetSize());
+            return backend->Apply(&resource, GetSize());
         }
 
-        void* GetGPUResource(u32 frameIndex)
+        void* GetGPUResource()
         {
-            return backend->GetGPUResource(frameIndex);
+            return backend->GetGPUResource();
         }
 
         Backend::ConstantBufferBackend* backend = nullptr;
@@ -0,0 +1,34 @@
+#pragma once
+#include <NovusTypes.h>
+#include <Utils/StrongTypedef.h>
+
+namespace Renderer
+{
+    enum BufferUsage
+    {
+        BUFFER_USAGE_VERTEX_BUFFER = 1,
+        BUFFER_USAGE_INDEX_BUFFER = 2,
+        BUFFER_USAGE_UNIFORM_BUFFER = 4,
+        BUFFER_USAGE_STORAGE_BUFFER = 8,
+        BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER = 16,
+        BUFFER_USAGE_TRANSFER_SOURCE = 32,
+        BUFFER_USAGE_TRANSFER_DESTINATION = 64
+    };
+
+    enum BufferCPUAccess
+    {
+        BUFFER_CPU_ACCESS_NONE, // The buffer lives in device local memory, UpdateBuffer uploads into it through the staging ring and needs BUFFER_USAGE_TRANSFER_DESTINATION
+        BUFFER_CPU_ACCESS_WRITE // The CPU writes into it through UpdateBuffer, the backend keeps one copy per frame in flight
+    };
+
+    struct BufferDesc
+    {
+        std::string debugName = "";
+        size_t size = 0;
+        u8 usage = BUFFER_USAGE_STORAGE_BUFFER; // BufferUsage flags
+        BufferCPUAccess cpuAccess = BUFFER_CPU_ACCESS_NONE;
+    };
+
+    // Lets strong-typedef an ID type with the underlying type of u16
+    STRONG_TYPEDEF(BufferID, u16);
+}
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace Renderer
         std::string debugName = "";
         ivec2 dimensions = ivec2(0, 0);
         u32 depth = 1;
+        u32 mipLevels = 1; // Rendertargets only ever use the first mip, the others can be written as UAVs with SetStorageImage
         ImageFormat format = IMAGE_FORMAT_UNKNOWN;
         SampleCount sampleCount = SAMPLE_COUNT_1;
         Color clearColor = Color::Clear;
@@ -12,6 +12,25 @@ namespace Renderer
         vec2 texCoord;
     };
 
+    // Axis aligned bounding box in the local space of a model
+    struct AABB
+    {
+        vec3 min = vec3(0.0f);
+        vec3 max = vec3(0.0f);
+    };
+
+    // Every LOD is a range of the index buffer of its model, they all index the same vertices
+    // LOD 0 is the full detail mesh, each one after it has roughly half the triangles of the one before
+    const u32 MODEL_MAX_LODS = 4;
+
+    // firstIndex and vertexOffset are where the LOD is in the geometry buffers its model shares with other models
+    struct ModelLOD
+    {
+        u32 firstIndex = 0;
+        u32 numIndices = 0;
+        i32 vertexOffset = 0;
+    };
+
     struct ModelDesc
     {
         std::string path;
@@ -1,6 +1,7 @@
 #pragma once
 #include <NovusTypes.h>
 #include <vector>
+#include <taskflow/taskflow.hpp>
 
 namespace Memory
 {
@@ -13,6 +14,8 @@ namespace Renderer
 
     struct RenderGraphDesc
     {
-        Memory::Allocator* allocator;
+        Memory::Allocator* allocator; // The passes live in here, so for a persistent RenderGraph it has to live as long as the RenderGraph
+        Memory::Allocator* frameAllocator = nullptr; // Only for persistent RenderGraphs, the commandlists of each Execute get allocated from this and it has to be reset between frames
+        tf::Taskflow* taskflow = nullptr; // Optional, if set the passes will be recorded in parallel on its workers
     };
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "FrustumCuller.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <xmmintrin.h>
+#include <taskflow/taskflow.hpp>
+
+namespace Renderer
+{
+    Frustum Frustum::FromViewProjection(const mat4x4& viewProjectionMatrix)
+    {
+        // Gribb-Hartmann, the planes are sums of the rows of the matrix
+        vec4 rows[4];
+        for (i32 i = 0; i < 4; i++)
+        {
+            rows[i] = vec4(viewProjectionMatrix[0][i], viewProjectionMatrix[1][i], viewProjectionMatrix[2][i], viewProjectionMatrix[3][i]);
+        }
+
+        // The planes don't need to be normalized since we only care about which side of them something is on
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0]; // Left
+        frustum.planes[1] = rows[3] - rows[0]; // Right
+        frustum.planes[2] = rows[3] + rows[1]; // Bottom
+        frustum.planes[3] = rows[3] - rows[1]; // Top
+        frustum.planes[4] = rows[3] + rows[2]; // Near
+        frustum.planes[5] = rows[3] - rows[2]; // Far
+
+        return frustum;
+    }
+
+    void FrustumCuller::Resize(u32 numInstances)
+    {
+        _numInstances = numInstances;
+
+        // Tasks start at their batch offset, which can be anywhere, so the last group of a task can reach up to three floats past the last instance
+        size_t paddedSize = static_cast<size_t>(numInstances) + 3;
+        _centerX.assign(paddedSize, 0.0f);
+        _centerY.assign(paddedSize, 0.0f);
+        _centerZ.assign(paddedSize, 0.0f);
+        _extentX.assign(paddedSize, 0.0f);
+        _extentY.assign(paddedSize, 0.0f);
+        _extentZ.assign(paddedSize, 0.0f);
+
+        _visibleInstances.resize(numInstances);
+    }
+
+    void FrustumCuller::SetBounds(u32 instance, const AABB& localBounds, const mat4x4& modelMatrix)
+    {
+        assert(instance < _numInstances);
+
+        // Transform the center and take the extents along each world axis, this gives the world space box enclosing the transformed one
+        vec3 localCenter = (localBounds.min + localBounds.max) * 0.5f;
+        vec3 localExtents = (localBounds.max - localBounds.min) * 0.5f;
+
+        vec3 center = vec3(modelMatrix * vec4(localCenter, 1.0f));
+        vec3 extents = glm::abs(vec3(modelMatrix[0])) * localExtents.x + glm::abs(vec3(modelMatrix[1])) * localExtents.y + glm::abs(vec3(modelMatrix[2])) * localExtents.z;
+
+        _centerX[instance] = center.x;
+        _centerY[instance] = center.y;
+        _centerZ[instance] = center.z;
+        _extentX[instance] = extents.x;
+        _extentY[instance] = extents.y;
+        _extentZ[instance] = extents.z;
+    }
+
+    void FrustumCuller::Cull(const Frustum& frustum, const std::vector<u32>& batchOffsets, tf::Taskflow* taskflow)
+    {
+        u32 numBatches = static_cast<u32>(batchOffsets.size());
+
+        // Split the batches into tasks, a task never spans two batches so it can pack its visible instances in place
+        _tasks.clear();
+        for (u32 i = 0; i < numBatches; i++)
+        {
+            u32 batchEnd = (i + 1 < numBatches) ? batchOffsets[i + 1] : _numInstances;
+
+            for (u32 begin = batchOffsets[i]; begin < batchEnd; begin += INSTANCES_PER_TASK)
+            {
+                CullTask& task = _tasks.emplace_back();
+                task.batch = i;
+                task.begin = begin;
+                task.end = std::min(begin + INSTANCES_PER_TASK, batchEnd);
+            }
+        }
+
+        if (taskflow != nullptr && _tasks.size() > 1)
+        {
+            for (CullTask& task : _tasks)
+            {
+                taskflow->emplace([this, &frustum, &task]()
+                {
+                    CullRange(frustum, task);
+                });
+            }
+            taskflow->wait_for_all();
+        }
+        else
+        {
+            for (CullTask& task : _tasks)
+            {
+                CullRange(frustum, task);
+            }
+        }
+
+        // Each task packed its visible instances at its own start, move them together so each batch is one contiguous range
+        _numVisible.assign(numBatches, 0);
+        _numVisibleTotal = 0;
+
+        for (const CullTask& task : _tasks)
+        {
+            u32 destination = batchOffsets[task.batch] + _numVisible[task.batch];
+            if (destination != task.begin && task.numVisible > 0)
+            {
+                memmove(&_visibleInstances[destination], &_visibleInstances[task.begin], task.numVisible * sizeof(u32));
+            }
+
+            _numVisible[task.batch] += task.numVisible;
+            _numVisibleTotal += task.numVisible;
+        }
+    }
+
+    void FrustumCuller::CullRange(const Frustum& frustum, CullTask& task)
+    {
+        // Broadcast every plane component once, the absolute normal is used to project the extents onto the plane normal
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        __m128 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+        for (u32 i = 0; i < 6; i++)
+        {
+            const vec4& plane = frustum.planes[i];
+            planeX[i] = _mm_set1_ps(plane.x);
+            planeY[i] = _mm_set1_ps(plane.y);
+            planeZ[i] = _mm_set1_ps(plane.z);
+            planeW[i] = _mm_set1_ps(plane.w);
+            absPlaneX[i] = _mm_set1_ps(glm::abs(plane.x));
+            absPlaneY[i] = _mm_set1_ps(glm::abs(plane.y));
+            absPlaneZ[i] = _mm_set1_ps(glm::abs(plane.z));
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        u32* visibleInstances = &_visibleInstances[task.begin];
+        u32 numVisible = 0;
+
+        for (u32 i = task.begin; i < task.end; i += 4)
+        {
+            __m128 centerX = _mm_loadu_ps(&_centerX[i]);
+            __m128 centerY = _mm_loadu_ps(&_centerY[i]);
+            __m128 centerZ = _mm_loadu_ps(&_centerZ[i]);
+            __m128 extentX = _mm_loadu_ps(&_extentX[i]);
+            __m128 extentY = _mm_loadu_ps(&_extentY[i]);
+            __m128 extentZ = _mm_loadu_ps(&_extentZ[i]);
+
+            // A box is outside if it is fully behind any plane, so distance + radius < 0
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (u32 j = 0; j < 6; j++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, planeX[j]), _mm_mul_ps(centerY, planeY[j])), _mm_add_ps(_mm_mul_ps(centerZ, planeZ[j]), planeW[j]));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, absPlaneX[j]), _mm_mul_ps(extentY, absPlaneY[j])), _mm_mul_ps(extentZ, absPlaneZ[j]));
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+            }
+
+            // Branchless compaction, every lane gets written but only visible ones advance the output
+            u32 mask = static_cast<u32>(_mm_movemask_ps(inside));
+            u32 numLanes = std::min(task.end - i, 4u);
+            for (u32 lane = 0; lane < numLanes; lane++)
+            {
+                visibleInstances[numVisible] = i + lane;
+                numVisible += (mask >> lane) & 1;
+            }
+        }
+
+        task.numVisible = numVisible;
+    }
+}
\ No newline at end of file
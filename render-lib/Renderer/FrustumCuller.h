@@ -0,0 +1,65 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <taskflow/taskflow.hpp>
+#include "Descriptors/ModelDesc.h"
+
+namespace Renderer
+{
+    struct Frustum
+    {
+        // Left, right, bottom, top, near, far, xyz is the normal pointing into the frustum and w the distance
+        vec4 planes[6];
+
+        static Frustum FromViewProjection(const mat4x4& viewProjectionMatrix);
+    };
+
+    // Culls the instances of a RenderLayer against a frustum, the instances are laid out batch after batch the same way the renderer lays them out in its instance buffer
+    // The world space bounds are kept as structure of arrays so four of them get tested at once with SSE
+    class FrustumCuller
+    {
+    public:
+        // Discards all bounds, call this when the layout of the layer changed and set the bounds of every instance again
+        void Resize(u32 numInstances);
+        void SetBounds(u32 instance, const AABB& localBounds, const mat4x4& modelMatrix);
+
+        // batchOffsets is where each batch starts, the instances of a batch go up until the start of the next one
+        // If taskflow is set the instances get culled in parallel on its workers
+        void Cull(const Frustum& frustum, const std::vector<u32>& batchOffsets, tf::Taskflow* taskflow);
+
+        // The visible instances of each batch are packed starting at the offset of the batch
+        const std::vector<u32>& GetVisibleInstances() { return _visibleInstances; }
+        u32 GetNumVisible(u32 batch) { return _numVisible[batch]; }
+        u32 GetNumVisibleTotal() { return _numVisibleTotal; }
+
+    public:
+        static const u32 INSTANCES_PER_TASK = 2048;
+
+    private:
+        struct CullTask
+        {
+            u32 batch = 0;
+            u32 begin = 0;
+            u32 end = 0;
+            u32 numVisible = 0;
+        };
+
+        void CullRange(const Frustum& frustum, CullTask& task);
+
+    private:
+        u32 _numInstances = 0;
+
+        // Padded with three extra floats so the last group of any task can be loaded as a whole
+        std::vector<f32> _centerX;
+        std::vector<f32> _centerY;
+        std::vector<f32> _centerZ;
+        std::vector<f32> _extentX;
+        std::vector<f32> _extentY;
+        std::vector<f32> _extentZ;
+
+        std::vector<CullTask> _tasks;
+        std::vector<u32> _visibleInstances;
+        std::vector<u32> _numVisible; // Per batch
+        u32 _numVisibleTotal = 0;
+    };
+}
\ No newline at end of file
@@ -3,11 +3,10 @@
 
 namespace Renderer
 {
-    // This struct needs to be 256 bytes padded
+    // The CPU side of an instance, renderers pack it into whatever their shaders read
     struct InstanceData
     {
         vec4 colorMultiplier = vec4(1,1,1,1); // 16 bytes
         mat4x4 modelMatrix = mat4x4(1.0f); // 64 bytes
-        u8 padding[176];
     };
 }
\ No newline at end of file
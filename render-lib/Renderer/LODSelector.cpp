@@ -0,0 +1,119 @@
+#include "LODSelector.h"
+#include "FrustumCuller.h"
+#include <cassert>
+#include <algorithm>
+#include <limits>
+
+namespace Renderer
+{
+    void LODSelector::Resize(u32 numInstances)
+    {
+        _spheres.assign(numInstances, vec4(0.0f));
+        _lods.assign(numInstances, 0);
+        _isPinned.assign(numInstances, 0);
+        _distances.assign(numInstances, 0.0f);
+        _sortedInstances.resize(numInstances);
+    }
+
+    void LODSelector::SetBounds(u32 instance, const AABB& localBounds, const mat4x4& modelMatrix, bool pinToLOD0)
+    {
+        assert(instance < _spheres.size());
+
+        // The sphere around the world space box FrustumCuller::SetBounds builds, so the culling pass can get the same one on the GPU
+        vec3 localCenter = (localBounds.min + localBounds.max) * 0.5f;
+        vec3 localExtents = (localBounds.max - localBounds.min) * 0.5f;
+
+        vec3 center = vec3(modelMatrix * vec4(localCenter, 1.0f));
+        vec3 extents = glm::abs(vec3(modelMatrix[0])) * localExtents.x + glm::abs(vec3(modelMatrix[1])) * localExtents.y + glm::abs(vec3(modelMatrix[2])) * localExtents.z;
+
+        _spheres[instance] = vec4(center, glm::length(extents));
+        _isPinned[instance] = pinToLOD0;
+    }
+
+    void LODSelector::Select(const vec3& cameraPosition, f32 projectionScale, const std::vector<u32>& batchOffsets, const std::vector<u32>& batchNumLODs, FrustumCuller& frustumCuller)
+    {
+        u32 numBatches = static_cast<u32>(batchOffsets.size());
+        _firstInstances.assign(numBatches * MODEL_MAX_LODS, 0);
+        _numInstances.assign(numBatches * MODEL_MAX_LODS, 0);
+        _nearestDistances.assign(numBatches, 0.0f);
+
+        const std::vector<u32>& visibleInstances = frustumCuller.GetVisibleInstances();
+
+        for (u32 i = 0; i < numBatches; i++)
+        {
+            u32 batchOffset = batchOffsets[i];
+            u32 numVisible = frustumCuller.GetNumVisible(i);
+            u32* numInstances = &_numInstances[i * MODEL_MAX_LODS];
+            u32* firstInstances = &_firstInstances[i * MODEL_MAX_LODS];
+            f32 nearestDistance = std::numeric_limits<f32>::max();
+
+            for (u32 j = 0; j < numVisible; j++)
+            {
+                u32 instance = visibleInstances[batchOffset + j];
+                const vec4& sphere = _spheres[instance];
+
+                // Clamping the distance to the radius keeps the camera from dividing by zero when it is inside the sphere
+                f32 distance = glm::length(vec3(sphere) - cameraPosition);
+                f32 screenSize = sphere.w * projectionScale / glm::max(distance, sphere.w);
+
+                _distances[instance] = distance;
+                nearestDistance = glm::min(nearestDistance, distance);
+
+                u32 lod = _isPinned[instance] ? 0 : SelectLOD(screenSize, _lods[instance], batchNumLODs[i]);
+                _lods[instance] = lod;
+                numInstances[lod]++;
+            }
+
+            // Counting sort, each LOD gets a contiguous range so it can be drawn with one call
+            u32 offset = batchOffset;
+            for (u32 lod = 0; lod < MODEL_MAX_LODS; lod++)
+            {
+                firstInstances[lod] = offset;
+                offset += numInstances[lod];
+            }
+
+            u32 writeOffsets[MODEL_MAX_LODS];
+            for (u32 lod = 0; lod < MODEL_MAX_LODS; lod++)
+            {
+                writeOffsets[lod] = firstInstances[lod];
+            }
+
+            for (u32 j = 0; j < numVisible; j++)
+            {
+                u32 instance = visibleInstances[batchOffset + j];
+                _sortedInstances[writeOffsets[_lods[instance]]++] = instance;
+            }
+
+            // Front to back within each LOD, so the instances drawn by one call get the most out of early-Z
+            for (u32 lod = 0; lod < MODEL_MAX_LODS; lod++)
+            {
+                auto begin = _sortedInstances.begin() + firstInstances[lod];
+                std::sort(begin, begin + numInstances[lod], [this](u32 a, u32 b) { return _distances[a] < _distances[b]; });
+            }
+
+            if (numVisible > 0)
+            {
+                _nearestDistances[i] = nearestDistance;
+            }
+        }
+    }
+
+    u32 LODSelector::SelectLOD(f32 screenSize, u32 currentLOD, u32 numLODs)
+    {
+        // Lets make sure the model has at least one LOD
+        assert(numLODs > 0);
+
+        // Only move past a threshold once the size is clearly on the other side of it
+        u32 lod = glm::min(currentLOD, numLODs - 1);
+        while (lod + 1 < numLODs && screenSize < SCREEN_SIZES[lod] * (1.0f - HYSTERESIS))
+        {
+            lod++;
+        }
+        while (lod > 0 && screenSize > SCREEN_SIZES[lod - 1] * (1.0f + HYSTERESIS))
+        {
+            lod--;
+        }
+
+        return lod;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include "Descriptors/ModelDesc.h"
+
+namespace Renderer
+{
+    class FrustumCuller;
+
+    // Picks a LOD for the visible instances of a RenderLayer from how much of the screen height their bounding spheres cover
+    // Every instance remembers its LOD and only switches once it is HYSTERESIS past a threshold, otherwise instances right on a threshold would pop back and forth
+    class LODSelector
+    {
+    public:
+        // Resets every instance to LOD 0, call this when the layout of the layer changed and set the bounds of every instance again
+        void Resize(u32 numInstances);
+        // Pinned instances always use LOD 0, for instances that also get drawn somewhere else at LOD 0 like a depth prepass
+        void SetBounds(u32 instance, const AABB& localBounds, const mat4x4& modelMatrix, bool pinToLOD0 = false);
+
+        // projectionScale is [1][1] of the projection matrix, a sphere with radius r at distance d then covers r * projectionScale / d of the screen height
+        // batchNumLODs is how many LODs the model of each batch has, the visible instances of each batch get sorted by LOD starting at the offset of the batch, and front to back within each LOD
+        void Select(const vec3& cameraPosition, f32 projectionScale, const std::vector<u32>& batchOffsets, const std::vector<u32>& batchNumLODs, FrustumCuller& frustumCuller);
+
+        const std::vector<u32>& GetSortedInstances() { return _sortedInstances; }
+        u32 GetFirstInstance(u32 batch, u32 lod) { return _firstInstances[batch * MODEL_MAX_LODS + lod]; }
+        u32 GetNumInstances(u32 batch, u32 lod) { return _numInstances[batch * MODEL_MAX_LODS + lod]; }
+        f32 GetNearestDistance(u32 batch) { return _nearestDistances[batch]; } // Distance from the camera to the nearest visible instance of the batch, 0 if none are visible
+        const std::vector<u32>& GetLODs() { return _lods; }
+
+        static u32 SelectLOD(f32 screenSize, u32 currentLOD, u32 numLODs);
+
+    public:
+        // LOD N gets used until the bounding sphere covers less than SCREEN_SIZES[N] of the screen height
+        static constexpr f32 SCREEN_SIZES[MODEL_MAX_LODS - 1] = { 0.25f, 0.1f, 0.04f };
+        static constexpr f32 HYSTERESIS = 0.15f;
+
+    private:
+        std::vector<vec4> _spheres; // World space, xyz is the center and w the radius
+        std::vector<u32> _lods;
+        std::vector<u8> _isPinned;
+        std::vector<f32> _distances; // From the camera, only up to date for the instances visible in the last Select
+
+        std::vector<u32> _sortedInstances;
+        std::vector<u32> _firstInstances; // Per batch and LOD
+        std::vector<u32> _numInstances; // Per batch and LOD
+        std::vector<f32> _nearestDistances; // Per batch
+    };
+}
\ No newline at end of file
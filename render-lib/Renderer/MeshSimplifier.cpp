@@ -0,0 +1,298 @@
+#include "MeshSimplifier.h"
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+namespace Renderer
+{
+    MeshSimplifier::Quadric MeshSimplifier::Quadric::FromPlane(const vec3& normal, f32 distance, f32 weight)
+    {
+        Quadric quadric;
+        quadric.a2 = normal.x * normal.x * weight;
+        quadric.ab = normal.x * normal.y * weight;
+        quadric.ac = normal.x * normal.z * weight;
+        quadric.ad = normal.x * distance * weight;
+        quadric.b2 = normal.y * normal.y * weight;
+        quadric.bc = normal.y * normal.z * weight;
+        quadric.bd = normal.y * distance * weight;
+        quadric.c2 = normal.z * normal.z * weight;
+        quadric.cd = normal.z * distance * weight;
+        quadric.d2 = distance * distance * weight;
+        quadric.weight = weight;
+
+        return quadric;
+    }
+
+    void MeshSimplifier::Quadric::Add(const Quadric& other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+    }
+
+    f32 MeshSimplifier::Quadric::Evaluate(const vec3& p) const
+    {
+        f32 error = a2 * p.x * p.x + 2.0f * ab * p.x * p.y + 2.0f * ac * p.x * p.z + 2.0f * ad * p.x
+                  + b2 * p.y * p.y + 2.0f * bc * p.y * p.z + 2.0f * bd * p.y
+                  + c2 * p.z * p.z + 2.0f * cd * p.z
+                  + d2;
+
+        // Rounding can make it go slightly negative on flat areas
+        return glm::max(error, 0.0f);
+    }
+
+    f32 MeshSimplifier::Quadric::EvaluateDistanceSquared(const vec3& position) const
+    {
+        if (weight <= 0.0f)
+            return 0.0f;
+
+        return Evaluate(position) / weight;
+    }
+
+    void MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, const std::vector<i16>& indices, size_t targetNumIndices, f32 maxError, std::vector<i16>& outIndices)
+    {
+        // Lets make sure this is a triangle list
+        assert(indices.size() % 3 == 0);
+
+        u32 numVertices = static_cast<u32>(vertices.size());
+        std::vector<u32> triangles(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            triangles[i] = static_cast<u16>(indices[i]);
+        }
+
+        // Vertices are split wherever the normal or texcoord changes, weld them by position so both sides of a seam are treated as one vertex
+        std::vector<u32> sortedVertices(numVertices);
+        std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+        std::sort(sortedVertices.begin(), sortedVertices.end(), [&](u32 a, u32 b)
+        {
+            const vec3& posA = vertices[a].pos;
+            const vec3& posB = vertices[b].pos;
+            if (posA.x != posB.x)
+                return posA.x < posB.x;
+            if (posA.y != posB.y)
+                return posA.y < posB.y;
+            return posA.z < posB.z;
+        });
+
+        std::vector<u32> weld(numVertices);
+        std::vector<bool> locked(numVertices, false); // Indexed by the welded vertex
+        for (u32 begin = 0; begin < numVertices;)
+        {
+            u32 end = begin + 1;
+            while (end < numVertices && vertices[sortedVertices[end]].pos == vertices[sortedVertices[begin]].pos)
+            {
+                end++;
+            }
+
+            for (u32 i = begin; i < end; i++)
+            {
+                weld[sortedVertices[i]] = sortedVertices[begin];
+            }
+
+            // Moving a seam vertex would need all of its copies to move together
+            locked[sortedVertices[begin]] = (end - begin) > 1;
+            begin = end;
+        }
+
+        // Edges that don't have exactly two triangles are open borders or non manifold, lock both ends of them
+        std::vector<std::pair<u32, u32>> edges;
+        edges.reserve(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (u32 j = 0; j < 3; j++)
+            {
+                u32 a = weld[triangles[i + j]];
+                u32 b = weld[triangles[i + (j + 1) % 3]];
+                edges.push_back(std::make_pair(glm::min(a, b), glm::max(a, b)));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t begin = 0; begin < edges.size();)
+        {
+            size_t end = begin + 1;
+            while (end < edges.size() && edges[end] == edges[begin])
+            {
+                end++;
+            }
+
+            if (end - begin != 2)
+            {
+                locked[edges[begin].first] = true;
+                locked[edges[begin].second] = true;
+            }
+            begin = end;
+        }
+
+        // Every triangle adds its plane to the quadrics of its corners, weighted by its area so small triangles don't dominate
+        std::vector<Quadric> quadrics(numVertices); // Indexed by the welded vertex
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            const vec3& p0 = vertices[triangles[i]].pos;
+            const vec3& p1 = vertices[triangles[i + 1]].pos;
+            const vec3& p2 = vertices[triangles[i + 2]].pos;
+
+            vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            f32 doubleArea = glm::length(normal);
+            if (doubleArea == 0.0f)
+                continue;
+
+            normal /= doubleArea;
+            Quadric quadric = Quadric::FromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5f);
+
+            for (u32 j = 0; j < 3; j++)
+            {
+                quadrics[weld[triangles[i + j]]].Add(quadric);
+            }
+        }
+
+        f32 maxErrorSquared = maxError * maxError;
+        std::vector<Collapse> collapses;
+        std::vector<u32> remap(numVertices);
+        std::vector<bool> touched(numVertices);
+        std::vector<u32> triangleOffsets(numVertices + 1);
+        std::vector<u32> vertexTriangles;
+
+        // Collapse in passes, a vertex only takes part in one collapse per pass so the errors and adjacency of a pass stay valid
+        while (triangles.size() > targetNumIndices)
+        {
+            collapses.clear();
+            for (size_t i = 0; i < triangles.size(); i += 3)
+            {
+                for (u32 j = 0; j < 3; j++)
+                {
+                    u32 from = triangles[i + j];
+                    u32 to = triangles[i + (j + 1) % 3];
+
+                    for (u32 k = 0; k < 2; k++)
+                    {
+                        if (!locked[weld[from]])
+                        {
+                            Quadric quadric = quadrics[weld[from]];
+                            quadric.Add(quadrics[weld[to]]);
+
+                            Collapse& collapse = collapses.emplace_back();
+                            collapse.from = from;
+                            collapse.to = to;
+                            collapse.error = quadric.EvaluateDistanceSquared(vertices[to].pos);
+                        }
+                        std::swap(from, to);
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+            // Which triangles each vertex is a corner of
+            std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+            for (u32 vertex : triangles)
+            {
+                triangleOffsets[vertex + 1]++;
+            }
+            for (u32 i = 0; i < numVertices; i++)
+            {
+                triangleOffsets[i + 1] += triangleOffsets[i];
+            }
+
+            vertexTriangles.resize(triangles.size());
+            std::vector<u32> writeOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); i++)
+            {
+                vertexTriangles[writeOffsets[triangles[i]]++] = static_cast<u32>(i / 3);
+            }
+
+            std::iota(remap.begin(), remap.end(), 0);
+            std::fill(touched.begin(), touched.end(), false);
+
+            size_t numTrianglesToRemove = (triangles.size() - targetNumIndices + 2) / 3;
+            size_t numTrianglesRemoved = 0;
+            u32 numCollapses = 0;
+
+            for (const Collapse& collapse : collapses)
+            {
+                if (collapse.error > maxErrorSquared || numTrianglesRemoved >= numTrianglesToRemove)
+                    break;
+
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                // Reject the collapse if any of the triangles that stay would flip over
+                const vec3& newPosition = vertices[collapse.to].pos;
+                bool flips = false;
+                u32 numRemoved = 0;
+
+                for (u32 i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++)
+                {
+                    const u32* triangle = &triangles[vertexTriangles[i] * 3];
+                    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                    {
+                        numRemoved++;
+                        continue;
+                    }
+
+                    vec3 positions[3] = { vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos };
+                    vec3 oldNormal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+                    for (u32 j = 0; j < 3; j++)
+                    {
+                        if (triangle[j] == collapse.from)
+                            positions[j] = newPosition;
+                    }
+                    vec3 newNormal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+
+                    if (glm::dot(oldNormal, newNormal) <= 0.0f)
+                    {
+                        flips = true;
+                        break;
+                    }
+                }
+
+                if (flips)
+                    continue;
+
+                // Everything around the moved vertex changed shape, so none of it can collapse again until the next pass
+                for (u32 i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++)
+                {
+                    const u32* triangle = &triangles[vertexTriangles[i] * 3];
+                    touched[triangle[0]] = true;
+                    touched[triangle[1]] = true;
+                    touched[triangle[2]] = true;
+                }
+
+                remap[collapse.from] = collapse.to;
+                quadrics[weld[collapse.to]].Add(quadrics[weld[collapse.from]]);
+
+                numTrianglesRemoved += numRemoved;
+                numCollapses++;
+            }
+
+            if (numCollapses == 0)
+                break;
+
+            // Apply the collapses and drop the triangles that lost their area
+            size_t numIndices = 0;
+            for (size_t i = 0; i < triangles.size(); i += 3)
+            {
+                u32 a = remap[triangles[i]];
+                u32 b = remap[triangles[i + 1]];
+                u32 c = remap[triangles[i + 2]];
+
+                if (weld[a] == weld[b] || weld[b] == weld[c] || weld[c] == weld[a])
+                    continue;
+
+                triangles[numIndices++] = a;
+                triangles[numIndices++] = b;
+                triangles[numIndices++] = c;
+            }
+            triangles.resize(numIndices);
+        }
+
+        outIndices.resize(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            outIndices[i] = static_cast<i16>(triangles[i]);
+        }
+    }
+}
\ No newline at end of file
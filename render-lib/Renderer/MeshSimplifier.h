@@ -0,0 +1,39 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include "Descriptors/ModelDesc.h"
+
+namespace Renderer
+{
+    // Quadric error mesh simplification, every collapse moves a vertex onto one of its neighbours so the simplified indices still index the original vertices
+    // Vertices on open borders and on normal or texcoord seams never move, that keeps the simplified mesh from tearing open
+    class MeshSimplifier
+    {
+    public:
+        // Collapses the cheapest edges until there are at most targetNumIndices left or the next collapse would move the surface further than maxError
+        static void Simplify(const std::vector<Vertex>& vertices, const std::vector<i16>& indices, size_t targetNumIndices, f32 maxError, std::vector<i16>& outIndices);
+
+    private:
+        // The sum of the squared distances to a set of planes, kept as the upper triangle of a symmetric 4x4 matrix
+        struct Quadric
+        {
+            f32 a2 = 0.0f, ab = 0.0f, ac = 0.0f, ad = 0.0f;
+            f32 b2 = 0.0f, bc = 0.0f, bd = 0.0f;
+            f32 c2 = 0.0f, cd = 0.0f;
+            f32 d2 = 0.0f;
+            f32 weight = 0.0f; // The summed area of the planes
+
+            static Quadric FromPlane(const vec3& normal, f32 distance, f32 weight);
+            void Add(const Quadric& other);
+            f32 Evaluate(const vec3& position) const; // Area weighted, so area times squared distance
+            f32 EvaluateDistanceSquared(const vec3& position) const; // Divided by the area, so it compares against distances no matter how big the mesh is
+        };
+
+        struct Collapse
+        {
+            u32 from = 0;
+            u32 to = 0;
+            f32 error = 0.0f;
+        };
+    };
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "RenderGraphBuilder.h"
 
 #include "Renderer.h"
+#include <Utils/XXHash64.h>
+#include <taskflow/taskflow.hpp>
 
 namespace Renderer
 {
@@ -10,8 +12,6 @@ namespace Renderer
         _desc = desc;
         assert(desc.allocator != nullptr); // You need to set an allocator
 
-        _renderGraphBuilder = Memory::Allocator::New<RenderGraphBuilder>(desc.allocator, desc.allocator, _renderer);
-
         return true;
     }
 
@@ -21,6 +21,8 @@ namespace Renderer
         {
             pass->DeInit();
         }
+
+        delete _compileAllocator;
     }
 
     /*void RenderGraph::AddPass(RenderPass& pass)
@@ -30,26 +32,183 @@ namespace Renderer
 
     void RenderGraph::Setup()
     {
-        for (IRenderPass* pass : _passes)
+        if (_isCompiled && !_isDirty)
+            return;
+
+        _isDirty = false;
+
+        if (_isCompiled)
+        {
+            // Running the setups against a builder that only lives this frame is enough to see if the declarations changed
+            Memory::Allocator* frameAllocator = GetFrameAllocator();
+            RenderGraphBuilder* builder = Memory::Allocator::New<RenderGraphBuilder>(frameAllocator, frameAllocator, _renderer);
+
+            u64 passHash = RunSetups(builder, nullptr);
+            u64 declarationHash = builder->CalculateDeclarationHash(passHash);
+
+            // It handed out transient images that the recompile needs to get again
+            builder->ReleaseTransientImages();
+
+            if (declarationHash == _declarationHash)
+                return;
+        }
+
+        Compile();
+    }
+
+    void RenderGraph::Compile()
+    {
+        Memory::Allocator* allocator = _desc.allocator;
+
+        // A persistent RenderGraph might compile several times, so what it compiles can't pile up in its allocator
+        if (_desc.frameAllocator != nullptr)
+        {
+            if (_compileAllocator == nullptr)
+            {
+                _compileAllocator = new Memory::StackAllocator(COMPILE_ALLOCATOR_SIZE);
+                _compileAllocator->Init();
+            }
+            else
+            {
+                _compileAllocator->Reset();
+            }
+
+            allocator = _compileAllocator;
+        }
+
+        _renderGraphBuilder = Memory::Allocator::New<RenderGraphBuilder>(allocator, allocator, _renderer);
+        _executingPasses = Memory::Allocator::New<DynamicArray<IRenderPass*>>(allocator, allocator, 32);
+
+        DynamicArray<IRenderPass*> setupPasses(allocator, 32);
+        u64 passHash = RunSetups(_renderGraphBuilder, &setupPasses);
+
+        // Passes whose writes nothing reads don't need to execute, writes to permanent images always count as read since they outlive the RenderGraph
+        u32 numSetupPasses = static_cast<u32>(setupPasses.Count());
+        std::vector<bool> isCulled;
+        _renderGraphBuilder->CullPasses(numSetupPasses, isCulled);
+
+        for (u32 i = 0; i < numSetupPasses; i++)
         {
-            if (pass->Setup(_renderGraphBuilder))
+            if (!isCulled[i])
             {
-                _executingPasses.Insert(pass);
+                _executingPasses->Insert(setupPasses[i]);
             }
         }
+
+        _renderGraphBuilder->Compile(static_cast<u32>(_executingPasses->Count()));
+
+        _declarationHash = _renderGraphBuilder->CalculateDeclarationHash(passHash);
+        _isCompiled = true;
+    }
+
+    u64 RenderGraph::RunSetups(RenderGraphBuilder* builder, DynamicArray<IRenderPass*>* setupPasses)
+    {
+        u64 passHash = 0;
+        u32 numSetupPasses = 0;
+
+        for (u32 i = 0; i < _passes.Count(); i++)
+        {
+            builder->SetCurrentPass(numSetupPasses);
+
+            if (_passes[i]->Setup(builder))
+            {
+                if (setupPasses != nullptr)
+                {
+                    setupPasses->Insert(_passes[i]);
+                }
+                numSetupPasses++;
+
+                passHash = XXHash64::hash(&i, sizeof(i), passHash);
+            }
+            else
+            {
+                builder->DiscardCurrentPass();
+            }
+        }
+
+        return passHash;
     }
 
     void RenderGraph::Execute()
     {
-        // TODO: Parallel_for this
-        CommandList commandList(_renderer, _desc.allocator);
-        commandList.PushMarker("RenderGraph", Color(0.0f, 0.0f, 0.4f));
-        for (IRenderPass* pass : _executingPasses)
+        assert(_isCompiled); // You need to call Setup before Execute
+
+        _renderGraphBuilder->AllocateTransientImages();
+
+        size_t numPasses = _executingPasses->Count();
+        if (numPasses == 0)
+            return;
+
+        // Let every pass fill its own CommandList, this calls into user code which creates pipelines etc so it has to stay on this thread
+        Memory::Allocator* frameAllocator = GetFrameAllocator();
+        DynamicArray<CommandList*> commandLists(frameAllocator, numPasses);
+        for (size_t i = 0; i < numPasses; i++)
         {
-            pass->Execute(commandList);
+            CommandList* commandList = Memory::Allocator::New<CommandList>(frameAllocator, _renderer, frameAllocator);
+            _renderGraphBuilder->AddBarriers(static_cast<u32>(i), *commandList);
+            _renderGraphBuilder->AddAttachmentOps(static_cast<u32>(i), *commandList);
+            (*_executingPasses)[i]->Execute(*commandList);
+
+            // Permanent images get transitioned back to where they rest between RenderGraphs after the last pass
+            if (i == numPasses - 1)
+            {
+                _renderGraphBuilder->AddBarriers(static_cast<u32>(numPasses), *commandList);
+            }
+
+            commandLists.Insert(commandList);
         }
-        commandList.PopMarker();
-        commandList.Execute();
+
+        // Passes merged with the pass before them get recorded into the same backend commandlist, that way they can keep rendering in the same render pass
+        std::vector<size_t> firstPasses;
+        for (size_t i = 0; i < numPasses; i++)
+        {
+            if (i == 0 || !_renderGraphBuilder->IsMergedWithPrevious(static_cast<u32>(i)))
+            {
+                firstPasses.push_back(i);
+            }
+        }
+        size_t numCommandLists = firstPasses.size();
+        firstPasses.push_back(numPasses);
+
+        // Grab the backend commandlists up front, the backend recycles them so this isn't threadsafe
+        std::vector<CommandListID> commandListIDs(numCommandLists);
+        for (size_t i = 0; i < numCommandLists; i++)
+        {
+            commandListIDs[i] = _renderer->BeginCommandList();
+        }
+
+        // Record each group of merged passes into its own backend commandlist
+        if (_desc.taskflow != nullptr)
+        {
+            for (size_t i = 0; i < numCommandLists; i++)
+            {
+                size_t firstPass = firstPasses[i];
+                size_t endPass = firstPasses[i + 1];
+                CommandListID commandListID = commandListIDs[i];
+
+                _desc.taskflow->emplace([&commandLists, firstPass, endPass, commandListID]()
+                {
+                    for (size_t j = firstPass; j < endPass; j++)
+                    {
+                        commandLists[j]->Record(commandListID);
+                    }
+                });
+            }
+            _desc.taskflow->wait_for_all();
+        }
+        else
+        {
+            for (size_t i = 0; i < numCommandLists; i++)
+            {
+                for (size_t j = firstPasses[i]; j < firstPasses[i + 1]; j++)
+                {
+                    commandLists[j]->Record(commandListIDs[i]);
+                }
+            }
+        }
+
+        // Submit them all at once, in the same order as the passes were added
+        _renderer->EndCommandLists(commandListIDs.data(), static_cast<u32>(numCommandLists));
     }
 
     void RenderGraph::InitializePipelineDesc(GraphicsPipelineDesc& desc)
@@ -28,9 +28,13 @@ namespace Renderer
             _passes.Insert(pass);
         }
 
+        // Runs the setups and compiles the graph, a persistent RenderGraph only does this again after Invalidate and if the declarations changed
         void Setup();
         void Execute();
 
+        // Call this on persistent RenderGraphs when something the setups depend on changed
+        void Invalidate() { _isDirty = true; }
+
         RenderGraphBuilder* GetBuilder() { return _renderGraphBuilder; }
 
         void InitializePipelineDesc(GraphicsPipelineDesc& desc);
@@ -40,12 +44,15 @@ namespace Renderer
             : _renderer(renderer)
             , _renderGraphBuilder(nullptr)
             , _passes(allocator, 32)
-            , _executingPasses(allocator, 32)
         {
         
         } // This gets friend-created by Renderer
         bool Init(RenderGraphDesc& desc);
 
+        void Compile();
+        u64 RunSetups(RenderGraphBuilder* builder, DynamicArray<IRenderPass*>* setupPasses); // Returns a hash of which passes are enabled
+        Memory::Allocator* GetFrameAllocator() { return (_desc.frameAllocator != nullptr) ? _desc.frameAllocator : _desc.allocator; }
+
     private:
         RenderGraphDesc _desc;
 
@@ -53,11 +60,19 @@ namespace Renderer
         //std::vector<IRenderPass*> _executingPasses;
 
         DynamicArray<IRenderPass*> _passes;
-        DynamicArray<IRenderPass*> _executingPasses;
+        DynamicArray<IRenderPass*>* _executingPasses = nullptr; // Lives with the builder
 
         Renderer* _renderer;
         RenderGraphBuilder* _renderGraphBuilder;
 
+        // Persistent RenderGraphs keep the builder and everything compiled in here, so a recompile can start over with an empty one
+        Memory::StackAllocator* _compileAllocator = nullptr;
+        static const size_t COMPILE_ALLOCATOR_SIZE = 1 * 1024 * 1024; // 1 MB
+
+        bool _isCompiled = false;
+        bool _isDirty = false;
+        u64 _declarationHash = 0;
+
         friend class Renderer; // To have access to the constructor
     };
 }
\ No newline at end of file
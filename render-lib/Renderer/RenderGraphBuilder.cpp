@@ -1,35 +1,736 @@
 #include "RenderGraphBuilder.h"
 #include "Renderer.h"
 #include "RenderGraph.h"
+#include <Utils/XXHash64.h>
+#include <algorithm>
 
 namespace Renderer
 {
     RenderGraphBuilder::RenderGraphBuilder(Memory::Allocator* allocator, Renderer* renderer)
-        : _renderer(renderer)
+        : _allocator(allocator)
+        , _renderer(renderer)
         , _trackedImages(allocator, 32)
         , _trackedTextures(allocator, 32)
         , _trackedDepthImages(allocator, 32)
+        , _trackedBuffers(allocator, 16)
+        , _transientImages(allocator, 16)
+        , _usedTransientImages(allocator, 16)
+        , _accesses(allocator, 64)
+        , _barriers(allocator, 64)
+        , _barrierBatches(allocator, 32)
+        , _bufferAccesses(allocator, 32)
+        , _bufferBarriers(allocator, 32)
+        , _bufferBarrierBatches(allocator, 16)
+        , _attachmentOps(allocator, 32)
+        , _attachmentOpsBatches(allocator, 32)
+        , _mergedWithPrevious(allocator, 32)
     {
 
     }
 
-    void RenderGraphBuilder::Compile(CommandList* /*commandList*/)
+    void RenderGraphBuilder::DiscardCurrentPass()
     {
+        // The accesses of the current pass are at the end
+        for (size_t i = _accesses.Count(); i > 0; i--)
+        {
+            ResourceAccess& access = _accesses[i - 1];
+            if (access.pass != _currentPass)
+                break;
+
+            access.pass = INVALID_PASS;
+        }
+
+        for (size_t i = _bufferAccesses.Count(); i > 0; i--)
+        {
+            BufferAccess& access = _bufferAccesses[i - 1];
+            if (access.pass != _currentPass)
+                break;
+
+            access.pass = INVALID_PASS;
+        }
+    }
+
+    void RenderGraphBuilder::CullPasses(u32 numPasses, std::vector<bool>& isCulled)
+    {
+        isCulled.assign(numPasses, false);
+
+        // Transient images that a pass we keep still needs the current contents of, permanent images always outlive the RenderGraph
+        std::vector<bool> isLive(_transientImages.Count(), false);
+
+        // Buffers are permanent, so a pass writing one is always needed
+        std::vector<bool> writesBuffer(numPasses, false);
+        for (const BufferAccess& access : _bufferAccesses)
+        {
+            if (access.pass != INVALID_PASS && access.state == RESOURCE_STATE_UAV)
+            {
+                writesBuffer[access.pass] = true;
+            }
+        }
+
+        // Walk the passes backwards so we know which contents later passes need when we get to the pass producing them
+        size_t end = _accesses.Count();
+        for (u32 pass = numPasses; pass > 0; pass--)
+        {
+            u32 passIndex = pass - 1;
+
+            // Accesses are in pass order, with the ones of discarded passes mixed in
+            size_t begin = end;
+            while (begin > 0 && (_accesses[begin - 1].pass == passIndex || _accesses[begin - 1].pass == INVALID_PASS))
+            {
+                begin--;
+            }
+
+            bool hasWrites = writesBuffer[passIndex];
+            bool isNeeded = writesBuffer[passIndex];
+            for (size_t i = begin; i < end; i++)
+            {
+                const ResourceAccess& access = _accesses[i];
+                if (access.pass != passIndex || access.state == RESOURCE_STATE_SHADER_READ)
+                    continue;
+
+                hasWrites = true;
+
+                u32 transientIndex = GetTransientIndex(access.image, access.depthImage);
+                if (transientIndex == INVALID_TRANSIENT || isLive[transientIndex])
+                {
+                    isNeeded = true;
+                }
+            }
+
+            // A pass that doesn't write any images might do other things we don't track, so only passes with unused writes get culled
+            if (hasWrites && !isNeeded)
+            {
+                isCulled[passIndex] = true;
+            }
+            else
+            {
+                // Whatever this pass overwrites isn't needed from earlier passes, whatever it reads or loads is
+                for (size_t i = begin; i < end; i++)
+                {
+                    const ResourceAccess& access = _accesses[i];
+                    if (access.pass != passIndex)
+                        continue;
+
+                    u32 transientIndex = GetTransientIndex(access.image, access.depthImage);
+                    if (transientIndex != INVALID_TRANSIENT)
+                    {
+                        isLive[transientIndex] = access.state == RESOURCE_STATE_SHADER_READ || !access.discard;
+                    }
+                }
+            }
+
+            end = begin;
+        }
+
+        // Renumber the accesses to the indices of the passes that are left
+        std::vector<u32> newPassIndices(numPasses);
+        u32 numExecutingPasses = 0;
+        for (u32 i = 0; i < numPasses; i++)
+        {
+            newPassIndices[i] = isCulled[i] ? INVALID_PASS : numExecutingPasses++;
+        }
+
+        for (ResourceAccess& access : _accesses)
+        {
+            if (access.pass != INVALID_PASS)
+            {
+                access.pass = newPassIndices[access.pass];
+            }
+        }
+
+        for (BufferAccess& access : _bufferAccesses)
+        {
+            if (access.pass != INVALID_PASS)
+            {
+                access.pass = newPassIndices[access.pass];
+            }
+        }
+    }
+
+    void RenderGraphBuilder::Compile(u32 numPasses)
+    {
+        CompileLifetimes();
+        CompileMerges(numPasses);
+        CompileBarriers(numPasses);
+        CompileBufferBarriers();
+        CompileAttachmentOps();
+    }
+
+    void RenderGraphBuilder::AddAccess(ImageID image, DepthImageID depthImage, ResourceState state, u8 stages, LoadMode loadMode)
+    {
+        bool discard = loadMode != LOAD_MODE_LOAD;
+
+        // A pass can only have the resource in one state, if it both reads and writes it the write wins
+        for (size_t i = _accesses.Count(); i > 0; i--)
+        {
+            ResourceAccess& access = _accesses[i - 1];
+            if (access.pass != _currentPass)
+                break;
+
+            if (access.image == image && access.depthImage == depthImage)
+            {
+                if (state == RESOURCE_STATE_SHADER_READ)
+                {
+                    access.stages |= stages;
+                }
+                else
+                {
+                    access.state = state;
+                    access.stages = stages;
+                    access.discard = discard;
+                    access.loadMode = loadMode;
+                }
+                return;
+            }
+        }
+
+        ResourceAccess access;
+        access.image = image;
+        access.depthImage = depthImage;
+        access.pass = _currentPass;
+        access.state = state;
+        access.stages = stages;
+        access.discard = discard;
+        access.loadMode = loadMode;
+        _accesses.Insert(access);
+    }
+
+    void RenderGraphBuilder::AddAccess(BufferID buffer, ResourceState state, u8 stages)
+    {
+        // Same as with images the write wins, but a pass can both read a buffer in shaders and draw indirect from it
+        for (size_t i = _bufferAccesses.Count(); i > 0; i--)
+        {
+            BufferAccess& access = _bufferAccesses[i - 1];
+            if (access.pass != _currentPass)
+                break;
+
+            if (access.buffer != buffer)
+                continue;
+
+            if (access.state == RESOURCE_STATE_UAV || state == RESOURCE_STATE_UAV)
+            {
+                access.state = RESOURCE_STATE_UAV;
+                access.stages |= stages;
+                return;
+            }
+
+            if (access.state == state)
+            {
+                access.stages |= stages;
+                return;
+            }
+        }
+
+        BufferAccess access;
+        access.buffer = buffer;
+        access.pass = _currentPass;
+        access.state = state;
+        access.stages = stages;
+        _bufferAccesses.Insert(access);
+    }
+
+    u32 RenderGraphBuilder::GetTransientIndex(ImageID image, DepthImageID depthImage)
+    {
+        u32 i = 0;
+        for (TransientImageLifetime& lifetime : _transientImages)
+        {
+            if (lifetime.image == image && lifetime.depthImage == depthImage)
+            {
+                return i;
+            }
+
+            i++;
+        }
 
+        return INVALID_TRANSIENT;
     }
 
-    ImageID RenderGraphBuilder::Create(ImageDesc& /*desc*/)
+    void RenderGraphBuilder::CompileLifetimes()
     {
-        return ImageID::Invalid();
+        for (TransientImageLifetime& lifetime : _transientImages)
+        {
+            lifetime.firstPass = INVALID_PASS;
+            lifetime.lastPass = 0;
+        }
+
+        for (const ResourceAccess& access : _accesses)
+        {
+            if (access.pass == INVALID_PASS)
+                continue;
+
+            u32 transientIndex = GetTransientIndex(access.image, access.depthImage);
+            if (transientIndex == INVALID_TRANSIENT)
+                continue;
+
+            TransientImageLifetime& lifetime = _transientImages[transientIndex];
+            lifetime.firstPass = std::min(lifetime.firstPass, access.pass);
+            lifetime.lastPass = std::max(lifetime.lastPass, access.pass);
+        }
+
+        // Transient images that only culled passes used don't need any memory
+        for (TransientImageLifetime& lifetime : _transientImages)
+        {
+            if (lifetime.firstPass != INVALID_PASS)
+            {
+                _usedTransientImages.Insert(lifetime);
+            }
+        }
+    }
+
+    void RenderGraphBuilder::AllocateTransientImages()
+    {
+        // Now that we know the lifetime of every transient image the backend can place them in memory
+        u32 numUsedTransientImages = static_cast<u32>(_usedTransientImages.Count());
+        _renderer->AllocateTransientImages(numUsedTransientImages > 0 ? &_usedTransientImages[0] : nullptr, numUsedTransientImages);
+    }
+
+    void RenderGraphBuilder::ReleaseTransientImages()
+    {
+        _renderer->ReleaseTransientImages();
+    }
+
+    u64 RenderGraphBuilder::CalculateDeclarationHash(u64 seed)
+    {
+        u64 hash = seed;
+
+        // The accesses have padding, so they get hashed field by field
+        for (const ResourceAccess& access : _accesses)
+        {
+            u32 fields[4];
+            fields[0] = static_cast<u32>(static_cast<type_safe::underlying_type<ImageID>>(access.image)) | (static_cast<u32>(static_cast<type_safe::underlying_type<DepthImageID>>(access.depthImage)) << 16);
+            fields[1] = access.pass;
+            fields[2] = static_cast<u32>(access.state) | (static_cast<u32>(access.stages) << 8) | (static_cast<u32>(access.discard) << 16);
+            fields[3] = static_cast<u32>(access.loadMode);
+
+            hash = XXHash64::hash(fields, sizeof(fields), hash);
+        }
+
+        for (const BufferAccess& access : _bufferAccesses)
+        {
+            u32 fields[3];
+            fields[0] = static_cast<u32>(static_cast<type_safe::underlying_type<BufferID>>(access.buffer));
+            fields[1] = access.pass;
+            fields[2] = static_cast<u32>(access.state) | (static_cast<u32>(access.stages) << 8);
+
+            hash = XXHash64::hash(fields, sizeof(fields), hash);
+        }
+
+        // Accesses refer to transient images by ID, and the same ID always comes with the same desc
+        for (const TransientImageLifetime& lifetime : _transientImages)
+        {
+            u32 ids = static_cast<u32>(static_cast<type_safe::underlying_type<ImageID>>(lifetime.image)) | (static_cast<u32>(static_cast<type_safe::underlying_type<DepthImageID>>(lifetime.depthImage)) << 16);
+            hash = XXHash64::hash(&ids, sizeof(ids), hash);
+        }
+
+        return hash;
     }
 
-    DepthImageID RenderGraphBuilder::Create(DepthImageDesc& /*desc*/)
+    void RenderGraphBuilder::CompileMerges(u32 numPasses)
     {
-        return DepthImageID::Invalid();
+        // The first and one past the last access of every pass
+        std::vector<size_t> passBegin(numPasses, 0);
+        std::vector<size_t> passEnd(numPasses, 0);
+        for (size_t i = 0; i < _accesses.Count(); i++)
+        {
+            u32 pass = _accesses[i].pass;
+            if (pass == INVALID_PASS)
+                continue;
+
+            if (passEnd[pass] == 0)
+            {
+                passBegin[pass] = i;
+            }
+            passEnd[pass] = i + 1;
+        }
+
+        // The barriers in front of a pass using buffers would end the render pass anyway
+        std::vector<bool> usesBuffers(numPasses, false);
+        for (const BufferAccess& access : _bufferAccesses)
+        {
+            if (access.pass != INVALID_PASS)
+            {
+                usesBuffers[access.pass] = true;
+            }
+        }
+
+        // A pass gets merged into the one before it when all it does is keep rendering to the same attachments, then there is nothing that would need a barrier in between
+        for (u32 pass = 0; pass < numPasses; pass++)
+        {
+            bool isMerged = pass > 0 && !usesBuffers[pass];
+            u32 numAttachments = 0;
+
+            for (size_t i = passBegin[pass]; i < passEnd[pass] && isMerged; i++)
+            {
+                const ResourceAccess& access = _accesses[i];
+                if (access.pass != pass)
+                    continue;
+
+                bool isAttachment = access.state == RESOURCE_STATE_RENDER_TARGET || access.state == RESOURCE_STATE_DEPTH_WRITE;
+                if (!isAttachment || access.discard)
+                {
+                    isMerged = false;
+                    break;
+                }
+                numAttachments++;
+
+                // The previous pass has to render to it the same way
+                bool isInPrevious = false;
+                for (size_t j = passBegin[pass - 1]; j < passEnd[pass - 1]; j++)
+                {
+                    const ResourceAccess& previousAccess = _accesses[j];
+                    if (previousAccess.pass == pass - 1 && previousAccess.image == access.image && previousAccess.depthImage == access.depthImage && previousAccess.state == access.state)
+                    {
+                        isInPrevious = true;
+                        break;
+                    }
+                }
+                isMerged = isInPrevious;
+            }
+
+            // And the previous pass can't render to anything this one doesn't
+            if (isMerged)
+            {
+                u32 numPreviousAttachments = 0;
+                for (size_t j = passBegin[pass - 1]; j < passEnd[pass - 1]; j++)
+                {
+                    const ResourceAccess& previousAccess = _accesses[j];
+                    if (previousAccess.pass == pass - 1 && (previousAccess.state == RESOURCE_STATE_RENDER_TARGET || previousAccess.state == RESOURCE_STATE_DEPTH_WRITE))
+                    {
+                        numPreviousAttachments++;
+                    }
+                }
+
+                isMerged = numAttachments > 0 && numAttachments == numPreviousAttachments;
+            }
+
+            _mergedWithPrevious.Insert(isMerged);
+        }
     }
 
-    RenderPassResource RenderGraphBuilder::Read(ImageID id, ShaderStage /*shaderStage*/)
+    void RenderGraphBuilder::CompileBarriers(u32 numPasses)
     {
+        DynamicArray<TrackedState> trackedStates(_allocator, 32);
+
+        size_t numAccesses = _accesses.Count();
+        for (size_t i = 0; i < numAccesses; i++)
+        {
+            const ResourceAccess& access = _accesses[i];
+            if (access.pass == INVALID_PASS)
+                continue;
+
+            TrackedState& tracked = GetTrackedState(access, trackedStates);
+
+            // Reading in the same state as before is fine without a barrier, the barrier into that state already covered the stages of every read in a row
+            bool isRead = access.state == RESOURCE_STATE_SHADER_READ;
+            if (isRead && tracked.state == access.state && !access.discard)
+                continue;
+
+            // Merged passes keep rendering inside the same render pass, which already orders the attachment writes
+            if (_mergedWithPrevious[access.pass] && tracked.state == access.state)
+                continue;
+
+            ImageBarrier barrier;
+            barrier.image = access.image;
+            barrier.depthImage = access.depthImage;
+            barrier.before = access.discard ? RESOURCE_STATE_UNDEFINED : tracked.state;
+            barrier.beforeStages = tracked.stages;
+            barrier.after = access.state;
+            barrier.afterStages = access.stages;
+
+            // Look ahead for the following reads so they don't need barriers of their own
+            if (isRead)
+            {
+                for (size_t j = i + 1; j < numAccesses; j++)
+                {
+                    const ResourceAccess& nextAccess = _accesses[j];
+                    if (nextAccess.pass == INVALID_PASS || nextAccess.image != access.image || nextAccess.depthImage != access.depthImage)
+                        continue;
+
+                    if (nextAccess.state != RESOURCE_STATE_SHADER_READ || nextAccess.discard)
+                        break;
+
+                    barrier.afterStages |= nextAccess.stages;
+                }
+            }
+
+            tracked.state = barrier.after;
+            tracked.stages = barrier.afterStages;
+
+            // Accesses are in pass order, so a new batch starts whenever the pass changes
+            if (_barrierBatches.Count() == 0 || _barrierBatches[_barrierBatches.Count() - 1].pass != access.pass)
+            {
+                BarrierBatch batch;
+                batch.pass = access.pass;
+                batch.firstBarrier = static_cast<u32>(_barriers.Count());
+                _barrierBatches.Insert(batch);
+            }
+
+            _barriers.Insert(barrier);
+            _barrierBatches[_barrierBatches.Count() - 1].numBarriers++;
+        }
+
+        // Permanent images go back to resting in the shader read state, that is where the next RenderGraph and Present expect them
+        BarrierBatch finalBatch;
+        finalBatch.pass = numPasses;
+        finalBatch.firstBarrier = static_cast<u32>(_barriers.Count());
+
+        for (TrackedState& tracked : trackedStates)
+        {
+            if (tracked.isTransient)
+                continue;
+
+            if (tracked.state == RESOURCE_STATE_SHADER_READ && tracked.stages == ALL_SHADER_STAGES)
+                continue;
+
+            ImageBarrier barrier;
+            barrier.image = tracked.image;
+            barrier.depthImage = tracked.depthImage;
+            barrier.before = tracked.state;
+            barrier.beforeStages = tracked.stages;
+            barrier.after = RESOURCE_STATE_SHADER_READ;
+            barrier.afterStages = ALL_SHADER_STAGES;
+
+            _barriers.Insert(barrier);
+            finalBatch.numBarriers++;
+        }
+
+        if (finalBatch.numBarriers > 0)
+        {
+            _barrierBatches.Insert(finalBatch);
+        }
+    }
+
+    void RenderGraphBuilder::CompileBufferBarriers()
+    {
+        DynamicArray<TrackedBufferState> trackedStates(_allocator, 16);
+
+        size_t numAccesses = _bufferAccesses.Count();
+        for (size_t i = 0; i < numAccesses; i++)
+        {
+            const BufferAccess& access = _bufferAccesses[i];
+            if (access.pass == INVALID_PASS)
+                continue;
+
+            TrackedBufferState& tracked = GetTrackedState(access, trackedStates);
+
+            if (access.state == RESOURCE_STATE_SHADER_READ)
+            {
+                // Reads after the same write only need syncing once per stage
+                u8 stages = (access.stages == SHADER_STAGE_NONE) ? ALL_SHADER_STAGES : access.stages;
+                if ((tracked.readStages & stages) == stages)
+                    continue;
+
+                // Look ahead for the following reads so they don't need barriers of their own
+                u8 afterStages = stages;
+                for (size_t j = i + 1; j < numAccesses; j++)
+                {
+                    const BufferAccess& nextAccess = _bufferAccesses[j];
+                    if (nextAccess.pass == INVALID_PASS || nextAccess.buffer != access.buffer)
+                        continue;
+
+                    if (nextAccess.state == RESOURCE_STATE_UAV)
+                        break;
+
+                    if (nextAccess.state == RESOURCE_STATE_SHADER_READ)
+                    {
+                        afterStages |= (nextAccess.stages == SHADER_STAGE_NONE) ? ALL_SHADER_STAGES : nextAccess.stages;
+                    }
+                }
+
+                AddBufferBarrier(access, tracked.lastWrite, tracked.lastWriteStages, afterStages);
+                tracked.readStages |= afterStages;
+            }
+            else if (access.state == RESOURCE_STATE_INDIRECT_ARGUMENT)
+            {
+                if (tracked.isReadIndirect)
+                    continue;
+
+                AddBufferBarrier(access, tracked.lastWrite, tracked.lastWriteStages, SHADER_STAGE_NONE);
+                tracked.isReadIndirect = true;
+            }
+            else
+            {
+                // A write has to wait for the reads since the last write, those already waited for the write itself
+                bool hasReads = tracked.readStages != SHADER_STAGE_NONE || tracked.isReadIndirect;
+                if (tracked.readStages != SHADER_STAGE_NONE)
+                {
+                    AddBufferBarrier(access, RESOURCE_STATE_SHADER_READ, tracked.readStages, access.stages);
+                }
+                if (tracked.isReadIndirect)
+                {
+                    AddBufferBarrier(access, RESOURCE_STATE_INDIRECT_ARGUMENT, SHADER_STAGE_NONE, access.stages);
+                }
+                if (!hasReads)
+                {
+                    AddBufferBarrier(access, tracked.lastWrite, tracked.lastWriteStages, access.stages);
+                }
+
+                tracked.lastWrite = RESOURCE_STATE_UAV;
+                tracked.lastWriteStages = access.stages;
+                tracked.readStages = SHADER_STAGE_NONE;
+                tracked.isReadIndirect = false;
+            }
+        }
+    }
+
+    void RenderGraphBuilder::AddBufferBarrier(const BufferAccess& access, ResourceState before, u8 beforeStages, u8 afterStages)
+    {
+        BufferBarrier barrier;
+        barrier.buffer = access.buffer;
+        barrier.before = before;
+        barrier.beforeStages = beforeStages;
+        barrier.after = access.state;
+        barrier.afterStages = afterStages;
+
+        // Accesses are in pass order, so a new batch starts whenever the pass changes
+        if (_bufferBarrierBatches.Count() == 0 || _bufferBarrierBatches[_bufferBarrierBatches.Count() - 1].pass != access.pass)
+        {
+            BarrierBatch batch;
+            batch.pass = access.pass;
+            batch.firstBarrier = static_cast<u32>(_bufferBarriers.Count());
+            _bufferBarrierBatches.Insert(batch);
+        }
+
+        _bufferBarriers.Insert(barrier);
+        _bufferBarrierBatches[_bufferBarrierBatches.Count() - 1].numBarriers++;
+    }
+
+    void RenderGraphBuilder::CompileAttachmentOps()
+    {
+        for (const ResourceAccess& access : _accesses)
+        {
+            if (access.pass == INVALID_PASS)
+                continue;
+
+            if (access.state != RESOURCE_STATE_RENDER_TARGET && access.state != RESOURCE_STATE_DEPTH_WRITE)
+                continue;
+
+            AttachmentOps ops;
+            ops.image = access.image;
+            ops.depthImage = access.depthImage;
+            ops.loadOp = (access.loadMode == LOAD_MODE_CLEAR) ? ATTACHMENT_LOAD_OP_CLEAR : (access.loadMode == LOAD_MODE_DISCARD) ? ATTACHMENT_LOAD_OP_DONT_CARE : ATTACHMENT_LOAD_OP_LOAD;
+
+            // Permanent images outlive the RenderGraph, transient ones only need storing if a later pass uses them
+            u32 transientIndex = GetTransientIndex(access.image, access.depthImage);
+            ops.store = transientIndex == INVALID_TRANSIENT || _transientImages[transientIndex].lastPass > access.pass;
+
+            // Loading and storing is what the backend does without being told
+            if (ops.loadOp == ATTACHMENT_LOAD_OP_LOAD && ops.store)
+                continue;
+
+            if (_attachmentOpsBatches.Count() == 0 || _attachmentOpsBatches[_attachmentOpsBatches.Count() - 1].pass != access.pass)
+            {
+                AttachmentOpsBatch batch;
+                batch.pass = access.pass;
+                batch.firstOps = static_cast<u32>(_attachmentOps.Count());
+                _attachmentOpsBatches.Insert(batch);
+            }
+
+            _attachmentOps.Insert(ops);
+            _attachmentOpsBatches[_attachmentOpsBatches.Count() - 1].numOps++;
+        }
+    }
+
+    RenderGraphBuilder::TrackedState& RenderGraphBuilder::GetTrackedState(const ResourceAccess& access, DynamicArray<TrackedState>& trackedStates)
+    {
+        for (TrackedState& tracked : trackedStates)
+        {
+            if (tracked.image == access.image && tracked.depthImage == access.depthImage)
+            {
+                return tracked;
+            }
+        }
+
+        TrackedState tracked;
+        tracked.image = access.image;
+        tracked.depthImage = access.depthImage;
+        tracked.isTransient = GetTransientIndex(access.image, access.depthImage) != INVALID_TRANSIENT;
+
+        // Transient images start out with undefined contents, permanent ones rest in the shader read state between RenderGraphs
+        tracked.state = tracked.isTransient ? RESOURCE_STATE_UNDEFINED : RESOURCE_STATE_SHADER_READ;
+        tracked.stages = tracked.isTransient ? SHADER_STAGE_NONE : ALL_SHADER_STAGES;
+
+        trackedStates.Insert(tracked);
+        return trackedStates[trackedStates.Count() - 1];
+    }
+
+    RenderGraphBuilder::TrackedBufferState& RenderGraphBuilder::GetTrackedState(const BufferAccess& access, DynamicArray<TrackedBufferState>& trackedStates)
+    {
+        for (TrackedBufferState& tracked : trackedStates)
+        {
+            if (tracked.buffer == access.buffer)
+            {
+                return tracked;
+            }
+        }
+
+        TrackedBufferState tracked;
+        tracked.buffer = access.buffer;
+
+        trackedStates.Insert(tracked);
+        return trackedStates[trackedStates.Count() - 1];
+    }
+
+    void RenderGraphBuilder::AddBarriers(u32 pass, CommandList& commandList)
+    {
+        for (BarrierBatch& batch : _barrierBatches)
+        {
+            if (batch.pass == pass)
+            {
+                commandList.ImageBarriers(&_barriers[batch.firstBarrier], batch.numBarriers);
+                break;
+            }
+        }
+
+        for (BarrierBatch& batch : _bufferBarrierBatches)
+        {
+            if (batch.pass == pass)
+            {
+                commandList.BufferBarriers(&_bufferBarriers[batch.firstBarrier], batch.numBarriers);
+                break;
+            }
+        }
+    }
+
+    void RenderGraphBuilder::AddAttachmentOps(u32 pass, CommandList& commandList)
+    {
+        for (AttachmentOpsBatch& batch : _attachmentOpsBatches)
+        {
+            if (batch.pass == pass)
+            {
+                commandList.SetAttachmentOps(&_attachmentOps[batch.firstOps], batch.numOps);
+                return;
+            }
+        }
+    }
+
+    ImageID RenderGraphBuilder::Create(ImageDesc& desc)
+    {
+        ImageID id = _renderer->CreateTransientImage(desc);
+
+        // The lifetime gets filled in from the accesses once we know which passes execute
+        TransientImageLifetime lifetime;
+        lifetime.image = id;
+        _transientImages.Insert(lifetime);
+
+        return id;
+    }
+
+    DepthImageID RenderGraphBuilder::Create(DepthImageDesc& desc)
+    {
+        DepthImageID id = _renderer->CreateTransientDepthImage(desc);
+
+        // The lifetime gets filled in from the accesses once we know which passes execute
+        TransientImageLifetime lifetime;
+        lifetime.depthImage = id;
+        _transientImages.Insert(lifetime);
+
+        return id;
+    }
+
+    RenderPassResource RenderGraphBuilder::Read(ImageID id, ShaderStage shaderStage)
+    {
+        AddAccess(id, DepthImageID::Invalid(), RESOURCE_STATE_SHADER_READ, static_cast<u8>(shaderStage), LOAD_MODE_LOAD);
         RenderPassResource resource = GetResource(id);
 
         return resource;
@@ -42,22 +743,56 @@ namespace Renderer
         return resource;
     }
 
-    RenderPassResource RenderGraphBuilder::Read(DepthImageID id, ShaderStage /*shaderStage*/)
+    RenderPassResource RenderGraphBuilder::Read(DepthImageID id, ShaderStage shaderStage)
     {
+        AddAccess(ImageID::Invalid(), id, RESOURCE_STATE_SHADER_READ, static_cast<u8>(shaderStage), LOAD_MODE_LOAD);
         RenderPassResource resource = GetResource(id);
 
         return resource;
     }
 
-    RenderPassMutableResource RenderGraphBuilder::Write(ImageID id, WriteMode /*writeMode*/, LoadMode /*loadMode*/)
+    RenderPassMutableResource RenderGraphBuilder::Write(ImageID id, WriteMode writeMode, LoadMode loadMode)
     {
+        ResourceState state = (writeMode == WRITE_MODE_UAV) ? RESOURCE_STATE_UAV : RESOURCE_STATE_RENDER_TARGET;
+        u8 stages = (writeMode == WRITE_MODE_UAV) ? static_cast<u8>(SHADER_STAGE_PIXEL | SHADER_STAGE_COMPUTE) : static_cast<u8>(SHADER_STAGE_NONE);
+        AddAccess(id, DepthImageID::Invalid(), state, stages, loadMode);
         RenderPassMutableResource resource = GetMutableResource(id);
 
         return resource;
     }
 
-    RenderPassMutableResource RenderGraphBuilder::Write(DepthImageID id, WriteMode /*writeMode*/, LoadMode /*loadMode*/)
+    RenderPassMutableResource RenderGraphBuilder::Write(DepthImageID id, WriteMode writeMode, LoadMode loadMode)
     {
+        ResourceState state = (writeMode == WRITE_MODE_UAV) ? RESOURCE_STATE_UAV : RESOURCE_STATE_DEPTH_WRITE;
+        u8 stages = (writeMode == WRITE_MODE_UAV) ? static_cast<u8>(SHADER_STAGE_PIXEL | SHADER_STAGE_COMPUTE) : static_cast<u8>(SHADER_STAGE_NONE);
+        AddAccess(ImageID::Invalid(), id, state, stages, loadMode);
+        RenderPassMutableResource resource = GetMutableResource(id);
+
+        return resource;
+    }
+
+    RenderPassResource RenderGraphBuilder::Read(BufferID id, ShaderStage shaderStage)
+    {
+        AddAccess(id, RESOURCE_STATE_SHADER_READ, static_cast<u8>(shaderStage));
+        RenderPassResource resource = GetResource(id);
+
+        return resource;
+    }
+
+    RenderPassResource RenderGraphBuilder::ReadIndirectArguments(BufferID id)
+    {
+        AddAccess(id, RESOURCE_STATE_INDIRECT_ARGUMENT, static_cast<u8>(SHADER_STAGE_NONE));
+        RenderPassResource resource = GetResource(id);
+
+        return resource;
+    }
+
+    RenderPassMutableResource RenderGraphBuilder::Write(BufferID id, WriteMode writeMode, LoadMode loadMode)
+    {
+        assert(writeMode == WRITE_MODE_UAV); // Buffers can't be rendertargets
+        assert(loadMode != LOAD_MODE_CLEAR); // There is nothing to clear buffers with, write them in the pass instead
+
+        AddAccess(id, RESOURCE_STATE_UAV, static_cast<u8>(SHADER_STAGE_PIXEL | SHADER_STAGE_COMPUTE));
         RenderPassMutableResource resource = GetMutableResource(id);
 
         return resource;
@@ -87,6 +822,18 @@ namespace Renderer
         return _trackedDepthImages[static_cast<type>(resource)];
     }
 
+    BufferID RenderGraphBuilder::GetBuffer(RenderPassResource resource)
+    {
+        using type = type_safe::underlying_type<RenderPassResource>;
+        return _trackedBuffers[static_cast<type>(resource)];
+    }
+
+    BufferID RenderGraphBuilder::GetBuffer(RenderPassMutableResource resource)
+    {
+        using type = type_safe::underlying_type<RenderPassMutableResource>;
+        return _trackedBuffers[static_cast<type>(resource)];
+    }
+
     RenderPassResource RenderGraphBuilder::GetResource(ImageID id)
     {
         using _type = type_safe::underlying_type<ImageID>;
@@ -181,4 +928,42 @@ namespace Renderer
         _trackedDepthImages.Insert(id);
         return RenderPassMutableResource(i);
     }
+
+    RenderPassResource RenderGraphBuilder::GetResource(BufferID id)
+    {
+        using _type = type_safe::underlying_type<BufferID>;
+
+        _type i = 0;
+        for (BufferID& trackedID : _trackedBuffers)
+        {
+            if (trackedID == id)
+            {
+                return RenderPassResource(i);
+            }
+
+            i++;
+        }
+
+        _trackedBuffers.Insert(id);
+        return RenderPassResource(i);
+    }
+
+    RenderPassMutableResource RenderGraphBuilder::GetMutableResource(BufferID id)
+    {
+        using _type = type_safe::underlying_type<BufferID>;
+
+        _type i = 0;
+        for (BufferID& trackedID : _trackedBuffers)
+        {
+            if (trackedID == id)
+            {
+                return RenderPassMutableResource(i);
+            }
+
+            i++;
+        }
+
+        _trackedBuffers.Insert(id);
+        return RenderPassMutableResource(i);
+    }
 }
\ No newline at end of file
@@ -7,10 +7,12 @@
 
 #include "RenderStates.h"
 #include "RenderPassResources.h"
+#include "ResourceStates.h"
 
 #include "Descriptors/TextureDesc.h"
 #include "Descriptors/ImageDesc.h"
 #include "Descriptors/DepthImageDesc.h"
+#include "Descriptors/BufferDesc.h"
 
 namespace Memory
 {
@@ -23,6 +25,15 @@ namespace Renderer
     class CommandList;
     class RenderGraph;
 
+    // The first and last executing pass a transient image is used in, images whose lifetimes don't overlap can share memory
+    struct TransientImageLifetime
+    {
+        ImageID image = ImageID::Invalid(); // Only one of image and depthImage is set
+        DepthImageID depthImage = DepthImageID::Invalid();
+        u32 firstPass = 0;
+        u32 lastPass = 0;
+    };
+
     class RenderGraphBuilder
     {
     public:
@@ -49,7 +60,7 @@ namespace Renderer
             SHADER_STAGE_COMPUTE = 4
         };
 
-        // Create transient resources
+        // Create transient resources, these only live for the passes of this RenderGraph that use them and might share memory with other transient resources
         ImageID Create(ImageDesc& desc);
         DepthImageID Create(DepthImageDesc& desc);
 
@@ -57,10 +68,13 @@ namespace Renderer
         RenderPassResource Read(ImageID id, ShaderStage shaderStage);
         RenderPassResource Read(TextureID id, ShaderStage shaderStage);
         RenderPassResource Read(DepthImageID id, ShaderStage shaderStage);
+        RenderPassResource Read(BufferID id, ShaderStage shaderStage);
+        RenderPassResource ReadIndirectArguments(BufferID id); // For buffers that DrawInstancedIndirect reads its arguments from
 
         // Writes
         RenderPassMutableResource Write(ImageID id, WriteMode writeMode, LoadMode loadMode);
         RenderPassMutableResource Write(DepthImageID id, WriteMode writeMode, LoadMode loadMode);
+        RenderPassMutableResource Write(BufferID id, WriteMode writeMode, LoadMode loadMode); // Buffers can only be written as UAVs, and there is nothing to clear them with
 
         // Render states
         void SetRasterizerState(RasterizerState& rasterizerState) { _rasterizerState = rasterizerState; }
@@ -70,15 +84,98 @@ namespace Renderer
         ImageID GetImage(RenderPassMutableResource resource);
         DepthImageID GetDepthImage(RenderPassResource resource);
         DepthImageID GetDepthImage(RenderPassMutableResource resource);
+        BufferID GetBuffer(RenderPassResource resource);
+        BufferID GetBuffer(RenderPassMutableResource resource);
+
+    private:
+        struct ResourceAccess
+        {
+            ImageID image = ImageID::Invalid(); // Only one of image and depthImage is set
+            DepthImageID depthImage = DepthImageID::Invalid();
+            u32 pass = 0;
+            ResourceState state = RESOURCE_STATE_UNDEFINED;
+            u8 stages = SHADER_STAGE_NONE;
+            bool discard = false; // The pass doesn't care about the previous contents
+            LoadMode loadMode = LOAD_MODE_LOAD;
+        };
+
+        struct TrackedState
+        {
+            ImageID image = ImageID::Invalid();
+            DepthImageID depthImage = DepthImageID::Invalid();
+            ResourceState state = RESOURCE_STATE_UNDEFINED;
+            u8 stages = SHADER_STAGE_NONE;
+            bool isTransient = false;
+        };
+
+        // Buffers are tracked apart from images, they are always permanent and have no layouts to transition
+        struct BufferAccess
+        {
+            BufferID buffer = BufferID::Invalid();
+            u32 pass = 0;
+            ResourceState state = RESOURCE_STATE_UNDEFINED;
+            u8 stages = SHADER_STAGE_NONE;
+        };
+
+        struct TrackedBufferState
+        {
+            BufferID buffer = BufferID::Invalid();
+            ResourceState lastWrite = RESOURCE_STATE_UNDEFINED; // We don't know what wrote the buffer before this RenderGraph
+            u8 lastWriteStages = SHADER_STAGE_NONE;
+            u8 readStages = SHADER_STAGE_NONE; // The shader stages that are synced with the last write
+            bool isReadIndirect = false; // Indirect draws are synced with the last write
+        };
+
+        struct BarrierBatch
+        {
+            u32 pass = 0; // The barriers go in front of this pass, or after the last pass if it equals the number of passes
+            u32 firstBarrier = 0;
+            u32 numBarriers = 0;
+        };
+
+        struct AttachmentOpsBatch
+        {
+            u32 pass = 0;
+            u32 firstOps = 0;
+            u32 numOps = 0;
+        };
+
+        static const u32 INVALID_PASS = ~0u;
+        static const u32 INVALID_TRANSIENT = ~0u;
+        static const u8 ALL_SHADER_STAGES = SHADER_STAGE_VERTEX | SHADER_STAGE_PIXEL | SHADER_STAGE_COMPUTE;
 
     private:
-        void Compile(CommandList* commandList);
+        void SetCurrentPass(u32 passIndex) { _currentPass = passIndex; }
+        void DiscardCurrentPass(); // The pass won't execute after all, so its accesses shouldn't cause barriers
+        void CullPasses(u32 numPasses, std::vector<bool>& isCulled); // Culls the passes whose writes are never used and renumbers the rest
+        void Compile(u32 numPasses);
+        bool IsMergedWithPrevious(u32 pass) { return _mergedWithPrevious[pass]; }
+        u64 CalculateDeclarationHash(u64 seed); // Covers everything the setups declared, the same hash means the same compiled RenderGraph
+
+        void AllocateTransientImages(); // Places the transient images the executing passes use in memory, this happens every Execute since other RenderGraphs might have moved them
+        void ReleaseTransientImages(); // For builders that only ran the setups and won't get compiled
+
+        void AddAccess(ImageID image, DepthImageID depthImage, ResourceState state, u8 stages, LoadMode loadMode);
+        void AddAccess(BufferID buffer, ResourceState state, u8 stages);
+        u32 GetTransientIndex(ImageID image, DepthImageID depthImage);
+        void CompileLifetimes();
+        void CompileMerges(u32 numPasses);
+        void CompileBarriers(u32 numPasses);
+        void CompileBufferBarriers();
+        void AddBufferBarrier(const BufferAccess& access, ResourceState before, u8 beforeStages, u8 afterStages);
+        void CompileAttachmentOps();
+        TrackedState& GetTrackedState(const ResourceAccess& access, DynamicArray<TrackedState>& trackedStates);
+        TrackedBufferState& GetTrackedState(const BufferAccess& access, DynamicArray<TrackedBufferState>& trackedStates);
+        void AddBarriers(u32 pass, CommandList& commandList);
+        void AddAttachmentOps(u32 pass, CommandList& commandList);
         
         RenderPassResource GetResource(ImageID id);
         RenderPassResource GetResource(TextureID id);
         RenderPassResource GetResource(DepthImageID id);
         RenderPassMutableResource GetMutableResource(ImageID id);
         RenderPassMutableResource GetMutableResource(DepthImageID id);
+        RenderPassResource GetResource(BufferID id);
+        RenderPassMutableResource GetMutableResource(BufferID id);
 
     private:
         Memory::Allocator* _allocator;
@@ -89,5 +186,22 @@ namespace Renderer
         DynamicArray<ImageID> _trackedImages;
         DynamicArray<TextureID> _trackedTextures;
         DynamicArray<DepthImageID> _trackedDepthImages;
+        DynamicArray<BufferID> _trackedBuffers;
+
+        u32 _currentPass = 0;
+        DynamicArray<TransientImageLifetime> _transientImages;
+        DynamicArray<TransientImageLifetime> _usedTransientImages; // The ones executing passes use
+
+        DynamicArray<ResourceAccess> _accesses; // In pass order
+        DynamicArray<ImageBarrier> _barriers;
+        DynamicArray<BarrierBatch> _barrierBatches;
+        DynamicArray<BufferAccess> _bufferAccesses; // In pass order
+        DynamicArray<BufferBarrier> _bufferBarriers;
+        DynamicArray<BarrierBatch> _bufferBarrierBatches;
+        DynamicArray<AttachmentOps> _attachmentOps;
+        DynamicArray<AttachmentOpsBatch> _attachmentOpsBatches;
+        DynamicArray<bool> _mergedWithPrevious; // Per pass, set if it renders to the same attachments as the pass before it and needs no barriers in between
+
+        friend class RenderGraph;
     };
 }
\ No newline at end of file
@@ -1,6 +1,209 @@
 #include "RenderLayer.h"
+#include <cassert>
 
 namespace Renderer
 {
+    RenderableID RenderLayer::AddRenderable(ModelID modelID, const InstanceData& instanceData)
+    {
+        RenderableID renderableID = RenderableID::Invalid();
+        if (_freeRenderables.size() > 0)
+        {
+            renderableID = _freeRenderables.back();
+            _freeRenderables.pop_back();
+        }
+        else
+        {
+            size_t nextHandle = _renderables.size();
 
+            // Make sure we haven't exceeded the limit of the RenderableID type, if this hits you need to change type of RenderableID to something bigger
+            assert(nextHandle < RenderableID::MaxValue());
+
+            renderableID = RenderableID(static_cast<RenderableID::type>(nextHandle));
+            _renderables.emplace_back();
+        }
+
+        u32 batchIndex = GetBatchIndex(modelID);
+        ModelBatch& batch = _batches[batchIndex];
+
+        RenderableLocation& location = GetLocation(renderableID);
+        location.batch = batchIndex;
+        location.instance = static_cast<u32>(batch.instances.size());
+
+        batch.instances.push_back(instanceData);
+        batch.renderables.push_back(renderableID);
+
+        MarkDirty(batch, location.instance);
+        _isLayoutDirty = true;
+
+        return renderableID;
+    }
+
+    void RenderLayer::RemoveRenderable(RenderableID renderableID)
+    {
+        RenderableLocation& location = GetLocation(renderableID);
+        ModelBatch& batch = _batches[location.batch];
+
+        // Keep the batch contiguous by moving its last instance into the hole
+        u32 lastInstance = static_cast<u32>(batch.instances.size()) - 1;
+        if (location.instance != lastInstance)
+        {
+            RenderableID movedID = batch.renderables[lastInstance];
+
+            batch.instances[location.instance] = batch.instances[lastInstance];
+            batch.renderables[location.instance] = movedID;
+            GetLocation(movedID).instance = location.instance;
+
+            MarkDirty(batch, location.instance);
+        }
+
+        batch.instances.pop_back();
+        batch.renderables.pop_back();
+
+        _freeRenderables.push_back(renderableID);
+        _isLayoutDirty = true;
+    }
+
+    const InstanceData& RenderLayer::GetInstanceData(RenderableID renderableID)
+    {
+        RenderableLocation& location = GetLocation(renderableID);
+        return _batches[location.batch].instances[location.instance];
+    }
+
+    void RenderLayer::SetModelMatrix(RenderableID renderableID, const mat4x4& modelMatrix)
+    {
+        RenderableLocation& location = GetLocation(renderableID);
+        ModelBatch& batch = _batches[location.batch];
+
+        batch.instances[location.instance].modelMatrix = modelMatrix;
+        MarkDirty(batch, location.instance);
+    }
+
+    void RenderLayer::SetColorMultiplier(RenderableID renderableID, const vec4& colorMultiplier)
+    {
+        RenderableLocation& location = GetLocation(renderableID);
+        ModelBatch& batch = _batches[location.batch];
+
+        batch.instances[location.instance].colorMultiplier = colorMultiplier;
+        MarkDirty(batch, location.instance);
+    }
+
+    void RenderLayer::SetSortKey(ModelID modelID, u64 sortKey)
+    {
+        ModelBatch& batch = _batches[GetBatchIndex(modelID)];
+        if (batch.sortKey == sortKey)
+            return;
+
+        batch.sortKey = sortKey;
+        _isSortDirty = true;
+    }
+
+    void RenderLayer::Sort()
+    {
+        if (!_isSortDirty)
+            return;
+
+        _isSortDirty = false;
+
+        size_t numPackets = _batches.size();
+        _drawPackets.resize(numPackets);
+        _sortScratch.resize(numPackets);
+
+        for (size_t i = 0; i < numPackets; i++)
+        {
+            _drawPackets[i].sortKey = _batches[i].sortKey;
+            _drawPackets[i].batch = static_cast<u32>(i);
+        }
+
+        if (numPackets < 2)
+            return;
+
+        DrawPacket* src = _drawPackets.data();
+        DrawPacket* dst = _sortScratch.data();
+
+        // LSD radix sort, one byte of the key per pass
+        for (u32 shift = 0; shift < 64; shift += 8)
+        {
+            size_t offsets[256] = {};
+            for (size_t i = 0; i < numPackets; i++)
+            {
+                offsets[(src[i].sortKey >> shift) & 0xFF]++;
+            }
+
+            // Keys that all share this byte are already sorted by it
+            if (offsets[(src[0].sortKey >> shift) & 0xFF] == numPackets)
+                continue;
+
+            size_t offset = 0;
+            for (size_t& bucket : offsets)
+            {
+                size_t count = bucket;
+                bucket = offset;
+                offset += count;
+            }
+
+            for (size_t i = 0; i < numPackets; i++)
+            {
+                dst[offsets[(src[i].sortKey >> shift) & 0xFF]++] = src[i];
+            }
+
+            std::swap(src, dst);
+        }
+
+        // An odd number of passes leaves the result in the scratch buffer
+        if (src != _drawPackets.data())
+        {
+            _drawPackets.swap(_sortScratch);
+        }
+    }
+
+    void RenderLayer::ClearDirty()
+    {
+        for (ModelBatch& batch : _batches)
+        {
+            batch.dirtyBegin = 0;
+            batch.dirtyEnd = 0;
+        }
+
+        _isLayoutDirty = false;
+    }
+
+    u32 RenderLayer::GetBatchIndex(ModelID modelID)
+    {
+        auto it = _batchLookup.find(static_cast<ModelID::type>(modelID));
+        if (it != _batchLookup.end())
+            return it->second;
+
+        u32 batchIndex = static_cast<u32>(_batches.size());
+        _batchLookup[static_cast<ModelID::type>(modelID)] = batchIndex;
+
+        ModelBatch& batch = _batches.emplace_back();
+        batch.model = modelID;
+
+        _isLayoutDirty = true;
+        _isSortDirty = true;
+
+        return batchIndex;
+    }
+
+    RenderLayer::RenderableLocation& RenderLayer::GetLocation(RenderableID renderableID)
+    {
+        // Lets make sure this id exists
+        assert(_renderables.size() > static_cast<RenderableID::type>(renderableID));
+
+        return _renderables[static_cast<RenderableID::type>(renderableID)];
+    }
+
+    void RenderLayer::MarkDirty(ModelBatch& batch, u32 instance)
+    {
+        if (batch.dirtyBegin == batch.dirtyEnd)
+        {
+            batch.dirtyBegin = instance;
+            batch.dirtyEnd = instance + 1;
+        }
+        else
+        {
+            batch.dirtyBegin = std::min(batch.dirtyBegin, instance);
+            batch.dirtyEnd = std::max(batch.dirtyEnd, instance + 1);
+        }
+    }
 }
\ No newline at end of file
@@ -2,44 +2,81 @@
 #include <NovusTypes.h>
 #include <vector>
 #include <robin_hood.h>
-#include <unordered_map>
+#include <Utils/StrongTypedef.h>
 #include "InstanceData.h"
+#include "SortKey.h"
 #include "Descriptors/ModelDesc.h"
 
 namespace Renderer
 {
-    // A RenderLayer is just a collection of models to be drawn at certain positions
+    STRONG_TYPEDEF(RenderableID, u32);
+
+    // All instances of one model, laid out contiguously so they can be drawn in one call
+    struct ModelBatch
+    {
+        ModelID model = ModelID::Invalid();
+        u64 sortKey = 0;
+
+        std::vector<InstanceData> instances; // In no particular order, removing one moves the last one into its place
+        std::vector<RenderableID> renderables; // The renderable each instance belongs to
+
+        // The instances that changed since the last ClearDirty
+        u32 dirtyBegin = 0;
+        u32 dirtyEnd = 0;
+    };
+
+    struct DrawPacket
+    {
+        u64 sortKey;
+        u32 batch;
+    };
+
+    // A RenderLayer is a retained collection of models to be drawn at certain positions, renderables stay in it until they are removed
     class RenderLayer
     {
     public:
-        typedef std::vector<InstanceData*> Instances;
-        typedef type_safe::underlying_type<ModelID> _ModelID;
+        RenderableID AddRenderable(ModelID modelID, const InstanceData& instanceData);
+        void RemoveRenderable(RenderableID renderableID);
 
-        void RegisterModel(ModelID modelID, InstanceData* instanceData) { _models[static_cast<_ModelID>(modelID)].push_back(instanceData); }
-        void Reset() 
-        {
-            for (auto& model : _models)
-            {
-                model.second.clear();
-            }
+        const InstanceData& GetInstanceData(RenderableID renderableID);
+        void SetModelMatrix(RenderableID renderableID, const mat4x4& modelMatrix);
+        void SetColorMultiplier(RenderableID renderableID, const vec4& colorMultiplier);
 
-            _models.clear(); 
-        }
+        // All instances of a model get drawn together, so the sort key is per model, see SortKey.h
+        void SetSortKey(ModelID modelID, u64 sortKey);
 
-        //robin_hood::unordered_map<_ModelID, Instances>& GetModels() { return _models; }
-        robin_hood::unordered_map<_ModelID, Instances>& GetModels() { return _models; }
+        // Radix sorts the batches by their sort keys, this only does any work if batches or sort keys changed since the last call
+        void Sort();
 
-        RenderLayer() {}
-        ~RenderLayer()
-        {
-            Reset();
-        }
+        const std::vector<ModelBatch>& GetBatches() { return _batches; }
+        const std::vector<DrawPacket>& GetDrawPackets() { return _drawPackets; } // The batches in sorted order
+
+        // True if instances were added or removed since the last ClearDirty, which moves the instances that come after them
+        bool HasLayoutChanged() { return _isLayoutDirty; }
+        void ClearDirty();
 
     private:
-        
+        struct RenderableLocation
+        {
+            u32 batch = 0;
+            u32 instance = 0;
+        };
+
+        u32 GetBatchIndex(ModelID modelID);
+        RenderableLocation& GetLocation(RenderableID renderableID);
+        void MarkDirty(ModelBatch& batch, u32 instance);
 
     private:
-        robin_hood::unordered_map<_ModelID, Instances> _models;
-        //std::unordered_map<_ModelID, Instances> _models;
+        std::vector<ModelBatch> _batches;
+        robin_hood::unordered_map<ModelID::type, u32> _batchLookup;
+
+        std::vector<RenderableLocation> _renderables; // Indexed by RenderableID
+        std::vector<RenderableID> _freeRenderables;
+
+        std::vector<DrawPacket> _drawPackets;
+        std::vector<DrawPacket> _sortScratch;
+
+        bool _isLayoutDirty = false;
+        bool _isSortDirty = false;
     };
 }
\ No newline at end of file
@@ -15,6 +15,52 @@ namespace Renderer
         return renderGraph;
     }
 
+    RenderGraph* Renderer::CreatePersistentRenderGraph(RenderGraphDesc& desc)
+    {
+        assert(desc.frameAllocator != nullptr); // The commandlists of every frame need an allocator that gets reset
+
+        RenderGraph* renderGraph = new RenderGraph(desc.allocator, this);
+        renderGraph->Init(desc);
+
+        return renderGraph;
+    }
+
+    GraphicsPipelineID Renderer::PrecompilePipeline(GraphicsPipelineDesc& desc, const std::vector<ImageID>& renderTargets, DepthImageID depthStencil)
+    {
+        using type = type_safe::underlying_type<RenderPassMutableResource>;
+        assert(renderTargets.size() <= MAX_RENDER_TARGETS);
+
+        for (size_t i = 0; i < renderTargets.size(); i++)
+        {
+            desc.renderTargets[i] = RenderPassMutableResource(static_cast<type>(i));
+        }
+
+        if (depthStencil != DepthImageID::Invalid())
+        {
+            desc.depthStencil = RenderPassMutableResource(0);
+        }
+
+        // RenderPassMutableResource(i) is renderTargets[i], textures aren't bound through the pipeline so those never get resolved
+        desc.ResourceToImageID = [](RenderPassResource /*resource*/)
+        {
+            return ImageID::Invalid();
+        };
+        desc.ResourceToDepthImageID = [](RenderPassResource /*resource*/)
+        {
+            return DepthImageID::Invalid();
+        };
+        desc.MutableResourceToImageID = [renderTargets](RenderPassMutableResource resource)
+        {
+            return renderTargets[static_cast<type>(resource)];
+        };
+        desc.MutableResourceToDepthImageID = [depthStencil](RenderPassMutableResource /*resource*/)
+        {
+            return depthStencil;
+        };
+
+        return QueuePipelineCompile(desc);
+    }
+
     RenderLayer& Renderer::GetRenderLayer(u32 layerHash)
     {
         return _renderLayers[layerHash];
@@ -1,6 +1,7 @@
 #pragma once
 #include <NovusTypes.h>
 #include <Utils/StringUtils.h>
+#include <vector>
 #include <robin_hood.h>
 #include "RenderGraph.h"
 #include "RenderGraphBuilder.h"
@@ -8,6 +9,8 @@
 #include "RenderPass.h"
 #include "ConstantBuffer.h"
 #include "RenderStates.h"
+#include "ResourceStates.h"
+#include "CommandStream.h"
 #include "Font.h"
 
 // Descriptors
@@ -22,6 +25,7 @@
 #include "Descriptors/ModelDesc.h"
 #include "Descriptors/SamplerDesc.h"
 #include "Descriptors/FontDesc.h"
+#include "Descriptors/BufferDesc.h"
 
 class Window;
 
@@ -36,6 +40,8 @@ namespace Renderer
         virtual ~Renderer();
 
         RenderGraph CreateRenderGraph(RenderGraphDesc& desc);
+        // Creates a RenderGraph to keep across frames, the passes get added once and only their execute functions run each frame, desc.frameAllocator has to be set
+        RenderGraph* CreatePersistentRenderGraph(RenderGraphDesc& desc);
         RenderLayer& GetRenderLayer(u32 layerHash);
 
         // Creation
@@ -47,6 +53,19 @@ namespace Renderer
         virtual GraphicsPipelineID CreatePipeline(GraphicsPipelineDesc& desc) = 0;
         virtual ComputePipelineID CreatePipeline(ComputePipelineDesc& desc) = 0;
 
+        // Registers a pipeline at init and compiles it on a worker thread, the returned ID is safe to use once WaitForPipelines has returned
+        // Since there is no RenderGraph yet the rendertargets are given directly, the desc gets its renderTargets and depthStencil set up to refer to them
+        GraphicsPipelineID PrecompilePipeline(GraphicsPipelineDesc& desc, const std::vector<ImageID>& renderTargets, DepthImageID depthStencil = DepthImageID::Invalid());
+        virtual void WaitForPipelines() = 0;
+
+        // When enabled a pipeline that isn't compiled yet gets compiled on a worker thread instead of stalling CreatePipeline, draws using it are skipped until it is ready
+        void SetAsyncPipelineCompilation(bool enabled) { _asyncPipelineCompilation = enabled; }
+        bool GetAsyncPipelineCompilation() { return _asyncPipelineCompilation; }
+        virtual u32 GetNumSkippedDraws() = 0; // How many draws were skipped last frame because their pipeline was still compiling
+        virtual u32 GetNumEmittedBinds() = 0; // How many pipeline, descriptor set, buffer, viewport and scissor binds were recorded last frame
+        virtual u32 GetNumSkippedBinds() = 0; // How many of those binds were skipped last frame because the same thing was already bound
+        virtual void LogMemoryStats() = 0; // Logs how much GPU memory each heap has reserved from the driver and handed out to resources
+
         template <typename T>
         ConstantBuffer<T>* CreateConstantBuffer()
         {
@@ -58,9 +77,16 @@ namespace Renderer
 
         virtual ModelID CreatePrimitiveModel(PrimitiveModelDesc& desc) = 0;
         virtual void UpdatePrimitiveModel(ModelID model, PrimitiveModelDesc& desc) = 0;
+        virtual const AABB& GetModelBounds(ModelID model) = 0; // Local space bounds, calculated from the vertices when the model gets loaded or updated
+        virtual u32 GetModelNumLODs(ModelID model) = 0;
+        virtual const ModelLOD& GetModelLOD(ModelID model, u32 lod) = 0; // What indirect draws of the LOD need to write into DrawInstancedIndirectArguments::numIndices, firstIndex and vertexOffset
+        virtual u32 GetModelGeometryBlock(ModelID model) = 0; // Models in the same geometry block share vertex and index buffers, so one indirect draw call can draw several of them
 
         virtual TextureID CreateDataTexture(DataTextureDesc& desc) = 0;
 
+        virtual BufferID CreateBuffer(BufferDesc& desc) = 0;
+        virtual void UpdateBuffer(BufferID buffer, const void* data, size_t offset, size_t size) = 0; // Writes into the copy used by the current frame with BUFFER_CPU_ACCESS_WRITE, otherwise it uploads through the staging ring
+
         // Loading
         virtual ModelID LoadModel(ModelDesc& desc) = 0;
         virtual TextureID LoadTexture(TextureDesc& desc) = 0;
@@ -72,18 +98,30 @@ namespace Renderer
         // Command List Functions
         virtual CommandListID BeginCommandList() = 0;
         virtual void EndCommandList(CommandListID commandList) = 0;
+        virtual void EndCommandLists(CommandListID* commandLists, u32 numCommandLists) = 0; // Submits all of them in one go, in the given order
         virtual void Clear(CommandListID commandList, ImageID image, Color color) = 0;
         virtual void Clear(CommandListID commandList, DepthImageID image, DepthClearFlags clearFlags, f32 depth, u8 stencil) = 0;
         virtual void Draw(CommandListID commandList, ModelID model) = 0;
+        virtual void DrawInstanced(CommandListID commandList, ModelID model, u32 lod, u32 numInstances, u32 firstInstance) = 0;
+        virtual void DrawInstancedIndirect(CommandListID commandList, ModelID model, BufferID argumentBuffer, u32 argumentOffset, u32 drawCount) = 0;
+        virtual void Dispatch(CommandListID commandList, u32 threadGroupCountX, u32 threadGroupCountY, u32 threadGroupCountZ) = 0;
         virtual void PopMarker(CommandListID commandList) = 0;
         virtual void PushMarker(CommandListID commandList, Color color, std::string name) = 0;
-        virtual void SetConstantBuffer(CommandListID commandList, u32 slot, void* gpuResource) = 0;
+        virtual void SetConstantBuffer(CommandListID commandList, u32 slot, void* gpuResource, u32 offset) = 0;
+        virtual void SetStorageBuffer(CommandListID commandList, u32 slot, BufferID buffer) = 0;
+        virtual void SetStorageImage(CommandListID commandList, u32 slot, ImageID image, u32 mipLevel) = 0;
+        virtual void SetSampledImage(CommandListID commandList, u32 slot, ImageID image) = 0;
+        virtual void SetSampledImage(CommandListID commandList, u32 slot, DepthImageID image) = 0;
         virtual void BeginPipeline(CommandListID commandList, GraphicsPipelineID pipeline) = 0;
         virtual void EndPipeline(CommandListID commandList, GraphicsPipelineID pipeline) = 0;
         virtual void SetPipeline(CommandListID commandList, ComputePipelineID pipeline) = 0;
         virtual void SetScissorRect(CommandListID commandList, ScissorRect scissorRect) = 0;
         virtual void SetViewport(CommandListID commandList, Viewport viewport) = 0;
-        virtual void SetTextureSampler(CommandListID commandList, u32 slot, TextureID texture, SamplerID sampler) = 0;
+        virtual void PushConstant(CommandListID commandList, void* data, u32 offset, u32 size) = 0;
+        virtual void ImageBarriers(CommandListID commandList, const ImageBarrier* barriers, u32 numBarriers) = 0;
+        virtual void BufferBarriers(CommandListID commandList, const BufferBarrier* barriers, u32 numBarriers) = 0;
+        virtual void SetAttachmentOps(CommandListID commandList, const AttachmentOps* ops, u32 numOps) = 0;
+        virtual void ExecuteCommands(CommandListID commandList, const CommandChunk* firstChunk) = 0; // Replays a packed command stream, see BackendDispatch::Dispatch
 
         // Non-commandlist based present functions
         virtual void Present(Window* window, ImageID image) = 0;
@@ -92,9 +130,20 @@ namespace Renderer
     protected:
         Renderer() {}; // Pure virtual class, disallow creation of it
 
+        virtual GraphicsPipelineID QueuePipelineCompile(GraphicsPipelineDesc& desc) = 0;
+
+        // Transient images get handed out by the RenderGraphBuilder, they are reused between frames and only get memory once the lifetimes of the frame are known
+        virtual ImageID CreateTransientImage(ImageDesc& desc) = 0;
+        virtual DepthImageID CreateTransientDepthImage(DepthImageDesc& desc) = 0;
+        virtual void AllocateTransientImages(const TransientImageLifetime* lifetimes, u32 numLifetimes) = 0;
+        virtual void ReleaseTransientImages() = 0; // Hands the transient images back without allocating them, for setups that only ran to check for changes
+
         virtual Backend::ConstantBufferBackend* CreateConstantBufferBackend(size_t size) = 0;
 
     protected:
         robin_hood::unordered_map<u32, RenderLayer> _renderLayers;
+        bool _asyncPipelineCompilation = true;
+
+        friend class RenderGraphBuilder; // To create and allocate transient images
     };
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vulkan/vulkan.h>
+#include "../../../ResourceStates.h"
+#include "../../../RenderGraphBuilder.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        // Maps the ResourceStates the RenderGraph tracks to what vkCmdPipelineBarrier needs
+        class BarrierUtilVK
+        {
+        public:
+            static inline VkImageLayout GetLayout(const ResourceState state)
+            {
+                switch (state)
+                {
+                case RESOURCE_STATE_UNDEFINED:      return VK_IMAGE_LAYOUT_UNDEFINED;
+                case RESOURCE_STATE_SHADER_READ:    return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                case RESOURCE_STATE_RENDER_TARGET:  return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                case RESOURCE_STATE_UAV:            return VK_IMAGE_LAYOUT_GENERAL;
+                case RESOURCE_STATE_DEPTH_WRITE:    return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                case RESOURCE_STATE_TRANSFER_DST:   return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                case RESOURCE_STATE_INDIRECT_ARGUMENT: break; // Buffers have no layout
+                }
+
+                return VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+
+            static inline VkAccessFlags GetAccessMask(const ResourceState state)
+            {
+                switch (state)
+                {
+                case RESOURCE_STATE_UNDEFINED:      return VK_ACCESS_MEMORY_WRITE_BIT; // The memory might have been written by an aliased transient image
+                case RESOURCE_STATE_SHADER_READ:    return VK_ACCESS_SHADER_READ_BIT;
+                case RESOURCE_STATE_RENDER_TARGET:  return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+                case RESOURCE_STATE_UAV:            return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                case RESOURCE_STATE_DEPTH_WRITE:    return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                case RESOURCE_STATE_TRANSFER_DST:   return VK_ACCESS_TRANSFER_WRITE_BIT;
+                case RESOURCE_STATE_INDIRECT_ARGUMENT: return VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+                }
+
+                return 0;
+            }
+
+            static inline VkPipelineStageFlags GetStageMask(const ResourceState state, const u8 shaderStages)
+            {
+                switch (state)
+                {
+                case RESOURCE_STATE_UNDEFINED:      return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                case RESOURCE_STATE_SHADER_READ:    return ToVkShaderStages(shaderStages);
+                case RESOURCE_STATE_RENDER_TARGET:  return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                case RESOURCE_STATE_UAV:            return ToVkShaderStages(shaderStages);
+                case RESOURCE_STATE_DEPTH_WRITE:    return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+                case RESOURCE_STATE_TRANSFER_DST:   return VK_PIPELINE_STAGE_TRANSFER_BIT;
+                case RESOURCE_STATE_INDIRECT_ARGUMENT: return VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+                }
+
+                return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            }
+
+            static inline VkPipelineStageFlags ToVkShaderStages(const u8 shaderStages)
+            {
+                // No stages means we don't know, so every shader stage has to be covered
+                if (shaderStages == RenderGraphBuilder::SHADER_STAGE_NONE)
+                    return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+                VkPipelineStageFlags stages = 0;
+                if (shaderStages & RenderGraphBuilder::SHADER_STAGE_VERTEX)
+                    stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+                if (shaderStages & RenderGraphBuilder::SHADER_STAGE_PIXEL)
+                    stages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+                if (shaderStages & RenderGraphBuilder::SHADER_STAGE_COMPUTE)
+                    stages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+                return stages;
+            }
+
+            static inline VkAttachmentLoadOp GetLoadOp(const AttachmentLoadOp loadOp)
+            {
+                switch (loadOp)
+                {
+                case ATTACHMENT_LOAD_OP_LOAD:       return VK_ATTACHMENT_LOAD_OP_LOAD;
+                case ATTACHMENT_LOAD_OP_CLEAR:      return VK_ATTACHMENT_LOAD_OP_CLEAR;
+                case ATTACHMENT_LOAD_OP_DONT_CARE:  return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                default:
+                    NC_LOG_FATAL("This should never hit, did we forget to update this function after adding more attachment load ops?");
+                }
+
+                return VK_ATTACHMENT_LOAD_OP_LOAD;
+            }
+
+            static inline VkImageAspectFlags GetAspectMask(const DepthImageFormat format)
+            {
+                // Layout transitions of combined depth stencil formats have to include both aspects
+                if (format == DEPTH_IMAGE_FORMAT_D32_FLOAT_S8X24_UINT || format == DEPTH_IMAGE_FORMAT_D24_UNORM_S8_UINT)
+                    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+            }
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "BufferHandlerVK.h"
+#include <Utils/DebugHandler.h>
+#include <cassert>
+#include "DebugMarkerUtilVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        BufferHandlerVK::BufferHandlerVK()
+        {
+
+        }
+
+        BufferHandlerVK::~BufferHandlerVK()
+        {
+
+        }
+
+        void BufferHandlerVK::Deinit(RenderDeviceVK* device)
+        {
+            for (Buffer& buffer : _buffers)
+            {
+                // Destroying the pool frees the descriptor sets allocated from it
+                if (buffer.descriptorPool != NULL)
+                {
+                    vkDestroyDescriptorPool(device->_device, buffer.descriptorPool, nullptr);
+                }
+
+                for (u32 i = 0; i < buffer.numCopies; i++)
+                {
+                    device->DestroyBuffer(buffer.buffers[i], buffer.allocations[i]);
+                }
+            }
+            _buffers.clear();
+        }
+
+        BufferID BufferHandlerVK::CreateBuffer(RenderDeviceVK* device, const BufferDesc& desc)
+        {
+            size_t nextHandle = _buffers.size();
+
+            // Make sure we haven't exceeded the limit of the BufferID type, if this hits you need to change type of BufferID to something bigger
+            assert(nextHandle < BufferID::MaxValue());
+            using type = type_safe::underlying_type<BufferID>;
+
+            assert(desc.size > 0); // Make sure the size is valid
+
+            Buffer buffer;
+            buffer.desc = desc;
+
+            VkBufferUsageFlags usage = ToVkBufferUsage(desc.usage);
+            VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+            if (desc.cpuAccess == BUFFER_CPU_ACCESS_WRITE)
+            {
+                // The CPU writes into these while older frames might still read them, so we need a copy per frame in flight
+                buffer.numCopies = RenderDeviceVK::FRAME_INDEX_COUNT;
+                memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            }
+
+            for (u32 i = 0; i < buffer.numCopies; i++)
+            {
+                // CPU writable buffers stay mapped for their whole lifetime, the allocator takes care of that
+                device->CreateBuffer(desc.size, usage, memoryProperties, buffer.buffers[i], buffer.allocations[i]);
+                DebugMarkerUtilVK::SetObjectName(device->_device, (u64)buffer.buffers[i], VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, desc.debugName.c_str());
+            }
+
+            _buffers.push_back(buffer);
+            return BufferID(static_cast<type>(nextHandle));
+        }
+
+        void BufferHandlerVK::UpdateBuffer(RenderDeviceVK* device, const BufferID bufferID, const void* data, size_t offset, size_t size)
+        {
+            using type = type_safe::underlying_type<BufferID>;
+
+            // Lets make sure this id exists
+            assert(_buffers.size() > static_cast<type>(bufferID));
+            Buffer& buffer = _buffers[static_cast<type>(bufferID)];
+
+            assert(offset + size <= buffer.desc.size); // Make sure we don't write outside of the buffer
+
+            // Device local buffers have a single copy that frames in flight might be reading, the upload gets ordered after them
+            if (buffer.desc.cpuAccess == BUFFER_CPU_ACCESS_NONE)
+            {
+                assert(buffer.desc.usage & BUFFER_USAGE_TRANSFER_DESTINATION); // We copy into it from the staging ring
+                device->_uploadHandler.UpdateBuffer(buffer.buffers[0], offset, data, size);
+                return;
+            }
+
+            u32 copyIndex = GetCopyIndex(device, buffer);
+            memcpy(static_cast<u8*>(buffer.allocations[copyIndex].mappedData) + offset, data, size);
+        }
+
+        const BufferDesc& BufferHandlerVK::GetDescriptor(const BufferID bufferID)
+        {
+            using type = type_safe::underlying_type<BufferID>;
+
+            // Lets make sure this id exists
+            assert(_buffers.size() > static_cast<type>(bufferID));
+            return _buffers[static_cast<type>(bufferID)].desc;
+        }
+
+        VkBuffer BufferHandlerVK::GetBuffer(RenderDeviceVK* device, const BufferID bufferID)
+        {
+            using type = type_safe::underlying_type<BufferID>;
+
+            // Lets make sure this id exists
+            assert(_buffers.size() > static_cast<type>(bufferID));
+            Buffer& buffer = _buffers[static_cast<type>(bufferID)];
+
+            return buffer.buffers[GetCopyIndex(device, buffer)];
+        }
+
+        VkDescriptorSet BufferHandlerVK::GetDescriptorSet(RenderDeviceVK* device, const BufferID bufferID, VkDescriptorSetLayout descriptorSetLayout)
+        {
+            using type = type_safe::underlying_type<BufferID>;
+
+            // Lets make sure this id exists
+            assert(_buffers.size() > static_cast<type>(bufferID));
+            Buffer& buffer = _buffers[static_cast<type>(bufferID)];
+
+            // Commandlists can be recorded in parallel, so the lazy creation below needs to be guarded
+            std::scoped_lock lock(_descriptorMutex);
+
+            // Uniform blocks are reserved for constant buffers which are bound through the constant buffer ring, so only storage buffers go through here
+            assert(buffer.desc.usage & BUFFER_USAGE_STORAGE_BUFFER);
+
+            if (buffer.descriptorPool == NULL)
+            {
+                VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+                VkDescriptorPoolSize poolSize = {};
+                poolSize.type = descriptorType;
+                poolSize.descriptorCount = buffer.numCopies;
+
+                VkDescriptorPoolCreateInfo poolInfo = {};
+                poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+                poolInfo.poolSizeCount = 1;
+                poolInfo.pPoolSizes = &poolSize;
+                poolInfo.maxSets = buffer.numCopies;
+
+                if (vkCreateDescriptorPool(device->_device, &poolInfo, nullptr, &buffer.descriptorPool) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create descriptor pool!");
+                }
+
+                VkDescriptorSetAllocateInfo allocInfo = {};
+                allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                allocInfo.descriptorPool = buffer.descriptorPool;
+                allocInfo.descriptorSetCount = 1;
+                allocInfo.pSetLayouts = &descriptorSetLayout;
+
+                for (u32 i = 0; i < buffer.numCopies; i++)
+                {
+                    if (vkAllocateDescriptorSets(device->_device, &allocInfo, &buffer.descriptorSets[i]) != VK_SUCCESS)
+                    {
+                        NC_LOG_FATAL("Failed to allocate descriptor sets!");
+                    }
+
+                    VkDescriptorBufferInfo descriptorBufferInfo = {};
+                    descriptorBufferInfo.buffer = buffer.buffers[i];
+                    descriptorBufferInfo.offset = 0;
+                    descriptorBufferInfo.range = buffer.desc.size;
+
+                    VkWriteDescriptorSet descriptorWrite = {};
+                    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    descriptorWrite.dstSet = buffer.descriptorSets[i];
+                    descriptorWrite.dstBinding = 0;
+                    descriptorWrite.dstArrayElement = 0;
+                    descriptorWrite.descriptorType = descriptorType;
+                    descriptorWrite.descriptorCount = 1;
+                    descriptorWrite.pBufferInfo = &descriptorBufferInfo;
+
+                    vkUpdateDescriptorSets(device->_device, 1, &descriptorWrite, 0, nullptr);
+                }
+            }
+
+            return buffer.descriptorSets[GetCopyIndex(device, buffer)];
+        }
+
+        u32 BufferHandlerVK::GetCopyIndex(RenderDeviceVK* device, const Buffer& buffer)
+        {
+            return (buffer.numCopies > 1) ? device->GetFrameIndex() : 0;
+        }
+
+        VkBufferUsageFlags BufferHandlerVK::ToVkBufferUsage(u8 usage)
+        {
+            VkBufferUsageFlags vkUsage = 0;
+
+            if (usage & BUFFER_USAGE_VERTEX_BUFFER)
+                vkUsage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+            if (usage & BUFFER_USAGE_INDEX_BUFFER)
+                vkUsage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+            if (usage & BUFFER_USAGE_UNIFORM_BUFFER)
+                vkUsage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+            if (usage & BUFFER_USAGE_STORAGE_BUFFER)
+                vkUsage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            if (usage & BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER)
+                vkUsage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+            if (usage & BUFFER_USAGE_TRANSFER_SOURCE)
+                vkUsage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            if (usage & BUFFER_USAGE_TRANSFER_DESTINATION)
+                vkUsage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+            return vkUsage;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+#include "../../../Descriptors/BufferDesc.h"
+#include "RenderDeviceVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        class BufferHandlerVK
+        {
+        public:
+            BufferHandlerVK();
+            ~BufferHandlerVK();
+
+            // Destroys all buffers, the GPU needs to be done using them
+            void Deinit(RenderDeviceVK* device);
+
+            BufferID CreateBuffer(RenderDeviceVK* device, const BufferDesc& desc);
+            void UpdateBuffer(RenderDeviceVK* device, const BufferID bufferID, const void* data, size_t offset, size_t size);
+
+            const BufferDesc& GetDescriptor(const BufferID bufferID);
+
+            // These return the copy used by the current frame
+            VkBuffer GetBuffer(RenderDeviceVK* device, const BufferID bufferID);
+            VkDescriptorSet GetDescriptorSet(RenderDeviceVK* device, const BufferID bufferID, VkDescriptorSetLayout descriptorSetLayout);
+
+        private:
+            struct Buffer
+            {
+                BufferDesc desc;
+                u32 numCopies = 1; // CPU writable buffers have one copy per frame in flight
+
+                VkBuffer buffers[RenderDeviceVK::FRAME_INDEX_COUNT] = {};
+                AllocationVK allocations[RenderDeviceVK::FRAME_INDEX_COUNT];
+
+                VkDescriptorPool descriptorPool = NULL;
+                VkDescriptorSet descriptorSets[RenderDeviceVK::FRAME_INDEX_COUNT] = {};
+            };
+
+        private:
+            u32 GetCopyIndex(RenderDeviceVK* device, const Buffer& buffer);
+            VkBufferUsageFlags ToVkBufferUsage(u8 usage);
+
+        private:
+            std::vector<Buffer> _buffers;
+            std::mutex _descriptorMutex;
+        };
+    }
+}
\ No newline at end of file
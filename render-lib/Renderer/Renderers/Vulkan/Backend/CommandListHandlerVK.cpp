@@ -12,13 +12,77 @@ namespace Renderer
 
         }
 
+        void CommandListHandlerVK::Init(RenderDeviceVK* device)
+        {
+            VkFenceCreateInfo fenceInfo = {};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Nothing is in flight yet, so the first wait should pass right away
+
+            for (u32 i = 0; i < RenderDeviceVK::FRAME_INDEX_COUNT; i++)
+            {
+                if (vkCreateFence(device->_device, &fenceInfo, nullptr, &_frameFences[i]) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create frame fence!");
+                }
+            }
+        }
+
+        void CommandListHandlerVK::FlipFrame(RenderDeviceVK* device, u32 frameIndex)
+        {
+            // Wait for the GPU to finish the last frame that used this index
+            vkWaitForFences(device->_device, 1, &_frameFences[frameIndex], VK_TRUE, UINT64_MAX);
+            vkResetFences(device->_device, 1, &_frameFences[frameIndex]);
+
+            // The commandlists submitted during that frame are now safe to reuse
+            std::queue<CommandListID>& closedCommandLists = _closedCommandLists[frameIndex];
+            while (!closedCommandLists.empty())
+            {
+                _availableCommandLists.push(closedCommandLists.front());
+                closedCommandLists.pop();
+            }
+        }
+
+        VkFence CommandListHandlerVK::GetFrameFence(u32 frameIndex)
+        {
+            assert(frameIndex < RenderDeviceVK::FRAME_INDEX_COUNT);
+            return _frameFences[frameIndex];
+        }
+
         CommandListHandlerVK::~CommandListHandlerVK()
         {
-            for (auto& commandList : _commandLists)
+
+        }
+
+        void CommandListHandlerVK::Deinit(RenderDeviceVK* device)
+        {
+            // Make sure no submitted frame still uses the commandlists
+            // FlipFrame reset the fence of the current frame and only Present signals it again, so that one isn't in flight and waiting on it would never return
+            for (u32 i = 0; i < RenderDeviceVK::FRAME_INDEX_COUNT; i++)
             {
-                // TODO: Cleanup
+                if (i != device->GetFrameIndex())
+                {
+                    vkWaitForFences(device->_device, 1, &_frameFences[i], VK_TRUE, UINT64_MAX);
+                }
+            }
+
+            for (u32 i = 0; i < RenderDeviceVK::FRAME_INDEX_COUNT; i++)
+            {
+                vkDestroyFence(device->_device, _frameFences[i], nullptr);
+                _frameFences[i] = VK_NULL_HANDLE;
+            }
+
+            // Destroying the pool frees the command buffer allocated from it
+            for (CommandList& commandList : _commandLists)
+            {
+                vkDestroyCommandPool(device->_device, commandList.commandPool, nullptr);
             }
             _commandLists.clear();
+
+            _availableCommandLists = std::queue<CommandListID>();
+            for (u32 i = 0; i < RenderDeviceVK::FRAME_INDEX_COUNT; i++)
+            {
+                _closedCommandLists[i] = std::queue<CommandListID>();
+            }
         }
 
         CommandListID CommandListHandlerVK::BeginCommandList(RenderDeviceVK* device)
@@ -87,16 +151,75 @@ namespace Renderer
                 submitInfo.pSignalSemaphores = &commandList.signalSemaphore;
             }
 
-            vkQueueSubmit(device->_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-            
-            // Do syncing stuff
-            vkQueueWaitIdle(device->_graphicsQueue);
+            // Pending uploads have to be submitted before anything that might use them
+            device->_uploadHandler.Flush();
 
-            commandList.waitSemaphore = NULL;
-            commandList.signalSemaphore = NULL;
-            commandList.boundGraphicsPipeline = GraphicsPipelineID::Invalid();
+            vkQueueSubmit(device->_graphicsQueue, 1, &submitInfo, commandList.signalFence);
+
+            ResetCommandList(device, id);
+        }
+
+        void CommandListHandlerVK::EndCommandLists(RenderDeviceVK* device, CommandListID* ids, u32 numIDs)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            std::vector<VkCommandBuffer> commandBuffers(numIDs);
+            std::vector<VkSemaphore> waitSemaphores;
+            std::vector<VkPipelineStageFlags> waitStageMasks;
+            std::vector<VkSemaphore> signalSemaphores;
+            VkFence signalFence = NULL;
+
+            for (u32 i = 0; i < numIDs; i++)
+            {
+                CommandList& commandList = _commandLists[static_cast<type>(ids[i])];
+
+                // Close command list
+                if (vkEndCommandBuffer(commandList.commandBuffer) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to record command buffer!");
+                }
+                commandBuffers[i] = commandList.commandBuffer;
+
+                if (commandList.waitSemaphore != NULL)
+                {
+                    waitSemaphores.push_back(commandList.waitSemaphore);
+                    waitStageMasks.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+                }
+
+                if (commandList.signalSemaphore != NULL)
+                {
+                    signalSemaphores.push_back(commandList.signalSemaphore);
+                }
+
+                if (commandList.signalFence != NULL)
+                {
+                    assert(signalFence == NULL); // A submit can only signal one fence
+                    signalFence = commandList.signalFence;
+                }
+            }
 
-            _availableCommandLists.push(id);
+            // Execute all command lists in one submit, they execute in the order they are in the array
+            VkSubmitInfo submitInfo = {};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = numIDs;
+            submitInfo.pCommandBuffers = commandBuffers.data();
+
+            submitInfo.waitSemaphoreCount = static_cast<u32>(waitSemaphores.size());
+            submitInfo.pWaitSemaphores = waitSemaphores.data();
+            submitInfo.pWaitDstStageMask = waitStageMasks.data();
+
+            submitInfo.signalSemaphoreCount = static_cast<u32>(signalSemaphores.size());
+            submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+            // Pending uploads have to be submitted before anything that might use them
+            device->_uploadHandler.Flush();
+
+            vkQueueSubmit(device->_graphicsQueue, 1, &submitInfo, signalFence);
+
+            for (u32 i = 0; i < numIDs; i++)
+            {
+                ResetCommandList(device, ids[i]);
+            }
         }
 
         VkCommandBuffer CommandListHandlerVK::GetCommandBuffer(CommandListID id)
@@ -167,6 +290,18 @@ namespace Renderer
             commandList.signalSemaphore = semaphore;
         }
 
+        void CommandListHandlerVK::SetSignalFence(CommandListID id, VkFence fence)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            CommandList& commandList = _commandLists[static_cast<type>(id)];
+
+            commandList.signalFence = fence;
+        }
+
         void CommandListHandlerVK::SetBoundGraphicsPipeline(CommandListID id, GraphicsPipelineID pipelineID)
         {
             using type = type_safe::underlying_type<CommandListID>;
@@ -189,6 +324,153 @@ namespace Renderer
             return _commandLists[static_cast<type>(id)].boundGraphicsPipeline;
         }
 
+        void CommandListHandlerVK::SetBoundComputePipeline(CommandListID id, ComputePipelineID pipelineID)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            CommandList& commandList = _commandLists[static_cast<type>(id)];
+
+            commandList.boundComputePipeline = pipelineID;
+        }
+
+        ComputePipelineID CommandListHandlerVK::GetBoundComputePipeline(CommandListID id)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            return _commandLists[static_cast<type>(id)].boundComputePipeline;
+        }
+
+        i8& CommandListHandlerVK::GetRenderPassOpenCount(CommandListID id)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            return _commandLists[static_cast<type>(id)].renderPassOpenCount;
+        }
+
+        BoundStateVK& CommandListHandlerVK::GetBoundState(CommandListID id)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            return _commandLists[static_cast<type>(id)].boundState;
+        }
+
+        void CommandListHandlerVK::SetSkipPipeline(CommandListID id, bool skip)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            _commandLists[static_cast<type>(id)].skipPipeline = skip;
+        }
+
+        bool CommandListHandlerVK::GetSkipPipeline(CommandListID id)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            return _commandLists[static_cast<type>(id)].skipPipeline;
+        }
+
+        void CommandListHandlerVK::SetOpenFramebuffer(CommandListID id, VkFramebuffer framebuffer)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            _commandLists[static_cast<type>(id)].openFramebuffer = framebuffer;
+        }
+
+        VkFramebuffer CommandListHandlerVK::GetOpenFramebuffer(CommandListID id)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            return _commandLists[static_cast<type>(id)].openFramebuffer;
+        }
+
+        void CommandListHandlerVK::SetPendingAttachmentOps(CommandListID id, const AttachmentOps* ops, u32 numOps)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            std::vector<AttachmentOps>& pendingOps = _commandLists[static_cast<type>(id)].pendingAttachmentOps;
+            pendingOps.assign(ops, ops + numOps);
+        }
+
+        bool CommandListHandlerVK::ConsumePendingAttachmentOps(CommandListID id, ImageID image, DepthImageID depthImage, AttachmentOps& ops)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            std::vector<AttachmentOps>& pendingOps = _commandLists[static_cast<type>(id)].pendingAttachmentOps;
+            for (size_t i = 0; i < pendingOps.size(); i++)
+            {
+                if (pendingOps[i].image == image && pendingOps[i].depthImage == depthImage)
+                {
+                    ops = pendingOps[i];
+
+                    pendingOps[i] = pendingOps.back();
+                    pendingOps.pop_back();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void CommandListHandlerVK::TakePendingAttachmentOps(CommandListID id, std::vector<AttachmentOps>& ops)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+
+            // Lets make sure this id exists
+            assert(_commandLists.size() > static_cast<type>(id));
+
+            ops.clear();
+            ops.swap(_commandLists[static_cast<type>(id)].pendingAttachmentOps);
+        }
+
+        void CommandListHandlerVK::ResetCommandList(RenderDeviceVK* device, CommandListID id)
+        {
+            using type = type_safe::underlying_type<CommandListID>;
+            CommandList& commandList = _commandLists[static_cast<type>(id)];
+
+            commandList.waitSemaphore = NULL;
+            commandList.signalSemaphore = NULL;
+            commandList.signalFence = NULL;
+            commandList.boundGraphicsPipeline = GraphicsPipelineID::Invalid();
+            commandList.boundComputePipeline = ComputePipelineID::Invalid();
+            commandList.renderPassOpenCount = 0;
+            commandList.skipPipeline = false;
+            commandList.openFramebuffer = VK_NULL_HANDLE;
+            commandList.pendingAttachmentOps.clear();
+            commandList.boundState = BoundStateVK(); // A new command buffer starts out with nothing bound
+
+            // The GPU might still be using it, so it only becomes available again once this frame has finished
+            _closedCommandLists[device->GetFrameIndex()].push(id);
+        }
+
         CommandListID CommandListHandlerVK::CreateCommandList(RenderDeviceVK* device)
         {
             size_t id = _commandLists.size();
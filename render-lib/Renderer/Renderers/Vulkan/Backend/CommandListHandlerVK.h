@@ -6,13 +6,41 @@
 
 #include "../../../Descriptors/CommandListDesc.h"
 #include "../../../Descriptors/GraphicsPipelineDesc.h"
+#include "../../../Descriptors/ComputePipelineDesc.h"
+#include "../../../ResourceStates.h"
+#include "RenderDeviceVK.h"
 
 
 namespace Renderer
 {
     namespace Backend
     {
-        class RenderDeviceVK;
+        // Vulkan keeps the bound pipeline and descriptor sets separately for graphics and compute
+        struct BindPointStateVK
+        {
+            static const u32 MAX_DESCRIPTOR_SETS = 8;
+
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+            VkDescriptorSet descriptorSets[MAX_DESCRIPTOR_SETS] = {};
+            u32 dynamicOffsets[MAX_DESCRIPTOR_SETS] = {};
+        };
+
+        // Shadows what is bound in a commandlist, so RendererVK can skip vkCmd calls that wouldn't change anything
+        struct BoundStateVK
+        {
+            // Descriptor sets and push constants go to the bind point of the pipeline that was bound last
+            VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            BindPointStateVK bindPoints[2]; // Indexed by VK_PIPELINE_BIND_POINT_GRAPHICS and VK_PIPELINE_BIND_POINT_COMPUTE
+
+            VkBuffer vertexBuffer = VK_NULL_HANDLE;
+            VkBuffer indexBuffer = VK_NULL_HANDLE;
+            VkViewport viewport = {};
+            VkRect2D scissor = {};
+
+            u32 numEmittedBinds = 0;
+            u32 numSkippedBinds = 0;
+        };
 
         class CommandListHandlerVK
         {
@@ -20,8 +48,16 @@ namespace Renderer
             CommandListHandlerVK();
             ~CommandListHandlerVK();
 
+            void Init(RenderDeviceVK* device);
+            void Deinit(RenderDeviceVK* device); // Waits for the frames in flight and destroys the frame fences and commandlists
+
+            // Waits until the GPU is done with the frame that last used frameIndex, and recycles the commandlists that were submitted in it
+            void FlipFrame(RenderDeviceVK* device, u32 frameIndex);
+            VkFence GetFrameFence(u32 frameIndex);
+
             CommandListID BeginCommandList(RenderDeviceVK* device);
             void EndCommandList(RenderDeviceVK* device, CommandListID id);
+            void EndCommandLists(RenderDeviceVK* device, CommandListID* ids, u32 numIDs);
 
             VkCommandBuffer GetCommandBuffer(CommandListID id);
 
@@ -31,27 +67,59 @@ namespace Renderer
             bool GetSignalSemaphore(CommandListID id, VkSemaphore& semaphore);
             void SetSignalSemaphore(CommandListID id, VkSemaphore semaphore);
 
+            void SetSignalFence(CommandListID id, VkFence fence);
+
             void SetBoundGraphicsPipeline(CommandListID id, GraphicsPipelineID pipelineID);
             GraphicsPipelineID GetBoundGraphicsPipeline(CommandListID id);
 
+            void SetBoundComputePipeline(CommandListID id, ComputePipelineID pipelineID);
+            ComputePipelineID GetBoundComputePipeline(CommandListID id);
+
+            i8& GetRenderPassOpenCount(CommandListID id);
+            BoundStateVK& GetBoundState(CommandListID id);
+
+            // Set between BeginPipeline and EndPipeline when the pipeline is still compiling, everything recorded in between gets skipped
+            void SetSkipPipeline(CommandListID id, bool skip);
+            bool GetSkipPipeline(CommandListID id);
+
+            // EndPipeline leaves the render pass open so the next pipeline can keep using it if it renders to the same framebuffer
+            void SetOpenFramebuffer(CommandListID id, VkFramebuffer framebuffer);
+            VkFramebuffer GetOpenFramebuffer(CommandListID id);
+
+            // The attachment ops of the current pass, each one is used up by the first render pass that renders to its image
+            void SetPendingAttachmentOps(CommandListID id, const AttachmentOps* ops, u32 numOps);
+            bool ConsumePendingAttachmentOps(CommandListID id, ImageID image, DepthImageID depthImage, AttachmentOps& ops);
+            void TakePendingAttachmentOps(CommandListID id, std::vector<AttachmentOps>& ops); // Hands out the ones nothing used up and clears them
+
         private:
             struct CommandList
             {
                 VkSemaphore waitSemaphore = NULL;
                 VkSemaphore signalSemaphore = NULL;
+                VkFence signalFence = NULL;
                 VkCommandBuffer commandBuffer;
                 VkCommandPool commandPool;
 
                 GraphicsPipelineID boundGraphicsPipeline = GraphicsPipelineID::Invalid();
+                ComputePipelineID boundComputePipeline = ComputePipelineID::Invalid();
+                i8 renderPassOpenCount = 0;
+                bool skipPipeline = false;
+                VkFramebuffer openFramebuffer = VK_NULL_HANDLE;
+                std::vector<AttachmentOps> pendingAttachmentOps;
+                BoundStateVK boundState;
             };
 
             CommandListID CreateCommandList(RenderDeviceVK* device);
+            void ResetCommandList(RenderDeviceVK* device, CommandListID id);
 
         private:
 
         private:
             std::vector<CommandList> _commandLists;
             std::queue<CommandListID> _availableCommandLists;
+            std::queue<CommandListID> _closedCommandLists[RenderDeviceVK::FRAME_INDEX_COUNT]; // These might still be in use by the GPU
+
+            VkFence _frameFences[RenderDeviceVK::FRAME_INDEX_COUNT];
         };
     }
 }
\ No newline at end of file
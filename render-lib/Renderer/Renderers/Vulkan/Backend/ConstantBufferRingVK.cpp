@@ -0,0 +1,117 @@
+#include "ConstantBufferRingVK.h"
+#include <Utils/DebugHandler.h>
+#include <cassert>
+#include <cstring>
+
+#include "RenderDeviceVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        static_assert(ConstantBufferRingVK::FRAME_COUNT == RenderDeviceVK::FRAME_INDEX_COUNT, "The constant buffer ring needs one region per frame in flight");
+
+        void ConstantBufferRingVK::Init(RenderDeviceVK* device)
+        {
+            // Dynamic offsets need to respect the alignment of the device
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device->_physicalDevice, &properties);
+            _alignment = static_cast<u32>(properties.limits.minUniformBufferOffsetAlignment);
+
+            if (MAX_CONSTANT_BUFFER_SIZE > properties.limits.maxUniformBufferRange)
+            {
+                NC_LOG_FATAL("Constant buffer ring descriptor range is bigger than the device supports!");
+            }
+
+            // Every pipeline declares its constant buffers with this exact layout, that way one descriptor set works with all of them
+            VkDescriptorSetLayoutBinding layoutBinding = {};
+            layoutBinding.binding = 0;
+            layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            layoutBinding.descriptorCount = 1;
+            layoutBinding.stageFlags = VK_SHADER_STAGE_ALL;
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = 1;
+            layoutInfo.pBindings = &layoutBinding;
+
+            if (vkCreateDescriptorSetLayout(device->_device, &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create constant buffer ring descriptor set layout!");
+            }
+
+            VkDescriptorPoolSize poolSize = {};
+            poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            poolSize.descriptorCount = FRAME_COUNT;
+
+            VkDescriptorPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.poolSizeCount = 1;
+            poolInfo.pPoolSizes = &poolSize;
+            poolInfo.maxSets = FRAME_COUNT;
+
+            if (vkCreateDescriptorPool(device->_device, &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create constant buffer ring descriptor pool!");
+            }
+
+            for (u32 i = 0; i < FRAME_COUNT; i++)
+            {
+                Frame& frame = _frames[i];
+
+                // The allocator keeps host visible blocks persistently mapped, so we never map or unmap this
+                device->CreateBuffer(RING_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.buffer, frame.allocation);
+
+                VkDescriptorSetAllocateInfo allocInfo = {};
+                allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                allocInfo.descriptorPool = _descriptorPool;
+                allocInfo.descriptorSetCount = 1;
+                allocInfo.pSetLayouts = &_descriptorSetLayout;
+
+                if (vkAllocateDescriptorSets(device->_device, &allocInfo, &frame.descriptorSet) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to allocate constant buffer ring descriptor set!");
+                }
+
+                VkDescriptorBufferInfo descriptorBufferInfo = {};
+                descriptorBufferInfo.buffer = frame.buffer;
+                descriptorBufferInfo.offset = 0;
+                descriptorBufferInfo.range = MAX_CONSTANT_BUFFER_SIZE;
+
+                VkWriteDescriptorSet descriptorWrite = {};
+                descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrite.dstSet = frame.descriptorSet;
+                descriptorWrite.dstBinding = 0;
+                descriptorWrite.dstArrayElement = 0;
+                descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                descriptorWrite.descriptorCount = 1;
+                descriptorWrite.pBufferInfo = &descriptorBufferInfo;
+
+                vkUpdateDescriptorSets(device->_device, 1, &descriptorWrite, 0, nullptr);
+            }
+        }
+
+        u32 ConstantBufferRingVK::Allocate(u32 frameIndex, const void* data, size_t size)
+        {
+            assert(size <= MAX_CONSTANT_BUFFER_SIZE);
+            Frame& frame = _frames[frameIndex];
+
+            u32 alignedSize = (static_cast<u32>(size) + _alignment - 1) & ~(_alignment - 1);
+            u32 offset = frame.offset.fetch_add(alignedSize);
+
+            // The descriptor always reads MAX_CONSTANT_BUFFER_SIZE bytes from the offset, so that much has to fit
+            if (offset + MAX_CONSTANT_BUFFER_SIZE > RING_SIZE)
+            {
+                NC_LOG_FATAL("Constant buffer ring ran out of space, increase RING_SIZE!");
+            }
+
+            memcpy(static_cast<u8*>(frame.allocation.mappedData) + offset, data, size);
+            return offset;
+        }
+
+        void ConstantBufferRingVK::Reset(u32 frameIndex)
+        {
+            _frames[frameIndex].offset = 0;
+        }
+    }
+}
\ No newline at end of file
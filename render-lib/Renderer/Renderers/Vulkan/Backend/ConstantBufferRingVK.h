@@ -0,0 +1,53 @@
+#pragma once
+#include <NovusTypes.h>
+#include <atomic>
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocatorVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        class RenderDeviceVK;
+
+        // Linear ring of persistently mapped uniform memory, one region per frame in flight
+        // Constant buffers are copied in with Allocate and bound through a single dynamic uniform buffer descriptor
+        class ConstantBufferRingVK
+        {
+        public:
+            void Init(RenderDeviceVK* device);
+
+            // Copies data into the ring of the current frame and returns the dynamic offset to bind it with
+            u32 Allocate(u32 frameIndex, const void* data, size_t size);
+
+            // Only call this once the GPU is done with the frame
+            void Reset(u32 frameIndex);
+
+            VkDescriptorSet GetDescriptorSet(u32 frameIndex) { return _frames[frameIndex].descriptorSet; }
+            VkDescriptorSetLayout GetDescriptorSetLayout() { return _descriptorSetLayout; }
+
+        public:
+            static const u32 FRAME_COUNT = 2; // Has to match RenderDeviceVK::FRAME_INDEX_COUNT
+            static const u32 RING_SIZE = 4 * 1024 * 1024; // 4 MB per frame
+            static const u32 MAX_CONSTANT_BUFFER_SIZE = 4096; // The range of the descriptor, no constant buffer can be bigger than this
+
+        private:
+            struct Frame
+            {
+                VkBuffer buffer = VK_NULL_HANDLE;
+                AllocationVK allocation;
+                VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+                std::atomic<u32> offset { 0 };
+            };
+
+            Frame _frames[FRAME_COUNT];
+
+            u32 _alignment = 256;
+
+            VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+            VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+        };
+    }
+}
\ No newline at end of file
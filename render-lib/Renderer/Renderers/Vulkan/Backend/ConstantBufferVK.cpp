@@ -5,15 +5,13 @@ namespace Renderer
 {
     namespace Backend
     {
-        void ConstantBufferBackendVK::Apply(u32 frameIndex, void* data, size_t size)
+        u32 ConstantBufferBackendVK::Apply(void* data, size_t size)
         {
-            void* destData;
-            vkMapMemory(device->_device, uniformBuffersMemory[frameIndex], 0, size, 0, &destData);
-            memcpy(destData, data, size);
-            vkUnmapMemory(device->_device, uniformBuffersMemory[frameIndex]);
+            // Copy into the persistently mapped ring of the current frame, the returned offset is what we bind with
+            return device->_constantBufferRing.Allocate(device->GetFrameIndex(), data, size);
         }
 
-        void* ConstantBufferBackendVK::GetGPUResource(u32 frameIndex)
+        void* ConstantBufferBackendVK::GetGPUResource()
         {
             return static_cast<void*>(this);
         }
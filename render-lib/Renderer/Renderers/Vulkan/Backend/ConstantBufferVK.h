@@ -2,13 +2,12 @@
 #include <NovusTypes.h>
 #include "../../../ConstantBuffer.h"
 #include <vulkan/vulkan.h>
+#include "RenderDeviceVK.h"
 
 namespace Renderer
 {
     namespace Backend
     {
-        class RenderDeviceVK;
-
         struct ConstantBufferBackendVK : public ConstantBufferBackend
         {
             ConstantBufferBackendVK() {};
@@ -17,22 +16,13 @@ namespace Renderer
 
             }
 
-            static const u32 FRAME_BUFFER_COUNT = 2;
             RenderDeviceVK* device;
-
-            VkBuffer uniformBuffers[FRAME_BUFFER_COUNT] = { nullptr, nullptr };
-            VkDeviceMemory uniformBuffersMemory[FRAME_BUFFER_COUNT] = { nullptr, nullptr };
-
-            VkDescriptorPool descriptorPool = NULL;
-            VkDescriptorSet descriptorSet[FRAME_BUFFER_COUNT];        
-
             size_t bufferSize;
-            u8 useIndex = 0;
 
         private:
-            void Apply(u32 frameIndex, void* data, size_t size) override;
+            u32 Apply(void* data, size_t size) override;
 
-            void* GetGPUResource(u32 frameIndex) override;
+            void* GetGPUResource() override;
         };
     }
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "RenderDeviceVK.h"
 #include "FormatConverterVK.h"
 #include "DebugMarkerUtilVK.h"
+#include "BarrierUtilVK.h"
+#include <algorithm>
 
 namespace Renderer
 {
@@ -30,9 +32,565 @@ namespace Renderer
             Image image;
             image.desc = desc;
 
+            CreateVkImage(device, image);
+
+            // Bind memory
+            device->AllocateImageMemory(image.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.allocation);
+
+            CreateColorView(device, image);
+            CreateMipViews(device, image);
+            
+            // Transition image from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, which is where the RenderGraph expects images to rest
+            device->TransitionImageLayout(image.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+            _images.push_back(image);
+
+            return ImageID(static_cast<type>(nextHandle));
+        }
+
+        DepthImageID ImageHandlerVK::CreateDepthImage(RenderDeviceVK* device, const DepthImageDesc& desc)
+        {
+            size_t nextHandle = _depthImages.size();
+
+            // Make sure we haven't exceeded the limit of the DepthImageID type, if this hits you need to change type of DepthImageID to something bigger
+            assert(nextHandle < DepthImageID::MaxValue());
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            DepthImage image;
+            image.desc = desc;
+
+            CreateVkImage(device, image);
+
+            // Bind memory
+            device->AllocateImageMemory(image.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image.allocation);
+
+            CreateDepthView(device, image);
+
+            // Transition image from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, which is where the RenderGraph expects images to rest
+            device->TransitionImageLayout(image.image, BarrierUtilVK::GetAspectMask(desc.format), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+            _depthImages.push_back(image);
+
+            return DepthImageID(static_cast<type>(nextHandle));
+        }
+
+        ImageID ImageHandlerVK::CreateTransientImage(RenderDeviceVK* device, const ImageDesc& desc)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Transient images get new views whenever they are placed again, so only permanent images can have mips
+            assert(desc.mipLevels == 1);
+
+            // Reuse a transient image from an earlier frame if one matches, that keeps the ID and with it the pipelines using it the same
+            for (ImageID id : _transientImages)
+            {
+                Image& image = _images[static_cast<type>(id)];
+                if (image.isTransientInUse)
+                    continue;
+
+                if (image.desc.dimensions == desc.dimensions && image.desc.depth == desc.depth && image.desc.format == desc.format && image.desc.sampleCount == desc.sampleCount)
+                {
+                    image.desc.debugName = desc.debugName;
+                    image.desc.clearColor = desc.clearColor;
+                    image.isTransientInUse = true;
+                    return id;
+                }
+            }
+
+            size_t nextHandle = _images.size();
+
+            // Make sure we haven't exceeded the limit of the ImageID type, if this hits you need to change type of ImageID to something bigger
+            assert(nextHandle < ImageID::MaxValue());
+
+            Image image;
+            image.desc = desc;
+            image.isTransient = true;
+            image.isTransientInUse = true;
+
+            // The memory and view are created once the image gets placed
+            CreateVkImage(device, image);
+
+            _images.push_back(image);
+
+            ImageID id = ImageID(static_cast<type>(nextHandle));
+            _transientImages.push_back(id);
+
+            return id;
+        }
+
+        DepthImageID ImageHandlerVK::CreateTransientDepthImage(RenderDeviceVK* device, const DepthImageDesc& desc)
+        {
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            for (DepthImageID id : _transientDepthImages)
+            {
+                DepthImage& image = _depthImages[static_cast<type>(id)];
+                if (image.isTransientInUse)
+                    continue;
+
+                if (image.desc.dimensions == desc.dimensions && image.desc.format == desc.format && image.desc.sampleCount == desc.sampleCount)
+                {
+                    image.desc.debugName = desc.debugName;
+                    image.desc.depthClearValue = desc.depthClearValue;
+                    image.desc.stencilClearValue = desc.stencilClearValue;
+                    image.isTransientInUse = true;
+                    return id;
+                }
+            }
+
+            size_t nextHandle = _depthImages.size();
+
+            // Make sure we haven't exceeded the limit of the DepthImageID type, if this hits you need to change type of DepthImageID to something bigger
+            assert(nextHandle < DepthImageID::MaxValue());
+
+            DepthImage image;
+            image.desc = desc;
+            image.isTransient = true;
+            image.isTransientInUse = true;
+
+            CreateVkImage(device, image);
+
+            _depthImages.push_back(image);
+
+            DepthImageID id = DepthImageID(static_cast<type>(nextHandle));
+            _transientDepthImages.push_back(id);
+
+            return id;
+        }
+
+        bool ImageHandlerVK::PlaceTransientImages(RenderDeviceVK* device, const TransientImageLifetime* lifetimes, u32 numLifetimes)
+        {
+            using imageType = type_safe::underlying_type<ImageID>;
+            using depthImageType = type_safe::underlying_type<DepthImageID>;
+
+            std::vector<TransientPlacement> placements(numLifetimes);
+            for (u32 i = 0; i < numLifetimes; i++)
+            {
+                TransientPlacement& placement = placements[i];
+                placement.image = lifetimes[i].image;
+                placement.depthImage = lifetimes[i].depthImage;
+                placement.firstPass = lifetimes[i].firstPass;
+                placement.lastPass = lifetimes[i].lastPass;
+
+                VkImage image = (placement.image != ImageID::Invalid()) ? _images[static_cast<imageType>(placement.image)].image : _depthImages[static_cast<depthImageType>(placement.depthImage)].image;
+                vkGetImageMemoryRequirements(device->_device, image, &placement.requirements);
+            }
+
+            // Place the biggest images first, each one goes at the lowest offset that doesn't overlap an image which is alive at the same time
+            std::vector<TransientPlacement*> sorted(numLifetimes);
+            for (u32 i = 0; i < numLifetimes; i++)
+            {
+                sorted[i] = &placements[i];
+            }
+            std::stable_sort(sorted.begin(), sorted.end(), [](const TransientPlacement* a, const TransientPlacement* b)
+            {
+                return a->requirements.size > b->requirements.size;
+            });
+
+            for (u32 i = 0; i < numLifetimes; i++)
+            {
+                TransientPlacement* placement = sorted[i];
+                VkDeviceSize alignment = placement->requirements.alignment;
+                VkDeviceSize offset = 0;
+
+                bool moved = true;
+                while (moved)
+                {
+                    moved = false;
+
+                    for (u32 j = 0; j < i; j++)
+                    {
+                        TransientPlacement* other = sorted[j];
+
+                        bool livesOverlap = placement->firstPass <= other->lastPass && other->firstPass <= placement->lastPass;
+                        bool memoryOverlaps = offset < other->offset + other->requirements.size && other->offset < offset + placement->requirements.size;
+
+                        if (livesOverlap && memoryOverlaps)
+                        {
+                            offset = (other->offset + other->requirements.size + alignment - 1) & ~(alignment - 1);
+                            moved = true;
+                        }
+                    }
+                }
+
+                placement->offset = offset;
+            }
+
+            // Compare with what the images are currently bound to
+            bool changed = placements.size() != _transientPlacements.size();
+            for (size_t i = 0; i < placements.size() && !changed; i++)
+            {
+                const TransientPlacement& placement = placements[i];
+                const TransientPlacement& current = _transientPlacements[i];
+
+                changed = placement.image != current.image || placement.depthImage != current.depthImage || placement.offset != current.offset;
+            }
+
+            // The same images might have been placed with a different lifetime earlier, lets make sure they are all actually bound where we want them
+            for (size_t i = 0; i < placements.size() && !changed; i++)
+            {
+                const TransientPlacement& placement = placements[i];
+                VkDeviceSize boundOffset = (placement.image != ImageID::Invalid()) ? _images[static_cast<imageType>(placement.image)].transientOffset : _depthImages[static_cast<depthImageType>(placement.depthImage)].transientOffset;
+
+                changed = boundOffset != placement.offset;
+            }
+
+            _transientPlacements = std::move(placements);
+            return changed;
+        }
+
+        void ImageHandlerVK::ApplyTransientPlacement(RenderDeviceVK* device)
+        {
+            using imageType = type_safe::underlying_type<ImageID>;
+            using depthImageType = type_safe::underlying_type<DepthImageID>;
+
+            // Images can only be bound to memory once, so every transient image gets recreated
+            for (ImageID id : _transientImages)
+            {
+                Image& image = _images[static_cast<imageType>(id)];
+
+                if (image.transientOffset != INVALID_TRANSIENT_OFFSET)
+                {
+                    vkDestroyImageView(device->_device, image.colorView, nullptr);
+                    vkDestroyImage(device->_device, image.image, nullptr);
+                    CreateVkImage(device, image);
+
+                    image.colorView = VK_NULL_HANDLE;
+                    image.transientOffset = INVALID_TRANSIENT_OFFSET;
+                }
+            }
+
+            for (DepthImageID id : _transientDepthImages)
+            {
+                DepthImage& image = _depthImages[static_cast<depthImageType>(id)];
+
+                if (image.transientOffset != INVALID_TRANSIENT_OFFSET)
+                {
+                    vkDestroyImageView(device->_device, image.depthView, nullptr);
+                    vkDestroyImage(device->_device, image.image, nullptr);
+                    CreateVkImage(device, image);
+
+                    image.depthView = VK_NULL_HANDLE;
+                    image.transientOffset = INVALID_TRANSIENT_OFFSET;
+                }
+            }
+
+            // Figure out how much memory the placement needs
+            VkMemoryRequirements requirements = {};
+            requirements.alignment = 1;
+            requirements.memoryTypeBits = ~0u;
+
+            for (const TransientPlacement& placement : _transientPlacements)
+            {
+                requirements.size = std::max(requirements.size, placement.offset + placement.requirements.size);
+                requirements.alignment = std::max(requirements.alignment, placement.requirements.alignment);
+                requirements.memoryTypeBits &= placement.requirements.memoryTypeBits;
+            }
+
+            if (requirements.memoryTypeBits == 0)
+            {
+                NC_LOG_FATAL("Transient images have no memory type in common, they can't share an allocation!");
+            }
+
+            // Only grow the allocation, shrinking it would just make us reallocate once the bigger graph comes back
+            if (requirements.size > _transientAllocationSize)
+            {
+                if (_transientAllocationSize > 0)
+                {
+                    device->FreeImageMemory(_transientAllocation);
+                }
+
+                _transientAllocation = device->_memoryAllocator.Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                _transientAllocationSize = requirements.size;
+            }
+
+            for (const TransientPlacement& placement : _transientPlacements)
+            {
+                VkDeviceSize offset = _transientAllocation.offset + placement.offset;
+
+                if (placement.image != ImageID::Invalid())
+                {
+                    Image& image = _images[static_cast<imageType>(placement.image)];
+                    vkBindImageMemory(device->_device, image.image, _transientAllocation.memory, offset);
+                    CreateColorView(device, image);
+
+                    image.transientOffset = placement.offset;
+                }
+                else
+                {
+                    DepthImage& image = _depthImages[static_cast<depthImageType>(placement.depthImage)];
+                    vkBindImageMemory(device->_device, image.image, _transientAllocation.memory, offset);
+                    CreateDepthView(device, image);
+
+                    image.transientOffset = placement.offset;
+                }
+            }
+
+            NC_LOG_MESSAGE("Placed %u transient images in %llu bytes", static_cast<u32>(_transientPlacements.size()), static_cast<u64>(requirements.size));
+        }
+
+        void ImageHandlerVK::ReleaseTransientImages()
+        {
+            using imageType = type_safe::underlying_type<ImageID>;
+            using depthImageType = type_safe::underlying_type<DepthImageID>;
+
+            for (ImageID id : _transientImages)
+            {
+                _images[static_cast<imageType>(id)].isTransientInUse = false;
+            }
+
+            for (DepthImageID id : _transientDepthImages)
+            {
+                _depthImages[static_cast<depthImageType>(id)].isTransientInUse = false;
+            }
+        }
+
+        bool ImageHandlerVK::IsTransient(const ImageID id)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.size() > static_cast<type>(id));
+            return _images[static_cast<type>(id)].isTransient;
+        }
+
+        bool ImageHandlerVK::IsTransient(const DepthImageID id)
+        {
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            // Lets make sure this id exists
+            assert(_depthImages.size() > static_cast<type>(id));
+            return _depthImages[static_cast<type>(id)].isTransient;
+        }
+
+        const ImageDesc& ImageHandlerVK::GetDescriptor(const ImageID id)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.size() > static_cast<type>(id));
+            return _images[static_cast<type>(id)].desc;
+        }
+
+        const DepthImageDesc& ImageHandlerVK::GetDescriptor(const DepthImageID id)
+        {
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            // Lets make sure this id exists
+            assert(_depthImages.size() > static_cast<type>(id));
+            return _depthImages[static_cast<type>(id)].desc;
+        }
+
+        VkImage ImageHandlerVK::GetImage(const ImageID id)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.size() > static_cast<type>(id));
+            return _images[static_cast<type>(id)].image;
+        }
+
+        VkImageView ImageHandlerVK::GetColorView(const ImageID id)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.size() > static_cast<type>(id));
+            return _images[static_cast<type>(id)].colorView;
+        }
+
+        VkDescriptorSet ImageHandlerVK::GetStorageDescriptorSet(RenderDeviceVK* device, const ImageID id, u32 mipLevel, VkDescriptorSetLayout descriptorSetLayout)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.size() > static_cast<type>(id));
+            Image& image = _images[static_cast<type>(id)];
+
+            // Lets make sure the mip exists
+            assert(mipLevel < image.desc.mipLevels);
+
+            // The views of transient images change whenever they are placed again, which would leave their descriptor sets pointing at destroyed views
+            assert(!image.isTransient);
+
+            std::scoped_lock lock(_descriptorMutex);
+
+            if (image.descriptorPool == VK_NULL_HANDLE)
+            {
+                image.descriptorPool = CreateDescriptorPool(device, image.desc.mipLevels);
+                image.storageDescriptorSets.resize(image.desc.mipLevels, VK_NULL_HANDLE);
+            }
+
+            VkDescriptorSet& descriptorSet = image.storageDescriptorSets[mipLevel];
+            if (descriptorSet == VK_NULL_HANDLE)
+            {
+                descriptorSet = AllocateDescriptorSet(device, image.descriptorPool, descriptorSetLayout, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, image.mipViews[mipLevel], VK_IMAGE_LAYOUT_GENERAL);
+            }
+
+            return descriptorSet;
+        }
+
+        VkDescriptorSet ImageHandlerVK::GetSampledDescriptorSet(RenderDeviceVK* device, const ImageID id, VkDescriptorSetLayout descriptorSetLayout)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.size() > static_cast<type>(id));
+            Image& image = _images[static_cast<type>(id)];
+
+            // The views of transient images change whenever they are placed again, which would leave their descriptor sets pointing at destroyed views
+            assert(!image.isTransient);
+
+            std::scoped_lock lock(_descriptorMutex);
+
+            if (image.descriptorPool == VK_NULL_HANDLE)
+            {
+                image.descriptorPool = CreateDescriptorPool(device, image.desc.mipLevels);
+                image.storageDescriptorSets.resize(image.desc.mipLevels, VK_NULL_HANDLE);
+            }
+
+            if (image.sampledDescriptorSet == VK_NULL_HANDLE)
+            {
+                image.sampledDescriptorSet = AllocateDescriptorSet(device, image.descriptorPool, descriptorSetLayout, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, image.sampledView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+
+            return image.sampledDescriptorSet;
+        }
+
+        VkDescriptorSet ImageHandlerVK::GetSampledDescriptorSet(RenderDeviceVK* device, const DepthImageID id, VkDescriptorSetLayout descriptorSetLayout)
+        {
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            // Lets make sure this id exists
+            assert(_depthImages.size() > static_cast<type>(id));
+            DepthImage& image = _depthImages[static_cast<type>(id)];
+
+            // The views of transient images change whenever they are placed again, which would leave their descriptor sets pointing at destroyed views
+            assert(!image.isTransient);
+
+            std::scoped_lock lock(_descriptorMutex);
+
+            if (image.descriptorPool == VK_NULL_HANDLE)
+            {
+                image.descriptorPool = CreateDescriptorPool(device, 0);
+            }
+
+            if (image.sampledDescriptorSet == VK_NULL_HANDLE)
+            {
+                image.sampledDescriptorSet = AllocateDescriptorSet(device, image.descriptorPool, descriptorSetLayout, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, image.depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+
+            return image.sampledDescriptorSet;
+        }
+
+        VkDescriptorPool ImageHandlerVK::CreateDescriptorPool(RenderDeviceVK* device, u32 numStorageSets)
+        {
+            // Room for one storage set per mip and one sampled set
+            VkDescriptorPoolSize poolSizes[2] = {};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            poolSizes[0].descriptorCount = 1;
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            poolSizes[1].descriptorCount = numStorageSets;
+
+            VkDescriptorPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.poolSizeCount = numStorageSets > 0 ? 2 : 1;
+            poolInfo.pPoolSizes = poolSizes;
+            poolInfo.maxSets = numStorageSets + 1;
+
+            VkDescriptorPool descriptorPool;
+            if (vkCreateDescriptorPool(device->_device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create descriptor pool!");
+            }
+
+            return descriptorPool;
+        }
+
+        VkDescriptorSet ImageHandlerVK::AllocateDescriptorSet(RenderDeviceVK* device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorType descriptorType, VkImageView imageView, VkImageLayout imageLayout)
+        {
+            VkDescriptorSetAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &descriptorSetLayout;
+
+            VkDescriptorSet descriptorSet;
+            if (vkAllocateDescriptorSets(device->_device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to allocate descriptor sets!");
+            }
+
+            VkDescriptorImageInfo descriptorImageInfo = {};
+            descriptorImageInfo.sampler = (descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) ? GetPointSampler(device) : VK_NULL_HANDLE;
+            descriptorImageInfo.imageView = imageView;
+            descriptorImageInfo.imageLayout = imageLayout;
+
+            VkWriteDescriptorSet descriptorWrite = {};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = descriptorSet;
+            descriptorWrite.dstBinding = 0;
+            descriptorWrite.dstArrayElement = 0;
+            descriptorWrite.descriptorType = descriptorType;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &descriptorImageInfo;
+
+            vkUpdateDescriptorSets(device->_device, 1, &descriptorWrite, 0, nullptr);
+
+            return descriptorSet;
+        }
+
+        VkSampler ImageHandlerVK::GetPointSampler(RenderDeviceVK* device)
+        {
+            if (_pointSampler != VK_NULL_HANDLE)
+                return _pointSampler;
+
+            // Images are read with texelFetch or at exact texel centers, so they don't need anything fancier
+            VkSamplerCreateInfo samplerInfo = {};
+            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+            samplerInfo.magFilter = VK_FILTER_NEAREST;
+            samplerInfo.minFilter = VK_FILTER_NEAREST;
+            samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+            samplerInfo.minLod = 0.0f;
+            samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+            if (vkCreateSampler(device->_device, &samplerInfo, nullptr, &_pointSampler) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create point sampler!");
+            }
+
+            return _pointSampler;
+        }
+
+        VkImage ImageHandlerVK::GetImage(const DepthImageID id)
+        {
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            // Lets make sure this id exists
+            assert(_depthImages.size() > static_cast<type>(id));
+            return _depthImages[static_cast<type>(id)].image;
+        }
+
+        VkImageView ImageHandlerVK::GetDepthView(const DepthImageID id)
+        {
+            using type = type_safe::underlying_type<DepthImageID>;
+
+            // Lets make sure this id exists
+            assert(_depthImages.size() > static_cast<type>(id));
+            return _depthImages[static_cast<type>(id)].depthView;
+        }
+
+        void ImageHandlerVK::CreateVkImage(RenderDeviceVK* device, Image& image)
+        {
+            const ImageDesc& desc = image.desc;
+
             assert(desc.dimensions.x > 0); // Make sure the width is valid
             assert(desc.dimensions.y > 0); // Make sure the height is valid
             assert(desc.depth > 0); // Make sure the depth is valid
+            assert(desc.mipLevels > 0); // Make sure the number of mips is valid
             assert(desc.format != IMAGE_FORMAT_UNKNOWN); // Make sure the format is valid
 
             // Create image
@@ -54,7 +612,7 @@ namespace Renderer
             imageInfo.extent.width = desc.dimensions.x;
             imageInfo.extent.height = desc.dimensions.y;
             imageInfo.extent.depth = desc.depth;
-            imageInfo.mipLevels = 1;
+            imageInfo.mipLevels = desc.mipLevels;
             imageInfo.arrayLayers = 1;
             imageInfo.samples = FormatConverterVK::ToVkSampleCount(desc.sampleCount);
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -75,68 +633,11 @@ namespace Renderer
             }
 
             DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.image, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, desc.debugName.c_str());
-
-            // Bind memory
-            VkMemoryRequirements memRequirements;
-            vkGetImageMemoryRequirements(device->_device, image.image, &memRequirements);
-
-            VkMemoryAllocateInfo allocInfo = {};
-            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-            allocInfo.allocationSize = memRequirements.size;
-            allocInfo.memoryTypeIndex = device->FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-            if (vkAllocateMemory(device->_device, &allocInfo, nullptr, &image.memory) != VK_SUCCESS) 
-            {
-                NC_LOG_FATAL("Failed to allocate image memory!");
-            }
-
-            vkBindImageMemory(device->_device, image.image, image.memory, 0);
-
-            // Create Color View
-            VkImageViewCreateInfo colorViewInfo = {};
-            colorViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            colorViewInfo.image = image.image;
-            if (desc.depth == 1)
-            {
-                colorViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            }
-            else
-            {
-                NC_LOG_FATAL("Non-3d images is currently unsupported");
-            }
-            colorViewInfo.format = imageInfo.format;
-            colorViewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-            colorViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            colorViewInfo.subresourceRange.baseMipLevel = 0;
-            colorViewInfo.subresourceRange.levelCount = 1;
-            colorViewInfo.subresourceRange.baseArrayLayer = 0;
-            colorViewInfo.subresourceRange.layerCount = 1;
-
-            if (vkCreateImageView(device->_device, &colorViewInfo, nullptr, &image.colorView) != VK_SUCCESS)
-            {
-                NC_LOG_FATAL("Failed to create color image view!");
-            }
-
-            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.colorView, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, desc.debugName.c_str());
-            
-            // Transition image from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_GENERAL
-            device->TransitionImageLayout(image.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-            _images.push_back(image);
-
-            return ImageID(static_cast<type>(nextHandle));
         }
 
-        DepthImageID ImageHandlerVK::CreateDepthImage(RenderDeviceVK* device, const DepthImageDesc& desc)
+        void ImageHandlerVK::CreateVkImage(RenderDeviceVK* device, DepthImage& image)
         {
-            size_t nextHandle = _images.size();
-
-            // Make sure we haven't exceeded the limit of the DepthImageID type, if this hits you need to change type of DepthImageID to something bigger
-            assert(nextHandle < DepthImageID::MaxValue());
-            using type = type_safe::underlying_type<DepthImageID>;
-
-            DepthImage image;
-            image.desc = desc;
+            const DepthImageDesc& desc = image.desc;
 
             // Create image
             VkImageCreateInfo imageInfo = {};
@@ -170,30 +671,91 @@ namespace Renderer
             }
 
             DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.image, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, desc.debugName.c_str());
+        }
 
-            // Bind memory
-            VkMemoryRequirements memRequirements;
-            vkGetImageMemoryRequirements(device->_device, image.image, &memRequirements);
+        void ImageHandlerVK::CreateColorView(RenderDeviceVK* device, Image& image)
+        {
+            // Create Color View
+            VkImageViewCreateInfo colorViewInfo = {};
+            colorViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            colorViewInfo.image = image.image;
+            if (image.desc.depth == 1)
+            {
+                colorViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            }
+            else
+            {
+                NC_LOG_FATAL("Non-3d images is currently unsupported");
+            }
+            colorViewInfo.format = FormatConverterVK::ToVkFormat(image.desc.format);
+            colorViewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+            colorViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            colorViewInfo.subresourceRange.baseMipLevel = 0;
+            colorViewInfo.subresourceRange.levelCount = 1;
+            colorViewInfo.subresourceRange.baseArrayLayer = 0;
+            colorViewInfo.subresourceRange.layerCount = 1;
 
-            VkMemoryAllocateInfo allocInfo = {};
-            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-            allocInfo.allocationSize = memRequirements.size;
-            allocInfo.memoryTypeIndex = device->FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (vkCreateImageView(device->_device, &colorViewInfo, nullptr, &image.colorView) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create color image view!");
+            }
+
+            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.colorView, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, image.desc.debugName.c_str());
+        }
 
-            if (vkAllocateMemory(device->_device, &allocInfo, nullptr, &image.memory) != VK_SUCCESS)
+        void ImageHandlerVK::CreateMipViews(RenderDeviceVK* device, Image& image)
+        {
+            u32 mipLevels = image.desc.mipLevels;
+            image.mipViews.resize(mipLevels);
+            image.mipViews[0] = image.colorView;
+            image.sampledView = image.colorView;
+
+            if (mipLevels == 1)
+                return;
+
+            VkImageViewCreateInfo viewInfo = {};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = image.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = FormatConverterVK::ToVkFormat(image.desc.format);
+            viewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            // One view per mip after the first
+            viewInfo.subresourceRange.levelCount = 1;
+            for (u32 i = 1; i < mipLevels; i++)
             {
-                NC_LOG_FATAL("Failed to allocate image memory!");
+                viewInfo.subresourceRange.baseMipLevel = i;
+
+                if (vkCreateImageView(device->_device, &viewInfo, nullptr, &image.mipViews[i]) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create mip image view!");
+                }
             }
 
-            vkBindImageMemory(device->_device, image.image, image.memory, 0);
+            // And one covering all of them
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = mipLevels;
 
+            if (vkCreateImageView(device->_device, &viewInfo, nullptr, &image.sampledView) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create sampled image view!");
+            }
+
+            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.sampledView, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, image.desc.debugName.c_str());
+        }
+
+        void ImageHandlerVK::CreateDepthView(RenderDeviceVK* device, DepthImage& image)
+        {
             // Create Depth View
             VkImageViewCreateInfo depthViewInfo = {};
             depthViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
             depthViewInfo.image = image.image;
             depthViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
            
-            depthViewInfo.format = imageInfo.format;
+            depthViewInfo.format = FormatConverterVK::ToVkFormat(image.desc.format);
             depthViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
             depthViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
             depthViewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -209,65 +771,7 @@ namespace Renderer
                 NC_LOG_FATAL("Failed to create depth image view!");
             }
 
-            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.depthView, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, desc.debugName.c_str());
-
-            _depthImages.push_back(image);
-
-            return DepthImageID(static_cast<type>(nextHandle));
-        }
-
-        const ImageDesc& ImageHandlerVK::GetDescriptor(const ImageID id)
-        {
-            using type = type_safe::underlying_type<ImageID>;
-
-            // Lets make sure this id exists
-            assert(_images.size() > static_cast<type>(id));
-            return _images[static_cast<type>(id)].desc;
-        }
-
-        const DepthImageDesc& ImageHandlerVK::GetDescriptor(const DepthImageID id)
-        {
-            using type = type_safe::underlying_type<DepthImageID>;
-
-            // Lets make sure this id exists
-            assert(_depthImages.size() > static_cast<type>(id));
-            return _depthImages[static_cast<type>(id)].desc;
-        }
-
-        VkImage ImageHandlerVK::GetImage(const ImageID id)
-        {
-            using type = type_safe::underlying_type<ImageID>;
-
-            // Lets make sure this id exists
-            assert(_images.size() > static_cast<type>(id));
-            return _images[static_cast<type>(id)].image;
-        }
-
-        VkImageView ImageHandlerVK::GetColorView(const ImageID id)
-        {
-            using type = type_safe::underlying_type<ImageID>;
-
-            // Lets make sure this id exists
-            assert(_images.size() > static_cast<type>(id));
-            return _images[static_cast<type>(id)].colorView;
-        }
-
-        VkImage ImageHandlerVK::GetImage(const DepthImageID id)
-        {
-            using type = type_safe::underlying_type<DepthImageID>;
-
-            // Lets make sure this id exists
-            assert(_depthImages.size() > static_cast<type>(id));
-            return _depthImages[static_cast<type>(id)].image;
-        }
-
-        VkImageView ImageHandlerVK::GetDepthView(const DepthImageID id)
-        {
-            using type = type_safe::underlying_type<DepthImageID>;
-
-            // Lets make sure this id exists
-            assert(_depthImages.size() > static_cast<type>(id));
-            return _depthImages[static_cast<type>(id)].depthView;
+            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)image.depthView, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, image.desc.debugName.c_str());
         }
     }
 }
\ No newline at end of file
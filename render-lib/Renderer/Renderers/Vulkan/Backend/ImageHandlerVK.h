@@ -1,10 +1,13 @@
 #pragma once
 #include <NovusTypes.h>
 #include <vector>
+#include <mutex>
 #include <vulkan/vulkan.h>
 
 #include "../../../Descriptors/ImageDesc.h"
 #include "../../../Descriptors/DepthImageDesc.h"
+#include "../../../RenderGraphBuilder.h"
+#include "MemoryAllocatorVK.h"
 
 namespace Renderer
 {
@@ -30,28 +33,99 @@ namespace Renderer
             VkImage GetImage(const DepthImageID id);
             VkImageView GetDepthView(const DepthImageID id);
 
+            // Like buffers every image keeps the descriptor sets it gets bound with, they are created on first use with the layout of the bound pipeline
+            // Storage sets hold one mip as a storage image, sampled sets hold every mip as a combined image sampler with point filtering and expect the image in the shader read state
+            VkDescriptorSet GetStorageDescriptorSet(RenderDeviceVK* device, const ImageID id, u32 mipLevel, VkDescriptorSetLayout descriptorSetLayout);
+            VkDescriptorSet GetSampledDescriptorSet(RenderDeviceVK* device, const ImageID id, VkDescriptorSetLayout descriptorSetLayout);
+            VkDescriptorSet GetSampledDescriptorSet(RenderDeviceVK* device, const DepthImageID id, VkDescriptorSetLayout descriptorSetLayout);
+
+            // Transient images are pooled, this hands out an unused one with a matching desc or creates a new one
+            // They have no memory until AllocateTransientImages has placed them
+            ImageID CreateTransientImage(RenderDeviceVK* device, const ImageDesc& desc);
+            DepthImageID CreateTransientDepthImage(RenderDeviceVK* device, const DepthImageDesc& desc);
+
+            // Places the transient images in one shared allocation, images whose lifetimes don't overlap alias each other
+            // Returns true if the placement differs from the current one, ApplyTransientPlacement then needs to be called once the GPU is idle
+            bool PlaceTransientImages(RenderDeviceVK* device, const TransientImageLifetime* lifetimes, u32 numLifetimes);
+            void ApplyTransientPlacement(RenderDeviceVK* device);
+            void ReleaseTransientImages(); // Makes every transient image available to the next RenderGraph
+
+            bool IsTransient(const ImageID id);
+            bool IsTransient(const DepthImageID id);
+
         private:
+            static const VkDeviceSize INVALID_TRANSIENT_OFFSET = ~0ull;
+
             struct Image
             {
                 ImageDesc desc;
 
-                VkDeviceMemory memory;
+                AllocationVK allocation;
                 VkImage image;
-                VkImageView colorView;
+                VkImageView colorView; // Only the first mip, this is what rendertargets use
+                VkImageView sampledView = VK_NULL_HANDLE; // Every mip, the same as colorView for images without mips
+                std::vector<VkImageView> mipViews; // One per mip for storage writes, the first one is colorView
+
+                VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+                std::vector<VkDescriptorSet> storageDescriptorSets; // One per mip
+                VkDescriptorSet sampledDescriptorSet = VK_NULL_HANDLE;
+
+                bool isTransient = false;
+                bool isTransientInUse = false;
+                VkDeviceSize transientOffset = INVALID_TRANSIENT_OFFSET; // Where in the transient allocation the image is bound
             };
 
             struct DepthImage
             {
                 DepthImageDesc desc;
 
-                VkDeviceMemory memory;
+                AllocationVK allocation;
                 VkImage image;
                 VkImageView depthView;
+
+                VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+                VkDescriptorSet sampledDescriptorSet = VK_NULL_HANDLE;
+
+                bool isTransient = false;
+                bool isTransientInUse = false;
+                VkDeviceSize transientOffset = INVALID_TRANSIENT_OFFSET;
+            };
+
+            struct TransientPlacement
+            {
+                ImageID image = ImageID::Invalid();
+                DepthImageID depthImage = DepthImageID::Invalid();
+                u32 firstPass = 0;
+                u32 lastPass = 0;
+
+                VkMemoryRequirements requirements;
+                VkDeviceSize offset = 0;
             };
 
+        private:
+            void CreateVkImage(RenderDeviceVK* device, Image& image);
+            void CreateVkImage(RenderDeviceVK* device, DepthImage& image);
+            void CreateColorView(RenderDeviceVK* device, Image& image);
+            void CreateMipViews(RenderDeviceVK* device, Image& image);
+            void CreateDepthView(RenderDeviceVK* device, DepthImage& image);
+
+            VkDescriptorPool CreateDescriptorPool(RenderDeviceVK* device, u32 numStorageSets);
+            VkDescriptorSet AllocateDescriptorSet(RenderDeviceVK* device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorType descriptorType, VkImageView imageView, VkImageLayout imageLayout);
+            VkSampler GetPointSampler(RenderDeviceVK* device);
+
         private:
             std::vector<Image> _images;
             std::vector<DepthImage> _depthImages;
+
+            std::vector<ImageID> _transientImages;
+            std::vector<DepthImageID> _transientDepthImages;
+
+            std::vector<TransientPlacement> _transientPlacements; // The placement of the last call to PlaceTransientImages
+            AllocationVK _transientAllocation;
+            VkDeviceSize _transientAllocationSize = 0;
+
+            std::mutex _descriptorMutex; // Commandlists can be recorded in parallel, so the lazy descriptor set creation needs to be guarded
+            VkSampler _pointSampler = VK_NULL_HANDLE;
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "MemoryAllocatorVK.h"
+#include <Utils/DebugHandler.h>
+#include <cassert>
+#include <algorithm>
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        const VkDeviceSize SMALL_ALLOCATION_MAX_SIZE = 256 * 1024; // 256 KB
+        const VkDeviceSize MEDIUM_ALLOCATION_MAX_SIZE = 16 * 1024 * 1024; // 16 MB
+
+        const VkDeviceSize SMALL_BLOCK_SIZE = 4 * 1024 * 1024; // 4 MB
+        const VkDeviceSize MEDIUM_BLOCK_SIZE = 64 * 1024 * 1024; // 64 MB
+        const VkDeviceSize LINEAR_BLOCK_SIZE = 32 * 1024 * 1024; // 32 MB
+
+        static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        void MemoryAllocatorVK::Init(VkDevice device, VkPhysicalDevice physicalDevice)
+        {
+            _device = device;
+
+            vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+
+            VkPhysicalDeviceProperties deviceProperties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+            // Buffers and optimal images share blocks, so we need to keep them this far apart
+            _bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+
+            for (u32 i = 0; i < _memoryProperties.memoryHeapCount; i++)
+            {
+                _heapStats[i].heapSize = _memoryProperties.memoryHeaps[i].size;
+            }
+        }
+
+        void MemoryAllocatorVK::Deinit()
+        {
+            for (u32 memoryTypeIndex = 0; memoryTypeIndex < _memoryProperties.memoryTypeCount; memoryTypeIndex++)
+            {
+                for (u8 sizeClass = 0; sizeClass < SIZE_CLASS_DEDICATED; sizeClass++)
+                {
+                    for (Block& block : _freeListPools[memoryTypeIndex][sizeClass].blocks)
+                    {
+                        DestroyBlock(memoryTypeIndex, block);
+                    }
+                    _freeListPools[memoryTypeIndex][sizeClass].blocks.clear();
+                }
+
+                for (Block& block : _linearPools[memoryTypeIndex].blocks)
+                {
+                    DestroyBlock(memoryTypeIndex, block);
+                }
+                _linearPools[memoryTypeIndex].blocks.clear();
+            }
+        }
+
+        AllocationVK MemoryAllocatorVK::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationStrategy strategy)
+        {
+            std::scoped_lock lock(_mutex);
+
+            AllocationVK allocation;
+            allocation.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+            allocation.strategy = strategy;
+            allocation.size = requirements.size;
+
+            u32 heapIndex = _memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex;
+            MemoryHeapStatsVK& heapStats = _heapStats[heapIndex];
+
+            SizeClass sizeClass = GetSizeClass(requirements.size, strategy);
+            allocation.sizeClass = sizeClass;
+
+            // Big allocations get their own memory
+            if (sizeClass == SIZE_CLASS_DEDICATED)
+            {
+                Block dedicatedBlock;
+                if (!CreateBlock(allocation.memoryTypeIndex, requirements.size, dedicatedBlock))
+                {
+                    NC_LOG_FATAL("Failed to allocate %llu bytes of dedicated memory!", requirements.size);
+                }
+
+                allocation.memory = dedicatedBlock.memory;
+                allocation.mappedData = dedicatedBlock.mappedData;
+                allocation.rangeSize = requirements.size;
+
+                heapStats.usedBytes += requirements.size;
+                heapStats.numAllocations++;
+                return allocation;
+            }
+
+            VkDeviceSize alignment = std::max(requirements.alignment, _bufferImageGranularity);
+            Pool& pool = GetPool(allocation.memoryTypeIndex, sizeClass, strategy);
+
+            // Try to fit it into one of our existing blocks
+            bool allocated = false;
+            for (size_t i = 0; i < pool.blocks.size() && !allocated; i++)
+            {
+                Block& block = pool.blocks[i];
+
+                if (strategy == ALLOCATION_STRATEGY_LINEAR)
+                {
+                    allocated = TryAllocateLinear(block, requirements.size, alignment, allocation);
+                }
+                else
+                {
+                    allocated = TryAllocateFromFreeList(block, requirements.size, alignment, allocation);
+                }
+
+                if (allocated)
+                {
+                    allocation.blockIndex = static_cast<u32>(i);
+                }
+            }
+
+            // None of them had room, so we need a new block
+            if (!allocated)
+            {
+                Block& block = pool.blocks.emplace_back();
+                if (!CreateBlock(allocation.memoryTypeIndex, GetBlockSize(sizeClass, strategy), block))
+                {
+                    NC_LOG_FATAL("Failed to allocate a new memory block!");
+                }
+                if (strategy == ALLOCATION_STRATEGY_FREE_LIST)
+                {
+                    block.freeRanges.push_back({ 0, block.size });
+                }
+
+                allocated = (strategy == ALLOCATION_STRATEGY_LINEAR) ? TryAllocateLinear(block, requirements.size, alignment, allocation) : TryAllocateFromFreeList(block, requirements.size, alignment, allocation);
+                assert(allocated); // A fresh block should always fit an allocation of this size class
+                allocation.blockIndex = static_cast<u32>(pool.blocks.size() - 1);
+            }
+
+            Block& block = pool.blocks[allocation.blockIndex];
+            block.numAllocations++;
+
+            allocation.memory = block.memory;
+            if (block.mappedData != nullptr)
+            {
+                allocation.mappedData = static_cast<u8*>(block.mappedData) + allocation.offset;
+            }
+
+            heapStats.usedBytes += allocation.rangeSize;
+            heapStats.numAllocations++;
+
+            return allocation;
+        }
+
+        void MemoryAllocatorVK::Free(AllocationVK& allocation)
+        {
+            if (allocation.memory == VK_NULL_HANDLE)
+                return;
+
+            std::scoped_lock lock(_mutex);
+
+            u32 heapIndex = _memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex;
+            MemoryHeapStatsVK& heapStats = _heapStats[heapIndex];
+
+            heapStats.usedBytes -= allocation.rangeSize;
+            heapStats.numAllocations--;
+
+            if (allocation.sizeClass == SIZE_CLASS_DEDICATED)
+            {
+                Block dedicatedBlock;
+                dedicatedBlock.memory = allocation.memory;
+                dedicatedBlock.size = allocation.rangeSize;
+                dedicatedBlock.mappedData = allocation.mappedData;
+
+                DestroyBlock(allocation.memoryTypeIndex, dedicatedBlock);
+            }
+            else
+            {
+                Pool& pool = GetPool(allocation.memoryTypeIndex, allocation.sizeClass, allocation.strategy);
+                Block& block = pool.blocks[allocation.blockIndex];
+
+                assert(block.numAllocations > 0); // We tried to free from a block that has no allocations
+                block.numAllocations--;
+
+                if (allocation.strategy == ALLOCATION_STRATEGY_LINEAR)
+                {
+                    // Linear blocks can't free individual ranges, but once they're empty we can start over from the beginning
+                    if (block.numAllocations == 0)
+                    {
+                        block.linearOffset = 0;
+                    }
+                }
+                else
+                {
+                    FreeToFreeList(block, allocation.rangeOffset, allocation.rangeSize);
+                }
+            }
+
+            allocation = AllocationVK();
+        }
+
+        const MemoryHeapStatsVK& MemoryAllocatorVK::GetHeapStats(u32 heapIndex)
+        {
+            assert(heapIndex < _memoryProperties.memoryHeapCount);
+            return _heapStats[heapIndex];
+        }
+
+        void MemoryAllocatorVK::LogStats()
+        {
+            std::scoped_lock lock(_mutex);
+
+            for (u32 i = 0; i < _memoryProperties.memoryHeapCount; i++)
+            {
+                const MemoryHeapStatsVK& stats = _heapStats[i];
+                NC_LOG_MESSAGE("Memory heap %u: %llu KB used in %u allocations, %llu KB reserved in %u device allocations, heap size %llu KB", i, stats.usedBytes / 1024, stats.numAllocations, stats.reservedBytes / 1024, stats.numDeviceAllocations, stats.heapSize / 1024);
+            }
+        }
+
+        u32 MemoryAllocatorVK::FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties)
+        {
+            for (u32 i = 0; i < _memoryProperties.memoryTypeCount; i++)
+            {
+                if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+                {
+                    return i;
+                }
+            }
+
+            NC_LOG_FATAL("Failed to find suitable memory type!");
+            return 0;
+        }
+
+        MemoryAllocatorVK::SizeClass MemoryAllocatorVK::GetSizeClass(VkDeviceSize size, AllocationStrategy strategy)
+        {
+            if (strategy == ALLOCATION_STRATEGY_LINEAR)
+            {
+                // Linear blocks only have one size class, but we don't want a single allocation to eat more than half a block
+                return (size <= LINEAR_BLOCK_SIZE / 2) ? SIZE_CLASS_SMALL : SIZE_CLASS_DEDICATED;
+            }
+
+            if (size <= SMALL_ALLOCATION_MAX_SIZE)
+                return SIZE_CLASS_SMALL;
+
+            if (size <= MEDIUM_ALLOCATION_MAX_SIZE)
+                return SIZE_CLASS_MEDIUM;
+
+            return SIZE_CLASS_DEDICATED;
+        }
+
+        VkDeviceSize MemoryAllocatorVK::GetBlockSize(SizeClass sizeClass, AllocationStrategy strategy)
+        {
+            if (strategy == ALLOCATION_STRATEGY_LINEAR)
+                return LINEAR_BLOCK_SIZE;
+
+            return (sizeClass == SIZE_CLASS_SMALL) ? SMALL_BLOCK_SIZE : MEDIUM_BLOCK_SIZE;
+        }
+
+        MemoryAllocatorVK::Pool& MemoryAllocatorVK::GetPool(u32 memoryTypeIndex, u8 sizeClass, AllocationStrategy strategy)
+        {
+            if (strategy == ALLOCATION_STRATEGY_LINEAR)
+                return _linearPools[memoryTypeIndex];
+
+            assert(sizeClass < SIZE_CLASS_DEDICATED); // Dedicated allocations don't live in pools
+            return _freeListPools[memoryTypeIndex][sizeClass];
+        }
+
+        bool MemoryAllocatorVK::CreateBlock(u32 memoryTypeIndex, VkDeviceSize size, Block& block)
+        {
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = size;
+            allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+            if (vkAllocateMemory(_device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+            {
+                return false;
+            }
+            block.size = size;
+
+            // Host visible blocks stay mapped for their whole lifetime, you can't map the same memory twice so allocations get a pointer into this
+            if (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            {
+                if (vkMapMemory(_device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mappedData) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to map memory block!");
+                }
+            }
+
+            u32 heapIndex = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+            _heapStats[heapIndex].reservedBytes += size;
+            _heapStats[heapIndex].numDeviceAllocations++;
+
+            return true;
+        }
+
+        void MemoryAllocatorVK::DestroyBlock(u32 memoryTypeIndex, Block& block)
+        {
+            if (block.mappedData != nullptr)
+            {
+                vkUnmapMemory(_device, block.memory);
+            }
+            vkFreeMemory(_device, block.memory, nullptr);
+
+            u32 heapIndex = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+            _heapStats[heapIndex].reservedBytes -= block.size;
+            _heapStats[heapIndex].numDeviceAllocations--;
+
+            block = Block();
+        }
+
+        bool MemoryAllocatorVK::TryAllocateFromFreeList(Block& block, VkDeviceSize size, VkDeviceSize alignment, AllocationVK& allocation)
+        {
+            // First fit
+            for (size_t i = 0; i < block.freeRanges.size(); i++)
+            {
+                FreeRange& range = block.freeRanges[i];
+
+                VkDeviceSize alignedOffset = AlignUp(range.offset, alignment);
+                VkDeviceSize padding = alignedOffset - range.offset;
+
+                if (padding + size > range.size)
+                    continue;
+
+                allocation.offset = alignedOffset;
+                allocation.rangeOffset = range.offset;
+                allocation.rangeSize = padding + size;
+
+                // Shrink the free range, or remove it if we used all of it
+                range.offset += allocation.rangeSize;
+                range.size -= allocation.rangeSize;
+
+                if (range.size == 0)
+                {
+                    block.freeRanges.erase(block.freeRanges.begin() + i);
+                }
+
+                return true;
+            }
+
+            return false;
+        }
+
+        bool MemoryAllocatorVK::TryAllocateLinear(Block& block, VkDeviceSize size, VkDeviceSize alignment, AllocationVK& allocation)
+        {
+            VkDeviceSize alignedOffset = AlignUp(block.linearOffset, alignment);
+
+            if (alignedOffset + size > block.size)
+                return false;
+
+            allocation.offset = alignedOffset;
+            allocation.rangeOffset = block.linearOffset;
+            allocation.rangeSize = (alignedOffset - block.linearOffset) + size;
+
+            block.linearOffset = alignedOffset + size;
+            return true;
+        }
+
+        void MemoryAllocatorVK::FreeToFreeList(Block& block, VkDeviceSize offset, VkDeviceSize size)
+        {
+            // Find where this range goes to keep the list sorted
+            auto it = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), offset, [](const FreeRange& range, VkDeviceSize value)
+            {
+                return range.offset < value;
+            });
+
+            it = block.freeRanges.insert(it, { offset, size });
+
+            // Merge with the next range
+            auto next = it + 1;
+            if (next != block.freeRanges.end() && it->offset + it->size == next->offset)
+            {
+                it->size += next->size;
+                block.freeRanges.erase(next);
+            }
+
+            // Merge with the previous range
+            if (it != block.freeRanges.begin())
+            {
+                auto previous = it - 1;
+                if (previous->offset + previous->size == it->offset)
+                {
+                    previous->size += it->size;
+                    block.freeRanges.erase(it);
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        enum AllocationStrategy
+        {
+            ALLOCATION_STRATEGY_FREE_LIST, // General purpose, freed ranges get merged and reused
+            ALLOCATION_STRATEGY_LINEAR // Bump allocated, a block rewinds once everything in it has been freed, use this for short lived data like staging buffers
+        };
+
+        struct AllocationVK
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            void* mappedData = nullptr; // Only set for host visible memory, it stays mapped for the whole lifetime of the allocation
+
+        private:
+            // The range we took from the block, this includes the alignment padding in front of offset
+            VkDeviceSize rangeOffset = 0;
+            VkDeviceSize rangeSize = 0;
+
+            u32 memoryTypeIndex = 0;
+            u32 blockIndex = 0;
+            u8 sizeClass = 0;
+            AllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST;
+
+            friend class MemoryAllocatorVK;
+        };
+
+        struct MemoryHeapStatsVK
+        {
+            VkDeviceSize heapSize = 0;
+            VkDeviceSize reservedBytes = 0; // Bytes we got from the driver through vkAllocateMemory
+            VkDeviceSize usedBytes = 0; // Bytes handed out to resources
+            u32 numDeviceAllocations = 0;
+            u32 numAllocations = 0;
+        };
+
+        // Sub-allocates buffers and images out of big VkDeviceMemory blocks so we stay far away from maxMemoryAllocationCount
+        class MemoryAllocatorVK
+        {
+        public:
+            void Init(VkDevice device, VkPhysicalDevice physicalDevice);
+            void Deinit();
+
+            AllocationVK Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST);
+            void Free(AllocationVK& allocation);
+
+            u32 GetNumHeaps() { return _memoryProperties.memoryHeapCount; }
+            const MemoryHeapStatsVK& GetHeapStats(u32 heapIndex);
+            void LogStats();
+
+        private:
+            enum SizeClass : u8
+            {
+                SIZE_CLASS_SMALL, // Lives in small blocks so tiny buffers like UI glyphs don't fragment the big blocks
+                SIZE_CLASS_MEDIUM,
+                SIZE_CLASS_DEDICATED, // Too big to share a block, gets its own vkAllocateMemory
+                SIZE_CLASS_COUNT
+            };
+
+            struct FreeRange
+            {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+            };
+
+            struct Block
+            {
+                VkDeviceMemory memory = VK_NULL_HANDLE;
+                VkDeviceSize size = 0;
+                void* mappedData = nullptr;
+
+                std::vector<FreeRange> freeRanges; // Sorted by offset, only used by ALLOCATION_STRATEGY_FREE_LIST
+                VkDeviceSize linearOffset = 0; // Only used by ALLOCATION_STRATEGY_LINEAR
+                u32 numAllocations = 0;
+            };
+
+            struct Pool
+            {
+                std::vector<Block> blocks;
+            };
+
+        private:
+            u32 FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties);
+            SizeClass GetSizeClass(VkDeviceSize size, AllocationStrategy strategy);
+            VkDeviceSize GetBlockSize(SizeClass sizeClass, AllocationStrategy strategy);
+
+            Pool& GetPool(u32 memoryTypeIndex, u8 sizeClass, AllocationStrategy strategy);
+            bool CreateBlock(u32 memoryTypeIndex, VkDeviceSize size, Block& block);
+            void DestroyBlock(u32 memoryTypeIndex, Block& block);
+
+            bool TryAllocateFromFreeList(Block& block, VkDeviceSize size, VkDeviceSize alignment, AllocationVK& allocation);
+            bool TryAllocateLinear(Block& block, VkDeviceSize size, VkDeviceSize alignment, AllocationVK& allocation);
+            void FreeToFreeList(Block& block, VkDeviceSize offset, VkDeviceSize size);
+
+        private:
+            VkDevice _device = VK_NULL_HANDLE;
+            VkPhysicalDeviceMemoryProperties _memoryProperties;
+            VkDeviceSize _bufferImageGranularity = 1;
+
+            Pool _freeListPools[VK_MAX_MEMORY_TYPES][SIZE_CLASS_DEDICATED];
+            Pool _linearPools[VK_MAX_MEMORY_TYPES];
+            MemoryHeapStatsVK _heapStats[VK_MAX_MEMORY_HEAPS];
+
+            std::mutex _mutex;
+        };
+    }
+}
\ No newline at end of file
@@ -1,15 +1,22 @@
 #include "ModelHandlerVK.h"
 #include <cassert>
 #include <filesystem>
+#include <string>
 #include <Utils/DebugHandler.h>
 #include <Utils/FileReader.h>
 #include "RenderDeviceVK.h"
 #include "DebugMarkerUtilVK.h"
+#include "../../../MeshSimplifier.h"
 
 namespace Renderer
 {
     namespace Backend
     {
+        const f32 LOD_MAX_ERROR = 0.01f; // How far each LOD may move the surface away from the one before it, relative to the diagonal of the bounds
+        const f32 LOD_MIN_REDUCTION = 0.75f; // The LOD chain ends once a LOD keeps more than this much of the indices of the one before
+        const u32 GEOMETRY_BLOCK_NUM_VERTICES = 1024 * 1024; // 32 MB
+        const u32 GEOMETRY_BLOCK_NUM_INDICES = 4 * 1024 * 1024; // 8 MB
+
         ModelHandlerVK::ModelHandlerVK()
         {
 
@@ -37,6 +44,10 @@ namespace Renderer
             tempData.vertices = desc.vertices;
             tempData.indices = desc.indices;
 
+            // Primitive models get their vertices updated, a simplification of the first ones could be completely wrong for the later ones
+            ModelLOD& lod = tempData.lods.emplace_back();
+            lod.numIndices = static_cast<u32>(desc.indices.size());
+
             InitializeModel(device, model, tempData);
 
             _models.push_back(model);
@@ -66,28 +77,55 @@ namespace Renderer
             TempModelData tempData;
 
             LoadFromFile(desc, tempData);
+            if (tempData.lods.empty())
+            {
+                GenerateLODs(tempData);
+            }
             InitializeModel(device, model, tempData);
                 
             _models.push_back(model);
             return ModelID(static_cast<type>(nextHandle));
         }
 
+        u32 ModelHandlerVK::GetGeometryBlock(ModelID modelID)
+        {
+            using type = type_safe::underlying_type<ModelID>;
+
+            // Lets make sure this id exists
+            assert(_models.size() > static_cast<type>(modelID));
+            return _models[static_cast<type>(modelID)].geometryBlock;
+        }
+
         VkBuffer ModelHandlerVK::GetVertexBuffer(ModelID modelID)
         {
             using type = type_safe::underlying_type<ModelID>;
 
             // Lets make sure this id exists
             assert(_models.size() > static_cast<type>(modelID));
-            return _models[static_cast<type>(modelID)].vertexBuffer;
+            return _geometryBlocks[_models[static_cast<type>(modelID)].geometryBlock].vertexBuffer;
+        }
+
+        u32 ModelHandlerVK::GetNumLODs(ModelID modelID)
+        {
+            using type = type_safe::underlying_type<ModelID>;
+
+            // Lets make sure this id exists
+            assert(_models.size() > static_cast<type>(modelID));
+            return _models[static_cast<type>(modelID)].numLODs;
         }
 
-        u32 ModelHandlerVK::GetNumIndices(ModelID modelID)
+        const ModelLOD& ModelHandlerVK::GetLOD(ModelID modelID, u32 lod)
         {
             using type = type_safe::underlying_type<ModelID>;
 
             // Lets make sure this id exists
             assert(_models.size() > static_cast<type>(modelID));
-            return _models[static_cast<type>(modelID)].numIndices;
+
+            // Lets make sure the model has this LOD
+            const Model& model = _models[static_cast<type>(modelID)];
+            assert(lod < model.numLODs);
+
+            return model.lods[lod];
         }
 
         VkBuffer ModelHandlerVK::GetIndexBuffer(ModelID modelID)
@@ -96,7 +134,16 @@ namespace Renderer
 
             // Lets make sure this id exists
             assert(_models.size() > static_cast<type>(modelID));
-            return _models[static_cast<type>(modelID)].indexBuffer;
+            return _geometryBlocks[_models[static_cast<type>(modelID)].geometryBlock].indexBuffer;
+        }
+
+        const AABB& ModelHandlerVK::GetBounds(ModelID modelID)
+        {
+            using type = type_safe::underlying_type<ModelID>;
+
+            // Lets make sure this id exists
+            assert(_models.size() > static_cast<type>(modelID));
+            return _models[static_cast<type>(modelID)].bounds;
         }
 
         void ModelHandlerVK::LoadFromFile(const ModelDesc& desc, TempModelData& data)
@@ -127,7 +174,7 @@ namespace Renderer
                 {
                     NC_LOG_FATAL("Model file %s had an invalid TypeID in its NovusTypeHeader, %u != %u", header.typeID, EXPECTED_TYPE_HEADER.typeID);
                 }
-                if (header.typeVersion != EXPECTED_TYPE_HEADER.typeVersion)
+                if (header.typeVersion != EXPECTED_TYPE_HEADER.typeVersion && header.typeVersion != TYPE_VERSION_WITHOUT_LODS)
                 {
                     NC_LOG_FATAL("Model file %s had an invalid TypeVersion in its NovusTypeHeader, %u != %u", header.typeVersion, EXPECTED_TYPE_HEADER.typeVersion);
                 }
@@ -184,26 +231,106 @@ namespace Renderer
                     NC_LOG_FATAL("Model file %s failed to read index %u", desc.path.c_str(), i);
                 }
             }
+
+            if (header.typeVersion == TYPE_VERSION_WITHOUT_LODS)
+                return;
+
+            // The indices above are LOD 0, the LODs after it follow with their own index count each and index the same vertices
+            ModelLOD& firstLOD = data.lods.emplace_back();
+            firstLOD.numIndices = indexCount;
+
+            u32 lodCount;
+            if (!buffer->GetU32(lodCount))
+            {
+                NC_LOG_FATAL("Model file %s did not have a valid lodCount", desc.path.c_str());
+            }
+
+            if (lodCount >= MODEL_MAX_LODS)
+            {
+                NC_LOG_FATAL("Model file %s has %u LODs after the first one, only %u are supported", desc.path.c_str(), lodCount, MODEL_MAX_LODS - 1);
+            }
+
+            for (u32 i = 0; i < lodCount; i++)
+            {
+                ModelLOD& lod = data.lods.emplace_back();
+                lod.firstIndex = static_cast<u32>(data.indices.size());
+
+                if (!buffer->GetU32(lod.numIndices))
+                {
+                    NC_LOG_FATAL("Model file %s did not have a valid indexCount for LOD %u", desc.path.c_str(), i + 1);
+                }
+
+                data.indices.resize(lod.firstIndex + lod.numIndices);
+                for (u32 j = 0; j < lod.numIndices; j++)
+                {
+                    if (!buffer->GetI16(data.indices[lod.firstIndex + j]))
+                    {
+                        NC_LOG_FATAL("Model file %s failed to read index %u of LOD %u", desc.path.c_str(), j, i + 1);
+                    }
+                }
+            }
         }
 
-        void ModelHandlerVK::InitializeModel(RenderDeviceVK* device, Model& model, const TempModelData& data)
+        void ModelHandlerVK::GenerateLODs(TempModelData& data)
         {
-            model.numIndices = static_cast<u32>(data.indices.size());
+            ModelLOD& firstLOD = data.lods.emplace_back();
+            firstLOD.numIndices = static_cast<u32>(data.indices.size());
 
-            // -- Create vertex buffer --
-            VkDeviceSize vertexBufferSize = sizeof(data.vertices[0]) * data.vertices.size();
-            device->CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, model.vertexBuffer, model.vertexBufferMemory);
+            if (data.vertices.size() == 0)
+                return;
 
-            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)model.vertexBuffer, VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, model.debugName.c_str());
+            vec3 boundsMin = data.vertices[0].pos;
+            vec3 boundsMax = data.vertices[0].pos;
+            for (const Vertex& vertex : data.vertices)
+            {
+                boundsMin = glm::min(boundsMin, vertex.pos);
+                boundsMax = glm::max(boundsMax, vertex.pos);
+            }
+            f32 maxError = glm::length(boundsMax - boundsMin) * LOD_MAX_ERROR;
 
-            UpdateVertices(device, model, data.vertices);
+            // Each LOD gets simplified from the one before it, aiming for half of its triangles
+            std::vector<i16> previousIndices;
+            std::vector<i16> lodIndices;
 
-            // -- Create index buffer --
-            VkDeviceSize indexBufferSize = sizeof(data.indices[0]) * data.indices.size();
-            device->CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, model.indexBuffer, model.indexBufferMemory);
+            for (u32 i = 1; i < MODEL_MAX_LODS; i++)
+            {
+                ModelLOD previousLOD = data.lods.back();
+                previousIndices.assign(data.indices.begin() + previousLOD.firstIndex, data.indices.begin() + previousLOD.firstIndex + previousLOD.numIndices);
 
-            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)model.vertexBuffer, VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, model.debugName.c_str());
-            
+                MeshSimplifier::Simplify(data.vertices, previousIndices, previousLOD.numIndices / 2, maxError * i, lodIndices);
+
+                if (lodIndices.size() == 0 || lodIndices.size() > previousLOD.numIndices * LOD_MIN_REDUCTION)
+                    break;
+
+                ModelLOD& lod = data.lods.emplace_back();
+                lod.firstIndex = static_cast<u32>(data.indices.size());
+                lod.numIndices = static_cast<u32>(lodIndices.size());
+
+                data.indices.insert(data.indices.end(), lodIndices.begin(), lodIndices.end());
+            }
+        }
+
+        void ModelHandlerVK::InitializeModel(RenderDeviceVK* device, Model& model, const TempModelData& data)
+        {
+            // Lets make sure the LOD chain fits
+            assert(data.lods.size() > 0 && data.lods.size() <= MODEL_MAX_LODS);
+
+            CalculateBounds(model, data.vertices);
+
+            // -- Sub-allocate vertices and indices --
+            AllocateGeometry(device, model, static_cast<u32>(data.vertices.size()), static_cast<u32>(data.indices.size()));
+
+            // The indices stay relative to the first vertex of the model, the draws add it as the vertex offset
+            model.numLODs = static_cast<u32>(data.lods.size());
+            for (u32 i = 0; i < model.numLODs; i++)
+            {
+                model.lods[i] = data.lods[i];
+                model.lods[i].firstIndex += model.firstIndex;
+                model.lods[i].vertexOffset = static_cast<i32>(model.firstVertex);
+            }
+
+            // Frames in flight might be drawing other models from the same block, so this can't go through the transfer queue
+            UpdateVertices(device, model, data.vertices);
             UpdateIndices(device, model, data.indices);
 
             // -- Create attribute descriptor --
@@ -230,48 +357,90 @@ namespace Renderer
 
         void ModelHandlerVK::UpdateVertices(RenderDeviceVK* device, Model& model, const std::vector<Vertex>& vertices)
         {
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
+            // Lets make sure we don't write into the vertices of the next model in the block
+            assert(vertices.size() <= model.numVertices);
+            if (vertices.size() == 0)
+                return;
 
-            // Create a staging buffer
+            // Frames in flight might still be drawing with the old vertices, the upload handler orders the copy after them
+            VkBuffer vertexBuffer = _geometryBlocks[model.geometryBlock].vertexBuffer;
             VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-            device->CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+            device->_uploadHandler.UpdateBuffer(vertexBuffer, sizeof(vertices[0]) * model.firstVertex, vertices.data(), vertexBufferSize);
+        }
+
+        void ModelHandlerVK::UpdateIndices(RenderDeviceVK* device, Model& model, const std::vector<i16>& indices)
+        {
+            // Lets make sure we don't write into the indices of the next model in the block
+            assert(indices.size() <= model.numIndices);
+            if (indices.size() == 0)
+                return;
+
+            VkBuffer indexBuffer = _geometryBlocks[model.geometryBlock].indexBuffer;
+            VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
+            device->_uploadHandler.UpdateBuffer(indexBuffer, sizeof(indices[0]) * model.firstIndex, indices.data(), indexBufferSize);
+        }
+
+        void ModelHandlerVK::AllocateGeometry(RenderDeviceVK* device, Model& model, u32 numVertices, u32 numIndices)
+        {
+            // A model has to fit in one block since a draw can only use one vertex and index buffer
+            if (numVertices > GEOMETRY_BLOCK_NUM_VERTICES || numIndices > GEOMETRY_BLOCK_NUM_INDICES)
+            {
+                NC_LOG_FATAL("Model %s has %u vertices and %u indices, a geometry block only fits %u and %u", model.debugName.c_str(), numVertices, numIndices, GEOMETRY_BLOCK_NUM_VERTICES, GEOMETRY_BLOCK_NUM_INDICES);
+            }
 
-            // Copy our vertex data into the staging buffer
-            void* vertexData;
-            vkMapMemory(device->_device, stagingBufferMemory, 0, vertexBufferSize, 0, &vertexData);
-            memcpy(vertexData, vertices.data(), (size_t)vertexBufferSize);
-            vkUnmapMemory(device->_device, stagingBufferMemory);
+            // Models only ever get added, so we only need to check the last block and start a new one when it is full
+            if (_geometryBlocks.empty() ||
+                _geometryBlocks.back().numVertices + numVertices > GEOMETRY_BLOCK_NUM_VERTICES ||
+                _geometryBlocks.back().numIndices + numIndices > GEOMETRY_BLOCK_NUM_INDICES)
+            {
+                CreateGeometryBlock(device);
+            }
 
-            // Copy the vertex data from our staging buffer to our vertex buffer
-            device->CopyBuffer(stagingBuffer, model.vertexBuffer, vertexBufferSize);
+            GeometryBlock& block = _geometryBlocks.back();
+            model.geometryBlock = static_cast<u32>(_geometryBlocks.size() - 1);
+            model.firstVertex = block.numVertices;
+            model.numVertices = numVertices;
+            model.firstIndex = block.numIndices;
+            model.numIndices = numIndices;
 
-            // Destroy and free our staging buffer
-            vkDestroyBuffer(device->_device, stagingBuffer, nullptr);
-            vkFreeMemory(device->_device, stagingBufferMemory, nullptr);
+            block.numVertices += numVertices;
+            block.numIndices += numIndices;
         }
 
-        void ModelHandlerVK::UpdateIndices(RenderDeviceVK* device, Model& model, const std::vector<i16>& indices)
+        void ModelHandlerVK::CreateGeometryBlock(RenderDeviceVK* device)
         {
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
+            GeometryBlock& block = _geometryBlocks.emplace_back();
+            std::string debugName = "GeometryBlock" + std::to_string(_geometryBlocks.size() - 1);
 
-            // Create a staging buffer
-            VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
-            device->CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+            // -- Create vertex buffer --
+            VkDeviceSize vertexBufferSize = sizeof(Vertex) * GEOMETRY_BLOCK_NUM_VERTICES;
+            device->CreateBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, block.vertexBuffer, block.vertexBufferAllocation);
+
+            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)block.vertexBuffer, VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, (debugName + " Vertices").c_str());
 
-            // Copy our index data into the staging buffer
-            void* indexData;
-            vkMapMemory(device->_device, stagingBufferMemory, 0, indexBufferSize, 0, &indexData);
-            memcpy(indexData, indices.data(), (size_t)indexBufferSize);
-            vkUnmapMemory(device->_device, stagingBufferMemory);
+            // -- Create index buffer --
+            VkDeviceSize indexBufferSize = sizeof(i16) * GEOMETRY_BLOCK_NUM_INDICES;
+            device->CreateBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, block.indexBuffer, block.indexBufferAllocation);
 
-            // Copy the index data from our staging buffer to our vertex buffer
-            device->CopyBuffer(stagingBuffer, model.indexBuffer, indexBufferSize);
+            DebugMarkerUtilVK::SetObjectName(device->_device, (u64)block.indexBuffer, VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, (debugName + " Indices").c_str());
+        }
 
-            // Destroy and free our staging buffer
-            vkDestroyBuffer(device->_device, stagingBuffer, nullptr);
-            vkFreeMemory(device->_device, stagingBufferMemory, nullptr);
+        void ModelHandlerVK::CalculateBounds(Model& model, const std::vector<Vertex>& vertices)
+        {
+            if (vertices.size() == 0)
+            {
+                model.bounds = AABB();
+                return;
+            }
+
+            model.bounds.min = vertices[0].pos;
+            model.bounds.max = vertices[0].pos;
+
+            for (const Vertex& vertex : vertices)
+            {
+                model.bounds.min = glm::min(model.bounds.min, vertex.pos);
+                model.bounds.max = glm::max(model.bounds.max, vertex.pos);
+            }
         }
     }
 }
\ No newline at end of file
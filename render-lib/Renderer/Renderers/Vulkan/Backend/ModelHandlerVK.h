@@ -5,6 +5,7 @@
 #include <vulkan/vulkan.h>
 
 #include "../../../Descriptors/ModelDesc.h"
+#include "MemoryAllocatorVK.h"
 
 namespace Renderer
 {
@@ -15,7 +16,8 @@ namespace Renderer
         class ModelHandlerVK
         {
             // Update the second value of this when the format exported from the converter gets changed
-            const NovusTypeHeader EXPECTED_TYPE_HEADER = NovusTypeHeader(42, 2);
+            const NovusTypeHeader EXPECTED_TYPE_HEADER = NovusTypeHeader(42, 3);
+            const u32 TYPE_VERSION_WITHOUT_LODS = 2; // Files converted before the LOD chain was added, they get it generated on load instead
         public:
             ModelHandlerVK();
             ~ModelHandlerVK();
@@ -25,40 +27,66 @@ namespace Renderer
 
             ModelID LoadModel(RenderDeviceVK* device, const ModelDesc& desc);
 
+            // Models get sub-allocated from a few big vertex and index buffers, models in the same geometry block share them
+            u32 GetGeometryBlock(ModelID modelID);
             VkBuffer GetVertexBuffer(ModelID modelID);
-
-            u32 GetNumIndices(ModelID modelID);
             VkBuffer GetIndexBuffer(ModelID modelID);
+
+            u32 GetNumLODs(ModelID modelID);
+            const ModelLOD& GetLOD(ModelID modelID, u32 lod);
+
+            const AABB& GetBounds(ModelID modelID);
             
         private:
             struct Model
             {
                 ModelDesc desc;
-                VkBuffer vertexBuffer;
-                VkDeviceMemory vertexBufferMemory;
-                VkBuffer indexBuffer;
-                VkDeviceMemory indexBufferMemory;
-                u32 numIndices;
+                u32 geometryBlock;
+                u32 firstVertex;
+                u32 numVertices;
+                u32 firstIndex;
+                u32 numIndices; // Of all LODs together
+                u32 numLODs;
+                ModelLOD lods[MODEL_MAX_LODS]; // Relative to the start of the geometry block
+                AABB bounds;
 
                 std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
                 std::string debugName;
             };
 
+            struct GeometryBlock
+            {
+                VkBuffer vertexBuffer;
+                AllocationVK vertexBufferAllocation;
+                VkBuffer indexBuffer;
+                AllocationVK indexBufferAllocation;
+
+                // How much has been handed out to models, nothing gets freed so this only grows
+                u32 numVertices = 0;
+                u32 numIndices = 0;
+            };
+
             struct TempModelData
             {
                 i32 indexType;
                 std::vector<Vertex> vertices;
                 std::vector<i16> indices;
+                std::vector<ModelLOD> lods; // Ranges of indices, empty if the LOD chain still has to be generated
             };
 
         private:
             void LoadFromFile(const ModelDesc& desc, TempModelData& data);
+            void GenerateLODs(TempModelData& data);
             void InitializeModel(RenderDeviceVK* device, Model& model, const TempModelData& data);
+            void AllocateGeometry(RenderDeviceVK* device, Model& model, u32 numVertices, u32 numIndices);
+            void CreateGeometryBlock(RenderDeviceVK* device);
             void UpdateVertices(RenderDeviceVK* device, Model& model, const std::vector<Vertex>& vertices);
             void UpdateIndices(RenderDeviceVK* device, Model& model, const std::vector<i16>& indices);
+            void CalculateBounds(Model& model, const std::vector<Vertex>& vertices);
 
         private:
             std::vector<Model> _models;
+            std::vector<GeometryBlock> _geometryBlocks;
         };
     }
 }
\ No newline at end of file
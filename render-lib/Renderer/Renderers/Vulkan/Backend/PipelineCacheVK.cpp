@@ -0,0 +1,336 @@
+#include "PipelineCacheVK.h"
+#include <Utils/DebugHandler.h>
+#include <Utils/XXHash64.h>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+#include "RenderDeviceVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        static const char* PIPELINE_CACHE_PATH = "Data/cache/PipelineCache.bin";
+        const u32 PIPELINE_CACHE_MAGIC = 0x4E435043; // "NCPC"
+        const u32 PIPELINE_CACHE_VERSION = 1;
+
+        void PipelineCacheVK::Init(RenderDeviceVK* device)
+        {
+            _device = device;
+
+            if (!LoadFromFile(_initialData))
+            {
+                _initialData.clear();
+            }
+
+            VkPipelineCacheCreateInfo cacheInfo = {};
+            cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            cacheInfo.initialDataSize = _initialData.size();
+            cacheInfo.pInitialData = _initialData.data();
+
+            if (vkCreatePipelineCache(device->_device, &cacheInfo, nullptr, &_cache) != VK_SUCCESS)
+            {
+                // The driver can still reject data that passed our validation, fall back to an empty cache
+                NC_LOG_WARNING("Driver rejected the pipeline cache at %s, starting with an empty one", PIPELINE_CACHE_PATH);
+
+                _initialData.clear();
+                cacheInfo.initialDataSize = 0;
+                cacheInfo.pInitialData = nullptr;
+
+                if (vkCreatePipelineCache(device->_device, &cacheInfo, nullptr, &_cache) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create pipeline cache!");
+                }
+            }
+        }
+
+        void PipelineCacheVK::Destroy()
+        {
+            if (_cache == VK_NULL_HANDLE)
+                return;
+
+            Save();
+
+            for (VkPipelineCache workerCache : _workerCaches)
+            {
+                vkDestroyPipelineCache(_device->_device, workerCache, nullptr);
+            }
+            _workerCaches.clear();
+            _freeWorkerCaches.clear();
+
+            vkDestroyPipelineCache(_device->_device, _cache, nullptr);
+            _cache = VK_NULL_HANDLE;
+        }
+
+        void PipelineCacheVK::AddEnabledExtensions(VkPhysicalDevice physicalDevice, std::vector<const char*>& extensions)
+        {
+            uint32_t extensionCount;
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+            for (const VkExtensionProperties& extension : availableExtensions)
+            {
+                if (!strcmp(extension.extensionName, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME))
+                {
+                    _creationFeedbackAvailable = true;
+                    extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+                    break;
+                }
+            }
+        }
+
+        VkResult PipelineCacheVK::CreateGraphicsPipeline(VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline& pipeline)
+        {
+            VkPipelineCreationFeedbackEXT pipelineFeedback = {};
+            std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(pipelineInfo.stageCount);
+
+            VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo = {};
+            feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+            feedbackInfo.pPipelineCreationFeedback = &pipelineFeedback;
+            feedbackInfo.pipelineStageCreationFeedbackCount = pipelineInfo.stageCount;
+            feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+
+            const void* next = pipelineInfo.pNext;
+            if (_creationFeedbackAvailable)
+            {
+                feedbackInfo.pNext = pipelineInfo.pNext;
+                pipelineInfo.pNext = &feedbackInfo;
+            }
+
+            VkPipelineCache workerCache = AcquireWorkerCache();
+            VkResult result = vkCreateGraphicsPipelines(_device->_device, workerCache, 1, &pipelineInfo, nullptr, &pipeline);
+            ReleaseWorkerCache(workerCache);
+
+            pipelineInfo.pNext = next;
+
+            if (result != VK_SUCCESS)
+                return result;
+
+            CountCreated(pipelineFeedback);
+            return result;
+        }
+
+        VkResult PipelineCacheVK::CreateComputePipeline(VkComputePipelineCreateInfo& pipelineInfo, VkPipeline& pipeline)
+        {
+            VkPipelineCreationFeedbackEXT pipelineFeedback = {};
+            VkPipelineCreationFeedbackEXT stageFeedback = {};
+
+            VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo = {};
+            feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+            feedbackInfo.pPipelineCreationFeedback = &pipelineFeedback;
+            feedbackInfo.pipelineStageCreationFeedbackCount = 1;
+            feedbackInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+
+            const void* next = pipelineInfo.pNext;
+            if (_creationFeedbackAvailable)
+            {
+                feedbackInfo.pNext = pipelineInfo.pNext;
+                pipelineInfo.pNext = &feedbackInfo;
+            }
+
+            VkPipelineCache workerCache = AcquireWorkerCache();
+            VkResult result = vkCreateComputePipelines(_device->_device, workerCache, 1, &pipelineInfo, nullptr, &pipeline);
+            ReleaseWorkerCache(workerCache);
+
+            pipelineInfo.pNext = next;
+
+            if (result != VK_SUCCESS)
+                return result;
+
+            CountCreated(pipelineFeedback);
+            return result;
+        }
+
+        void PipelineCacheVK::CountCreated(const VkPipelineCreationFeedbackEXT& pipelineFeedback)
+        {
+            _numCreated++;
+
+            if (_creationFeedbackAvailable && (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+            {
+                if (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+                {
+                    _numHits++;
+                }
+                else
+                {
+                    _numMisses++;
+                }
+            }
+        }
+
+        void PipelineCacheVK::Save()
+        {
+            // Nothing new got compiled since the last save, the file on disk is already up to date
+            u32 numCreated = _numCreated;
+            if (_cache == VK_NULL_HANDLE || numCreated == _numCreatedAtLastSave)
+                return;
+
+            // Merge what the worker caches compiled into the main cache, the ones currently in use get merged on the next save
+            {
+                std::scoped_lock lock(_workerCacheMutex);
+
+                if (_freeWorkerCaches.size() > 0)
+                {
+                    if (vkMergePipelineCaches(_device->_device, _cache, static_cast<u32>(_freeWorkerCaches.size()), _freeWorkerCaches.data()) != VK_SUCCESS)
+                    {
+                        NC_LOG_ERROR("Failed to merge the worker pipeline caches!");
+                    }
+                }
+            }
+
+            size_t dataSize = 0;
+            if (vkGetPipelineCacheData(_device->_device, _cache, &dataSize, nullptr) != VK_SUCCESS)
+            {
+                NC_LOG_ERROR("Failed to get the size of the pipeline cache data!");
+                return;
+            }
+
+            std::vector<u8> data(dataSize);
+            if (vkGetPipelineCacheData(_device->_device, _cache, &dataSize, data.data()) != VK_SUCCESS)
+            {
+                NC_LOG_ERROR("Failed to get the pipeline cache data!");
+                return;
+            }
+
+            FileHeader header;
+            FillHeader(header);
+            header.dataSize = dataSize;
+            header.dataHash = XXHash64::hash(data.data(), dataSize, 0);
+
+            std::filesystem::path path = std::filesystem::absolute(PIPELINE_CACHE_PATH);
+            std::filesystem::path tempPath = path;
+            tempPath += ".tmp";
+
+            std::error_code errorCode;
+            std::filesystem::create_directories(path.parent_path(), errorCode);
+
+            // Write to a temporary file first so a crash while saving can't leave a half written cache behind
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                if (!file.is_open())
+                {
+                    NC_LOG_ERROR("Failed to open %s for writing the pipeline cache!", tempPath.string().c_str());
+                    return;
+                }
+
+                file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+                file.write(reinterpret_cast<const char*>(data.data()), dataSize);
+            }
+
+            std::filesystem::rename(tempPath, path, errorCode);
+            if (errorCode)
+            {
+                NC_LOG_ERROR("Failed to move the pipeline cache to %s!", path.string().c_str());
+                return;
+            }
+
+            _numCreatedAtLastSave = numCreated;
+            NC_LOG_MESSAGE("Saved pipeline cache (%u bytes, %u hits, %u misses, %u pipelines created)", static_cast<u32>(dataSize), GetNumHits(), GetNumMisses(), numCreated);
+        }
+
+        VkPipelineCache PipelineCacheVK::AcquireWorkerCache()
+        {
+            {
+                std::scoped_lock lock(_workerCacheMutex);
+
+                if (_freeWorkerCaches.size() > 0)
+                {
+                    VkPipelineCache cache = _freeWorkerCaches.back();
+                    _freeWorkerCaches.pop_back();
+                    return cache;
+                }
+            }
+
+            // Every worker cache starts out with what we loaded from disk so pipelines compiled in earlier runs are still hits
+            VkPipelineCacheCreateInfo cacheInfo = {};
+            cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+            cacheInfo.initialDataSize = _initialData.size();
+            cacheInfo.pInitialData = _initialData.data();
+
+            VkPipelineCache cache;
+            if (vkCreatePipelineCache(_device->_device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create worker pipeline cache!");
+            }
+
+            std::scoped_lock lock(_workerCacheMutex);
+            _workerCaches.push_back(cache);
+
+            return cache;
+        }
+
+        void PipelineCacheVK::ReleaseWorkerCache(VkPipelineCache cache)
+        {
+            std::scoped_lock lock(_workerCacheMutex);
+            _freeWorkerCaches.push_back(cache);
+        }
+
+        bool PipelineCacheVK::LoadFromFile(std::vector<u8>& data)
+        {
+            std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+                return false;
+
+            size_t fileSize = static_cast<size_t>(file.tellg());
+            if (fileSize < sizeof(FileHeader))
+            {
+                NC_LOG_WARNING("Pipeline cache at %s is truncated, ignoring it", PIPELINE_CACHE_PATH);
+                return false;
+            }
+
+            FileHeader header;
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+
+            FileHeader expectedHeader;
+            FillHeader(expectedHeader);
+
+            if (header.magic != expectedHeader.magic || header.version != expectedHeader.version)
+            {
+                NC_LOG_WARNING("Pipeline cache at %s has an unknown format, ignoring it", PIPELINE_CACHE_PATH);
+                return false;
+            }
+
+            // A cache from another GPU or driver is useless at best, and some drivers crash on it at worst
+            if (header.vendorID != expectedHeader.vendorID || header.deviceID != expectedHeader.deviceID || header.driverVersion != expectedHeader.driverVersion ||
+                memcmp(header.pipelineCacheUUID, expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+            {
+                NC_LOG_MESSAGE("Pipeline cache at %s was made by another device or driver, ignoring it", PIPELINE_CACHE_PATH);
+                return false;
+            }
+
+            if (header.dataSize != fileSize - sizeof(FileHeader))
+            {
+                NC_LOG_WARNING("Pipeline cache at %s is truncated, ignoring it", PIPELINE_CACHE_PATH);
+                return false;
+            }
+
+            data.resize(header.dataSize);
+            file.read(reinterpret_cast<char*>(data.data()), header.dataSize);
+
+            if (XXHash64::hash(data.data(), data.size(), 0) != header.dataHash)
+            {
+                NC_LOG_WARNING("Pipeline cache at %s is corrupt, ignoring it", PIPELINE_CACHE_PATH);
+                return false;
+            }
+
+            return true;
+        }
+
+        void PipelineCacheVK::FillHeader(FileHeader& header)
+        {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(_device->_physicalDevice, &properties);
+
+            header.magic = PIPELINE_CACHE_MAGIC;
+            header.version = PIPELINE_CACHE_VERSION;
+            header.vendorID = properties.vendorID;
+            header.deviceID = properties.deviceID;
+            header.driverVersion = properties.driverVersion;
+            memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        class RenderDeviceVK;
+
+        // Wraps the VkPipelineCache every pipeline gets created through, it is loaded from disk on startup and saved back on shutdown
+        // The file is only used if it was written by the same vendor, device and driver, otherwise we start with an empty cache
+        // Pipelines can be compiled on several threads at once, each compile borrows a cache of its own which gets merged into the main one when saving
+        class PipelineCacheVK
+        {
+        public:
+            void Init(RenderDeviceVK* device);
+            void Destroy();
+
+            // VK_EXT_pipeline_creation_feedback is what tells us if a pipeline was a cache hit, it gets enabled if the device supports it
+            void AddEnabledExtensions(VkPhysicalDevice physicalDevice, std::vector<const char*>& extensions);
+
+            VkResult CreateGraphicsPipeline(VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline& pipeline);
+            VkResult CreateComputePipeline(VkComputePipelineCreateInfo& pipelineInfo, VkPipeline& pipeline);
+
+            // Writes the cache to disk, this is safe to call at any point but it stalls while the driver serializes the cache
+            void Save();
+
+            VkPipelineCache GetCache() { return _cache; }
+
+            u32 GetNumHits() { return _numHits; }
+            u32 GetNumMisses() { return _numMisses; }
+            u32 GetNumCreated() { return _numCreated; } // Hits and misses are only counted with VK_EXT_pipeline_creation_feedback, this counts every pipeline
+
+        private:
+            struct FileHeader
+            {
+                u32 magic = 0;
+                u32 version = 0;
+                u32 vendorID = 0;
+                u32 deviceID = 0;
+                u32 driverVersion = 0;
+                u8 pipelineCacheUUID[VK_UUID_SIZE] = {};
+                u64 dataSize = 0;
+                u64 dataHash = 0;
+            };
+
+        private:
+            bool LoadFromFile(std::vector<u8>& data);
+            void FillHeader(FileHeader& header);
+
+            void CountCreated(const VkPipelineCreationFeedbackEXT& pipelineFeedback);
+
+            VkPipelineCache AcquireWorkerCache();
+            void ReleaseWorkerCache(VkPipelineCache cache);
+
+        private:
+            RenderDeviceVK* _device = nullptr;
+            VkPipelineCache _cache = VK_NULL_HANDLE;
+
+            std::vector<u8> _initialData; // What we loaded from disk, worker caches start out with this
+            std::vector<VkPipelineCache> _workerCaches;
+            std::vector<VkPipelineCache> _freeWorkerCaches;
+            std::mutex _workerCacheMutex;
+
+            bool _creationFeedbackAvailable = false;
+
+            std::atomic<u32> _numHits { 0 };
+            std::atomic<u32> _numMisses { 0 };
+            std::atomic<u32> _numCreated { 0 };
+            u32 _numCreatedAtLastSave = 0;
+        };
+    }
+}
\ No newline at end of file
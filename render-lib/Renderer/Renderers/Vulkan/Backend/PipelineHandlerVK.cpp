@@ -6,6 +6,7 @@
 #include "ShaderHandlerVK.h"
 #include "ImageHandlerVK.h"
 #include "SpirvReflect.h"
+#include <algorithm>
 
 
 namespace Renderer
@@ -14,7 +15,9 @@ namespace Renderer
     {
         PipelineHandlerVK::PipelineHandlerVK()
         {
-
+            // Pipelines can get compiled on other threads while we hand out IDs, so the storage must never reallocate
+            _graphicsPipelines.reserve(MAX_GRAPHICS_PIPELINES);
+            _computePipelines.reserve(MAX_COMPUTE_PIPELINES);
         }
 
         PipelineHandlerVK::~PipelineHandlerVK()
@@ -32,28 +35,70 @@ namespace Renderer
         }
 
         GraphicsPipelineID PipelineHandlerVK::CreatePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, const GraphicsPipelineDesc& desc)
+        {
+            bool needsCompile;
+            GraphicsPipelineID id = ReservePipeline(desc, needsCompile);
+
+            if (needsCompile)
+            {
+                CompilePipeline(device, shaderHandler, imageHandler, id);
+            }
+
+            return id;
+        }
+
+        GraphicsPipelineID PipelineHandlerVK::ReservePipeline(const GraphicsPipelineDesc& desc, bool& needsCompile)
         {
             assert(desc.ResourceToImageID != nullptr); // You need to bind this function pointer before creating pipeline, maybe use RenderGraph::InitializePipelineDesc?
             assert(desc.ResourceToDepthImageID != nullptr); // You need to bind this function pointer before creating pipeline, maybe use RenderGraph::InitializePipelineDesc?
             assert(desc.MutableResourceToImageID != nullptr); // You need to bind this function pointer before creating pipeline, maybe use RenderGraph::InitializePipelineDesc?
             assert(desc.MutableResourceToDepthImageID != nullptr); // You need to bind this function pointer before creating pipeline, maybe use RenderGraph::InitializePipelineDesc?
 
+            GraphicsPipelineCacheDesc cacheDesc;
+            u64 cacheDescHash = CalculateCacheDescHash(desc, cacheDesc);
+
+            std::scoped_lock lock(_graphicsPipelineMutex);
+
             // Check the cache
-            size_t nextID;
-            u64 cacheDescHash = CalculateCacheDescHash(desc);
-            if (TryFindExistingGPipeline(cacheDescHash, nextID))
+            auto it = _graphicsPipelineIDs.find(cacheDescHash);
+            if (it != _graphicsPipelineIDs.end())
             {
-                return GraphicsPipelineID(static_cast<gIDType>(nextID));
+                needsCompile = false;
+                return GraphicsPipelineID(it->second);
             }
-            nextID = _graphicsPipelines.size();
+            size_t nextID = _graphicsPipelines.size();
 
             // Make sure we haven't exceeded the limit of the GraphicsPipelineID type, if this hits you need to change type of GraphicsPipelineID to something bigger
             assert(nextID < GraphicsPipelineID::MaxValue());
 
-            GraphicsPipeline pipeline;
+            if (nextID >= MAX_GRAPHICS_PIPELINES)
+            {
+                NC_LOG_FATAL("We exceeded MAX_GRAPHICS_PIPELINES, increase it!");
+            }
+
+            GraphicsPipeline& pipeline = _graphicsPipelines.emplace_back();
             pipeline.desc = desc;
             pipeline.cacheDescHash = cacheDescHash;
 
+            // The resource lookups point into the RenderGraph of this frame which might be gone by the time the pipeline compiles, so compiling uses the resolved images instead
+            pipeline.renderTargets = cacheDesc.renderTargets;
+            pipeline.depthStencil = cacheDesc.depthStencil;
+            pipeline.desc.ResourceToImageID = nullptr;
+            pipeline.desc.ResourceToDepthImageID = nullptr;
+            pipeline.desc.MutableResourceToImageID = nullptr;
+            pipeline.desc.MutableResourceToDepthImageID = nullptr;
+
+            _graphicsPipelineIDs[cacheDescHash] = static_cast<gIDType>(nextID);
+
+            needsCompile = true;
+            return GraphicsPipelineID(static_cast<gIDType>(nextID));
+        }
+
+        void PipelineHandlerVK::CompilePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, GraphicsPipelineID id)
+        {
+            GraphicsPipeline& pipeline = _graphicsPipelines[static_cast<gIDType>(id)];
+            const GraphicsPipelineDesc& desc = pipeline.desc;
+
             // -- Get number of rendertargets --
             u8 numRenderTargets = 0;
             for (int i = 0; i < MAX_RENDER_TARGETS; i++)
@@ -64,154 +109,19 @@ namespace Renderer
                 numRenderTargets++;
             }
 
-            // -- Create Render Pass --
-            std::vector<VkAttachmentDescription> colorAttachments(numRenderTargets);
-            std::vector< VkAttachmentReference> colorAttachmentRefs(numRenderTargets);
-            for (int i = 0; i < numRenderTargets; i++)
-            {
-                ImageID imageID = desc.MutableResourceToImageID(desc.renderTargets[i]);
-                const ImageDesc& imageDesc = imageHandler->GetDescriptor(imageID);
-                colorAttachments[i].format = FormatConverterVK::ToVkFormat(imageDesc.format);
-                colorAttachments[i].samples = FormatConverterVK::ToVkSampleCount(imageDesc.sampleCount);
-                colorAttachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-                colorAttachments[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-                colorAttachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-                colorAttachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-                colorAttachments[i].initialLayout = VK_IMAGE_LAYOUT_GENERAL;
-                colorAttachments[i].finalLayout = VK_IMAGE_LAYOUT_GENERAL;
-
-                colorAttachmentRefs[i].attachment = i;
-                colorAttachmentRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-            }
-
-            VkSubpassDescription subpass = {};
-            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-            subpass.colorAttachmentCount = numRenderTargets;
-            subpass.pColorAttachments = colorAttachmentRefs.data();
-
-            VkSubpassDependency dependency = {};
-            dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-            dependency.dstSubpass = 0;
-            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.srcAccessMask = 0;
-            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-            VkRenderPassCreateInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-            renderPassInfo.attachmentCount = numRenderTargets;
-            renderPassInfo.pAttachments = colorAttachments.data();
-            renderPassInfo.subpassCount = 1;
-            renderPassInfo.pSubpasses = &subpass;
-            renderPassInfo.dependencyCount = 1;
-            renderPassInfo.pDependencies = &dependency;
-
-            if (vkCreateRenderPass(device->_device, &renderPassInfo, nullptr, &pipeline.renderPass) != VK_SUCCESS)
-            {
-                NC_LOG_FATAL("Failed to create render pass!");
-            }
-
-            // -- Create Framebuffer --
-            u8 numAttachments = numRenderTargets;
-            if (desc.depthStencil != RenderPassMutableResource::Invalid())
-                numAttachments++;
-
-            std::vector<VkImageView> attachments(numAttachments);
-            // Add all color rendertargets as attachments
-            for (int i = 0; i < numRenderTargets; i++)
-            {
-                ImageID imageID = desc.MutableResourceToImageID(desc.renderTargets[i]);
-                attachments[i] = imageHandler->GetColorView(imageID);
-            }
-            // Add depthstencil as attachment
-            if (desc.depthStencil != RenderPassMutableResource::Invalid())
-            {
-                DepthImageID depthImageID = desc.MutableResourceToDepthImageID(desc.depthStencil);
-                attachments[numRenderTargets] = imageHandler->GetDepthView(depthImageID);
-            }
-
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = pipeline.renderPass;
-            framebufferInfo.attachmentCount = numAttachments;
-            framebufferInfo.pAttachments = attachments.data();
-            framebufferInfo.width = static_cast<u32>(desc.states.viewport.width);
-            framebufferInfo.height = static_cast<u32>(desc.states.viewport.height);
-            framebufferInfo.layers = 1;
-
-            if (vkCreateFramebuffer(device->_device, &framebufferInfo, nullptr, &pipeline.framebuffer) != VK_SUCCESS)
-            {
-                NC_LOG_FATAL("Failed to create framebuffer!");
-            }
-            
-            // -- Create Descriptor Set Layout from reflected SPIR-V --
-            const ShaderBinary* shaderBinaries[2] = { shaderHandler->GetSPIRV(desc.states.vertexShader), shaderHandler->GetSPIRV(desc.states.pixelShader) };
-
-            for (int i = 0; i < 2; i++)
-            {
-                SpvReflectShaderModule reflectModule = {};
-                SpvReflectResult result = spvReflectCreateShaderModule(shaderBinaries[i]->size(), shaderBinaries[i]->data(), &reflectModule);
-
-                if (result != SPV_REFLECT_RESULT_SUCCESS)
-                {
-                    NC_LOG_FATAL("We failed to reflect the spirv");
-                }
-
-                uint32_t count = 0;
-                result = spvReflectEnumerateDescriptorSets(&reflectModule, &count, NULL);
-                
-                if (result != SPV_REFLECT_RESULT_SUCCESS)
-                {
-                    NC_LOG_FATAL("We failed to reflect the spirv descriptor set count");
-                }
-
-                std::vector<SpvReflectDescriptorSet*> sets(count);
-                result = spvReflectEnumerateDescriptorSets(&reflectModule, &count, sets.data());
-                
-                if (result != SPV_REFLECT_RESULT_SUCCESS)
-                {
-                    NC_LOG_FATAL("We failed to reflect the spirv descriptor sets");
-                }
-
-                for (size_t set = 0; set < sets.size(); set++)
-                {
-                    const SpvReflectDescriptorSet& reflectionSet = *(sets[set]);
-
-                    DescriptorSetLayoutData& layout = GetDescriptorSet(reflectionSet.set, pipeline.descriptorSetLayoutDatas);
+            // -- Get Render Pass --
+            // Pipelines only need a compatible render pass, so every pipeline rendering to the same formats shares one
+            RenderPassCacheDesc renderPassDesc;
+            GetRenderPassCacheDesc(imageHandler, pipeline, renderPassDesc);
+            pipeline.renderPass = FindOrCreateRenderPass(device, renderPassDesc);
 
-                    for (uint32_t binding = 0; binding < reflectionSet.binding_count; binding++)
-                    {
-                        const SpvReflectDescriptorBinding& reflectionBinding = *(reflectionSet.bindings[binding]);
+            // Depth only pipelines don't need a pixel shader
+            bool hasPixelShader = desc.states.pixelShader != PixelShaderID::Invalid();
+            u32 numShaders = hasPixelShader ? 2 : 1;
 
-                        layout.bindings.push_back(VkDescriptorSetLayoutBinding());
-                        VkDescriptorSetLayoutBinding& layoutBinding = layout.bindings.back();
-                        layoutBinding.binding = reflectionBinding.binding;
-                        layoutBinding.descriptorType = static_cast<VkDescriptorType>(reflectionBinding.descriptor_type);
-                        layoutBinding.descriptorCount = 1;
-
-                        for (uint32_t dim = 0; dim < reflectionBinding.array.dims_count; dim++)
-                        {
-                            layoutBinding.descriptorCount *= reflectionBinding.array.dims[dim];
-                        }
-                        layoutBinding.stageFlags = static_cast<VkShaderStageFlagBits>(reflectModule.shader_stage);
-                    }
-                    layout.setNumber = reflectionSet.set;
-                    layout.createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-                    layout.createInfo.bindingCount = static_cast<u32>(layout.bindings.size());
-                    layout.createInfo.pBindings = layout.bindings.data();
-                }
-            }
-
-            size_t numDescriptorSets = pipeline.descriptorSetLayoutDatas.size();
-            pipeline.descriptorSetLayouts.resize(numDescriptorSets);
-
-            for (size_t i = 0; i < numDescriptorSets; i++)
-            {
-                if (vkCreateDescriptorSetLayout(device->_device, &pipeline.descriptorSetLayoutDatas[i].createInfo, nullptr, &pipeline.descriptorSetLayouts[i]) != VK_SUCCESS)
-                {
-                    NC_LOG_FATAL("Failed to create descriptor set layout!");
-                }
-            }
+            // -- Create Descriptor Set Layouts and Pipeline Layout from reflected SPIR-V --
+            const ShaderBinary* shaderBinaries[2] = { shaderHandler->GetSPIRV(desc.states.vertexShader), hasPixelShader ? shaderHandler->GetSPIRV(desc.states.pixelShader) : nullptr };
+            CreatePipelineLayout(device, shaderBinaries, numShaders, pipeline.layout);
 
             // -- Create shader stage infos --
             VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
@@ -225,7 +135,7 @@ namespace Renderer
             fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
             fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-            fragShaderStageInfo.module = shaderHandler->GetShaderModule(desc.states.pixelShader);
+            fragShaderStageInfo.module = hasPixelShader ? shaderHandler->GetShaderModule(desc.states.pixelShader) : VK_NULL_HANDLE;
             fragShaderStageInfo.pName = "main";
 
             VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
@@ -293,6 +203,14 @@ namespace Renderer
             viewportState.scissorCount = 1;
             viewportState.pScissors = &scissor;
 
+            // Viewport and scissor get set when the pipeline is bound, that way pipelines sharing them don't have to set them again
+            VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+            VkPipelineDynamicStateCreateInfo dynamicState = {};
+            dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            dynamicState.dynamicStateCount = 2;
+            dynamicState.pDynamicStates = dynamicStates;
+
             // -- Rasterizer --
             VkPipelineRasterizationStateCreateInfo rasterizer = {};
             rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -343,112 +261,506 @@ namespace Renderer
             colorBlending.blendConstants[2] = 0.0f; // TODO: Blend constants
             colorBlending.blendConstants[3] = 0.0f; // TODO: Blend constants
             
-            VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-            pipelineLayoutInfo.setLayoutCount = static_cast<u32>(pipeline.descriptorSetLayouts.size());
-            pipelineLayoutInfo.pSetLayouts = pipeline.descriptorSetLayouts.data();
-            pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-            pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-            if (vkCreatePipelineLayout(device->_device, &pipelineLayoutInfo, nullptr, &pipeline.pipelineLayout) != VK_SUCCESS)
+            // -- Depth Stencil --
+            const DepthStencilState& depthStencilState = desc.states.depthStencilState;
+
+            VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+            depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            depthStencil.depthTestEnable = depthStencilState.depthEnable;
+            depthStencil.depthWriteEnable = depthStencilState.depthWriteEnable;
+            depthStencil.depthCompareOp = FormatConverterVK::ToVkCompareOp(depthStencilState.depthFunc);
+            depthStencil.depthBoundsTestEnable = VK_FALSE;
+            depthStencil.stencilTestEnable = depthStencilState.stencilEnable;
+
+            const DepthStencilOpDesc* stencilOpDescs[2] = { &depthStencilState.frontFace, &depthStencilState.backFace };
+            VkStencilOpState* stencilOpStates[2] = { &depthStencil.front, &depthStencil.back };
+            for (int i = 0; i < 2; i++)
             {
-                NC_LOG_FATAL("Failed to create pipeline layout!");
+                stencilOpStates[i]->failOp = FormatConverterVK::ToVkStencilOp(stencilOpDescs[i]->stencilFailOp);
+                stencilOpStates[i]->depthFailOp = FormatConverterVK::ToVkStencilOp(stencilOpDescs[i]->stencilDepthFailOp);
+                stencilOpStates[i]->passOp = FormatConverterVK::ToVkStencilOp(stencilOpDescs[i]->stencilPassOp);
+                stencilOpStates[i]->compareOp = FormatConverterVK::ToVkCompareOp(stencilOpDescs[i]->stencilFunc);
+                stencilOpStates[i]->compareMask = depthStencilState.stencilReadMask;
+                stencilOpStates[i]->writeMask = depthStencilState.stencilWriteMask;
             }
 
+
             VkGraphicsPipelineCreateInfo pipelineInfo = {};
             pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-            pipelineInfo.stageCount = 2;
+            pipelineInfo.stageCount = numShaders;
             pipelineInfo.pStages = shaderStages;
             pipelineInfo.pVertexInputState = &vertexInputInfo;
             pipelineInfo.pInputAssemblyState = &inputAssembly;
             pipelineInfo.pViewportState = &viewportState;
             pipelineInfo.pRasterizationState = &rasterizer;
             pipelineInfo.pMultisampleState = &multisampling;
-            pipelineInfo.pDepthStencilState = nullptr; // Optional
+            pipelineInfo.pDepthStencilState = desc.depthStencil != RenderPassMutableResource::Invalid() ? &depthStencil : nullptr; // The render pass only has a depth attachment if we have a depthstencil
             pipelineInfo.pColorBlendState = &colorBlending;
-            pipelineInfo.pDynamicState = nullptr; // Optional
-            pipelineInfo.layout = pipeline.pipelineLayout;
+            pipelineInfo.pDynamicState = &dynamicState;
+            pipelineInfo.layout = pipeline.layout.pipelineLayout;
             pipelineInfo.renderPass = pipeline.renderPass;
             pipelineInfo.subpass = 0;
             pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
             pipelineInfo.basePipelineIndex = -1; // Optional
 
-            if (vkCreateGraphicsPipelines(device->_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS)
+            if (device->_pipelineCache.CreateGraphicsPipeline(pipelineInfo, pipeline.pipeline) != VK_SUCCESS)
             {
                 NC_LOG_FATAL("Failed to create graphics pipeline!");
             }
 
-            _graphicsPipelines.push_back(pipeline);
-            return GraphicsPipelineID(static_cast<gIDType>(nextID));
+            _graphicsPipelineReady[static_cast<gIDType>(id)].store(true, std::memory_order_release);
         }
 
-        ComputePipelineID PipelineHandlerVK::CreatePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, const ComputePipelineDesc& desc)
+        VkFramebuffer PipelineHandlerVK::GetFramebuffer(RenderDeviceVK* device, ImageHandlerVK* imageHandler, GraphicsPipelineID id)
         {
-            return ComputePipelineID();
+            const GraphicsPipeline& pipeline = _graphicsPipelines[static_cast<gIDType>(id)];
+
+            FramebufferCacheDesc cacheDesc = {};
+            cacheDesc.renderPass = pipeline.renderPass;
+            cacheDesc.width = static_cast<u32>(pipeline.desc.states.viewport.width);
+            cacheDesc.height = static_cast<u32>(pipeline.desc.states.viewport.height);
+            cacheDesc.layers = 1;
+
+            // Add all color rendertargets as attachments
+            for (int i = 0; i < MAX_RENDER_TARGETS; i++)
+            {
+                if (pipeline.desc.renderTargets[i] == RenderPassMutableResource::Invalid())
+                    break;
+
+                cacheDesc.attachments[cacheDesc.numAttachments++] = imageHandler->GetColorView(pipeline.renderTargets[i]);
+            }
+            // Add depthstencil as attachment
+            if (pipeline.desc.depthStencil != RenderPassMutableResource::Invalid())
+            {
+                cacheDesc.attachments[cacheDesc.numAttachments++] = imageHandler->GetDepthView(pipeline.depthStencil);
+            }
+
+            u64 cacheDescHash = XXHash64::hash(&cacheDesc, sizeof(cacheDesc), 0);
+
+            std::scoped_lock lock(_framebufferMutex);
+
+            // Check the cache
+            auto it = _framebuffers.find(cacheDescHash);
+            if (it != _framebuffers.end())
+            {
+                return it->second;
+            }
+
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = cacheDesc.renderPass;
+            framebufferInfo.attachmentCount = cacheDesc.numAttachments;
+            framebufferInfo.pAttachments = cacheDesc.attachments.data();
+            framebufferInfo.width = cacheDesc.width;
+            framebufferInfo.height = cacheDesc.height;
+            framebufferInfo.layers = cacheDesc.layers;
+
+            VkFramebuffer framebuffer;
+            if (vkCreateFramebuffer(device->_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create framebuffer!");
+            }
+
+            _framebuffers[cacheDescHash] = framebuffer;
+            return framebuffer;
         }
 
-        u64 PipelineHandlerVK::CalculateCacheDescHash(const GraphicsPipelineDesc& desc)
+        void PipelineHandlerVK::DestroyFramebuffers(RenderDeviceVK* device)
         {
-            GraphicsPipelineCacheDesc cacheDesc;
-            cacheDesc.states = desc.states;
+            std::scoped_lock lock(_framebufferMutex);
 
-            cacheDesc.numSRVs = 0;
-            for (auto& texture : desc.textures)
+            for (auto& it : _framebuffers)
             {
-                if (texture == RenderPassResource::Invalid())
-                    break;
+                vkDestroyFramebuffer(device->_device, it.second, nullptr);
+            }
+            _framebuffers.clear();
+        }
 
-                cacheDesc.numSRVs++;
+        VkRenderPass PipelineHandlerVK::GetRenderPass(RenderDeviceVK* device, ImageHandlerVK* imageHandler, GraphicsPipelineID id, const VkAttachmentLoadOp* loadOps, const VkAttachmentStoreOp* storeOps)
+        {
+            const GraphicsPipeline& pipeline = _graphicsPipelines[static_cast<gIDType>(id)];
+
+            RenderPassCacheDesc cacheDesc;
+            GetRenderPassCacheDesc(imageHandler, pipeline, cacheDesc);
+
+            u32 numAttachments = cacheDesc.numRenderTargets + (cacheDesc.depthFormat != VK_FORMAT_UNDEFINED ? 1 : 0);
+            for (u32 i = 0; i < numAttachments; i++)
+            {
+                cacheDesc.loadOps[i] = loadOps[i];
+                cacheDesc.storeOps[i] = storeOps[i];
             }
 
+            // Render passes that only differ in load and store ops are compatible, so this works with the pipeline that was created against the default one
+            return FindOrCreateRenderPass(device, cacheDesc);
+        }
+
+        void PipelineHandlerVK::GetRenderPassCacheDesc(ImageHandlerVK* imageHandler, const GraphicsPipeline& pipeline, RenderPassCacheDesc& cacheDesc)
+        {
+            cacheDesc = {};
+            cacheDesc.loadOps.fill(VK_ATTACHMENT_LOAD_OP_LOAD);
+            cacheDesc.storeOps.fill(VK_ATTACHMENT_STORE_OP_STORE);
+
             for (int i = 0; i < MAX_RENDER_TARGETS; i++)
             {
-                if (desc.renderTargets[i] == RenderPassMutableResource::Invalid())
+                if (pipeline.desc.renderTargets[i] == RenderPassMutableResource::Invalid())
                     break;
 
-                cacheDesc.renderTargets[i] = desc.MutableResourceToImageID(desc.renderTargets[i]);
+                const ImageDesc& imageDesc = imageHandler->GetDescriptor(pipeline.renderTargets[i]);
+                cacheDesc.colorFormats[i] = FormatConverterVK::ToVkFormat(imageDesc.format);
+                cacheDesc.colorSampleCounts[i] = FormatConverterVK::ToVkSampleCount(imageDesc.sampleCount);
+                cacheDesc.numRenderTargets++;
             }
 
-            if (desc.depthStencil != RenderPassMutableResource::Invalid())
+            if (pipeline.desc.depthStencil != RenderPassMutableResource::Invalid())
             {
-                cacheDesc.depthStencil = desc.MutableResourceToDepthImageID(desc.depthStencil);
+                const DepthImageDesc& depthImageDesc = imageHandler->GetDescriptor(pipeline.depthStencil);
+                cacheDesc.depthFormat = FormatConverterVK::ToVkFormat(depthImageDesc.format);
+                cacheDesc.depthSampleCount = FormatConverterVK::ToVkSampleCount(depthImageDesc.sampleCount);
             }
+        }
 
-            u64 hash = XXHash64::hash(&cacheDesc, sizeof(cacheDesc), 0);
+        VkRenderPass PipelineHandlerVK::FindOrCreateRenderPass(RenderDeviceVK* device, const RenderPassCacheDesc& cacheDesc)
+        {
+            u64 cacheDescHash = XXHash64::hash(&cacheDesc, sizeof(cacheDesc), 0);
 
-            return hash;
+            // Pipelines compile on several threads at once
+            std::scoped_lock lock(_renderPassMutex);
+
+            // Check the cache
+            auto it = _renderPasses.find(cacheDescHash);
+            if (it != _renderPasses.end())
+            {
+                return it->second;
+            }
+
+            bool hasDepthStencil = cacheDesc.depthFormat != VK_FORMAT_UNDEFINED;
+            u32 numAttachments = cacheDesc.numRenderTargets + (hasDepthStencil ? 1 : 0);
+
+            std::vector<VkAttachmentDescription> attachments(numAttachments);
+            std::vector<VkAttachmentReference> colorAttachmentRefs(cacheDesc.numRenderTargets);
+            for (u32 i = 0; i < cacheDesc.numRenderTargets; i++)
+            {
+                attachments[i].format = cacheDesc.colorFormats[i];
+                attachments[i].samples = cacheDesc.colorSampleCounts[i];
+                attachments[i].loadOp = cacheDesc.loadOps[i];
+                attachments[i].storeOp = cacheDesc.storeOps[i];
+                attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                attachments[i].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // The RenderGraph transitions rendertargets before the pass
+                attachments[i].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+                colorAttachmentRefs[i].attachment = i;
+                colorAttachmentRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            }
+
+            VkAttachmentReference depthAttachmentRef = {};
+            if (hasDepthStencil)
+            {
+                VkAttachmentDescription& depthAttachment = attachments[cacheDesc.numRenderTargets];
+                depthAttachment.format = cacheDesc.depthFormat;
+                depthAttachment.samples = cacheDesc.depthSampleCount;
+                depthAttachment.loadOp = cacheDesc.loadOps[cacheDesc.numRenderTargets];
+                depthAttachment.storeOp = cacheDesc.storeOps[cacheDesc.numRenderTargets];
+                depthAttachment.stencilLoadOp = cacheDesc.loadOps[cacheDesc.numRenderTargets];
+                depthAttachment.stencilStoreOp = cacheDesc.storeOps[cacheDesc.numRenderTargets];
+                depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+                depthAttachmentRef.attachment = cacheDesc.numRenderTargets;
+                depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            }
+
+            VkSubpassDescription subpass = {};
+            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpass.colorAttachmentCount = cacheDesc.numRenderTargets;
+            subpass.pColorAttachments = colorAttachmentRefs.data();
+            subpass.pDepthStencilAttachment = hasDepthStencil ? &depthAttachmentRef : nullptr;
+
+            // Passes that keep rendering to the same attachments don't get barriers from the RenderGraph, so the render pass has to order itself after earlier attachment writes
+            VkSubpassDependency dependency = {};
+            dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+            dependency.dstSubpass = 0;
+            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+            VkRenderPassCreateInfo renderPassInfo = {};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+            renderPassInfo.attachmentCount = numAttachments;
+            renderPassInfo.pAttachments = attachments.data();
+            renderPassInfo.subpassCount = 1;
+            renderPassInfo.pSubpasses = &subpass;
+            renderPassInfo.dependencyCount = 1;
+            renderPassInfo.pDependencies = &dependency;
+
+            VkRenderPass renderPass;
+            if (vkCreateRenderPass(device->_device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create render pass!");
+            }
+
+            _renderPasses[cacheDescHash] = renderPass;
+            return renderPass;
         }
 
-        bool PipelineHandlerVK::TryFindExistingGPipeline(u64 descHash, size_t& id)
+        ComputePipelineID PipelineHandlerVK::CreatePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, const ComputePipelineDesc& desc)
         {
-            id = 0;
+            // The desc is nothing but the shader, so we can hash it as is
+            u64 cacheDescHash = XXHash64::hash(&desc, sizeof(desc), 0);
 
-            for (auto& pipeline : _graphicsPipelines)
+            std::scoped_lock lock(_computePipelineMutex);
+
+            // Check the cache
+            auto it = _computePipelineIDs.find(cacheDescHash);
+            if (it != _computePipelineIDs.end())
             {
-                if (descHash == pipeline.cacheDescHash)
-                {
-                    return true;
-                }
-                id++;
+                return ComputePipelineID(it->second);
             }
+            size_t nextID = _computePipelines.size();
+
+            // Make sure we haven't exceeded the limit of the ComputePipelineID type, if this hits you need to change type of ComputePipelineID to something bigger
+            assert(nextID < ComputePipelineID::MaxValue());
+
+            if (nextID >= MAX_COMPUTE_PIPELINES)
+            {
+                NC_LOG_FATAL("We exceeded MAX_COMPUTE_PIPELINES, increase it!");
+            }
+
+            ComputePipeline& pipeline = _computePipelines.emplace_back();
+            pipeline.desc = desc;
+            pipeline.cacheDescHash = cacheDescHash;
 
-            return false;
+            // -- Create Descriptor Set Layouts and Pipeline Layout from reflected SPIR-V --
+            const ShaderBinary* shaderBinary = shaderHandler->GetSPIRV(desc.computeShader);
+            CreatePipelineLayout(device, &shaderBinary, 1, pipeline.layout);
+
+            VkPipelineShaderStageCreateInfo shaderStageInfo = {};
+            shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            shaderStageInfo.module = shaderHandler->GetShaderModule(desc.computeShader);
+            shaderStageInfo.pName = "main";
+
+            VkComputePipelineCreateInfo pipelineInfo = {};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage = shaderStageInfo;
+            pipelineInfo.layout = pipeline.layout.pipelineLayout;
+            pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+            pipelineInfo.basePipelineIndex = -1;
+
+            if (device->_pipelineCache.CreateComputePipeline(pipelineInfo, pipeline.pipeline) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create compute pipeline!");
+            }
+
+            _computePipelineIDs[cacheDescHash] = static_cast<cIDType>(nextID);
+
+            return ComputePipelineID(static_cast<cIDType>(nextID));
         }
 
-        bool PipelineHandlerVK::TryFindExistingCPipeline(u64 descHash, size_t& id)
+        void PipelineHandlerVK::CreatePipelineLayout(RenderDeviceVK* device, const ShaderBinary* const* shaderBinaries, u32 numShaders, PipelineLayoutVK& layout)
         {
-            id = 0;
+            for (u32 i = 0; i < numShaders; i++)
+            {
+                SpvReflectShaderModule reflectModule = {};
+                SpvReflectResult result = spvReflectCreateShaderModule(shaderBinaries[i]->size(), shaderBinaries[i]->data(), &reflectModule);
 
-            for (auto& pipeline : _computePipelines)
+                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                {
+                    NC_LOG_FATAL("We failed to reflect the spirv");
+                }
+
+                uint32_t count = 0;
+                result = spvReflectEnumerateDescriptorSets(&reflectModule, &count, NULL);
+                
+                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                {
+                    NC_LOG_FATAL("We failed to reflect the spirv descriptor set count");
+                }
+
+                std::vector<SpvReflectDescriptorSet*> sets(count);
+                result = spvReflectEnumerateDescriptorSets(&reflectModule, &count, sets.data());
+                
+                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                {
+                    NC_LOG_FATAL("We failed to reflect the spirv descriptor sets");
+                }
+
+                for (size_t set = 0; set < sets.size(); set++)
+                {
+                    const SpvReflectDescriptorSet& reflectionSet = *(sets[set]);
+
+                    DescriptorSetLayoutData& setLayout = GetDescriptorSet(reflectionSet.set, layout.descriptorSetLayoutDatas);
+
+                    for (uint32_t binding = 0; binding < reflectionSet.binding_count; binding++)
+                    {
+                        const SpvReflectDescriptorBinding& reflectionBinding = *(reflectionSet.bindings[binding]);
+                        VkDescriptorType descriptorType = static_cast<VkDescriptorType>(reflectionBinding.descriptor_type);
+
+                        // Textures and samplers are only ever accessed through the global texture table, the set containing them uses its layout
+                        if (descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER)
+                        {
+                            setLayout.isTextureTable = true;
+                            continue;
+                        }
+
+                        // Constant buffers are bound with a dynamic offset into the constant buffer ring, their layout has to match the one of the ring exactly
+                        if (descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                        {
+                            descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                        }
+
+                        // Several stages of a pipeline can use the same binding
+                        auto existingBinding = std::find_if(setLayout.bindings.begin(), setLayout.bindings.end(), [&reflectionBinding](const VkDescriptorSetLayoutBinding& layoutBinding)
+                        {
+                            return layoutBinding.binding == reflectionBinding.binding;
+                        });
+                        if (existingBinding != setLayout.bindings.end())
+                        {
+                            continue;
+                        }
+
+                        setLayout.bindings.push_back(VkDescriptorSetLayoutBinding());
+                        VkDescriptorSetLayoutBinding& layoutBinding = setLayout.bindings.back();
+                        layoutBinding.binding = reflectionBinding.binding;
+                        layoutBinding.descriptorType = descriptorType;
+                        layoutBinding.descriptorCount = 1;
+
+                        for (uint32_t dim = 0; dim < reflectionBinding.array.dims_count; dim++)
+                        {
+                            layoutBinding.descriptorCount *= reflectionBinding.array.dims[dim];
+                        }
+
+                        // Buffers keep one descriptor set no matter which pipeline binds them, graphics or compute, so the layouts have to be identical across stages
+                        layoutBinding.stageFlags = VK_SHADER_STAGE_ALL;
+                    }
+                    setLayout.setNumber = reflectionSet.set;
+                    setLayout.createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+                    setLayout.createInfo.bindingCount = static_cast<u32>(setLayout.bindings.size());
+                    setLayout.createInfo.pBindings = setLayout.bindings.data();
+                }
+
+                // -- Reflect push constants --
+                count = 0;
+                result = spvReflectEnumeratePushConstantBlocks(&reflectModule, &count, NULL);
+
+                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                {
+                    NC_LOG_FATAL("We failed to reflect the spirv push constant block count");
+                }
+
+                std::vector<SpvReflectBlockVariable*> pushConstantBlocks(count);
+                result = spvReflectEnumeratePushConstantBlocks(&reflectModule, &count, pushConstantBlocks.data());
+
+                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                {
+                    NC_LOG_FATAL("We failed to reflect the spirv push constant blocks");
+                }
+
+                for (SpvReflectBlockVariable* pushConstantBlock : pushConstantBlocks)
+                {
+                    layout.pushConstantSize = std::max(layout.pushConstantSize, pushConstantBlock->offset + pushConstantBlock->size);
+                }
+
+                spvReflectDestroyShaderModule(&reflectModule);
+            }
+
+            // Sets none of the shaders use still need a layout, otherwise the sets after them would end up at the wrong index
+            u32 numSets = 0;
+            for (const DescriptorSetLayoutData& layoutData : layout.descriptorSetLayoutDatas)
             {
-                if (descHash == pipeline.cacheDescHash)
+                numSets = std::max(numSets, layoutData.setNumber + 1);
+            }
+
+            for (u32 set = 0; set < numSets; set++)
+            {
+                DescriptorSetLayoutData& setLayout = GetDescriptorSet(set, layout.descriptorSetLayoutDatas);
+                setLayout.setNumber = set;
+                setLayout.createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+                setLayout.createInfo.bindingCount = static_cast<u32>(setLayout.bindings.size());
+                setLayout.createInfo.pBindings = setLayout.bindings.data();
+            }
+
+            // The layouts need to be in set order since the set number is the index into the pipeline layout
+            std::sort(layout.descriptorSetLayoutDatas.begin(), layout.descriptorSetLayoutDatas.end(), [](const DescriptorSetLayoutData& a, const DescriptorSetLayoutData& b)
+            {
+                return a.setNumber < b.setNumber;
+            });
+
+            size_t numDescriptorSets = layout.descriptorSetLayoutDatas.size();
+            layout.descriptorSetLayouts.resize(numDescriptorSets);
+
+            for (size_t i = 0; i < numDescriptorSets; i++)
+            {
+                DescriptorSetLayoutData& layoutData = layout.descriptorSetLayoutDatas[i];
+                if (layoutData.isTextureTable)
+                {
+                    // The texture table needs a set of its own
+                    if (!layoutData.bindings.empty())
+                    {
+                        NC_LOG_FATAL("Set %u mixes textures or samplers with other resources, the texture table needs a set of its own!", layoutData.setNumber);
+                    }
+
+                    layout.descriptorSetLayouts[i] = device->_textureTable.GetDescriptorSetLayout();
+                    layout.textureTableSet = static_cast<i32>(layoutData.setNumber);
+                    continue;
+                }
+
+                if (vkCreateDescriptorSetLayout(device->_device, &layoutData.createInfo, nullptr, &layout.descriptorSetLayouts[i]) != VK_SUCCESS)
                 {
-                    return true;
+                    NC_LOG_FATAL("Failed to create descriptor set layout!");
                 }
-                id++;
             }
 
-            return false;
+            VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutInfo.setLayoutCount = static_cast<u32>(layout.descriptorSetLayouts.size());
+            pipelineLayoutInfo.pSetLayouts = layout.descriptorSetLayouts.data();
+
+            // All push constants share one range visible to every stage, compute included
+            VkPushConstantRange pushConstantRange = {};
+            pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+            pushConstantRange.offset = 0;
+            pushConstantRange.size = layout.pushConstantSize;
+
+            pipelineLayoutInfo.pushConstantRangeCount = layout.pushConstantSize > 0 ? 1 : 0;
+            pipelineLayoutInfo.pPushConstantRanges = layout.pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+            if (vkCreatePipelineLayout(device->_device, &pipelineLayoutInfo, nullptr, &layout.pipelineLayout) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create pipeline layout!");
+            }
+        }
+
+        u64 PipelineHandlerVK::CalculateCacheDescHash(const GraphicsPipelineDesc& desc, GraphicsPipelineCacheDesc& cacheDesc)
+        {
+            cacheDesc.states = desc.states;
+
+            cacheDesc.numSRVs = 0;
+            for (auto& texture : desc.textures)
+            {
+                if (texture == RenderPassResource::Invalid())
+                    break;
+
+                cacheDesc.numSRVs++;
+            }
+
+            for (int i = 0; i < MAX_RENDER_TARGETS; i++)
+            {
+                if (desc.renderTargets[i] == RenderPassMutableResource::Invalid())
+                    break;
+
+                cacheDesc.renderTargets[i] = desc.MutableResourceToImageID(desc.renderTargets[i]);
+            }
+
+            if (desc.depthStencil != RenderPassMutableResource::Invalid())
+            {
+                cacheDesc.depthStencil = desc.MutableResourceToDepthImageID(desc.depthStencil);
+            }
+
+            u64 hash = XXHash64::hash(&cacheDesc, sizeof(cacheDesc), 0);
+
+            return hash;
         }
 
         DescriptorSetLayoutData& PipelineHandlerVK::GetDescriptorSet(u32 setNumber, std::vector<DescriptorSetLayoutData>& sets)
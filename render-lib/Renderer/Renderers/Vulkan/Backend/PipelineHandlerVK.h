@@ -1,18 +1,21 @@
 #pragma once
 #include <NovusTypes.h>
 #include <vector>
+#include <array>
+#include <mutex>
+#include <atomic>
 #include <vulkan/vulkan.h>
 #include <robin_hood.h>
 
 #include "../../../Descriptors/GraphicsPipelineDesc.h"
 #include "../../../Descriptors/ComputePipelineDesc.h"
+#include "ShaderHandlerVK.h"
 
 namespace Renderer
 {
     namespace Backend
     {
         class RenderDeviceVK;
-        class ShaderHandlerVK;
         class ImageHandlerVK;
 
         struct DescriptorSetLayoutData
@@ -20,6 +23,18 @@ namespace Renderer
             uint32_t setNumber;
             VkDescriptorSetLayoutCreateInfo createInfo;
             std::vector<VkDescriptorSetLayoutBinding> bindings;
+            bool isTextureTable = false;
+        };
+
+        // Everything we reflect out of the shaders of a pipeline, graphics and compute pipelines build it the same way
+        struct PipelineLayoutVK
+        {
+            std::vector<DescriptorSetLayoutData> descriptorSetLayoutDatas;
+            std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+            i32 textureTableSet = -1;
+            u32 pushConstantSize = 0;
+
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
         };
 
         class PipelineHandlerVK
@@ -31,18 +46,43 @@ namespace Renderer
             ~PipelineHandlerVK();
 
             GraphicsPipelineID CreatePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, const GraphicsPipelineDesc& desc);
+
+            // Splits CreatePipeline in two so the compile can happen on another thread, ReservePipeline returns the ID right away and sets needsCompile if CompilePipeline still has to be called for it
+            GraphicsPipelineID ReservePipeline(const GraphicsPipelineDesc& desc, bool& needsCompile);
+            void CompilePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, GraphicsPipelineID id);
+
+            // Framebuffers are cached by render pass and attachment views, so pipelines rendering to the same attachments get the same framebuffer and can share a render pass instance
+            VkFramebuffer GetFramebuffer(RenderDeviceVK* device, ImageHandlerVK* imageHandler, GraphicsPipelineID id);
+            // Transient images get new views when they are placed in memory again, the framebuffers get recreated with the new views on their next use
+            void DestroyFramebuffers(RenderDeviceVK* device);
+
+            // Returns false while the pipeline is still compiling on another thread, nothing but GetDescriptor may be used on it until then
+            bool IsReady(GraphicsPipelineID id) { return _graphicsPipelineReady[static_cast<gIDType>(id)].load(std::memory_order_acquire); }
             ComputePipelineID CreatePipeline(RenderDeviceVK* device, ShaderHandlerVK* shaderHandler, ImageHandlerVK* imageHandler, const ComputePipelineDesc& desc);
 
             const GraphicsPipelineDesc& GetDescriptor(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].desc; }
-            const ComputePipelineDesc& GetDescriptor(ComputePipelineID id) { return _computePipelines[static_cast<gIDType>(id)].desc; }
+            const ComputePipelineDesc& GetDescriptor(ComputePipelineID id) { return _computePipelines[static_cast<cIDType>(id)].desc; }
 
             VkPipeline GetPipeline(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].pipeline; }
-            VkRenderPass GetRenderPass(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].renderPass; }
-            VkFramebuffer GetFramebuffer(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].framebuffer; }
+            ImageID GetRenderTarget(GraphicsPipelineID id, u32 index) { return _graphicsPipelines[static_cast<gIDType>(id)].renderTargets[index]; } // Invalid after the last rendertarget
+            DepthImageID GetDepthStencil(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].depthStencil; }
+
+            // Returns a render pass compatible with the pipeline, loadOps and storeOps have one entry per rendertarget followed by one for the depthstencil
+            VkRenderPass GetRenderPass(RenderDeviceVK* device, ImageHandlerVK* imageHandler, GraphicsPipelineID id, const VkAttachmentLoadOp* loadOps, const VkAttachmentStoreOp* storeOps);
 
-            DescriptorSetLayoutData& GetDescriptorSetLayoutData(GraphicsPipelineID id, u32 index) { return _graphicsPipelines[static_cast<gIDType>(id)].descriptorSetLayoutDatas[index]; }
-            VkDescriptorSetLayout& GetDescriptorSetLayout(GraphicsPipelineID id, u32 index) { return _graphicsPipelines[static_cast<gIDType>(id)].descriptorSetLayouts[index]; }
-            VkPipelineLayout& GetPipelineLayout(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].pipelineLayout; }
+            DescriptorSetLayoutData& GetDescriptorSetLayoutData(GraphicsPipelineID id, u32 index) { return _graphicsPipelines[static_cast<gIDType>(id)].layout.descriptorSetLayoutDatas[index]; }
+            VkDescriptorSetLayout& GetDescriptorSetLayout(GraphicsPipelineID id, u32 index) { return _graphicsPipelines[static_cast<gIDType>(id)].layout.descriptorSetLayouts[index]; }
+            VkPipelineLayout& GetPipelineLayout(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].layout.pipelineLayout; }
+
+            // Returns the set the pipeline expects the texture table in, or -1 if it doesn't sample any textures
+            i32 GetTextureTableSet(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].layout.textureTableSet; }
+            u32 GetPushConstantSize(GraphicsPipelineID id) { return _graphicsPipelines[static_cast<gIDType>(id)].layout.pushConstantSize; }
+
+            VkPipeline GetPipeline(ComputePipelineID id) { return _computePipelines[static_cast<cIDType>(id)].pipeline; }
+            VkDescriptorSetLayout& GetDescriptorSetLayout(ComputePipelineID id, u32 index) { return _computePipelines[static_cast<cIDType>(id)].layout.descriptorSetLayouts[index]; }
+            VkPipelineLayout& GetPipelineLayout(ComputePipelineID id) { return _computePipelines[static_cast<cIDType>(id)].layout.pipelineLayout; }
+            i32 GetTextureTableSet(ComputePipelineID id) { return _computePipelines[static_cast<cIDType>(id)].layout.textureTableSet; }
+            u32 GetPushConstantSize(ComputePipelineID id) { return _computePipelines[static_cast<cIDType>(id)].layout.pushConstantSize; }
 
         private:
 
@@ -51,14 +91,14 @@ namespace Renderer
                 GraphicsPipelineDesc desc;
                 u64 cacheDescHash;
 
-                VkRenderPass renderPass;
+                // Resolved from the desc when the pipeline got reserved
+                std::array<ImageID, MAX_RENDER_TARGETS> renderTargets;
+                DepthImageID depthStencil = DepthImageID::Invalid();
+
+                VkRenderPass renderPass; // Shared with every pipeline rendering to the same formats
                 
-                VkPipelineLayout pipelineLayout;
+                PipelineLayoutVK layout;
                 VkPipeline pipeline;
-                VkFramebuffer framebuffer;
-
-                std::vector<DescriptorSetLayoutData> descriptorSetLayoutDatas;
-                std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
 
                 VkDescriptorPool descriptorPool;
                 std::vector<VkDescriptorSet> descriptorSets;
@@ -68,25 +108,68 @@ namespace Renderer
             {
                 GraphicsPipelineDesc::States states;
                 u32 numSRVs = 0;
-                ImageID renderTargets[MAX_RENDER_TARGETS] = { ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid() };
+                std::array<ImageID, MAX_RENDER_TARGETS> renderTargets = { ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid(), ImageID::Invalid() };
                 DepthImageID depthStencil = DepthImageID::Invalid();
             };
 
+            // No padding in these two since we hash them as raw bytes
+            struct RenderPassCacheDesc
+            {
+                std::array<VkFormat, MAX_RENDER_TARGETS> colorFormats;
+                std::array<VkSampleCountFlagBits, MAX_RENDER_TARGETS> colorSampleCounts;
+                VkFormat depthFormat;
+                VkSampleCountFlagBits depthSampleCount;
+                u32 numRenderTargets;
+                std::array<VkAttachmentLoadOp, MAX_RENDER_TARGETS + 1> loadOps;
+                std::array<VkAttachmentStoreOp, MAX_RENDER_TARGETS + 1> storeOps;
+            };
+
+            struct FramebufferCacheDesc
+            {
+                u32 numAttachments;
+                u32 width;
+                u32 height;
+                u32 layers;
+                VkRenderPass renderPass;
+                std::array<VkImageView, MAX_RENDER_TARGETS + 1> attachments;
+            };
+
             struct ComputePipeline
             {
                 ComputePipelineDesc desc;
                 u64 cacheDescHash;
+
+                PipelineLayoutVK layout;
+                VkPipeline pipeline;
             };
 
         private:
-            u64 CalculateCacheDescHash(const GraphicsPipelineDesc& desc);
-            bool TryFindExistingGPipeline(u64 descHash, size_t& id);
-            bool TryFindExistingCPipeline(u64 descHash, size_t& id);
+            u64 CalculateCacheDescHash(const GraphicsPipelineDesc& desc, GraphicsPipelineCacheDesc& cacheDesc);
+            void GetRenderPassCacheDesc(ImageHandlerVK* imageHandler, const GraphicsPipeline& pipeline, RenderPassCacheDesc& cacheDesc);
+            VkRenderPass FindOrCreateRenderPass(RenderDeviceVK* device, const RenderPassCacheDesc& cacheDesc);
             DescriptorSetLayoutData& GetDescriptorSet(u32 setNumber, std::vector<DescriptorSetLayoutData>& sets);
+            void CreatePipelineLayout(RenderDeviceVK* device, const ShaderBinary* const* shaderBinaries, u32 numShaders, PipelineLayoutVK& layout);
             
         private:
             std::vector<GraphicsPipeline> _graphicsPipelines;
             std::vector<ComputePipeline> _computePipelines;
+
+            robin_hood::unordered_map<u64, gIDType> _graphicsPipelineIDs; // Maps the cache desc hash to the pipeline
+            std::mutex _graphicsPipelineMutex;
+
+            robin_hood::unordered_map<u64, cIDType> _computePipelineIDs; // Maps the desc hash to the pipeline
+            std::mutex _computePipelineMutex;
+
+            robin_hood::unordered_map<u64, VkRenderPass> _renderPasses; // Maps the render pass cache desc hash to the render pass
+            std::mutex _renderPassMutex;
+
+            robin_hood::unordered_map<u64, VkFramebuffer> _framebuffers; // Maps the framebuffer cache desc hash to the framebuffer
+            std::mutex _framebufferMutex;
+
+            static const u32 MAX_GRAPHICS_PIPELINES = 1024;
+            std::atomic<bool> _graphicsPipelineReady[MAX_GRAPHICS_PIPELINES] = {};
+
+            static const u32 MAX_COMPUTE_PIPELINES = 256;
         };
     }
 }
\ No newline at end of file
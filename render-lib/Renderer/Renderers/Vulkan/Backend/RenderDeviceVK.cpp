@@ -32,12 +32,20 @@ namespace Renderer
         const std::vector<const char*> deviceExtensions =
         {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-            "VK_KHR_maintenance1"
+            "VK_KHR_maintenance1",
+            VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME // Used by the texture table
         };
 
         RenderDeviceVK::~RenderDeviceVK()
         {
+            // Saves the pipeline cache for the next launch
+            _pipelineCache.Destroy();
+
             // TODO: All cleanup
+
+            // Whatever is still in use here leaked
+            _memoryAllocator.LogStats();
+            _memoryAllocator.Deinit();
         }
 
         void RenderDeviceVK::Init()
@@ -73,24 +81,23 @@ namespace Renderer
 
         ConstantBufferBackend* RenderDeviceVK::CreateConstantBufferBackend(size_t size)
         {
+            if (size > ConstantBufferRingVK::MAX_CONSTANT_BUFFER_SIZE)
+            {
+                NC_LOG_FATAL("Constant buffers can't be bigger than %u bytes!", ConstantBufferRingVK::MAX_CONSTANT_BUFFER_SIZE);
+            }
+
+            // The backend doesn't own any memory, Apply copies it into the constant buffer ring of the frame
             ConstantBufferBackendVK* cbBackend = new ConstantBufferBackendVK();
             cbBackend->device = this;
             cbBackend->bufferSize = size;
 
-            VkDeviceSize bufferSize = size;
-
-            for (int i = 0; i < Backend::ConstantBufferBackendVK::FRAME_BUFFER_COUNT; i++)
-            {
-                CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, cbBackend->uniformBuffers[i], cbBackend->uniformBuffersMemory[i]);
-            }
-
             _constantBufferBackends.push_back(cbBackend);
             return cbBackend;
         }
 
         void RenderDeviceVK::FlushGPU()
         {
-
+            vkDeviceWaitIdle(_device);
         }
 
         static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
@@ -129,8 +136,13 @@ namespace Renderer
             SetupDebugMessenger();
             PickPhysicalDevice();
             CreateLogicalDevice();
+            _memoryAllocator.Init(_device, _physicalDevice);
             CreateCommandPool();
             CreateCommandBuffers();
+            _constantBufferRing.Init(this);
+            _uploadHandler.Init(this);
+            _textureTable.Init(this);
+            _pipelineCache.Init(this);
 
             _initialized = true;
         }
@@ -149,7 +161,7 @@ namespace Renderer
             appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
             appInfo.pEngineName = "NovusCore";
             appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-            appInfo.apiVersion = VK_API_VERSION_1_0;
+            appInfo.apiVersion = VK_API_VERSION_1_1; // VK_EXT_descriptor_indexing depends on functionality that is core in 1.1
 
             VkInstanceCreateInfo createInfo = {};
             createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -264,6 +276,10 @@ namespace Renderer
 
             std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
             std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+            if (indices.transferFamily.has_value())
+            {
+                uniqueQueueFamilies.insert(indices.transferFamily.value());
+            }
 
             float queuePriority = 1.0f;
             for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -277,9 +293,19 @@ namespace Renderer
 
             VkPhysicalDeviceFeatures deviceFeatures = {};
             deviceFeatures.samplerAnisotropy = VK_TRUE;
+            deviceFeatures.multiDrawIndirect = VK_TRUE; // Indirect draws of several models sharing geometry buffers go out as one call
+
+            // The texture table is a partially bound array of textures that gets written to while it's in use
+            VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+            descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+            descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
 
             VkDeviceCreateInfo createInfo = {};
             createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            createInfo.pNext = &descriptorIndexingFeatures;
 
             createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
             createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -292,6 +318,7 @@ namespace Renderer
                 enabledExtensions.push_back(extension);
             }
             DebugMarkerUtilVK::AddEnabledExtension(enabledExtensions);
+            _pipelineCache.AddEnabledExtensions(_physicalDevice, enabledExtensions);
 
             createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
             createInfo.ppEnabledExtensionNames = enabledExtensions.data();
@@ -319,6 +346,10 @@ namespace Renderer
 
             vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0, &_graphicsQueue);
             vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentQueue);
+            if (indices.transferFamily.has_value())
+            {
+                vkGetDeviceQueue(_device, indices.transferFamily.value(), 0, &_transferQueue);
+            }
         }
 
         void RenderDeviceVK::CreateCommandPool()
@@ -454,6 +485,11 @@ namespace Renderer
                 {
                     NC_LOG_FATAL("Failed to create image available semaphore!");
                 }
+
+                if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &swapChain->renderFinishedSemaphores[i]) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create render finished semaphore!");
+                }
             }
         }
 
@@ -569,29 +605,34 @@ namespace Renderer
             // Create descriptor pool
             VkDescriptorPoolSize descriptorPoolSize = {}; 
             descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorPoolSize.descriptorCount = 1;
+            descriptorPoolSize.descriptorCount = FRAME_INDEX_COUNT;
 
             VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
             descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
             descriptorPoolInfo.poolSizeCount = 1;
             descriptorPoolInfo.pPoolSizes = &descriptorPoolSize;
-            descriptorPoolInfo.maxSets = 1;
+            descriptorPoolInfo.maxSets = FRAME_INDEX_COUNT;
 
             if (vkCreateDescriptorPool(_device, &descriptorPoolInfo, nullptr, &swapChain->descriptorPool) != VK_SUCCESS)
             {
                 NC_LOG_FATAL("Failed to create descriptor pool!");
             }
 
-            // Create descriptor set
+            // Create one descriptor set per frame in flight, Present rewrites the one of the current frame
+            static_assert(SwapChainVK::FRAME_BUFFER_COUNT >= FRAME_INDEX_COUNT, "The swapchain needs a descriptor set per frame in flight");
+
             VkDescriptorSetAllocateInfo allocInfo = {};
             allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
             allocInfo.descriptorPool = swapChain->descriptorPool;
             allocInfo.descriptorSetCount = 1;
             allocInfo.pSetLayouts = &swapChain->descriptorSetLayout;
 
-            if (vkAllocateDescriptorSets(_device, &allocInfo, &swapChain->descriptorSet) != VK_SUCCESS)
+            for (u32 i = 0; i < FRAME_INDEX_COUNT; i++)
             {
-                NC_LOG_FATAL("Failed to allocate descriptor sets!");
+                if (vkAllocateDescriptorSets(_device, &allocInfo, &swapChain->descriptorSets[i]) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to allocate descriptor sets!");
+                }
             }
 
             // Create sampler
@@ -727,7 +768,7 @@ namespace Renderer
             pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
             pipelineInfo.basePipelineIndex = -1; // Optional
 
-            if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &swapChain->pipeline) != VK_SUCCESS)
+            if (_pipelineCache.CreateGraphicsPipeline(pipelineInfo, swapChain->pipeline) != VK_SUCCESS)
             {
                 NC_LOG_FATAL("Failed to create graphics pipeline!");
             }
@@ -758,6 +799,12 @@ namespace Renderer
                 return 0;
             }
 
+            if (!deviceFeatures.multiDrawIndirect)
+            {
+                NC_LOG_MESSAGE("[Renderer]: GPU Detected %s with score %i because it doesn't support multi draw indirect", deviceProperties.deviceName, 0);
+                return 0;
+            }
+
             // Application can't function without geometry shaders
             if (!deviceFeatures.geometryShader)
             {
@@ -808,10 +855,16 @@ namespace Renderer
             int i = 0;
             for (const auto& queueFamily : queueFamilies)
             {
-                if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && !indices.graphicsFamily.has_value())
                 {
                     indices.graphicsFamily = i;
                 }
+
+                // A transfer only queue family maps to the copy engines, which lets uploads run alongside rendering
+                if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT && !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+                {
+                    indices.transferFamily = i;
+                }
                 
                 // This is disabled since when we initialize Vulkan and pick a device we don't have a surface yet, I have no idea if this will cause an issue in the future...
                 /*VkBool32 presentSupport = false;
@@ -819,11 +872,9 @@ namespace Renderer
                 if (queueFamily.queueCount > 0 && presentSupport) {
                     indices.presentFamily = i;
                 }*/
-                indices.presentFamily = i; // So we just assume it works for now
-
-                if (indices.IsComplete())
+                if (!indices.graphicsFamily.has_value() || indices.graphicsFamily.value() == static_cast<uint32_t>(i))
                 {
-                    break;
+                    indices.presentFamily = i; // So we just assume it works for now
                 }
 
                 i++;
@@ -930,7 +981,7 @@ namespace Renderer
             vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
         }
 
-        void RenderDeviceVK::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+        void RenderDeviceVK::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, AllocationVK& allocation, AllocationStrategy strategy)
         {
             VkBufferCreateInfo bufferInfo = {};
             bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -946,80 +997,28 @@ namespace Renderer
             VkMemoryRequirements memRequirements;
             vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
 
-            VkMemoryAllocateInfo allocInfo = {};
-            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-            allocInfo.allocationSize = memRequirements.size;
-            allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-            if (vkAllocateMemory(_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-            {
-                NC_LOG_FATAL("Failed to allocate buffer memory!");
-            }
-
-            vkBindBufferMemory(_device, buffer, bufferMemory, 0);
+            allocation = _memoryAllocator.Allocate(memRequirements, properties, strategy);
+            vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
         }
 
-        u32 RenderDeviceVK::FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties)
+        void RenderDeviceVK::DestroyBuffer(VkBuffer buffer, AllocationVK& allocation)
         {
-            VkPhysicalDeviceMemoryProperties memProperties;
-            vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
-
-            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-            {
-                if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-                {
-                    return i;
-                }
-            }
-
-            NC_LOG_FATAL("Failed to find suitable memory type!");
-            return 0;
+            vkDestroyBuffer(_device, buffer, nullptr);
+            _memoryAllocator.Free(allocation);
         }
 
-        void RenderDeviceVK::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+        void RenderDeviceVK::AllocateImageMemory(VkImage image, VkMemoryPropertyFlags properties, AllocationVK& allocation)
         {
-            VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-            VkBufferCopy copyRegion = {};
-            copyRegion.srcOffset = 0; // Optional
-            copyRegion.dstOffset = 0; // Optional
-            copyRegion.size = size;
-            vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+            VkMemoryRequirements memRequirements;
+            vkGetImageMemoryRequirements(_device, image, &memRequirements);
 
-            EndSingleTimeCommands(commandBuffer);
+            allocation = _memoryAllocator.Allocate(memRequirements, properties);
+            vkBindImageMemory(_device, image, allocation.memory, allocation.offset);
         }
 
-        void RenderDeviceVK::CopyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, u32 width, u32 height)
+        void RenderDeviceVK::FreeImageMemory(AllocationVK& allocation)
         {
-            VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
-            VkBufferImageCopy region = {};
-            region.bufferOffset = 0;
-            region.bufferRowLength = 0;
-            region.bufferImageHeight = 0;
-
-            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            region.imageSubresource.mipLevel = 0;
-            region.imageSubresource.baseArrayLayer = 0;
-            region.imageSubresource.layerCount = 1;
-
-            region.imageOffset = { 0, 0, 0 };
-            region.imageExtent = {
-                width,
-                height,
-                1
-            };
-
-            vkCmdCopyBufferToImage(
-                commandBuffer,
-                srcBuffer,
-                dstImage,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1,
-                &region
-            );
-
-            EndSingleTimeCommands(commandBuffer);
+            _memoryAllocator.Free(allocation);
         }
 
         void RenderDeviceVK::TransitionImageLayout(VkImage image, VkImageAspectFlags aspects, VkImageLayout oldLayout, VkImageLayout newLayout)
@@ -1041,7 +1040,7 @@ namespace Renderer
             imageBarrier.image = image;
             imageBarrier.subresourceRange.aspectMask = aspects;
             imageBarrier.subresourceRange.baseMipLevel = 0;
-            imageBarrier.subresourceRange.levelCount = 1;
+            imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
             imageBarrier.subresourceRange.layerCount = 1;
 
             VkPipelineStageFlagBits srcFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
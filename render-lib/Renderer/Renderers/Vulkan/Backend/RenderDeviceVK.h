@@ -6,6 +6,11 @@
 
 #include "../../../Descriptors/ImageDesc.h"
 #include "../../../Descriptors/DepthImageDesc.h"
+#include "MemoryAllocatorVK.h"
+#include "ConstantBufferRingVK.h"
+#include "UploadHandlerVK.h"
+#include "TextureTableVK.h"
+#include "PipelineCacheVK.h"
 
 class Window;
 struct GLFWwindow;
@@ -23,6 +28,7 @@ namespace Renderer
         {
             std::optional<uint32_t> graphicsFamily;
             std::optional<uint32_t> presentFamily;
+            std::optional<uint32_t> transferFamily; // Only set if the device has a queue family dedicated to transfers
 
             bool IsComplete()
             {
@@ -45,6 +51,9 @@ namespace Renderer
 
             void FlushGPU();
 
+        public:
+            static const u32 FRAME_INDEX_COUNT = 2;
+
         private:
             void InitOnce();
 
@@ -73,17 +82,16 @@ namespace Renderer
             VkCommandBuffer BeginSingleTimeCommands();
             void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
 
-            void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-            u32 FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties);
-            void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-            void CopyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, u32 width, u32 height);
+            void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, AllocationVK& allocation, AllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST);
+            void DestroyBuffer(VkBuffer buffer, AllocationVK& allocation);
+            void AllocateImageMemory(VkImage image, VkMemoryPropertyFlags properties, AllocationVK& allocation);
+            void FreeImageMemory(AllocationVK& allocation);
             void TransitionImageLayout(VkImage image, VkImageAspectFlags aspects, VkImageLayout oldLayout, VkImageLayout newLayout);
             void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspects, VkImageLayout oldLayout, VkImageLayout newLayout);
 
         private:
-            static const u32 FRAME_INDEX_COUNT = 2;
             static bool _initialized;
-            u32 _frameIndex;
+            u32 _frameIndex = 0;
 
             VkInstance _instance;
             VkDebugUtilsMessengerEXT _debugMessenger;
@@ -95,12 +103,23 @@ namespace Renderer
 
             VkQueue _graphicsQueue = VK_NULL_HANDLE;
             VkQueue _presentQueue = VK_NULL_HANDLE;
+            VkQueue _transferQueue = VK_NULL_HANDLE;
+
+            MemoryAllocatorVK _memoryAllocator;
+            ConstantBufferRingVK _constantBufferRing;
+            UploadHandlerVK _uploadHandler;
+            TextureTableVK _textureTable;
+            PipelineCacheVK _pipelineCache;
 
             std::vector<ConstantBufferBackendVK*> _constantBufferBackends;
             std::vector<SwapChainVK*> _swapChains;
 
             friend class RendererVK;
             friend struct ConstantBufferBackendVK;
+            friend class ConstantBufferRingVK;
+            friend class UploadHandlerVK;
+            friend class TextureTableVK;
+            friend class PipelineCacheVK;
             friend class ImageHandlerVK;
             friend class TextureHandlerVK;
             friend class ModelHandlerVK;
@@ -108,6 +127,7 @@ namespace Renderer
             friend class PipelineHandlerVK;
             friend class CommandListHandlerVK;
             friend class SamplerHandlerVK;
+            friend class BufferHandlerVK;
         };
     }
 }
\ No newline at end of file
@@ -3,8 +3,6 @@
 #include <Utils/StringUtils.h>
 #include <Utils/XXHash64.h>
 #include "RenderDeviceVK.h"
-#include "TextureHandlerVK.h"
-#include "PipelineHandlerVK.h"
 
 namespace Renderer
 {
@@ -63,71 +61,14 @@ namespace Renderer
                 NC_LOG_FATAL("Failed to create texture sampler!");
             }
 
+            // SamplerIDs index straight into the texture table
+            device->_textureTable.SetSampler(static_cast<u32>(nextID), samplerContainer.sampler);
+
             _samplerContainers.push_back(samplerContainer);
+            _samplerIDs[samplerHash] = static_cast<type>(nextID);
             return SamplerID(static_cast<type>(nextID));
         }
 
-        VkDescriptorSet SamplerHandlerVK::GetCombinedSampler(RenderDeviceVK* device, TextureHandlerVK* textureHandler, PipelineHandlerVK* pipelineHandler, const SamplerID samplerID, const u32 slot, const TextureID textureID, const GraphicsPipelineID pipelineID)
-        {
-            SamplerContainer& samplerContainer = _samplerContainers[static_cast<_SamplerID>(samplerID)];
-
-            VkImageView imageView = textureHandler->GetImageView(textureID);
-            
-            Backend::DescriptorSetLayoutData& descriptorSetLayoutData = pipelineHandler->GetDescriptorSetLayoutData(pipelineID, slot);
-            VkDescriptorSetLayout& descriptorSetLayout = pipelineHandler->GetDescriptorSetLayout(pipelineID, slot);
-            
-            CombinedSampler& combinedSampler = samplerContainer.combinedSamplers[static_cast<_TextureID>(textureID)];
-            
-            if (combinedSampler.descriptorPool == NULL)
-            {
-                VkDescriptorPoolSize poolSize = {};
-                poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                poolSize.descriptorCount = 1;
-
-                VkDescriptorPoolCreateInfo poolInfo = {};
-                poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-                poolInfo.poolSizeCount = 1;
-                poolInfo.pPoolSizes = &poolSize;
-                poolInfo.maxSets = 1;
-
-                if (vkCreateDescriptorPool(device->_device, &poolInfo, nullptr, &combinedSampler.descriptorPool) != VK_SUCCESS)
-                {
-                    NC_LOG_FATAL("Failed to create descriptor pool for combined sampler!");
-                }
-
-                VkDescriptorSetAllocateInfo allocInfo = {};
-                allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-                allocInfo.descriptorPool = combinedSampler.descriptorPool;
-                allocInfo.descriptorSetCount = 1;
-                allocInfo.pSetLayouts = &descriptorSetLayout;
-
-                if (vkAllocateDescriptorSets(device->_device, &allocInfo, &combinedSampler.descriptorSet) != VK_SUCCESS)
-                {
-                    NC_LOG_FATAL("Failed to allocate descriptor sets!");
-                }
-
-                VkDescriptorImageInfo imageInfo = {};
-                imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                imageInfo.imageView = imageView;
-                imageInfo.sampler = samplerContainer.sampler;
-
-                VkWriteDescriptorSet descriptorWrite = {};
-                descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                descriptorWrite.dstSet = combinedSampler.descriptorSet;
-                descriptorWrite.dstBinding = 0;
-                descriptorWrite.dstArrayElement = 0;
-                descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                descriptorWrite.descriptorCount = 1;
-                descriptorWrite.pBufferInfo = nullptr;
-                descriptorWrite.pImageInfo = &imageInfo;
-                descriptorWrite.pTexelBufferView = nullptr;
-
-                vkUpdateDescriptorSets(device->_device, 1, &descriptorWrite, 0, nullptr);
-            }
-
-            return combinedSampler.descriptorSet;
-        }
-
         const SamplerDesc& SamplerHandlerVK::GetSamplerDesc(const SamplerID id)
         {
             using type = type_safe::underlying_type<SamplerID>;
@@ -144,18 +85,12 @@ namespace Renderer
 
         bool SamplerHandlerVK::TryFindExistingSamplerContainer(u64 descHash, size_t& id)
         {
-            id = 0;
+            auto it = _samplerIDs.find(descHash);
+            if (it == _samplerIDs.end())
+                return false;
 
-            for (auto& samplerContainer : _samplerContainers)
-            {
-                if (descHash == samplerContainer.samplerHash)
-                {
-                    return true;
-                }
-                id++;
-            }
-
-            return false;
+            id = it->second;
+            return true;
         }
 
         VkFilter SamplerHandlerVK::ToVkFilterMag(SamplerFilter filter)
@@ -4,17 +4,13 @@
 #include <vulkan/vulkan.h>
 #include <robin_hood.h>
 
-#include "../../../Descriptors/TextureDesc.h"
 #include "../../../Descriptors/SamplerDesc.h"
-#include "../../../Descriptors/GraphicsPipelineDesc.h"
 
 namespace Renderer
 {
     namespace Backend
     {
         class RenderDeviceVK;
-        class TextureHandlerVK;
-        class PipelineHandlerVK;
 
         class SamplerHandlerVK
         {
@@ -24,26 +20,15 @@ namespace Renderer
 
             SamplerID CreateSampler(RenderDeviceVK* device, const SamplerDesc& desc);
 
-            VkDescriptorSet GetCombinedSampler(RenderDeviceVK* device, TextureHandlerVK* textureHandler, PipelineHandlerVK* pipelineHandler, const SamplerID samplerID, const u32 slot, const TextureID textureID, const GraphicsPipelineID pipelineID);
-
             const SamplerDesc& GetSamplerDesc(const SamplerID samplerID);
 
         private:
-            struct CombinedSampler
-            {
-                VkDescriptorPool descriptorPool = NULL;
-                VkDescriptorSet descriptorSet;
-            };
-
-            using _SamplerID = type_safe::underlying_type<SamplerID>;
-            using _TextureID = type_safe::underlying_type<TextureID>;
             struct SamplerContainer
             {
                 u64 samplerHash;
                 SamplerDesc desc;
 
                 VkSampler sampler;
-                robin_hood::unordered_map<_TextureID, CombinedSampler> combinedSamplers;
             };
 
         private:
@@ -59,6 +44,7 @@ namespace Renderer
 
         private:
             std::vector<SamplerContainer> _samplerContainers;
+            robin_hood::unordered_map<u64, type_safe::underlying_type<SamplerID>> _samplerIDs; // Maps the sampler hash to the sampler
         };
     }
 }
\ No newline at end of file
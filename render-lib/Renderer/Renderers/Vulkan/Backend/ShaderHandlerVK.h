@@ -35,6 +35,7 @@ namespace Renderer
 
             const ShaderBinary* GetSPIRV(const VertexShaderID id) { return &_vertexShaders[static_cast<vsIDType>(id)].spirv; }
             const ShaderBinary* GetSPIRV(const PixelShaderID id) { return &_pixelShaders[static_cast<psIDType>(id)].spirv; }
+            const ShaderBinary* GetSPIRV(const ComputeShaderID id) { return &_computeShaders[static_cast<csIDType>(id)].spirv; }
 
         private:
             struct Shader
@@ -111,7 +111,7 @@ namespace Renderer
 
             VkDescriptorPool descriptorPool;
             VkDescriptorSetLayout descriptorSetLayout;
-            VkDescriptorSet descriptorSet;
+            VkDescriptorSet descriptorSets[FRAME_BUFFER_COUNT]; // One per frame in flight, indexed by RenderDeviceVK::GetFrameIndex, so we never rewrite one the GPU might still be reading
             VkSampler sampler;
 
             VkSurfaceKHR surface;
@@ -122,6 +122,7 @@ namespace Renderer
             VkImageView imageViews[FRAME_BUFFER_COUNT];
             VkFramebuffer framebuffers[FRAME_BUFFER_COUNT];
             VkSemaphore imageAvailableSemaphores[FRAME_BUFFER_COUNT];
+            VkSemaphore renderFinishedSemaphores[FRAME_BUFFER_COUNT];
         };
     }
 }
\ No newline at end of file
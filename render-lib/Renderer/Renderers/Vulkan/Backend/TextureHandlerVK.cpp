@@ -58,6 +58,9 @@ namespace Renderer
 
             CreateTexture(device, texture, pixels);
 
+            // TextureIDs index straight into the texture table
+            device->_textureTable.SetTexture(static_cast<u32>(nextHandle), texture.imageView);
+
             _textures.push_back(texture);
             return TextureID(static_cast<type>(nextHandle));
         }
@@ -84,6 +87,9 @@ namespace Renderer
 
             CreateTexture(device, texture, desc.data);
 
+            // TextureIDs index straight into the texture table
+            device->_textureTable.SetTexture(static_cast<u32>(nextHandle), texture.imageView);
+
             _textures.push_back(texture);
             return TextureID(static_cast<type>(nextHandle));
         }
@@ -104,20 +110,8 @@ namespace Renderer
 
         void TextureHandlerVK::CreateTexture(RenderDeviceVK* device, Texture& texture, u8* pixels)
         {
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
-
             VkDeviceSize imageSize = static_cast<i64>(texture.width) * static_cast<i64>(texture.height) * static_cast<i64>(texture.pixelSize);
 
-            device->CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-            void* data;
-            vkMapMemory(device->_device, stagingBufferMemory, 0, imageSize, 0, &data);
-            memcpy(data, pixels, static_cast<size_t>(imageSize));
-            vkUnmapMemory(device->_device, stagingBufferMemory);
-
-            stbi_image_free(pixels);
-
             VkImageCreateInfo imageInfo = {};
             imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
             imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -141,24 +135,12 @@ namespace Renderer
 
             DebugMarkerUtilVK::SetObjectName(device->_device, (u64)texture.image, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, texture.debugName.c_str());
 
-            VkMemoryRequirements memRequirements;
-            vkGetImageMemoryRequirements(device->_device, texture.image, &memRequirements);
-
-            VkMemoryAllocateInfo allocInfo = {};
-            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-            allocInfo.allocationSize = memRequirements.size;
-            allocInfo.memoryTypeIndex = device->FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-            if (vkAllocateMemory(device->_device, &allocInfo, nullptr, &texture.memory) != VK_SUCCESS)
-            {
-                NC_LOG_FATAL("Failed to allocate texture image memory!");
-            }
+            device->AllocateImageMemory(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.allocation);
 
-            vkBindImageMemory(device->_device, texture.image, texture.memory, 0);
+            // The pixels get copied into the staging ring right away, the upload itself is batched with the rest of the frame
+            device->_uploadHandler.UploadImage(texture.image, static_cast<u32>(texture.width), static_cast<u32>(texture.height), pixels, imageSize);
 
-            device->TransitionImageLayout(texture.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-            device->CopyBufferToImage(stagingBuffer, texture.image, static_cast<u32>(texture.width), static_cast<u32>(texture.height));
-            device->TransitionImageLayout(texture.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            stbi_image_free(pixels);
 
             VkImageViewCreateInfo viewInfo = {};
             viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
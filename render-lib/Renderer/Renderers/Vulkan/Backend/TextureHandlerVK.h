@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 
 #include "../../../Descriptors/TextureDesc.h"
+#include "MemoryAllocatorVK.h"
 
 namespace Renderer
 {
@@ -30,7 +31,7 @@ namespace Renderer
                 i32 pixelSize;
                 ImageFormat format;
 
-                VkDeviceMemory memory;
+                AllocationVK allocation;
                 VkImage image;
                 VkImageView imageView;
 
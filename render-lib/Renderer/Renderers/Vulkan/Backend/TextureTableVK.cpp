@@ -0,0 +1,127 @@
+#include "TextureTableVK.h"
+#include <Utils/DebugHandler.h>
+#include <cassert>
+
+#include "RenderDeviceVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        void TextureTableVK::Init(RenderDeviceVK* device)
+        {
+            _device = device;
+
+            VkDescriptorSetLayoutBinding layoutBindings[2] = {};
+            layoutBindings[TEXTURES_BINDING].binding = TEXTURES_BINDING;
+            layoutBindings[TEXTURES_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            layoutBindings[TEXTURES_BINDING].descriptorCount = MAX_TEXTURES;
+            layoutBindings[TEXTURES_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+            layoutBindings[SAMPLERS_BINDING].binding = SAMPLERS_BINDING;
+            layoutBindings[SAMPLERS_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            layoutBindings[SAMPLERS_BINDING].descriptorCount = MAX_SAMPLERS;
+            layoutBindings[SAMPLERS_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+            // Not every slot is filled, and new textures get written while earlier frames using the set are still in flight
+            VkDescriptorBindingFlagsEXT bindingFlags[2] =
+            {
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+            };
+
+            VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+            bindingFlagsInfo.bindingCount = 2;
+            bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.pNext = &bindingFlagsInfo;
+            layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+            layoutInfo.bindingCount = 2;
+            layoutInfo.pBindings = layoutBindings;
+
+            if (vkCreateDescriptorSetLayout(device->_device, &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create texture table descriptor set layout!");
+            }
+
+            VkDescriptorPoolSize poolSizes[2] = {};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            poolSizes[0].descriptorCount = MAX_TEXTURES;
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            poolSizes[1].descriptorCount = MAX_SAMPLERS;
+
+            VkDescriptorPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+            poolInfo.poolSizeCount = 2;
+            poolInfo.pPoolSizes = poolSizes;
+            poolInfo.maxSets = 1;
+
+            if (vkCreateDescriptorPool(device->_device, &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create texture table descriptor pool!");
+            }
+
+            VkDescriptorSetAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = _descriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &_descriptorSetLayout;
+
+            if (vkAllocateDescriptorSets(device->_device, &allocInfo, &_descriptorSet) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to allocate texture table descriptor set!");
+            }
+        }
+
+        void TextureTableVK::SetTexture(u32 index, VkImageView imageView)
+        {
+            if (index >= MAX_TEXTURES)
+            {
+                NC_LOG_FATAL("Texture table is full, increase MAX_TEXTURES!");
+            }
+
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = imageView;
+
+            VkWriteDescriptorSet descriptorWrite = {};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = _descriptorSet;
+            descriptorWrite.dstBinding = TEXTURES_BINDING;
+            descriptorWrite.dstArrayElement = index;
+            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &imageInfo;
+
+            std::scoped_lock lock(_mutex);
+            vkUpdateDescriptorSets(_device->_device, 1, &descriptorWrite, 0, nullptr);
+        }
+
+        void TextureTableVK::SetSampler(u32 index, VkSampler sampler)
+        {
+            if (index >= MAX_SAMPLERS)
+            {
+                NC_LOG_FATAL("Texture table is out of sampler slots, increase MAX_SAMPLERS!");
+            }
+
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.sampler = sampler;
+
+            VkWriteDescriptorSet descriptorWrite = {};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = _descriptorSet;
+            descriptorWrite.dstBinding = SAMPLERS_BINDING;
+            descriptorWrite.dstArrayElement = index;
+            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &imageInfo;
+
+            std::scoped_lock lock(_mutex);
+            vkUpdateDescriptorSets(_device->_device, 1, &descriptorWrite, 0, nullptr);
+        }
+    }
+}
\ No newline at end of file
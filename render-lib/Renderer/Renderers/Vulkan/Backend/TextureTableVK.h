@@ -0,0 +1,44 @@
+#pragma once
+#include <NovusTypes.h>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        class RenderDeviceVK;
+
+        // One global descriptor set holding every texture and sampler, TextureIDs and SamplerIDs are indices straight into it
+        // Shaders declare it as:
+        //     layout(set = X, binding = 0) uniform texture2D _textures[];
+        //     layout(set = X, binding = 1) uniform sampler _samplers[];
+        // and get the indices to use through push constants or instance data
+        class TextureTableVK
+        {
+        public:
+            void Init(RenderDeviceVK* device);
+
+            void SetTexture(u32 index, VkImageView imageView);
+            void SetSampler(u32 index, VkSampler sampler);
+
+            VkDescriptorSet GetDescriptorSet() { return _descriptorSet; }
+            VkDescriptorSetLayout GetDescriptorSetLayout() { return _descriptorSetLayout; }
+
+        public:
+            static const u32 TEXTURES_BINDING = 0;
+            static const u32 SAMPLERS_BINDING = 1;
+
+            static const u32 MAX_TEXTURES = 4096;
+            static const u32 MAX_SAMPLERS = 64;
+
+        private:
+            RenderDeviceVK* _device = nullptr;
+            std::mutex _mutex;
+
+            VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+            VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+            VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,477 @@
+#include "UploadHandlerVK.h"
+#include <Utils/DebugHandler.h>
+#include <cassert>
+#include <cstring>
+
+#include "RenderDeviceVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        void UploadHandlerVK::Init(RenderDeviceVK* device)
+        {
+            _device = device;
+
+            QueueFamilyIndices indices = device->FindQueueFamilies(device->_physicalDevice);
+            _graphicsQueue = device->_graphicsQueue;
+            _graphicsFamily = indices.graphicsFamily.value();
+
+            if (indices.transferFamily.has_value())
+            {
+                _transferQueue = device->_transferQueue;
+                _transferFamily = indices.transferFamily.value();
+            }
+
+            // -- Create command pools --
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            poolInfo.queueFamilyIndex = _graphicsFamily;
+
+            if (vkCreateCommandPool(device->_device, &poolInfo, nullptr, &_graphicsCommandPool) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to create upload command pool!");
+            }
+
+            if (HasDedicatedTransferQueue())
+            {
+                poolInfo.queueFamilyIndex = _transferFamily;
+
+                if (vkCreateCommandPool(device->_device, &poolInfo, nullptr, &_transferCommandPool) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create transfer command pool!");
+                }
+            }
+
+            // -- Create staging ring --
+            device->CreateBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _stagingBuffer, _stagingAllocation);
+        }
+
+        void UploadHandlerVK::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+        {
+            std::scoped_lock lock(_mutex);
+
+            VkBuffer stagingBuffer;
+            VkDeviceSize stagingOffset;
+            AllocateStaging(data, size, stagingBuffer, stagingOffset);
+
+            Batch* batch = GetCurrentBatch();
+
+            VkBufferCopy copyRegion = {};
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.dstOffset = dstOffset;
+            copyRegion.size = size;
+
+            if (HasDedicatedTransferQueue())
+            {
+                VkCommandBuffer transferCommandBuffer = GetTransferCommandBuffer(batch);
+                vkCmdCopyBuffer(transferCommandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+                // Release the buffer from the transfer queue family...
+                VkBufferMemoryBarrier bufferBarrier = {};
+                bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                bufferBarrier.dstAccessMask = 0;
+                bufferBarrier.srcQueueFamilyIndex = _transferFamily;
+                bufferBarrier.dstQueueFamilyIndex = _graphicsFamily;
+                bufferBarrier.buffer = dstBuffer;
+                bufferBarrier.offset = dstOffset;
+                bufferBarrier.size = size;
+
+                vkCmdPipelineBarrier(transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+                // ...and acquire it on the graphics queue family
+                bufferBarrier.srcAccessMask = 0;
+                bufferBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+                vkCmdPipelineBarrier(GetGraphicsCommandBuffer(batch), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+            }
+            else
+            {
+                vkCmdCopyBuffer(GetGraphicsCommandBuffer(batch), stagingBuffer, dstBuffer, 1, &copyRegion);
+                batch->hasGraphicsCopies = true;
+            }
+        }
+
+        void UploadHandlerVK::UpdateBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+        {
+            std::scoped_lock lock(_mutex);
+
+            VkBuffer stagingBuffer;
+            VkDeviceSize stagingOffset;
+            AllocateStaging(data, size, stagingBuffer, stagingOffset);
+
+            Batch* batch = GetCurrentBatch();
+            VkCommandBuffer commandBuffer = GetGraphicsCommandBuffer(batch);
+
+            // Previous frames might still read this buffer and earlier uploads in this batch might have written it, so wait for both before we overwrite it
+            VkMemoryBarrier memoryBarrier = {};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+            VkBufferCopy copyRegion = {};
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.dstOffset = dstOffset;
+            copyRegion.size = size;
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+            batch->hasGraphicsCopies = true;
+        }
+
+        void UploadHandlerVK::UploadImage(VkImage dstImage, u32 width, u32 height, const void* data, VkDeviceSize size)
+        {
+            std::scoped_lock lock(_mutex);
+
+            VkBuffer stagingBuffer;
+            VkDeviceSize stagingOffset;
+            AllocateStaging(data, size, stagingBuffer, stagingOffset);
+
+            Batch* batch = GetCurrentBatch();
+            VkCommandBuffer copyCommandBuffer = HasDedicatedTransferQueue() ? GetTransferCommandBuffer(batch) : GetGraphicsCommandBuffer(batch);
+
+            VkImageMemoryBarrier imageBarrier = {};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = dstImage;
+            imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = 1;
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = 1;
+
+            // Transition from UNDEFINED to TRANSFER_DST_OPTIMAL
+            imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            imageBarrier.srcAccessMask = 0;
+            imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(copyCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+            VkBufferImageCopy region = {};
+            region.bufferOffset = stagingOffset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = { 0, 0, 0 };
+            region.imageExtent = { width, height, 1 };
+
+            vkCmdCopyBufferToImage(copyCommandBuffer, stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            // Transition from TRANSFER_DST_OPTIMAL to SHADER_READ_ONLY_OPTIMAL
+            imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            if (HasDedicatedTransferQueue())
+            {
+                // The transition doubles as the queue family ownership transfer, it's released on the transfer queue...
+                imageBarrier.srcQueueFamilyIndex = _transferFamily;
+                imageBarrier.dstQueueFamilyIndex = _graphicsFamily;
+                imageBarrier.dstAccessMask = 0;
+
+                vkCmdPipelineBarrier(copyCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+                // ...and acquired on the graphics queue
+                imageBarrier.srcAccessMask = 0;
+                imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+                vkCmdPipelineBarrier(GetGraphicsCommandBuffer(batch), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+            }
+            else
+            {
+                vkCmdPipelineBarrier(copyCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+            }
+        }
+
+        u64 UploadHandlerVK::Flush()
+        {
+            std::scoped_lock lock(_mutex);
+
+            RetireCompletedBatches();
+
+            if (_currentBatch == nullptr)
+                return _lastSubmittedBatchID;
+
+            return SubmitCurrentBatch();
+        }
+
+        bool UploadHandlerVK::IsBatchComplete(u64 batchID)
+        {
+            std::scoped_lock lock(_mutex);
+
+            RetireCompletedBatches();
+            return batchID <= _lastCompletedBatchID;
+        }
+
+        void UploadHandlerVK::WaitForBatch(u64 batchID)
+        {
+            std::scoped_lock lock(_mutex);
+
+            // Batches finish in the order they were submitted, so retiring up until the one we want is enough
+            while (!_submittedBatches.empty() && _submittedBatches.front()->id <= batchID)
+            {
+                Batch* batch = _submittedBatches.front();
+                vkWaitForFences(_device->_device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+
+                _submittedBatches.pop_front();
+                RetireBatch(batch);
+            }
+        }
+
+        UploadHandlerVK::Batch* UploadHandlerVK::GetCurrentBatch()
+        {
+            if (_currentBatch != nullptr)
+                return _currentBatch;
+
+            if (!_freeBatches.empty())
+            {
+                _currentBatch = _freeBatches.back();
+                _freeBatches.pop_back();
+            }
+            else
+            {
+                // Create a new batch, we only need as many as there are batches in flight at once
+                Batch* batch = new Batch();
+
+                VkCommandBufferAllocateInfo allocInfo = {};
+                allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                allocInfo.commandBufferCount = 1;
+                allocInfo.commandPool = _graphicsCommandPool;
+
+                if (vkAllocateCommandBuffers(_device->_device, &allocInfo, &batch->graphicsCommandBuffer) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to allocate upload command buffer!");
+                }
+
+                if (HasDedicatedTransferQueue())
+                {
+                    allocInfo.commandPool = _transferCommandPool;
+
+                    if (vkAllocateCommandBuffers(_device->_device, &allocInfo, &batch->transferCommandBuffer) != VK_SUCCESS)
+                    {
+                        NC_LOG_FATAL("Failed to allocate transfer command buffer!");
+                    }
+
+                    VkSemaphoreCreateInfo semaphoreInfo = {};
+                    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+                    if (vkCreateSemaphore(_device->_device, &semaphoreInfo, nullptr, &batch->transferSemaphore) != VK_SUCCESS)
+                    {
+                        NC_LOG_FATAL("Failed to create transfer semaphore!");
+                    }
+                }
+
+                VkFenceCreateInfo fenceInfo = {};
+                fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+                if (vkCreateFence(_device->_device, &fenceInfo, nullptr, &batch->fence) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to create upload fence!");
+                }
+
+                _currentBatch = batch;
+            }
+
+            _currentBatch->id = _nextBatchID++;
+            return _currentBatch;
+        }
+
+        VkCommandBuffer UploadHandlerVK::GetTransferCommandBuffer(Batch* batch)
+        {
+            if (!batch->isRecordingTransfer)
+            {
+                VkCommandBufferBeginInfo beginInfo = {};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+                if (vkBeginCommandBuffer(batch->transferCommandBuffer, &beginInfo) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to begin recording transfer command buffer!");
+                }
+                batch->isRecordingTransfer = true;
+            }
+
+            return batch->transferCommandBuffer;
+        }
+
+        VkCommandBuffer UploadHandlerVK::GetGraphicsCommandBuffer(Batch* batch)
+        {
+            if (!batch->isRecordingGraphics)
+            {
+                VkCommandBufferBeginInfo beginInfo = {};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+                if (vkBeginCommandBuffer(batch->graphicsCommandBuffer, &beginInfo) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to begin recording upload command buffer!");
+                }
+                batch->isRecordingGraphics = true;
+            }
+
+            return batch->graphicsCommandBuffer;
+        }
+
+        void UploadHandlerVK::AllocateStaging(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset)
+        {
+            // Big uploads would eat most of the ring, so they get a staging buffer that lives as long as their batch
+            if (size > MAX_RING_UPLOAD_SIZE)
+            {
+                Batch* batch = GetCurrentBatch();
+
+                StagingBuffer stagingBuffer;
+                _device->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer.buffer, stagingBuffer.allocation, ALLOCATION_STRATEGY_LINEAR);
+                memcpy(stagingBuffer.allocation.mappedData, data, static_cast<size_t>(size));
+
+                batch->dedicatedStagingBuffers.push_back(stagingBuffer);
+
+                buffer = stagingBuffer.buffer;
+                offset = 0;
+                return;
+            }
+
+            u64 begin = (_stagingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+            // Allocations can't wrap around the end of the ring, skip ahead to the start instead
+            if ((begin % STAGING_RING_SIZE) + size > STAGING_RING_SIZE)
+            {
+                begin = (begin / STAGING_RING_SIZE + 1) * STAGING_RING_SIZE;
+            }
+            u64 end = begin + size;
+
+            // If the ring is full we need to wait until the GPU is done with the oldest batch
+            while (end - _stagingTail > STAGING_RING_SIZE)
+            {
+                if (_submittedBatches.empty())
+                {
+                    // The current batch is the one holding on to the memory, so submit it first
+                    SubmitCurrentBatch();
+                }
+
+                Batch* oldestBatch = _submittedBatches.front();
+                vkWaitForFences(_device->_device, 1, &oldestBatch->fence, VK_TRUE, UINT64_MAX);
+
+                _submittedBatches.pop_front();
+                RetireBatch(oldestBatch);
+            }
+
+            _stagingHead = end;
+
+            offset = begin % STAGING_RING_SIZE;
+            buffer = _stagingBuffer;
+            memcpy(static_cast<u8*>(_stagingAllocation.mappedData) + offset, data, static_cast<size_t>(size));
+        }
+
+        u64 UploadHandlerVK::SubmitCurrentBatch()
+        {
+            Batch* batch = _currentBatch;
+            assert(batch != nullptr);
+            _currentBatch = nullptr;
+
+            batch->stagingEnd = _stagingHead;
+
+            if (batch->isRecordingTransfer)
+            {
+                vkEndCommandBuffer(batch->transferCommandBuffer);
+
+                VkSubmitInfo submitInfo = {};
+                submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                submitInfo.commandBufferCount = 1;
+                submitInfo.pCommandBuffers = &batch->transferCommandBuffer;
+                submitInfo.signalSemaphoreCount = 1;
+                submitInfo.pSignalSemaphores = &batch->transferSemaphore;
+
+                if (vkQueueSubmit(_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+                {
+                    NC_LOG_FATAL("Failed to submit transfer command buffer!");
+                }
+            }
+
+            // Make the copies visible to everything that gets submitted after this
+            VkCommandBuffer graphicsCommandBuffer = GetGraphicsCommandBuffer(batch);
+            if (batch->hasGraphicsCopies)
+            {
+                VkMemoryBarrier memoryBarrier = {};
+                memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+                vkCmdPipelineBarrier(graphicsCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+            }
+            vkEndCommandBuffer(graphicsCommandBuffer);
+
+            // The graphics submission is always there since it acquires the resources and signals the fence of the batch
+            VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+            VkSubmitInfo submitInfo = {};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &graphicsCommandBuffer;
+
+            if (batch->isRecordingTransfer)
+            {
+                submitInfo.waitSemaphoreCount = 1;
+                submitInfo.pWaitSemaphores = &batch->transferSemaphore;
+                submitInfo.pWaitDstStageMask = &waitStage;
+            }
+
+            if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, batch->fence) != VK_SUCCESS)
+            {
+                NC_LOG_FATAL("Failed to submit upload command buffer!");
+            }
+
+            _submittedBatches.push_back(batch);
+            _lastSubmittedBatchID = batch->id;
+
+            return batch->id;
+        }
+
+        void UploadHandlerVK::RetireCompletedBatches()
+        {
+            while (!_submittedBatches.empty())
+            {
+                Batch* batch = _submittedBatches.front();
+                if (vkGetFenceStatus(_device->_device, batch->fence) != VK_SUCCESS)
+                    break;
+
+                _submittedBatches.pop_front();
+                RetireBatch(batch);
+            }
+        }
+
+        void UploadHandlerVK::RetireBatch(Batch* batch)
+        {
+            _stagingTail = batch->stagingEnd;
+            _lastCompletedBatchID = batch->id;
+
+            for (StagingBuffer& stagingBuffer : batch->dedicatedStagingBuffers)
+            {
+                _device->DestroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+            }
+            batch->dedicatedStagingBuffers.clear();
+
+            vkResetFences(_device->_device, 1, &batch->fence);
+            vkResetCommandBuffer(batch->graphicsCommandBuffer, 0);
+            if (batch->isRecordingTransfer)
+            {
+                vkResetCommandBuffer(batch->transferCommandBuffer, 0);
+            }
+
+            batch->isRecordingTransfer = false;
+            batch->isRecordingGraphics = false;
+            batch->hasGraphicsCopies = false;
+
+            _freeBatches.push_back(batch);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocatorVK.h"
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        class RenderDeviceVK;
+
+        // Stages uploads through a persistently mapped ring buffer and batches everything recorded between two flushes into one submission
+        // If the device has a dedicated transfer queue, uploads into new resources run on it and get handed over to the graphics queue
+        class UploadHandlerVK
+        {
+        public:
+            void Init(RenderDeviceVK* device);
+
+            // Uploads into a buffer that the GPU hasn't used yet
+            void UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+            // Uploads into a buffer that frames in flight might still be reading, this is ordered after them on the graphics queue
+            void UpdateBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+            // Uploads the first mip of an image that the GPU hasn't used yet, leaving it in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            void UploadImage(VkImage dstImage, u32 width, u32 height, const void* data, VkDeviceSize size);
+
+            // Submits all uploads recorded since the last flush, this needs to happen before any work using them gets submitted
+            // Returns the ID of the submitted batch, or the last submitted one if there was nothing to flush
+            u64 Flush();
+
+            bool IsBatchComplete(u64 batchID);
+            void WaitForBatch(u64 batchID);
+
+            bool HasDedicatedTransferQueue() { return _transferQueue != VK_NULL_HANDLE; }
+
+        public:
+            static const VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024; // 64 MB
+            static const VkDeviceSize MAX_RING_UPLOAD_SIZE = STAGING_RING_SIZE / 4; // Bigger uploads get a staging buffer of their own
+            static const VkDeviceSize STAGING_ALIGNMENT = 16; // Buffer to image copies need offsets aligned to the texel size
+
+        private:
+            struct StagingBuffer
+            {
+                VkBuffer buffer = VK_NULL_HANDLE;
+                AllocationVK allocation;
+            };
+
+            struct Batch
+            {
+                u64 id = 0;
+
+                VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE; // Only used with a dedicated transfer queue
+                VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+                bool isRecordingTransfer = false;
+                bool isRecordingGraphics = false;
+                bool hasGraphicsCopies = false;
+
+                VkSemaphore transferSemaphore = VK_NULL_HANDLE; // Signaled by the transfer submission, waited on by the graphics submission
+                VkFence fence = VK_NULL_HANDLE; // Signaled once the whole batch is done
+
+                u64 stagingEnd = 0; // The staging ring can be reused up until here once the batch is done
+                std::vector<StagingBuffer> dedicatedStagingBuffers;
+            };
+
+        private:
+            Batch* GetCurrentBatch();
+            VkCommandBuffer GetTransferCommandBuffer(Batch* batch);
+            VkCommandBuffer GetGraphicsCommandBuffer(Batch* batch);
+
+            void AllocateStaging(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+
+            u64 SubmitCurrentBatch();
+            void RetireCompletedBatches();
+            void RetireBatch(Batch* batch);
+
+        private:
+            RenderDeviceVK* _device = nullptr;
+            std::mutex _mutex;
+
+            VkQueue _graphicsQueue = VK_NULL_HANDLE;
+            VkQueue _transferQueue = VK_NULL_HANDLE;
+            u32 _graphicsFamily = 0;
+            u32 _transferFamily = 0;
+
+            VkCommandPool _graphicsCommandPool = VK_NULL_HANDLE;
+            VkCommandPool _transferCommandPool = VK_NULL_HANDLE;
+
+            // The ring positions only ever grow, the position in the buffer is them modulo STAGING_RING_SIZE
+            VkBuffer _stagingBuffer = VK_NULL_HANDLE;
+            AllocationVK _stagingAllocation;
+            u64 _stagingHead = 0;
+            u64 _stagingTail = 0;
+
+            Batch* _currentBatch = nullptr;
+            std::deque<Batch*> _submittedBatches;
+            std::vector<Batch*> _freeBatches;
+
+            u64 _nextBatchID = 1;
+            u64 _lastSubmittedBatchID = 0;
+            u64 _lastCompletedBatchID = 0;
+        };
+    }
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "RendererVK.h"
+#include "../../BackendDispatch.h"
 #include "../../../Window/Window.h"
 #include <Utils/StringUtils.h>
 #include <Utils/DebugHandler.h>
@@ -12,13 +13,18 @@
 #include "Backend/PipelineHandlerVK.h"
 #include "Backend/CommandListHandlerVK.h"
 #include "Backend/SamplerHandlerVK.h"
+#include "Backend/BufferHandlerVK.h"
 #include "Backend/SwapChainVK.h"
 #include "Backend/DebugMarkerUtilVK.h"
 #include "Backend/ConstantBufferVK.h"
+#include "Backend/BarrierUtilVK.h"
+#include <taskflow/taskflow.hpp>
 
 namespace Renderer
 {
-    RendererVK::RendererVK()
+    const u32 PIPELINE_CACHE_SAVE_INTERVAL = 1800; // In frames, saving does nothing if no new pipelines got compiled since the last time
+
+    RendererVK::RendererVK(tf::Taskflow* taskflow)
         : _device(new Backend::RenderDeviceVK())
     {
         _device->Init();
@@ -28,7 +34,10 @@ namespace Renderer
         _shaderHandler = new Backend::ShaderHandlerVK();
         _pipelineHandler = new Backend::PipelineHandlerVK();
         _commandListHandler = new Backend::CommandListHandlerVK();
+        _commandListHandler->Init(_device);
         _samplerHandler = new Backend::SamplerHandlerVK();
+        _bufferHandler = new Backend::BufferHandlerVK();
+        _pipelineTaskflow = new tf::Taskflow(taskflow->share_executor()); // Its own taskflow so WaitForPipelines only waits for pipelines
     }
 
     void RendererVK::InitWindow(Window* window)
@@ -38,9 +47,12 @@ namespace Renderer
 
     void RendererVK::Deinit()
     {
+        WaitForPipelines(); // Make sure no pipeline is still compiling
         _device->FlushGPU(); // Make sure it has finished rendering
 
-        delete(_device);
+        _bufferHandler->Deinit(_device);
+        _commandListHandler->Deinit(_device);
+
         delete(_imageHandler);
         delete(_textureHandler);
         delete(_modelHandler);
@@ -48,6 +60,11 @@ namespace Renderer
         delete(_pipelineHandler);
         delete(_commandListHandler);
         delete(_samplerHandler);
+        delete(_bufferHandler);
+        delete(_pipelineTaskflow);
+
+        // The handlers have released their allocations by now, the device frees the memory blocks they lived in
+        delete(_device);
     }
 
     ImageID RendererVK::CreateImage(ImageDesc& desc)
@@ -67,13 +84,78 @@ namespace Renderer
 
     GraphicsPipelineID RendererVK::CreatePipeline(GraphicsPipelineDesc& desc)
     {
+        if (_asyncPipelineCompilation)
+        {
+            return QueuePipelineCompile(desc);
+        }
+
         return _pipelineHandler->CreatePipeline(_device, _shaderHandler, _imageHandler, desc);
     }
 
-    ComputePipelineID RendererVK::CreatePipeline(ComputePipelineDesc& /*desc*/)
+    void RendererVK::WaitForPipelines()
+    {
+        std::scoped_lock lock(_pipelineTaskflowMutex);
+        _pipelineTaskflow->wait_for_all();
+    }
+
+    void RendererVK::LogMemoryStats()
+    {
+        _device->_memoryAllocator.LogStats();
+    }
+
+    GraphicsPipelineID RendererVK::QueuePipelineCompile(GraphicsPipelineDesc& desc)
+    {
+        bool needsCompile;
+        GraphicsPipelineID pipelineID = _pipelineHandler->ReservePipeline(desc, needsCompile);
+
+        if (needsCompile)
+        {
+            // Passes can be recorded in parallel, so CreatePipeline might get here from several threads at once
+            std::scoped_lock lock(_pipelineTaskflowMutex);
+            _pipelineTaskflow->emplace([this, pipelineID]()
+            {
+                _pipelineHandler->CompilePipeline(_device, _shaderHandler, _imageHandler, pipelineID);
+            });
+            _pipelineTaskflow->dispatch();
+        }
+
+        return pipelineID;
+    }
+
+    ImageID RendererVK::CreateTransientImage(ImageDesc& desc)
+    {
+        return _imageHandler->CreateTransientImage(_device, desc);
+    }
+
+    DepthImageID RendererVK::CreateTransientDepthImage(DepthImageDesc& desc)
+    {
+        return _imageHandler->CreateTransientDepthImage(_device, desc);
+    }
+
+    void RendererVK::AllocateTransientImages(const TransientImageLifetime* lifetimes, u32 numLifetimes)
+    {
+        // The placement only changes when the RenderGraph does, so this is rare enough that we can afford to stall
+        if (_imageHandler->PlaceTransientImages(_device, lifetimes, numLifetimes))
+        {
+            WaitForPipelines();
+            _device->FlushGPU();
+
+            _imageHandler->ApplyTransientPlacement(_device);
+            _pipelineHandler->DestroyFramebuffers(_device);
+        }
+
+        _imageHandler->ReleaseTransientImages();
+    }
+
+    void RendererVK::ReleaseTransientImages()
+    {
+        _imageHandler->ReleaseTransientImages();
+    }
+
+    ComputePipelineID RendererVK::CreatePipeline(ComputePipelineDesc& desc)
     {
-        NC_LOG_FATAL("Not supported yet");
-        return ComputePipelineID::Invalid();
+        // Compute pipelines are a single small stage, so they always compile right away
+        return _pipelineHandler->CreatePipeline(_device, _shaderHandler, _imageHandler, desc);
     }
 
     ModelID RendererVK::CreatePrimitiveModel(PrimitiveModelDesc& desc)
@@ -86,11 +168,41 @@ namespace Renderer
         _modelHandler->UpdatePrimitiveModel(_device, model, desc);
     }
 
+    const AABB& RendererVK::GetModelBounds(ModelID model)
+    {
+        return _modelHandler->GetBounds(model);
+    }
+
+    u32 RendererVK::GetModelNumLODs(ModelID model)
+    {
+        return _modelHandler->GetNumLODs(model);
+    }
+
+    const ModelLOD& RendererVK::GetModelLOD(ModelID model, u32 lod)
+    {
+        return _modelHandler->GetLOD(model, lod);
+    }
+
+    u32 RendererVK::GetModelGeometryBlock(ModelID model)
+    {
+        return _modelHandler->GetGeometryBlock(model);
+    }
+
     TextureID RendererVK::CreateDataTexture(DataTextureDesc& desc)
     {
         return _textureHandler->CreateDataTexture(_device, desc);
     }
 
+    BufferID RendererVK::CreateBuffer(BufferDesc& desc)
+    {
+        return _bufferHandler->CreateBuffer(_device, desc);
+    }
+
+    void RendererVK::UpdateBuffer(BufferID buffer, const void* data, size_t offset, size_t size)
+    {
+        _bufferHandler->UpdateBuffer(_device, buffer, data, offset, size);
+    }
+
     ModelID RendererVK::LoadModel(ModelDesc& desc)
     {
         return _modelHandler->LoadModel(_device, desc);
@@ -123,14 +235,33 @@ namespace Renderer
 
     void RendererVK::EndCommandList(CommandListID commandListID)
     {
-        if (_renderPassOpenCount != 0)
+        if (_commandListHandler->GetRenderPassOpenCount(commandListID) != 0)
         {
             NC_LOG_FATAL("We found unmatched calls to BeginPipeline in your commandlist, for every BeginPipeline you need to also EndPipeline!");
         }
+        EndRenderPass(commandListID);
+        FlushPendingClears(commandListID);
+        CountBinds(commandListID);
 
         _commandListHandler->EndCommandList(_device, commandListID);
     }
 
+    void RendererVK::EndCommandLists(CommandListID* commandListIDs, u32 numCommandLists)
+    {
+        for (u32 i = 0; i < numCommandLists; i++)
+        {
+            if (_commandListHandler->GetRenderPassOpenCount(commandListIDs[i]) != 0)
+            {
+                NC_LOG_FATAL("We found unmatched calls to BeginPipeline in your commandlist, for every BeginPipeline you need to also EndPipeline!");
+            }
+            EndRenderPass(commandListIDs[i]);
+            FlushPendingClears(commandListIDs[i]);
+            CountBinds(commandListIDs[i]);
+        }
+
+        _commandListHandler->EndCommandLists(_device, commandListIDs, numCommandLists);
+    }
+
     void RendererVK::Clear(CommandListID commandListID, ImageID imageID, Color color)
     {
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
@@ -149,36 +280,118 @@ namespace Renderer
         ImageSubresourceRange.baseArrayLayer = 0;
         ImageSubresourceRange.layerCount = 1;
 
-        // Transition image to TRANSFER_DST_OPTIMAL
-        _device->TransitionImageLayout(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        // The pass has to write the image as a rendertarget, so the RenderGraph already put it in that state
+        ImageBarrier barrier;
+        barrier.image = imageID;
+        barrier.before = RESOURCE_STATE_RENDER_TARGET;
+        barrier.after = RESOURCE_STATE_TRANSFER_DST;
+        ImageBarriers(commandListID, &barrier, 1);
 
         vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColorValue, 1, &ImageSubresourceRange);
 
-        // Transition image back to GENERAL
-        _device->TransitionImageLayout(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+        barrier.before = RESOURCE_STATE_TRANSFER_DST;
+        barrier.after = RESOURCE_STATE_RENDER_TARGET;
+        ImageBarriers(commandListID, &barrier, 1);
     }
 
-    void RendererVK::Clear(CommandListID /*commandListID*/, DepthImageID /*imageID*/, DepthClearFlags /*clearFlags*/, f32 /*depth*/, u8 /*stencil*/)
+    void RendererVK::Clear(CommandListID commandListID, DepthImageID imageID, DepthClearFlags clearFlags, f32 depth, u8 stencil)
     {
-        
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        VkImage image = _imageHandler->GetImage(imageID);
+
+        VkClearDepthStencilValue clearDepthValue = {};
+        clearDepthValue.depth = depth;
+        clearDepthValue.stencil = stencil;
+
+        VkImageAspectFlags aspectMask = Backend::BarrierUtilVK::GetAspectMask(_imageHandler->GetDescriptor(imageID).format);
+        if (clearFlags == DepthClearFlags::DEPTH_CLEAR_DEPTH)
+        {
+            aspectMask &= VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+        else if (clearFlags == DepthClearFlags::DEPTH_CLEAR_STENCIL)
+        {
+            aspectMask &= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
+
+        VkImageSubresourceRange ImageSubresourceRange;
+        ImageSubresourceRange.aspectMask = aspectMask;
+        ImageSubresourceRange.baseMipLevel = 0;
+        ImageSubresourceRange.levelCount = 1;
+        ImageSubresourceRange.baseArrayLayer = 0;
+        ImageSubresourceRange.layerCount = 1;
+
+        // The pass has to write the image as a depthstencil, so the RenderGraph already put it in that state
+        ImageBarrier barrier;
+        barrier.depthImage = imageID;
+        barrier.before = RESOURCE_STATE_DEPTH_WRITE;
+        barrier.after = RESOURCE_STATE_TRANSFER_DST;
+        ImageBarriers(commandListID, &barrier, 1);
+
+        vkCmdClearDepthStencilImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearDepthValue, 1, &ImageSubresourceRange);
+
+        barrier.before = RESOURCE_STATE_TRANSFER_DST;
+        barrier.after = RESOURCE_STATE_DEPTH_WRITE;
+        ImageBarriers(commandListID, &barrier, 1);
     }
 
     void RendererVK::Draw(CommandListID commandListID, ModelID modelID)
     {
+        // The pipeline is still compiling, skip the draw instead of stalling on it
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            _numSkippedDraws++;
+            return;
+        }
+
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        BindModelBuffers(commandListID, modelID);
 
-        // Bind vertex buffer
-        VkBuffer vertexBuffer = _modelHandler->GetVertexBuffer(modelID);
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, offsets);
+        // Draw, always with full detail
+        const ModelLOD& modelLOD = _modelHandler->GetLOD(modelID, 0);
+        vkCmdDrawIndexed(commandBuffer, modelLOD.numIndices, 1, modelLOD.firstIndex, modelLOD.vertexOffset, 0);
+    }
 
-        // Bind index buffer
-        VkBuffer indexBuffer = _modelHandler->GetIndexBuffer(modelID);
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+    void RendererVK::DrawInstanced(CommandListID commandListID, ModelID modelID, u32 lod, u32 numInstances, u32 firstInstance)
+    {
+        // The pipeline is still compiling, skip the draw instead of stalling on it
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            _numSkippedDraws++;
+            return;
+        }
+
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        BindModelBuffers(commandListID, modelID);
+
+        // Draw, the per instance data gets fetched in the shader using gl_InstanceIndex
+        const ModelLOD& modelLOD = _modelHandler->GetLOD(modelID, lod);
+        vkCmdDrawIndexed(commandBuffer, modelLOD.numIndices, numInstances, modelLOD.firstIndex, modelLOD.vertexOffset, firstInstance);
+    }
+
+    void RendererVK::DrawInstancedIndirect(CommandListID commandListID, ModelID modelID, BufferID argumentBufferID, u32 argumentOffset, u32 drawCount)
+    {
+        // The pipeline is still compiling, skip the draw instead of stalling on it
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            _numSkippedDraws++;
+            return;
+        }
 
-        // Draw
-        u32 numIndices = _modelHandler->GetNumIndices(modelID);
-        vkCmdDrawIndexed(commandBuffer, numIndices, 1, 0, 0, 0);
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        BindModelBuffers(commandListID, modelID);
+
+        // Whatever wrote the arguments decides how many indices and instances get drawn, and from which models of the geometry block
+        VkBuffer argumentBuffer = _bufferHandler->GetBuffer(_device, argumentBufferID);
+        vkCmdDrawIndexedIndirect(commandBuffer, argumentBuffer, argumentOffset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    void RendererVK::Dispatch(CommandListID commandListID, u32 threadGroupCountX, u32 threadGroupCountY, u32 threadGroupCountZ)
+    {
+        // Lets make sure a compute pipeline is bound
+        assert(_commandListHandler->GetBoundState(commandListID).bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE);
+
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        vkCmdDispatch(commandBuffer, threadGroupCountX, threadGroupCountY, threadGroupCountZ);
     }
 
     void RendererVK::PopMarker(CommandListID commandListID)
@@ -193,143 +406,499 @@ namespace Renderer
         Backend::DebugMarkerUtilVK::PushMarker(commandBuffer, color, name);
     }
 
-    void RendererVK::SetConstantBuffer(CommandListID commandListID, u32 slot, void* gpuResource)
+    void RendererVK::SetConstantBuffer(CommandListID commandListID, u32 slot, void* /*gpuResource*/, u32 offset)
+    {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
+        // All constant buffers live in the ring of the current frame, so binding one is just a dynamic offset into the same descriptor set
+        VkDescriptorSet descriptorSet = _device->_constantBufferRing.GetDescriptorSet(_device->GetFrameIndex());
+        BindDescriptorSet(commandListID, slot, descriptorSet, &offset);
+    }
+
+    void RendererVK::SetStorageBuffer(CommandListID commandListID, u32 slot, BufferID bufferID)
+    {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
+        VkDescriptorSetLayout descriptorSetLayout = GetBoundDescriptorSetLayout(commandListID, slot);
+        VkDescriptorSet descriptorSet = _bufferHandler->GetDescriptorSet(_device, bufferID, descriptorSetLayout);
+
+        // Bind descriptor set
+        BindDescriptorSet(commandListID, slot, descriptorSet, nullptr);
+    }
+
+    void RendererVK::SetStorageImage(CommandListID commandListID, u32 slot, ImageID imageID, u32 mipLevel)
+    {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
+        VkDescriptorSetLayout descriptorSetLayout = GetBoundDescriptorSetLayout(commandListID, slot);
+        VkDescriptorSet descriptorSet = _imageHandler->GetStorageDescriptorSet(_device, imageID, mipLevel, descriptorSetLayout);
+
+        BindDescriptorSet(commandListID, slot, descriptorSet, nullptr);
+    }
+
+    void RendererVK::SetSampledImage(CommandListID commandListID, u32 slot, ImageID imageID)
+    {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
+        VkDescriptorSetLayout descriptorSetLayout = GetBoundDescriptorSetLayout(commandListID, slot);
+        VkDescriptorSet descriptorSet = _imageHandler->GetSampledDescriptorSet(_device, imageID, descriptorSetLayout);
+
+        BindDescriptorSet(commandListID, slot, descriptorSet, nullptr);
+    }
+
+    void RendererVK::SetSampledImage(CommandListID commandListID, u32 slot, DepthImageID imageID)
+    {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
+        VkDescriptorSetLayout descriptorSetLayout = GetBoundDescriptorSetLayout(commandListID, slot);
+        VkDescriptorSet descriptorSet = _imageHandler->GetSampledDescriptorSet(_device, imageID, descriptorSetLayout);
+
+        BindDescriptorSet(commandListID, slot, descriptorSet, nullptr);
+    }
+
+    void RendererVK::BeginPipeline(CommandListID commandListID, GraphicsPipelineID pipelineID)
     {
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
-        GraphicsPipelineID graphicsPipelineID = _commandListHandler->GetBoundGraphicsPipeline(commandListID);
 
-        Backend::DescriptorSetLayoutData& descriptorSetLayoutData = _pipelineHandler->GetDescriptorSetLayoutData(graphicsPipelineID, slot);
-        VkDescriptorSetLayout& descriptorSetLayout = _pipelineHandler->GetDescriptorSetLayout(graphicsPipelineID, slot);
-        VkPipelineLayout pipelineLayout = _pipelineHandler->GetPipelineLayout(graphicsPipelineID);
+        i8& renderPassOpenCount = _commandListHandler->GetRenderPassOpenCount(commandListID);
+        if (renderPassOpenCount != 0)
+        {
+            NC_LOG_FATAL("You need to match your BeginPipeline calls with a EndPipeline call before beginning another pipeline!");
+        }
+        renderPassOpenCount++;
 
-        Backend::ConstantBufferBackendVK* constantBuffer = static_cast<Backend::ConstantBufferBackendVK*>(gpuResource);
+        // If the pipeline is still compiling on a worker we skip everything until the matching EndPipeline
+        if (!_pipelineHandler->IsReady(pipelineID))
+        {
+            _commandListHandler->SetSkipPipeline(commandListID, true);
+            return;
+        }
+
+        VkPipeline pipeline = _pipelineHandler->GetPipeline(pipelineID);
+        VkFramebuffer frameBuffer = _pipelineHandler->GetFramebuffer(_device, _imageHandler, pipelineID);
+        const GraphicsPipelineDesc& pipelineDesc = _pipelineHandler->GetDescriptor(pipelineID);
 
-        if (constantBuffer->descriptorPool == NULL)
+        // Pipelines rendering to the same attachments keep using the render pass the previous one left open
+        if (_commandListHandler->GetOpenFramebuffer(commandListID) != frameBuffer)
         {
-            VkDescriptorPoolSize poolSize = {};
-            poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            poolSize.descriptorCount = 1;
+            EndRenderPass(commandListID);
 
-            VkDescriptorPoolCreateInfo poolInfo = {};
-            poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-            poolInfo.poolSizeCount = 1;
-            poolInfo.pPoolSizes = &poolSize;
-            poolInfo.maxSets = Backend::ConstantBufferBackendVK::FRAME_BUFFER_COUNT;
+            // The first render pass on an attachment uses the ops the pass asked for, the ones after it load and store
+            VkAttachmentLoadOp loadOps[MAX_RENDER_TARGETS + 1];
+            VkAttachmentStoreOp storeOps[MAX_RENDER_TARGETS + 1];
+            VkClearValue clearValues[MAX_RENDER_TARGETS + 1] = {};
+            u32 numAttachments = 0;
 
-            if (vkCreateDescriptorPool(_device->_device, &poolInfo, nullptr, &constantBuffer->descriptorPool) != VK_SUCCESS)
+            for (u32 i = 0; i < MAX_RENDER_TARGETS; i++)
             {
-                NC_LOG_FATAL("Failed to create descriptor pool!");
+                ImageID imageID = _pipelineHandler->GetRenderTarget(pipelineID, i);
+                if (imageID == ImageID::Invalid())
+                    break;
+
+                AttachmentOps ops;
+                _commandListHandler->ConsumePendingAttachmentOps(commandListID, imageID, DepthImageID::Invalid(), ops);
+
+                const Color& clearColor = _imageHandler->GetDescriptor(imageID).clearColor;
+                clearValues[numAttachments].color = { clearColor.r, clearColor.g, clearColor.b, clearColor.a };
+                loadOps[numAttachments] = Backend::BarrierUtilVK::GetLoadOp(ops.loadOp);
+                storeOps[numAttachments] = ops.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                numAttachments++;
             }
 
-            VkDescriptorSetAllocateInfo allocInfo = {};
-            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-            allocInfo.descriptorPool = constantBuffer->descriptorPool;
-            allocInfo.descriptorSetCount = 1;
-            allocInfo.pSetLayouts = &descriptorSetLayout;
+            DepthImageID depthImageID = _pipelineHandler->GetDepthStencil(pipelineID);
+            if (depthImageID != DepthImageID::Invalid())
+            {
+                AttachmentOps ops;
+                _commandListHandler->ConsumePendingAttachmentOps(commandListID, ImageID::Invalid(), depthImageID, ops);
+
+                const DepthImageDesc& depthImageDesc = _imageHandler->GetDescriptor(depthImageID);
+                clearValues[numAttachments].depthStencil = { depthImageDesc.depthClearValue, depthImageDesc.stencilClearValue };
+                loadOps[numAttachments] = Backend::BarrierUtilVK::GetLoadOp(ops.loadOp);
+                storeOps[numAttachments] = ops.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                numAttachments++;
+            }
+
+            VkRenderPass renderPass = _pipelineHandler->GetRenderPass(_device, _imageHandler, pipelineID, loadOps, storeOps);
+
+            // Set up renderpass
+            VkRenderPassBeginInfo renderPassInfo = {};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass;
+            renderPassInfo.framebuffer = frameBuffer;
+            renderPassInfo.renderArea.offset = { 0, 0 };
+            renderPassInfo.renderArea.extent = { static_cast<u32>(pipelineDesc.states.viewport.width), static_cast<u32>(pipelineDesc.states.viewport.height) };
+            renderPassInfo.clearValueCount = numAttachments;
+            renderPassInfo.pClearValues = clearValues;
+
+            // Start renderpass
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            _commandListHandler->SetOpenFramebuffer(commandListID, frameBuffer);
+        }
+
+        // Bind pipeline
+        BindPipeline(commandListID, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline, _pipelineHandler->GetPipelineLayout(pipelineID));
+        _commandListHandler->SetBoundGraphicsPipeline(commandListID, pipelineID);
+
+        // Viewport and scissor are dynamic state, they start out as what the pipeline was created with
+        SetViewport(commandListID, pipelineDesc.states.viewport);
+        SetScissorRect(commandListID, pipelineDesc.states.scissorRect);
+
+        // Bind the texture table if the pipeline samples any textures
+        i32 textureTableSet = _pipelineHandler->GetTextureTableSet(pipelineID);
+        if (textureTableSet >= 0)
+        {
+            BindDescriptorSet(commandListID, static_cast<u32>(textureTableSet), _device->_textureTable.GetDescriptorSet(), nullptr);
+        }
+    }
+
+    void RendererVK::EndPipeline(CommandListID commandListID, GraphicsPipelineID /*pipelineID*/)
+    {
+        i8& renderPassOpenCount = _commandListHandler->GetRenderPassOpenCount(commandListID);
+        if (renderPassOpenCount <= 0)
+        {
+            NC_LOG_FATAL("You tried to call EndPipeline without first calling BeginPipeline!");
+        }
+        renderPassOpenCount--;
+
+        // The render pass stays open until something needs it closed, see EndRenderPass
+        _commandListHandler->SetSkipPipeline(commandListID, false);
+    }
+
+    void RendererVK::EndRenderPass(CommandListID commandListID)
+    {
+        if (_commandListHandler->GetOpenFramebuffer(commandListID) == VK_NULL_HANDLE)
+            return;
+
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        vkCmdEndRenderPass(commandBuffer);
+
+        _commandListHandler->SetOpenFramebuffer(commandListID, VK_NULL_HANDLE);
+    }
+
+    void RendererVK::FlushPendingClears(CommandListID commandListID)
+    {
+        std::vector<AttachmentOps> pendingOps;
+        _commandListHandler->TakePendingAttachmentOps(commandListID, pendingOps);
 
-            for (int i = 0; i < Backend::ConstantBufferBackendVK::FRAME_BUFFER_COUNT; i++)
+        for (AttachmentOps& ops : pendingOps)
+        {
+            if (ops.loadOp != ATTACHMENT_LOAD_OP_CLEAR)
+                continue;
+
+            if (ops.image != ImageID::Invalid())
             {
-                if (vkAllocateDescriptorSets(_device->_device, &allocInfo, &constantBuffer->descriptorSet[i]) != VK_SUCCESS)
-                {
-                    NC_LOG_FATAL("Failed to allocate descriptor sets!");
-                }
-
-                VkDescriptorBufferInfo descriptorBufferInfo = {};
-                descriptorBufferInfo.buffer = constantBuffer->uniformBuffers[i];
-                descriptorBufferInfo.offset = 0;
-                descriptorBufferInfo.range = constantBuffer->bufferSize;
-
-                VkWriteDescriptorSet descriptorWrite = {};
-                descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                descriptorWrite.dstSet = constantBuffer->descriptorSet[i];
-                descriptorWrite.dstBinding = 0;
-                descriptorWrite.dstArrayElement = 0;
-                descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-                descriptorWrite.descriptorCount = 1;
-                descriptorWrite.pBufferInfo = &descriptorBufferInfo;
-                descriptorWrite.pImageInfo = nullptr;
-                descriptorWrite.pTexelBufferView = nullptr;
-
-                vkUpdateDescriptorSets(_device->_device, 1, &descriptorWrite, 0, nullptr);
+                Clear(commandListID, ops.image, _imageHandler->GetDescriptor(ops.image).clearColor);
+            }
+            else
+            {
+                const DepthImageDesc& depthImageDesc = _imageHandler->GetDescriptor(ops.depthImage);
+                Clear(commandListID, ops.depthImage, DepthClearFlags::DEPTH_CLEAR_BOTH, depthImageDesc.depthClearValue, depthImageDesc.stencilClearValue);
             }
         }
+    }
 
-        // Bind descriptor set
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, slot, 1, &constantBuffer->descriptorSet[constantBuffer->useIndex], 0, nullptr);
-        // Flip useIndex between 0 and 1
-        constantBuffer->useIndex = !constantBuffer->useIndex;
+    void RendererVK::SetPipeline(CommandListID commandListID, ComputePipelineID pipelineID)
+    {
+        if (_commandListHandler->GetRenderPassOpenCount(commandListID) != 0)
+        {
+            NC_LOG_FATAL("You can't set a compute pipeline between BeginPipeline and EndPipeline!");
+        }
+
+        // Dispatches can't happen inside a render pass
+        EndRenderPass(commandListID);
+
+        BindPipeline(commandListID, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineHandler->GetPipeline(pipelineID), _pipelineHandler->GetPipelineLayout(pipelineID));
+        _commandListHandler->SetBoundComputePipeline(commandListID, pipelineID);
+
+        // Bind the texture table if the pipeline samples any textures
+        i32 textureTableSet = _pipelineHandler->GetTextureTableSet(pipelineID);
+        if (textureTableSet >= 0)
+        {
+            BindDescriptorSet(commandListID, static_cast<u32>(textureTableSet), _device->_textureTable.GetDescriptorSet(), nullptr);
+        }
     }
 
-    void RendererVK::BeginPipeline(CommandListID commandListID, GraphicsPipelineID pipelineID)
+    void RendererVK::SetScissorRect(CommandListID commandListID, ScissorRect scissorRect)
     {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
+        VkRect2D scissor = {};
+        scissor.offset = { scissorRect.left, scissorRect.top };
+        scissor.extent = { static_cast<u32>(scissorRect.right - scissorRect.left), static_cast<u32>(scissorRect.bottom - scissorRect.top) };
+
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        if (memcmp(&boundState.scissor, &scissor, sizeof(VkRect2D)) == 0)
+        {
+            boundState.numSkippedBinds++;
+            return;
+        }
+
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        GraphicsPipelineDesc pipelineDesc = _pipelineHandler->GetDescriptor(pipelineID);
-        VkPipeline pipeline = _pipelineHandler->GetPipeline(pipelineID);
-        VkRenderPass renderPass = _pipelineHandler->GetRenderPass(pipelineID);
-        VkFramebuffer frameBuffer = _pipelineHandler->GetFramebuffer(pipelineID);
+        boundState.scissor = scissor;
+        boundState.numEmittedBinds++;
+    }
 
-        if (_renderPassOpenCount != 0)
+    void RendererVK::SetViewport(CommandListID commandListID, Viewport viewport)
+    {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
         {
-            NC_LOG_FATAL("You need to match your BeginPipeline calls with a EndPipeline call before beginning another pipeline!");
+            return;
         }
-        _renderPassOpenCount++;
 
-        // Set up renderpass
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = frameBuffer;
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = { static_cast<u32>(pipelineDesc.states.viewport.width), static_cast<u32>(pipelineDesc.states.viewport.height) };
+        VkViewport vkViewport = {};
+        vkViewport.x = viewport.topLeftX;
+        vkViewport.y = viewport.topLeftY;
+        vkViewport.width = viewport.width;
+        vkViewport.height = viewport.height;
+        vkViewport.minDepth = viewport.minDepth;
+        vkViewport.maxDepth = viewport.maxDepth;
 
-        // Start renderpass
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        if (memcmp(&boundState.viewport, &vkViewport, sizeof(VkViewport)) == 0)
+        {
+            boundState.numSkippedBinds++;
+            return;
+        }
 
-        // Bind pipeline
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        vkCmdSetViewport(commandBuffer, 0, 1, &vkViewport);
 
-        _commandListHandler->SetBoundGraphicsPipeline(commandListID, pipelineID);
+        boundState.viewport = vkViewport;
+        boundState.numEmittedBinds++;
     }
 
-    void RendererVK::EndPipeline(CommandListID commandListID, GraphicsPipelineID /*pipelineID*/)
+    void RendererVK::BindPipeline(CommandListID commandListID, VkPipelineBindPoint bindPoint, VkPipeline pipeline, VkPipelineLayout pipelineLayout)
     {
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        Backend::BindPointStateVK& bindPointState = boundState.bindPoints[bindPoint];
+        boundState.bindPoint = bindPoint;
+
+        if (bindPointState.pipeline == pipeline)
+        {
+            boundState.numSkippedBinds++;
+            return;
+        }
+
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
 
-        if (_renderPassOpenCount <= 0)
+        bindPointState.pipeline = pipeline;
+        boundState.numEmittedBinds++;
+
+        // Sets bound through another layout might not be compatible with this one, so we can't count on them still being bound
+        if (bindPointState.pipelineLayout != pipelineLayout)
         {
-            NC_LOG_FATAL("You tried to call EndPipeline without first calling BeginPipeline!");
+            for (u32 i = 0; i < Backend::BindPointStateVK::MAX_DESCRIPTOR_SETS; i++)
+            {
+                bindPointState.descriptorSets[i] = VK_NULL_HANDLE;
+            }
+            bindPointState.pipelineLayout = pipelineLayout;
         }
-        _renderPassOpenCount--;
+    }
 
-        vkCmdEndRenderPass(commandBuffer);
+    VkDescriptorSetLayout RendererVK::GetBoundDescriptorSetLayout(CommandListID commandListID, u32 slot)
+    {
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+
+        if (boundState.bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+        {
+            return _pipelineHandler->GetDescriptorSetLayout(_commandListHandler->GetBoundComputePipeline(commandListID), slot);
+        }
+
+        return _pipelineHandler->GetDescriptorSetLayout(_commandListHandler->GetBoundGraphicsPipeline(commandListID), slot);
     }
 
-    void RendererVK::SetPipeline(CommandListID /*commandListID*/, ComputePipelineID /*pipelineID*/)
+    void RendererVK::BindDescriptorSet(CommandListID commandListID, u32 slot, VkDescriptorSet descriptorSet, const u32* dynamicOffset)
     {
-        
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        Backend::BindPointStateVK& bindPointState = boundState.bindPoints[boundState.bindPoint];
+
+        // Lets make sure we can shadow this slot
+        assert(slot < Backend::BindPointStateVK::MAX_DESCRIPTOR_SETS);
+
+        u32 offset = (dynamicOffset != nullptr) ? *dynamicOffset : 0;
+        if (bindPointState.descriptorSets[slot] == descriptorSet && bindPointState.dynamicOffsets[slot] == offset)
+        {
+            boundState.numSkippedBinds++;
+            return;
+        }
+
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+        vkCmdBindDescriptorSets(commandBuffer, boundState.bindPoint, bindPointState.pipelineLayout, slot, 1, &descriptorSet, (dynamicOffset != nullptr) ? 1 : 0, dynamicOffset);
+
+        bindPointState.descriptorSets[slot] = descriptorSet;
+        bindPointState.dynamicOffsets[slot] = offset;
+        boundState.numEmittedBinds++;
     }
 
-    void RendererVK::SetScissorRect(CommandListID /*commandListID*/, ScissorRect /*scissorRect*/)
+    void RendererVK::BindModelBuffers(CommandListID commandListID, ModelID modelID)
     {
-        
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+
+        // Bind vertex buffer
+        VkBuffer vertexBuffer = _modelHandler->GetVertexBuffer(modelID);
+        if (boundState.vertexBuffer != vertexBuffer)
+        {
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, offsets);
+
+            boundState.vertexBuffer = vertexBuffer;
+            boundState.numEmittedBinds++;
+        }
+        else
+        {
+            boundState.numSkippedBinds++;
+        }
+
+        // Bind index buffer
+        VkBuffer indexBuffer = _modelHandler->GetIndexBuffer(modelID);
+        if (boundState.indexBuffer != indexBuffer)
+        {
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+            boundState.indexBuffer = indexBuffer;
+            boundState.numEmittedBinds++;
+        }
+        else
+        {
+            boundState.numSkippedBinds++;
+        }
     }
 
-    void RendererVK::SetViewport(CommandListID /*commandListID*/, Viewport /*viewport*/)
+    void RendererVK::CountBinds(CommandListID commandListID)
     {
-        
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        _numEmittedBinds += boundState.numEmittedBinds;
+        _numSkippedBinds += boundState.numSkippedBinds;
     }
 
-    void RendererVK::SetTextureSampler(CommandListID commandListID, u32 slot, TextureID textureID, SamplerID samplerID)
+    void RendererVK::PushConstant(CommandListID commandListID, void* data, u32 offset, u32 size)
     {
+        if (_commandListHandler->GetSkipPipeline(commandListID))
+        {
+            return;
+        }
+
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
-        GraphicsPipelineID graphicsPipelineID = _commandListHandler->GetBoundGraphicsPipeline(commandListID);
-        VkPipelineLayout pipelineLayout = _pipelineHandler->GetPipelineLayout(graphicsPipelineID);
+        Backend::BoundStateVK& boundState = _commandListHandler->GetBoundState(commandListID);
+        VkPipelineLayout pipelineLayout = boundState.bindPoints[boundState.bindPoint].pipelineLayout;
 
-        VkDescriptorSet combinedSamplerDescriptor = _samplerHandler->GetCombinedSampler(_device, _textureHandler, _pipelineHandler, samplerID, slot, textureID, graphicsPipelineID);
+        // Lets make sure the bound pipeline has room for this
+        u32 pushConstantSize = (boundState.bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) ? _pipelineHandler->GetPushConstantSize(_commandListHandler->GetBoundComputePipeline(commandListID)) : _pipelineHandler->GetPushConstantSize(_commandListHandler->GetBoundGraphicsPipeline(commandListID));
+        assert(offset + size <= pushConstantSize);
 
-        // Bind descriptor set
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, slot, 1, &combinedSamplerDescriptor, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_ALL, offset, size, data);
+    }
+
+    void RendererVK::ImageBarriers(CommandListID commandListID, const ImageBarrier* barriers, u32 numBarriers)
+    {
+        // Layout transitions can't happen inside a render pass, and the previous pass might still have clears to do before its images change state
+        EndRenderPass(commandListID);
+        FlushPendingClears(commandListID);
+
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+
+        // All barriers in front of a pass go into one vkCmdPipelineBarrier
+        std::vector<VkImageMemoryBarrier> imageBarriers(numBarriers);
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+
+        for (u32 i = 0; i < numBarriers; i++)
+        {
+            const ImageBarrier& barrier = barriers[i];
+            VkImageMemoryBarrier& imageBarrier = imageBarriers[i];
+
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = Backend::BarrierUtilVK::GetAccessMask(barrier.before);
+            imageBarrier.dstAccessMask = Backend::BarrierUtilVK::GetAccessMask(barrier.after);
+            imageBarrier.oldLayout = Backend::BarrierUtilVK::GetLayout(barrier.before);
+            imageBarrier.newLayout = Backend::BarrierUtilVK::GetLayout(barrier.after);
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+            if (barrier.image != ImageID::Invalid())
+            {
+                imageBarrier.image = _imageHandler->GetImage(barrier.image);
+                imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1 }; // The RenderGraph tracks images as a whole, mips included
+            }
+            else
+            {
+                imageBarrier.image = _imageHandler->GetImage(barrier.depthImage);
+                imageBarrier.subresourceRange = { Backend::BarrierUtilVK::GetAspectMask(_imageHandler->GetDescriptor(barrier.depthImage).format), 0, 1, 0, 1 };
+            }
+
+            srcStages |= Backend::BarrierUtilVK::GetStageMask(barrier.before, barrier.beforeStages);
+            dstStages |= Backend::BarrierUtilVK::GetStageMask(barrier.after, barrier.afterStages);
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, numBarriers, imageBarriers.data());
+    }
+
+    void RendererVK::BufferBarriers(CommandListID commandListID, const BufferBarrier* barriers, u32 numBarriers)
+    {
+        // Like the image barriers these can't happen inside a render pass
+        EndRenderPass(commandListID);
+
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+
+        std::vector<VkBufferMemoryBarrier> bufferBarriers(numBarriers);
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+
+        for (u32 i = 0; i < numBarriers; i++)
+        {
+            const BufferBarrier& barrier = barriers[i];
+            VkBufferMemoryBarrier& bufferBarrier = bufferBarriers[i];
+
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.srcAccessMask = Backend::BarrierUtilVK::GetAccessMask(barrier.before);
+            bufferBarrier.dstAccessMask = Backend::BarrierUtilVK::GetAccessMask(barrier.after);
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = _bufferHandler->GetBuffer(_device, barrier.buffer);
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+
+            srcStages |= Backend::BarrierUtilVK::GetStageMask(barrier.before, barrier.beforeStages);
+            dstStages |= Backend::BarrierUtilVK::GetStageMask(barrier.after, barrier.afterStages);
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, numBarriers, bufferBarriers.data(), 0, nullptr);
+    }
+
+    void RendererVK::SetAttachmentOps(CommandListID commandListID, const AttachmentOps* ops, u32 numOps)
+    {
+        // Whatever the previous pass in this commandlist didn't use up doesn't apply to this one
+        FlushPendingClears(commandListID);
+
+        _commandListHandler->SetPendingAttachmentOps(commandListID, ops, numOps);
+    }
+
+    void RendererVK::ExecuteCommands(CommandListID commandListID, const CommandChunk* firstChunk)
+    {
+        // RendererVK is final, so the dispatch can call straight into our functions
+        BackendDispatch::Dispatch(this, commandListID, firstChunk);
     }
 
     void RendererVK::Present(Window* window, ImageID imageID)
@@ -347,9 +916,9 @@ namespace Renderer
         vkAcquireNextImageKHR(_device->_device, swapChain->swapChain, UINT64_MAX, swapChain->imageAvailableSemaphores[semaphoreIndex], VK_NULL_HANDLE, &frameIndex);
         _commandListHandler->SetWaitSemaphore(commandListID, swapChain->imageAvailableSemaphores[semaphoreIndex]);
 
-        VkImage image = _imageHandler->GetImage(imageID);
+        // Update SRV descriptor, the set of the current frame isn't used by any submission still in flight since we waited for its fence
+        VkDescriptorSet descriptorSet = swapChain->descriptorSets[_device->GetFrameIndex()];
 
-        // Update SRV descriptor
         VkDescriptorImageInfo imageInfo = {};
         imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         imageInfo.imageView = _imageHandler->GetColorView(imageID);
@@ -357,7 +926,7 @@ namespace Renderer
 
         VkWriteDescriptorSet descriptorWrite = {};
         descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = swapChain->descriptorSet;
+        descriptorWrite.dstSet = descriptorSet;
         descriptorWrite.dstBinding = 0;
         descriptorWrite.dstArrayElement = 0;
         descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -380,30 +949,29 @@ namespace Renderer
         renderPassInfo.clearValueCount = 1;
         renderPassInfo.pClearValues = &clearColor;
 
-        // Transition image from GENERAL to SHADER_READ_ONLY_OPTIMAL
-        _device->TransitionImageLayout(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-       
+        // The RenderGraph leaves the image in SHADER_READ_ONLY_OPTIMAL after its last pass, so it can be sampled as is
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
        
         // Bind pipeline and descriptors and render
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, swapChain->pipeline);
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, swapChain->pipelineLayout, 0, 1, &swapChain->descriptorSet, 0, nullptr);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, swapChain->pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 
         vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
         vkCmdEndRenderPass(commandBuffer);
 
-        // Transition image from SHADER_READ_ONLY_OPTIMAL to GENERAL
-        _device->TransitionImageLayout(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
         PopMarker(commandListID);
 
+        // This is the last submit of the frame, so it signals both the semaphore we present on and the fence of the frame
+        _commandListHandler->SetSignalSemaphore(commandListID, swapChain->renderFinishedSemaphores[semaphoreIndex]);
+        _commandListHandler->SetSignalFence(commandListID, _commandListHandler->GetFrameFence(_device->GetFrameIndex()));
         _commandListHandler->EndCommandList(_device, commandListID);
 
         // Present
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        presentInfo.waitSemaphoreCount = 0;
-        presentInfo.pWaitSemaphores = VK_NULL_HANDLE;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &swapChain->renderFinishedSemaphores[semaphoreIndex];
 
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = &swapChain->swapChain;
@@ -411,10 +979,25 @@ namespace Renderer
         presentInfo.pResults = nullptr; // Optional
 
         vkQueuePresentKHR(_device->_presentQueue, &presentInfo);
-        vkQueueWaitIdle(_device->_presentQueue);
 
         // Flip frameIndex between 0 and 1
         swapChain->frameIndex = !swapChain->frameIndex;
+
+        // Move on to the next frame, this waits until the GPU is done with the last frame that used the same index
+        _device->EndFrame();
+        _commandListHandler->FlipFrame(_device, _device->GetFrameIndex());
+        _device->_constantBufferRing.Reset(_device->GetFrameIndex());
+
+        _numSkippedDrawsLastFrame = _numSkippedDraws.exchange(0);
+        _numEmittedBindsLastFrame = _numEmittedBinds.exchange(0);
+        _numSkippedBindsLastFrame = _numSkippedBinds.exchange(0);
+
+        // Pipelines compiled while playing would otherwise only reach the disk if we get to shut down cleanly
+        if (++_numFramesSinceCacheSave >= PIPELINE_CACHE_SAVE_INTERVAL)
+        {
+            _device->_pipelineCache.Save();
+            _numFramesSinceCacheSave = 0;
+        }
     }
 
     void RendererVK::Present(Window* /*window*/, DepthImageID /*image*/)
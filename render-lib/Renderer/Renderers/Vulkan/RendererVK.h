@@ -1,5 +1,9 @@
 #pragma once
 #include "../../Renderer.h"
+#include <atomic>
+#include <mutex>
+#include <taskflow/taskflow.hpp>
+#include <vulkan/vulkan.h>
 
 namespace Renderer
 {
@@ -13,12 +17,13 @@ namespace Renderer
         class PipelineHandlerVK;
         class CommandListHandlerVK;
         class SamplerHandlerVK;
+        class BufferHandlerVK;
     }
     
-    class RendererVK : public Renderer
+    class RendererVK final : public Renderer
     {
     public:
-        RendererVK();
+        RendererVK(tf::Taskflow* taskflow); // Pipelines get compiled on the workers of taskflow, so we don't start a thread pool of our own
 
         void InitWindow(Window* window) override;
         void Deinit() override;
@@ -31,12 +36,24 @@ namespace Renderer
 
         GraphicsPipelineID CreatePipeline(GraphicsPipelineDesc& desc) override;
         ComputePipelineID CreatePipeline(ComputePipelineDesc& desc) override;
+        void WaitForPipelines() override;
+        u32 GetNumSkippedDraws() override { return _numSkippedDrawsLastFrame; }
+        u32 GetNumEmittedBinds() override { return _numEmittedBindsLastFrame; }
+        u32 GetNumSkippedBinds() override { return _numSkippedBindsLastFrame; }
+        void LogMemoryStats() override;
 
         ModelID CreatePrimitiveModel(PrimitiveModelDesc& desc) override;
         void UpdatePrimitiveModel(ModelID model, PrimitiveModelDesc& desc) override;
+        const AABB& GetModelBounds(ModelID model) override;
+        u32 GetModelNumLODs(ModelID model) override;
+        const ModelLOD& GetModelLOD(ModelID model, u32 lod) override;
+        u32 GetModelGeometryBlock(ModelID model) override;
 
         TextureID CreateDataTexture(DataTextureDesc& desc) override;
 
+        BufferID CreateBuffer(BufferDesc& desc) override;
+        void UpdateBuffer(BufferID buffer, const void* data, size_t offset, size_t size) override;
+
         // Loading
         ModelID LoadModel(ModelDesc& desc) override;
         TextureID LoadTexture(TextureDesc& desc) override;
@@ -48,18 +65,30 @@ namespace Renderer
         // Command List Functions
         CommandListID BeginCommandList() override;
         void EndCommandList(CommandListID commandListID) override;
+        void EndCommandLists(CommandListID* commandListIDs, u32 numCommandLists) override;
         void Clear(CommandListID commandListID, ImageID image, Color color) override;
         void Clear(CommandListID commandListID, DepthImageID image, DepthClearFlags clearFlags, f32 depth, u8 stencil) override;
         void Draw(CommandListID commandListID, ModelID model) override;
+        void DrawInstanced(CommandListID commandListID, ModelID model, u32 lod, u32 numInstances, u32 firstInstance) override;
+        void DrawInstancedIndirect(CommandListID commandListID, ModelID model, BufferID argumentBuffer, u32 argumentOffset, u32 drawCount) override;
+        void Dispatch(CommandListID commandListID, u32 threadGroupCountX, u32 threadGroupCountY, u32 threadGroupCountZ) override;
         void PopMarker(CommandListID commandListID) override;
         void PushMarker(CommandListID commandListID, Color color, std::string name) override;
-        void SetConstantBuffer(CommandListID commandListID, u32 slot, void* gpuResource) override;
+        void SetConstantBuffer(CommandListID commandListID, u32 slot, void* gpuResource, u32 offset) override;
+        void SetStorageBuffer(CommandListID commandListID, u32 slot, BufferID buffer) override;
+        void SetStorageImage(CommandListID commandListID, u32 slot, ImageID image, u32 mipLevel) override;
+        void SetSampledImage(CommandListID commandListID, u32 slot, ImageID image) override;
+        void SetSampledImage(CommandListID commandListID, u32 slot, DepthImageID image) override;
         void BeginPipeline(CommandListID commandListID, GraphicsPipelineID pipeline) override;
         void EndPipeline(CommandListID commandListID, GraphicsPipelineID pipeline) override;
         void SetPipeline(CommandListID commandListID, ComputePipelineID pipeline) override;
         void SetScissorRect(CommandListID commandListID, ScissorRect scissorRect) override;
         void SetViewport(CommandListID commandListID, Viewport viewport) override;
-        void SetTextureSampler(CommandListID commandListID, u32 slot, TextureID textureID, SamplerID samplerID) override;
+        void PushConstant(CommandListID commandListID, void* data, u32 offset, u32 size) override;
+        void ImageBarriers(CommandListID commandListID, const ImageBarrier* barriers, u32 numBarriers) override;
+        void BufferBarriers(CommandListID commandListID, const BufferBarrier* barriers, u32 numBarriers) override;
+        void SetAttachmentOps(CommandListID commandListID, const AttachmentOps* ops, u32 numOps) override;
+        void ExecuteCommands(CommandListID commandListID, const CommandChunk* firstChunk) override;
 
         // Non-commandlist based present functions
         void Present(Window* window, ImageID image) override;
@@ -67,6 +96,25 @@ namespace Renderer
         
     protected:
         Backend::ConstantBufferBackend* CreateConstantBufferBackend(size_t size) override;
+        GraphicsPipelineID QueuePipelineCompile(GraphicsPipelineDesc& desc) override;
+
+        ImageID CreateTransientImage(ImageDesc& desc) override;
+        DepthImageID CreateTransientDepthImage(DepthImageDesc& desc) override;
+        void AllocateTransientImages(const TransientImageLifetime* lifetimes, u32 numLifetimes) override;
+        void ReleaseTransientImages() override;
+
+    private:
+        // Ends the render pass EndPipeline left open, anything that can't be recorded inside a render pass calls this first
+        void EndRenderPass(CommandListID commandListID);
+        // Clears the attachments the pass wanted cleared but never began a render pass on
+        void FlushPendingClears(CommandListID commandListID);
+
+        // These skip the vkCmd call if the commandlist already has the same thing bound
+        void BindPipeline(CommandListID commandListID, VkPipelineBindPoint bindPoint, VkPipeline pipeline, VkPipelineLayout pipelineLayout);
+        void BindDescriptorSet(CommandListID commandListID, u32 slot, VkDescriptorSet descriptorSet, const u32* dynamicOffset); // Binds through the layout of the pipeline that was bound last, graphics or compute
+        void BindModelBuffers(CommandListID commandListID, ModelID modelID);
+        VkDescriptorSetLayout GetBoundDescriptorSetLayout(CommandListID commandListID, u32 slot); // The layout of a set of the pipeline that was bound last, graphics or compute
+        void CountBinds(CommandListID commandListID); // Adds the binds of a commandlist that is about to end to this frame's counters
 
     private:
         Backend::RenderDeviceVK* _device = nullptr;
@@ -77,7 +125,19 @@ namespace Renderer
         Backend::PipelineHandlerVK* _pipelineHandler = nullptr;
         Backend::CommandListHandlerVK* _commandListHandler = nullptr;
         Backend::SamplerHandlerVK* _samplerHandler = nullptr;
+        Backend::BufferHandlerVK* _bufferHandler = nullptr;
+
+        tf::Taskflow* _pipelineTaskflow = nullptr; // Precompiled and async compiled pipelines get compiled on this
+        std::mutex _pipelineTaskflowMutex;
+
+        std::atomic<u32> _numSkippedDraws { 0 };
+        u32 _numSkippedDrawsLastFrame = 0;
+
+        std::atomic<u32> _numEmittedBinds { 0 };
+        std::atomic<u32> _numSkippedBinds { 0 };
+        u32 _numEmittedBindsLastFrame = 0;
+        u32 _numSkippedBindsLastFrame = 0;
 
-        i8 _renderPassOpenCount = 0;
+        u32 _numFramesSinceCacheSave = 0;
     };
 }
@@ -0,0 +1,59 @@
+#pragma once
+#include <NovusTypes.h>
+#include "Descriptors/ImageDesc.h"
+#include "Descriptors/DepthImageDesc.h"
+#include "Descriptors/BufferDesc.h"
+
+namespace Renderer
+{
+    // How a pass uses an image or buffer, the backend turns these into layouts, access masks and pipeline stages
+    enum ResourceState : u8
+    {
+        RESOURCE_STATE_UNDEFINED, // Transient images before their first use, the contents get discarded
+        RESOURCE_STATE_SHADER_READ, // This is also where permanent images rest between RenderGraphs
+        RESOURCE_STATE_RENDER_TARGET,
+        RESOURCE_STATE_UAV,
+        RESOURCE_STATE_DEPTH_WRITE,
+        RESOURCE_STATE_TRANSFER_DST, // Only used by the backend around clears
+        RESOURCE_STATE_INDIRECT_ARGUMENT // Buffers only, read by indirect draws
+    };
+
+    struct ImageBarrier
+    {
+        ImageID image = ImageID::Invalid(); // Only one of image and depthImage is set
+        DepthImageID depthImage = DepthImageID::Invalid();
+
+        ResourceState before = RESOURCE_STATE_UNDEFINED;
+        ResourceState after = RESOURCE_STATE_UNDEFINED;
+        u8 beforeStages = 0; // RenderGraphBuilder::ShaderStage flags, only used by the shader read and UAV states
+        u8 afterStages = 0;
+    };
+
+    // Buffers have no layouts, so these only order the accesses and make writes visible
+    struct BufferBarrier
+    {
+        BufferID buffer = BufferID::Invalid();
+
+        ResourceState before = RESOURCE_STATE_UNDEFINED; // Undefined means we don't know who wrote it last
+        ResourceState after = RESOURCE_STATE_UNDEFINED;
+        u8 beforeStages = 0; // RenderGraphBuilder::ShaderStage flags, only used by the shader read and UAV states
+        u8 afterStages = 0;
+    };
+
+    enum AttachmentLoadOp : u8
+    {
+        ATTACHMENT_LOAD_OP_LOAD,
+        ATTACHMENT_LOAD_OP_CLEAR, // Clears to ImageDesc::clearColor or the DepthImageDesc clear values
+        ATTACHMENT_LOAD_OP_DONT_CARE
+    };
+
+    // What the first render pass of a pass does with an attachment when it starts and ends, later render passes in the same pass load and store it
+    struct AttachmentOps
+    {
+        ImageID image = ImageID::Invalid(); // Only one of image and depthImage is set
+        DepthImageID depthImage = DepthImageID::Invalid();
+
+        AttachmentLoadOp loadOp = ATTACHMENT_LOAD_OP_LOAD;
+        bool store = true; // Transient images that no later pass uses don't need their contents written back
+    };
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include <NovusTypes.h>
+#include <algorithm>
+#include "Descriptors/GraphicsPipelineDesc.h"
+#include "Descriptors/ModelDesc.h"
+
+namespace Renderer
+{
+    // Draws get sorted by a 64 bit key so that draws sharing state end up next to each other, from the most significant bit:
+    // Opaque:      pass (6) | 0 (1) | pipeline (10) | material (14) | mesh (16) | depth (17)
+    // Translucent: pass (6) | 1 (1) | inverted depth (17) | pipeline (10) | material (14) | mesh (16)
+    // Opaque draws then go front to back within the same state for early-Z, translucent ones go back to front for blending
+    class SortKey
+    {
+    public:
+        // depth is the distance to the camera normalized to [0, 1]
+        static inline u64 Opaque(u8 pass, GraphicsPipelineID pipeline, u16 material, ModelID mesh, f32 depth)
+        {
+            u64 key = GetPassBits(pass, false);
+            key |= GetStateBits(pipeline, material, mesh) << DEPTH_BITS;
+            key |= QuantizeDepth(depth);
+
+            return key;
+        }
+
+        static inline u64 Translucent(u8 pass, GraphicsPipelineID pipeline, u16 material, ModelID mesh, f32 depth)
+        {
+            u64 key = GetPassBits(pass, true);
+            key |= static_cast<u64>(DEPTH_MASK - QuantizeDepth(depth)) << STATE_BITS;
+            key |= GetStateBits(pipeline, material, mesh);
+
+            return key;
+        }
+
+        // Replaces the depth of a key made by Opaque or Translucent, for keys that get updated every frame as the camera moves
+        static inline u64 WithDepth(u64 key, f32 depth)
+        {
+            bool isTranslucent = (key >> 57) & 1;
+            if (isTranslucent)
+            {
+                key &= ~(static_cast<u64>(DEPTH_MASK) << STATE_BITS);
+                key |= static_cast<u64>(DEPTH_MASK - QuantizeDepth(depth)) << STATE_BITS;
+            }
+            else
+            {
+                key &= ~static_cast<u64>(DEPTH_MASK);
+                key |= QuantizeDepth(depth);
+            }
+
+            return key;
+        }
+
+    private:
+        static inline u64 GetPassBits(u8 pass, bool isTranslucent)
+        {
+            assert(pass < (1 << PASS_BITS)); // There are only 6 bits for the pass
+
+            return (static_cast<u64>(pass) << 58) | (static_cast<u64>(isTranslucent) << 57);
+        }
+
+        static inline u64 GetStateBits(GraphicsPipelineID pipeline, u16 material, ModelID mesh)
+        {
+            u64 pipelineBits = static_cast<GraphicsPipelineID::type>(pipeline) & ((1 << PIPELINE_BITS) - 1);
+            u64 materialBits = material & ((1 << MATERIAL_BITS) - 1);
+            u64 meshBits = static_cast<ModelID::type>(mesh);
+
+            return (pipelineBits << (MATERIAL_BITS + MESH_BITS)) | (materialBits << MESH_BITS) | meshBits;
+        }
+
+        static inline u32 QuantizeDepth(f32 depth)
+        {
+            depth = std::min(std::max(depth, 0.0f), 1.0f);
+            return static_cast<u32>(depth * DEPTH_MASK);
+        }
+
+    private:
+        static const u32 PASS_BITS = 6;
+        static const u32 PIPELINE_BITS = 10;
+        static const u32 MATERIAL_BITS = 14;
+        static const u32 MESH_BITS = 16;
+        static const u32 STATE_BITS = PIPELINE_BITS + MATERIAL_BITS + MESH_BITS;
+        static const u32 DEPTH_BITS = 17;
+        static const u32 DEPTH_MASK = (1 << DEPTH_BITS) - 1;
+    };
+}
\ No newline at end of file
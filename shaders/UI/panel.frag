@@ -1,13 +1,21 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(set = 0, binding = 0) uniform SharedUniformBufferObject 
 {
     vec4 color;
 } panelUbo;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
+layout(set = 1, binding = 0) uniform texture2D _textures[];
+layout(set = 1, binding = 1) uniform sampler _samplers[];
+
+layout(push_constant) uniform PushConstants
+{
+    uint textureIndex;
+    uint samplerIndex;
+} pushConstants;
 
 layout(location = 0) in vec2 fragTexCoord;
 
@@ -15,6 +23,6 @@ layout(location = 0) out vec4 outColor;
 
 void main() 
 {
-	outColor = texture(texSampler, fragTexCoord);
+	outColor = texture(sampler2D(_textures[pushConstants.textureIndex], _samplers[pushConstants.samplerIndex]), fragTexCoord);
 	outColor *= panelUbo.color;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(set = 0, binding = 0) uniform SharedUniformBufferObject 
 {
@@ -9,7 +10,14 @@ layout(set = 0, binding = 0) uniform SharedUniformBufferObject
 	float outlineWidth;
 } textUbo;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
+layout(set = 1, binding = 0) uniform texture2D _textures[];
+layout(set = 1, binding = 1) uniform sampler _samplers[];
+
+layout(push_constant) uniform PushConstants
+{
+    uint textureIndex;
+    uint samplerIndex;
+} pushConstants;
 
 layout(location = 0) in vec2 fragTexCoord;
 
@@ -17,7 +25,7 @@ layout(location = 0) out vec4 outColor;
 
 void main() 
 {
-	float distance = texture(texSampler, fragTexCoord).r;
+	float distance = texture(sampler2D(_textures[pushConstants.textureIndex], _samplers[pushConstants.samplerIndex]), fragTexCoord).r;
 	float smoothWidth = fwidth(distance);
 	float alpha = smoothstep(0.5 - smoothWidth, 0.5 + smoothWidth, distance);
 	vec3 rgb = vec3(alpha) * textUbo.textColor.rgb;
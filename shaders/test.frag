@@ -1,15 +1,24 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(set = 2, binding = 0) uniform sampler2D texSampler;
+layout(set = 2, binding = 0) uniform texture2D _textures[];
+layout(set = 2, binding = 1) uniform sampler _samplers[];
+
+layout(push_constant) uniform PushConstants
+{
+    uint textureIndex;
+    uint samplerIndex;
+} pushConstants;
 
 layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec4 fragColorMultiplier;
 
 layout(location = 0) out vec4 outColor;
 
 void main() 
 {
     //outColor = vec4(fragTexCoord, 0.0, 1.0); // Debug Texcoords
-	outColor = texture(texSampler, fragTexCoord);
+	outColor = texture(sampler2D(_textures[pushConstants.textureIndex], _samplers[pushConstants.samplerIndex]), fragTexCoord) * fragColorMultiplier;
 }
\ No newline at end of file
@@ -7,20 +7,36 @@ layout(set = 0, binding = 0) uniform SharedUniformBufferObject
     mat4 proj;
 } sharedUbo;
 
-layout(set = 1, binding = 0) uniform ModelUniformBufferObject 
+const uint MAX_INSTANCES = 16384; // Has to match MAX_INSTANCES in ClientRenderer
+
+// Three rows of the model matrix per instance followed by one packed RGBA8 color multiplier per instance
+layout(set = 1, binding = 0) readonly buffer InstanceBuffer
+{
+    vec4 transforms[MAX_INSTANCES * 3];
+    uint colors[];
+} instanceBuffer;
+
+// The instances that survived frustum culling, each batch packs its visible instances starting at its offset in the instance buffer
+layout(set = 3, binding = 0) readonly buffer VisibleInstanceBuffer
 {
-	vec4 colorMultiplier;
-    mat4 model;
-} modelUbo;
+    uint visibleInstances[];
+} visibleInstanceBuffer;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColorMultiplier;
 
 void main() 
 {
-    gl_Position = sharedUbo.proj * sharedUbo.view * modelUbo.model * vec4(inPosition, 1.0);
+    uint instanceIndex = visibleInstanceBuffer.visibleInstances[gl_InstanceIndex];
+    uint transformIndex = instanceIndex * 3;
+    vec4 position = vec4(inPosition, 1.0);
+    vec4 worldPosition = vec4(dot(instanceBuffer.transforms[transformIndex], position), dot(instanceBuffer.transforms[transformIndex + 1], position), dot(instanceBuffer.transforms[transformIndex + 2], position), 1.0);
+
+    gl_Position = sharedUbo.proj * sharedUbo.view * worldPosition;
 	fragTexCoord = inTexCoord;
+    fragColorMultiplier = unpackUnorm4x8(instanceBuffer.colors[instanceIndex]);
 }
\ No newline at end of file